@@ -115,6 +115,12 @@ typedef struct svn_memcache_t svn_memcache_t;
  */
 typedef struct svn_membuffer_t svn_membuffer_t;
 
+/**
+ * An opaque structure representing a persistent, memory-mapped cache file
+ * that can serve as second-level cache behind other caches.
+ */
+typedef struct svn_cache__disk_t svn_cache__disk_t;
+
 /**
  * Opaque type for an in-memory cache.
  */
@@ -270,6 +276,56 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
                                      apr_pool_t *result_pool,
                                      apr_pool_t *scratch_pool);
 
+/**
+ * Set @a *disk_p to the persistent cache file at the local absolute
+ * @a path.  If the file does not exist yet, create it with all of its
+ * @a size bytes, including its index, allocated on disk.  Since other
+ * processes may have the file mapped, an existing file is never resized
+ * or re-initialized: if it has been created with a different size or by
+ * an incompatible version, raise #SVN_ERR_MALFORMED_FILE instead.
+ *
+ * Cache files are process-global objects.  Opening the same @a path again
+ * returns the same object; doing so with a different @a size raises
+ * #SVN_ERR_MALFORMED_FILE.  The file may be shared with other processes as
+ * well.  Use @a scratch_pool for temporary allocations.
+ *
+ * Raises #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support
+ * memory-mapped files.
+ */
+svn_error_t *
+svn_cache__disk_open(svn_cache__disk_t **disk_p,
+                     const char *path,
+                     apr_uint64_t size,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Creates a new cache in @a *cache_p that uses @a l1 as its first-level
+ * cache and @a disk as its second-level cache.  Items written to the
+ * cache get written to both.  Items found in @a disk only will be copied
+ * to @a l1.  Since @a disk survives process restarts, only immutable data
+ * should be cached this way.
+ *
+ * @a serialize_func, @a deserialize_func and @a klen must match those of
+ * @a l1.  @a prefix is used to differentiate this cache from other caches
+ * in @a disk.  It must be stable across process restarts.  @a *cache_p
+ * will be allocated in @a result_pool.
+ *
+ * If @a deserialize_func is NULL, then the data is returned as an
+ * svn_stringbuf_t; if @a serialize_func is NULL, then the data is
+ * assumed to be an svn_stringbuf_t.
+ *
+ * These caches are thread-safe if @a l1 is.
+ */
+svn_error_t *
+svn_cache__create_disk_tier(svn_cache__t **cache_p,
+                            svn_cache__t *l1,
+                            svn_cache__disk_t *disk,
+                            svn_cache__serialize_func_t serialize_func,
+                            svn_cache__deserialize_func_t deserialize_func,
+                            apr_ssize_t klen,
+                            const char *prefix,
+                            apr_pool_t *result_pool);
+
 /**
  * Creates a new membuffer cache object in @a *cache. It will contain
  * up to @a total_size bytes of data, using @a directory_size bytes
@@ -299,6 +355,18 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
  * (no data being written to the cache) if some reader or another writer
  * currently holds the segment lock.
  *
+ * If @a shared is set, the cache contents will be placed in anonymous
+ * shared memory and every segment will be protected by a process-shared
+ * lock.  Child processes forked after this call will then access the same
+ * cache as their parent and siblings.  In that mode, the full keys are
+ * always stored in the cache and @a thread_safe is implied.  Return
+ * #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support it.
+ * If a process dies while holding a segment lock, the next process to
+ * acquire that lock empties the segment.  This relies on APR releasing
+ * the lock of a dead process, which it does for SysV semaphores and for
+ * robust pthread mutexes.  Where neither is available, such a crash
+ * blocks the cache for all other processes.
+ *
  * Allocations will be made in @a result_pool, in particular the data buffers.
  */
 svn_error_t *
@@ -308,6 +376,7 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   apr_size_t segment_count,
                                   svn_boolean_t thread_safe,
                                   svn_boolean_t allow_blocking_writes,
+                                  svn_boolean_t shared,
                                   apr_pool_t *result_pool);
 
 /**
@@ -554,6 +623,19 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * Request the process-global membuffer cache to be placed in shared
+ * memory if @a shared is set, such that processes forked after its
+ * creation all use the same cache.  Falls back to a process-local cache
+ * if the platform does not support that.  This must be called before the
+ * first call to svn_cache__get_global_membuffer_cache() to have any
+ * effect.
+ *
+ * @since New in 1.11.
+ */
+void
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
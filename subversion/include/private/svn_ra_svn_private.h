@@ -146,6 +146,32 @@ svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn);
 
+/** Low-level I/O statistics of an ra_svn connection.  Each "call" is
+ * one read or write request to the underlying socket or stream, i.e.
+ * usually one syscall.
+ */
+typedef struct svn_ra_svn__io_stats_t
+{
+  /** Number of bytes received and the number of reads it took. */
+  apr_uint64_t bytes_read;
+  apr_uint64_t read_calls;
+
+  /** Number of bytes sent and the number of writes it took. */
+  apr_uint64_t bytes_written;
+  apr_uint64_t write_calls;
+
+  /** Current sizes of the connection's read and write buffers. */
+  apr_size_t read_buf_size;
+  apr_size_t write_buf_size;
+} svn_ra_svn__io_stats_t;
+
+/**
+ * Copy the I/O statistics collected for @a conn so far into @a *stats.
+ */
+void
+svn_ra_svn__get_io_stats(svn_ra_svn__io_stats_t *stats,
+                         svn_ra_svn_conn_t *conn);
+
 /**
  * @defgroup ra_svn_deprecated ra_svn low-level functions
  * @{
@@ -225,6 +251,17 @@ svn_error_t *
 svn_ra_svn__flush(svn_ra_svn_conn_t *conn,
                   apr_pool_t *pool);
 
+/** Write the @a len bytes at @a data to @a conn as they are.  @a data
+ * must already be in ra_svn wire format, e.g. a response previously
+ * captured from another connection object.  Use @a pool for temporary
+ * allocations.  Writes will be buffered until the next read or flush.
+ */
+svn_error_t *
+svn_ra_svn__write_raw(svn_ra_svn_conn_t *conn,
+                      apr_pool_t *pool,
+                      const char *data,
+                      apr_size_t len);
+
 /** Write a tuple, using a printf-like interface.
  *
  * The format string @a fmt may contain:
@@ -370,7 +407,8 @@ svn_ra_svn__has_command(svn_boolean_t *has_command,
  * the parameters of the command, and @a baton.  @a *terminate will be
  * set if either @a error_on_disconnect is FALSE and the connection got
  * closed, or if the command being handled has the "terminate" flag set
- * in the command table.
+ * in the command table.  I/O buffers of @a conn that have grown while
+ * handling the command return to their initial size afterwards.
  */
 svn_error_t *
 svn_ra_svn__handle_command(svn_boolean_t *terminate,
@@ -771,7 +809,9 @@ svn_ra_svn__write_cmd_get_file(svn_ra_svn_conn_t *conn,
                                svn_boolean_t stream);
 
 /** Send a "update" command over connection @a conn.
- * Use @a pool for allocations.
+ * Use @a pool for allocations.  If @a send_text_deltas is FALSE, ask the
+ * server to omit file contents from the editor drive.  Only servers with
+ * the #SVN_RA_SVN_CAP_SKELETON_UPDATE capability honor that flag.
  *
  * @see #svn_ra_do_update3 for a description.
  */
@@ -783,7 +823,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry);
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t send_text_deltas);
 
 /** Send a "switch" command over connection @a conn.
  * Use @a pool for allocations.
@@ -359,10 +359,10 @@ svn_repos__dump_node_record(svn_stream_t *dump_stream,
  * if a replay-style drive will instead be used, it should be passed
  * as @c NULL.
  *
- * In contrast to the dump editor used inside svn_repos_dump_fs4(), this
+ * In contrast to the dump editor used inside svn_repos_dump_fs5(), this
  * one supports only deltas mode.
  *
- * ### TODO: Unify with the dump editor inside svn_repos_dump_fs4().
+ * ### TODO: Unify with the dump editor inside svn_repos_dump_fs5().
  */
 svn_error_t *
 svn_repos__get_dump_editor(const svn_delta_editor_t **editor,
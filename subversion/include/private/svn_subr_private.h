@@ -591,6 +591,26 @@ svn__decompress_lz4(const void *data, apr_size_t len,
                     svn_stringbuf_t *out,
                     apr_size_t limit);
 
+/* Same as svn__compress_zlib(), but use Zstandard compression.
+ * COMPRESSION_METHOD is passed to zstd as its compression level, i.e.
+ * the SVN__COMPRESSION_ZLIB_* values are valid and map to similar
+ * compression ratios.  Return SVN_ERR_UNSUPPORTED_FEATURE if Subversion
+ * has been built without zstd support.
+ */
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int compression_method);
+
+/* Same as svn__decompress_zlib(), but use Zstandard compression.
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if Subversion has been built without
+ * zstd support.
+ */
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit);
+
 /** @} */
 
 /**
@@ -726,6 +746,35 @@ svn_dso__pool(void);
 /** @} */
 
 
+/**
+ * @defgroup svn_request_window Adaptive request window API
+ * @{
+ */
+
+/* Return the number of requests to keep in flight after WINDOW requests
+ * have been allowed so far and IN_FLIGHT were actually outstanding.
+ * RTT is the average time the recent requests spent in flight and
+ * MIN_RTT the lowest such time observed, i.e. the pure network latency.
+ * MIN_RTT must not exceed RTT.
+ *
+ * The window doubles while requests hardly queue up anywhere and the
+ * current window is actually being used.  It shrinks by a quarter when
+ * more than half of the requests are queued.  The result is limited to
+ * MAX_WINDOW when growing and to MIN_WINDOW when shrinking.  If
+ * MIN_WINDOW exceeds MAX_WINDOW, MAX_WINDOW takes precedence.  If RTT is
+ * not positive, WINDOW is returned unchanged.
+ */
+unsigned int
+svn_request_window__adjust(unsigned int window,
+                           unsigned int in_flight,
+                           apr_interval_time_t rtt,
+                           apr_interval_time_t min_rtt,
+                           unsigned int min_window,
+                           unsigned int max_window);
+
+/** @} */
+
+
 /* Return the xml (expat) version we compiled against. */
 const char *svn_xml__compiled_version(void);
 
@@ -746,6 +795,18 @@ const char *svn_lz4__compiled_version(void);
  */
 int svn_lz4__runtime_version(void);
 
+/* Return TRUE if Subversion has been built with Zstandard support. */
+svn_boolean_t svn_zstd__is_available(void);
+
+/* Return the zstd version we compiled against or NULL if zstd is not
+ * available. */
+const char *svn_zstd__compiled_version(void);
+
+/* Return the zstd version we run against as a composed value:
+ * major * 100 * 100 + minor * 100 + release.  0 if zstd is not available.
+ */
+int svn_zstd__runtime_version(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
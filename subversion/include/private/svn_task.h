@@ -0,0 +1,150 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_task.h
+ * @brief Parallel processing of sequential tasks
+ *
+ * Many long-running operations like verify, dump or pack consist of a
+ * sequence of mostly independent steps, e.g. one per revision or shard.
+ * Their results, however, must be reported in sequence order.
+ *
+ * svn_task__run() splits such an operation into a "process" part that
+ * may be executed by any number of worker threads and an "output" part
+ * that is always executed by the calling thread, strictly in sequence
+ * order.  The number of tasks being processed ahead of the output is
+ * limited, i.e. memory usage does not depend on the total number of
+ * tasks.
+ *
+ * Every worker thread may have a private context object, e.g. its own
+ * svn_fs_t instance, that gets passed to all tasks processed by it.
+ *
+ * Without APR thread support or with a thread count of 1, all tasks
+ * will be processed in the calling thread with the same semantics.
+ */
+
+
+
+#ifndef SVN_TASK_H
+#define SVN_TASK_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+
+/* Callback constructing the *THREAD_CONTEXT for a worker thread.
+ * BATON is the context baton passed to svn_task__run().  Allocate the
+ * context in RESULT_POOL, which remains valid until the worker thread
+ * terminates.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * This may be called from any thread.
+ */
+typedef svn_error_t *
+(*svn_task__thread_context_constructor_t)(void **thread_context,
+                                          void *baton,
+                                          apr_pool_t *result_pool,
+                                          apr_pool_t *scratch_pool);
+
+/* Callback processing the task with number TASK_INDEX.  PROCESS_BATON is
+ * the respective baton passed to svn_task__run() and THREAD_CONTEXT is
+ * the context of the current worker thread.  Return the task result in
+ * *RESULT, allocated in RESULT_POOL.  Use SCRATCH_POOL for temporary
+ * allocations.
+ *
+ * Call CANCEL_FUNC with CANCEL_BATON periodically.  This will also fail
+ * if the operation got aborted due to an error in some other task.
+ *
+ * Errors returned by this function are fatal:  They will be returned by
+ * svn_task__run() after all preceding results have been handed to the
+ * output function.  Recoverable failures should be part of *RESULT.
+ *
+ * This may be called from any thread and in any order.
+ */
+typedef svn_error_t *
+(*svn_task__process_func_t)(void **result,
+                            void *process_baton,
+                            void *thread_context,
+                            apr_int64_t task_index,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Callback receiving the RESULT of the task with number TASK_INDEX.
+ * OUTPUT_BATON is the respective baton passed to svn_task__run().
+ * Use SCRATCH_POOL for temporary allocations.  RESULT will become
+ * invalid after this function returns.
+ *
+ * Returning an error aborts the whole operation.
+ *
+ * This will always be called from the thread that called svn_task__run()
+ * and strictly in order of TASK_INDEX.
+ */
+typedef svn_error_t *
+(*svn_task__output_func_t)(void *result,
+                           void *output_baton,
+                           apr_int64_t task_index,
+                           apr_pool_t *scratch_pool);
+
+/* Process TASK_COUNT tasks numbered 0 to TASK_COUNT-1 using up to
+ * THREAD_COUNT worker threads.
+ *
+ * Each task gets processed by calling PROCESS_FUNC with PROCESS_BATON
+ * and the context of the respective worker thread.  If CONTEXT_CONSTRUCTOR
+ * is not NULL, it will be called with CONTEXT_BATON once per worker thread
+ * to create that context.  Otherwise, the context will be NULL.
+ *
+ * If OUTPUT_FUNC is not NULL, it will be called with OUTPUT_BATON for
+ * each task result, in task order and always in the calling thread.
+ *
+ * Return the first error, in task order, returned by PROCESS_FUNC or
+ * OUTPUT_FUNC.  No further output will be generated after that and all
+ * pending tasks will be canceled.
+ *
+ * CANCEL_FUNC with CANCEL_BATON will be called from the worker threads
+ * as well, i.e. it must be thread-safe.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+svn_error_t *
+svn_task__run(int thread_count,
+              apr_int64_t task_count,
+              svn_task__thread_context_constructor_t context_constructor,
+              void *context_baton,
+              svn_task__process_func_t process_func,
+              void *process_baton,
+              svn_task__output_func_t output_func,
+              void *output_baton,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_TASK_H */
@@ -117,6 +117,12 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_SERF_LOG_COMPONENTS       "serf-log-components"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SERF_LOG_LEVEL            "serf-log-level"
+/** @since New in 1.11. */
+#define SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS       "svn-max-connections"
+/** @since New in 1.11. */
+#define SVN_CONFIG_OPTION_HTTP_HTTP2                "http-http2"
+/** @since New in 1.11. */
+#define SVN_CONFIG_OPTION_HTTP_MAX_STREAMS          "http-max-streams"
 
 
 #define SVN_CONFIG_CATEGORY_CONFIG          "config"
@@ -235,6 +241,10 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_DEFAULT_OPTION_STORE_SSL_CLIENT_CERT_PP_PLAINTEXT \
                                                              SVN_CONFIG_ASK
 #define SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_CONNECTIONS       4
+/** @since New in 1.11. */
+#define SVN_CONFIG_DEFAULT_OPTION_SVN_MAX_CONNECTIONS        4
+/** @since New in 1.11. */
+#define SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_STREAMS           100
 
 /** Read configuration information from the standard sources and merge it
  * into the hash @a *cfg_hash.  If @a config_dir is not NULL it specifies a
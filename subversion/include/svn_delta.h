@@ -69,6 +69,14 @@ extern "C" {
  */
 #define SVN_DELTA_COMPRESSION_LEVEL_DEFAULT 5
 
+/** This is the default number of delta windows that Subversion's
+ * repository and RA layers compress concurrently when writing svndiff
+ * data.  See svn_txdelta_to_svndiff4().
+ *
+ * @since New in 1.11.
+ */
+#define SVN_DELTA_ENCODER_THREADS_DEFAULT 4
+
 /**
  * Get libsvn_delta version information.
  *
@@ -519,11 +527,43 @@ svn_txdelta_apply(svn_stream_t *source,
  * the value to pass as the @a baton argument to @a *handler. The svndiff
  * version is @a svndiff_version. @a compression_level is the zlib
  * compression level from 0 (no compression) and 9 (maximum compression).
+ * @a compression_level is currently ignored if @a svndiff_version is set
+ * to 2.
+ *
+ * @a svndiff_version may be 3 for the Zstandard based svndiff3 format,
+ * in which case @a compression_level is used as the zstd compression
+ * level.  Writing and reading svndiff3 data fails with
+ * #SVN_ERR_UNSUPPORTED_FEATURE if Subversion has been built without
+ * zstd support.
+ *
+ * If @a max_threads is larger than 1, up to that many windows will be
+ * compressed concurrently by worker threads.  The output does not depend
+ * on @a max_threads but the encoded data of a window may only be written
+ * to @a output while handling some later window.  @a output itself is
+ * only ever accessed by the thread calling @a *handler.  @a max_threads
+ * is ignored for svndiff version 0 and if APR does not support threads.
+ * No threads are started for deltas that consist of a single window.
+ *
+ * @since New in 1.11.
+ */
+void
+svn_txdelta_to_svndiff4(svn_txdelta_window_handler_t *handler,
+                        void **handler_baton,
+                        svn_stream_t *output,
+                        int svndiff_version,
+                        int compression_level,
+                        int max_threads,
+                        apr_pool_t *pool);
+
+/** Similar to svn_txdelta_to_svndiff4(), but always compressing the
+ * windows in the calling thread.
  *
  * @since New in 1.7.  Since 1.10, @a svndiff_version can be 2 for the
  * svndiff2 format.  @a compression_level is currently ignored if
  * @a svndiff_version is set to 2.
+ * @deprecated Provided for backward compatibility with the 1.10 API.
  */
+SVN_DEPRECATED
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
                         void **handler_baton,
@@ -560,7 +600,7 @@ svn_txdelta_to_svndiff(svn_stream_t *output,
 
 /** Return a readable generic stream which will produce svndiff-encoded
  * text delta from the delta stream @a txstream.  @a svndiff_version and
- * @a compression_level are same as in svn_txdelta_to_svndiff3().
+ * @a compression_level are same as in svn_txdelta_to_svndiff4().
  *
  * Allocate the stream in @a pool.
  *
@@ -166,6 +166,18 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_LOG_ADDRESSING       "fsfs-log-addressing"
 
+/** Enable / disable memory-mapped access to FSFS pack files.
+ *
+ * If enabled, read-only access to packed shards will be served directly
+ * from a memory mapping of the respective pack file instead of going
+ * through buffered file I/O.  Non-packed revisions and transactions are
+ * not affected.  This option will be ignored on platforms without
+ * memory-mapping support.
+ *
+ * @since New in 1.11.
+ */
+#define SVN_FS_CONFIG_FSFS_MMAP_PACKED          "fsfs-mmap-packed"
+
 /* Note to maintainers: if you add further SVN_FS_CONFIG_FSFS_CACHE_* knobs,
    update fs_fs.c:verify_as_revision_before_current_plus_plus(). */
 
@@ -227,6 +239,42 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_NO_FLUSH_TO_DISK          "no-flush-to-disk"
 
+/** String with a decimal representation of the maximum number of threads
+ * that long-running maintenance operations like svn_fs_verify() or
+ * svn_fs_pack2() may use.
+ * Values of "1" or less mean that everything will be done in the calling
+ * thread, which is also the default.
+ *
+ * Backends may ignore this option.
+ *
+ * @note Using multiple threads requires the process-wide membuffer cache
+ * to be thread-safe, i.e. #svn_cache_config_t.single_threaded must not
+ * be set.
+ *
+ * @since New in 1.11.
+ */
+#define SVN_FS_CONFIG_PARALLEL_JOBS             "parallel-jobs"
+
+/** Enable group commit.  If set to "true", concurrent commits to the same
+ * repository from within the same process will be queued up while one of
+ * them holds the repository write lock.  The lock holder will then commit
+ * all queued transactions as consecutive revisions, merging each of them
+ * with its predecessors as required, and make them durable using a single
+ * combined disk flush before making the new revisions visible.
+ *
+ * Backends may ignore this option.  The default is "false", unless
+ * enabled in the "commits" section of the repository's FSFS / FSX
+ * configuration file, which this option overrides.  Commits
+ * are not grouped while memcached or a persistent disk cache is in use.
+ *
+ * @note Queued commits get processed by another thread, so the
+ * process-wide membuffer cache must be thread-safe, i.e.
+ * #svn_cache_config_t.single_threaded must not be set.
+ *
+ * @since New in 1.11.
+ */
+#define SVN_FS_CONFIG_GROUP_COMMIT              "group-commit"
+
 /** @} */
 
 
@@ -543,6 +591,10 @@ typedef void (*svn_fs_hotcopy_notify_t)(void *baton,
  * incremental hotcopy is not implemented, raise
  * #SVN_ERR_UNSUPPORTED_FEATURE.
  *
+ * @a fs_config is passed to both filesystem objects and may be @c NULL.
+ * With FSFS, #SVN_FS_CONFIG_PARALLEL_JOBS controls the number of threads
+ * used to copy the revision and revprop shards.
+ *
  * For each revision range copied, @a notify_func will be called with
  * staring and ending revision numbers (both inclusive and not necessarily
  * different) and with the @a notify_baton.  Currently, this notification
@@ -555,8 +607,27 @@ typedef void (*svn_fs_hotcopy_notify_t)(void *baton,
  *
  * Use @a scratch_pool for temporary allocations.
  *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_fs_hotcopy4(const char *src_path,
+                const char *dest_path,
+                svn_boolean_t clean,
+                svn_boolean_t incremental,
+                apr_hash_t *fs_config,
+                svn_fs_hotcopy_notify_t notify_func,
+                void *notify_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_fs_hotcopy4(), but with @a fs_config always passed as @c NULL.
+ *
+ * @deprecated Provided for backward compatibility with the 1.10 API.
  * @since New in 1.9.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_hotcopy3(const char *src_path,
                 const char *dest_path,
@@ -3301,11 +3372,34 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
                                              apr_pool_t *pool);
 
 /**
- * Possibly update the filesystem located in the directory @a path
- * to use disk space more efficiently.
+ * Possibly update the filesystem located in the directory @a db_path
+ * to use disk space more efficiently.  Use the backend-specific
+ * configuration @a fs_config when opening the filesystem.  @a NULL is
+ * valid for all backends.
+ *
+ * Backends may pack multiple shards concurrently if @a fs_config allows
+ * for it, see #SVN_FS_CONFIG_PARALLEL_JOBS.  @a notify_func will still
+ * be called in shard order and from the calling thread, while
+ * @a cancel_func may be called from any thread.
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2(), but with @a fs_config always passed as @c NULL.
  *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.10 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
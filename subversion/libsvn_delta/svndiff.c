@@ -24,14 +24,22 @@
 
 #include <assert.h>
 #include <string.h>
+
+#if APR_HAS_THREADS
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
+#endif
+
 #include "svn_delta.h"
 #include "svn_io.h"
 #include "delta.h"
 #include "svn_pools.h"
 #include "svn_private_config.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_error_private.h"
 #include "private/svn_delta_private.h"
+#include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_dep_compat.h"
@@ -39,13 +47,16 @@
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -55,9 +66,42 @@ get_svndiff_header(int version)
 
 /* ----- Text delta to svndiff ----- */
 
+#if APR_HAS_THREADS
+
+/* A single window to be encoded by a worker thread. */
+typedef struct encode_job_t
+{
+  /* Private copy of the window to encode. */
+  svn_txdelta_window_t *window;
+
+  /* Results of encode_window(). */
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+  svn_error_t *err;
+
+  /* Set by the worker thread once all of the above are valid.
+     Protected by the encoder's MUTEX. */
+  svn_boolean_t done;
+
+  /* Encoder settings to use. */
+  int version;
+  int compression_level;
+
+  /* The encoder's synchronization objects. */
+  svn_mutex__t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* Thread-safe pool containing all of the above data.  It is being
+     cleared whenever the job gets recycled. */
+  apr_pool_t *pool;
+} encode_job_t;
+
+#endif
+
 /* We make one of these and get it passed back to us in calls to the
    window handler.  We only use it to record the write function and
-   baton passed to svn_txdelta_to_svndiff3().  */
+   baton passed to svn_txdelta_to_svndiff4().  */
 struct encoder_baton {
   svn_stream_t *output;
   svn_boolean_t header_done;
@@ -65,6 +109,25 @@ struct encoder_baton {
   int compression_level;
   /* Pool for temporary allocations, will be cleared periodically. */
   apr_pool_t *scratch_pool;
+
+#if APR_HAS_THREADS
+  /* Concurrent encoding only:  Ring buffer of MAX_JOBS jobs of which
+     PENDING are currently being processed, starting with the oldest
+     at index FIRST_JOB.  JOBS is NULL until the second window arrives. */
+  encode_job_t *jobs;
+  int max_jobs;
+  int first_job;
+  int pending;
+
+  /* Signals the completion of any of the JOBS. */
+  svn_mutex__t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* Concurrent encoding only:  Copy of the first window, allocated in
+     HELD_POOL, while we don't know yet whether there will be more. */
+  svn_txdelta_window_t *held_window;
+  apr_pool_t *held_pool;
+#endif
 };
 
 /* This is at least as big as the largest size for a single instruction. */
@@ -198,7 +261,15 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *compressed_instructions;
+      compressed_instructions = svn_stringbuf_create_empty(pool);
+      SVN_ERR(svn__compress_zstd(instructions->data, instructions->len,
+                                 compressed_instructions, compression_level));
+      instructions = compressed_instructions;
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -217,7 +288,16 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, instructions->len);
 
   /* Encode the data. */
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__compress_zstd(window->new_data->data,
+                                 window->new_data->len,
+                                 compressed, compression_level));
+      newdata = svn_stringbuf__morph_into_string(compressed);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -245,6 +325,32 @@ encode_window(svn_stringbuf_t **instructions_p,
   return SVN_NO_ERROR;
 }
 
+/* Write the window data HEADER, INSTRUCTIONS and NEWDATA produced by
+   encode_window() to the output stream of EB. */
+static svn_error_t *
+write_encoded_window(struct encoder_baton *eb,
+                     svn_stringbuf_t *header,
+                     svn_stringbuf_t *instructions,
+                     const svn_string_t *newdata)
+{
+  apr_size_t len;
+
+  len = header->len;
+  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
+  if (instructions->len > 0)
+    {
+      len = instructions->len;
+      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
+    }
+  if (newdata->len > 0)
+    {
+      len = newdata->len;
+      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Note: When changing things here, check the related comment in
    the svn_txdelta_to_svndiff_stream() function.  */
 static svn_error_t *
@@ -286,33 +392,354 @@ window_handler(svn_txdelta_window_t *window, void *baton)
                         eb->scratch_pool));
 
   /* Write out the window.  */
-  len = header->len;
-  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
-  if (instructions->len > 0)
+  return svn_error_trace(write_encoded_window(eb, header, instructions,
+                                              newdata));
+}
+
+/* ----- Concurrent window encoding ----- */
+
+/* Compressing the windows is by far the most expensive part of the
+   encoder but the windows are independent of each other.  So, we may
+   hand them over to worker threads and only write the results to the
+   output stream in the original order.
+
+   The encoder keeps a ring buffer of jobs with one private pool each,
+   i.e. the number of windows in flight is limited and the memory usage
+   is independent of the size of the delta.
+ */
+#if APR_HAS_THREADS
+
+/* Maximum number of worker threads throughout the process. */
+#define MAX_ENCODER_THREADS 16
+
+/* Number of microseconds that an unused thread remains in the pool before
+ * being terminated. */
+#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
+
+/* Thread pool shared by all concurrent encoders. */
+static apr_thread_pool_t *thread_pool = NULL;
+
+/* Keep track on whether we already created the THREAD_POOL. */
+static svn_atomic_t thread_pool_initialized = FALSE;
+
+/* Destructor function that implicitly cleans up any running threads
+   in the THREAD_POOL *once*.
+
+   Must be run as a pre-cleanup hook.
+ */
+static apr_status_t
+thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = thread_pool;
+  if (!thread_pool)
+    return APR_SUCCESS;
+
+  thread_pool = NULL;
+  thread_pool_initialized = FALSE;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+/* Implements svn_atomic__err_init_func_t.  Create the THREAD_POOL. */
+static svn_error_t *
+create_thread_pool(void *baton,
+                   apr_pool_t *scratch_pool)
+{
+  /* The thread-pool must be allocated from a thread-safe pool and must
+     outlive all encoders. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_status_t status;
+
+  status = apr_thread_pool_create(&thread_pool, 0, MAX_ENCODER_THREADS,
+                                  pool);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't create svndiff encoder thread pool"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, NULL, thread_pool_pre_cleanup);
+
+  /* let idle threads linger for a while in case more requests are
+     coming in */
+  apr_thread_pool_idle_wait_set(thread_pool, THREADPOOL_THREAD_IDLE_LIMIT);
+
+  /* don't queue requests unless we reached the worker thread limit */
+  apr_thread_pool_threshold_set(thread_pool, 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread-pool task:  Encode the window of the encode_job_t given by DATA
+   and signal its completion. */
+static void * APR_THREAD_FUNC
+encode_task(apr_thread_t *tid,
+            void *data)
+{
+  encode_job_t *job = data;
+  svn_error_t *err;
+
+  job->err = encode_window(&job->instructions, &job->header, &job->newdata,
+                           job->window, job->version, job->compression_level,
+                           job->pool);
+
+  /* As soon as DONE has been set, the main thread may recycle JOB.
+     If the synchronization fails, there is no way to tell the main
+     thread about it. */
+  err = svn_mutex__lock(job->mutex);
+  if (!err)
     {
-      len = instructions->len;
-      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
+      job->done = TRUE;
+      apr_thread_cond_broadcast(job->cond);
+      err = svn_mutex__unlock(job->mutex, SVN_NO_ERROR);
     }
-  if (newdata->len > 0)
+  svn_error_clear(err);
+
+  return NULL;
+}
+
+/* Wait for the oldest pending job in EB to complete and remove it from
+   the queue.  Return the job in *JOB_P. */
+static svn_error_t *
+wait_for_oldest_job(encode_job_t **job_p,
+                    struct encoder_baton *eb)
+{
+  encode_job_t *job = &eb->jobs[eb->first_job];
+  apr_status_t status = APR_SUCCESS;
+
+  /* This loop implicitly handles spurious wake-ups. */
+  SVN_ERR(svn_mutex__lock(eb->mutex));
+  while (!job->done && !status)
+    status = apr_thread_cond_wait(eb->cond, svn_mutex__get(eb->mutex));
+  SVN_ERR(svn_mutex__unlock(eb->mutex, SVN_NO_ERROR));
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't wait for condition variable"));
+
+  eb->first_job = (eb->first_job + 1) % eb->max_jobs;
+  eb->pending--;
+  job->done = FALSE;
+
+  *job_p = job;
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait for the oldest pending job in EB to complete and write its
+   results to EB's output stream. */
+static svn_error_t *
+write_oldest_job(struct encoder_baton *eb)
+{
+  encode_job_t *job;
+  svn_error_t *err;
+
+  SVN_ERR(wait_for_oldest_job(&job, eb));
+
+  err = job->err;
+  job->err = SVN_NO_ERROR;
+  if (!err)
+    err = write_encoded_window(eb, job->header, job->instructions,
+                               job->newdata);
+
+  svn_pool_clear(job->pool);
+
+  return svn_error_trace(err);
+}
+
+/* Wait for all pending jobs in EB to complete and discard their results.
+   Jobs must not access the encoder anymore after this returned. */
+static svn_error_t *
+discard_pending_jobs(struct encoder_baton *eb)
+{
+  while (eb->pending)
     {
-      len = newdata->len;
-      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
+      encode_job_t *job;
+      SVN_ERR(wait_for_oldest_job(&job, eb));
+
+      svn_error_clear(job->err);
+      job->err = SVN_NO_ERROR;
+      svn_pool_clear(job->pool);
     }
 
   return SVN_NO_ERROR;
 }
 
+/* Pool cleanup function for the encoder_baton given by DATA.
+   Makes sure that no job outlives the encoder. */
+static apr_status_t
+encoder_cleanup(void *data)
+{
+  struct encoder_baton *eb = data;
+  int i;
+
+  if (eb->jobs)
+    {
+      svn_error_clear(discard_pending_jobs(eb));
+      for (i = 0; i < eb->max_jobs; ++i)
+        svn_pool_destroy(eb->jobs[i].pool);
+
+      eb->jobs = NULL;
+    }
+
+  return APR_SUCCESS;
+}
+
+/* Allocate the job queue and synchronization objects for EB. */
+static svn_error_t *
+init_jobs(struct encoder_baton *eb)
+{
+  apr_pool_t *pool = eb->scratch_pool;
+  apr_status_t status;
+  int i;
+
+  SVN_ERR(svn_atomic__init_once(&thread_pool_initialized, create_thread_pool,
+                                NULL, pool));
+
+  SVN_ERR(svn_mutex__init(&eb->mutex, TRUE, pool));
+  status = apr_thread_cond_create(&eb->cond, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  /* To be able to encode in a separate thread, each job must use a
+     separate, thread-safe pool.  Root pools achieve exactly that. */
+  eb->jobs = apr_pcalloc(pool, eb->max_jobs * sizeof(*eb->jobs));
+  for (i = 0; i < eb->max_jobs; ++i)
+    {
+      encode_job_t *job = &eb->jobs[i];
+      job->version = eb->version;
+      job->compression_level = eb->compression_level;
+      job->mutex = eb->mutex;
+      job->cond = eb->cond;
+      job->pool = svn_pool_create(NULL);
+    }
+
+  apr_pool_cleanup_register(pool, eb, encoder_cleanup,
+                            apr_pool_cleanup_null);
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue WINDOW for encoding in EB.  If the queue is full, write the
+   oldest window to the output first. */
+static svn_error_t *
+queue_window(struct encoder_baton *eb,
+             svn_txdelta_window_t *window)
+{
+  encode_job_t *job;
+  apr_status_t status;
+
+  if (eb->jobs == NULL)
+    SVN_ERR(init_jobs(eb));
+
+  if (eb->pending == eb->max_jobs)
+    SVN_ERR(write_oldest_job(eb));
+
+  job = &eb->jobs[(eb->first_job + eb->pending) % eb->max_jobs];
+  job->window = svn_txdelta_window_dup(window, job->pool);
+  eb->pending++;
+
+  /* If we can't get a worker thread, simply do the work here. */
+  status = apr_thread_pool_push(thread_pool, encode_task, job, 0, eb);
+  if (status)
+    encode_task(NULL, job);
+
+  return SVN_NO_ERROR;
+}
+
+/* Encode the window held back by EB in this thread and write it to the
+   output stream. */
+static svn_error_t *
+write_held_window(struct encoder_baton *eb)
+{
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+
+  SVN_ERR(encode_window(&instructions, &header, &newdata, eb->held_window,
+                        eb->version, eb->compression_level, eb->held_pool));
+
+  return svn_error_trace(write_encoded_window(eb, header, instructions,
+                                              newdata));
+}
+
+/* Like window_handler() but compressing the windows concurrently. */
+static svn_error_t *
+concurrent_window_handler(svn_txdelta_window_t *window, void *baton)
+{
+  struct encoder_baton *eb = baton;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_size_t len;
+
+  /* Make sure we write the header.  */
+  if (!eb->header_done)
+    {
+      len = SVNDIFF_HEADER_SIZE;
+      SVN_ERR(svn_stream_write(eb->output, get_svndiff_header(eb->version),
+                               &len));
+      eb->header_done = TRUE;
+    }
+
+  /* Most deltas consist of a single window and there is nothing to win
+     from handing that one to another thread.  So, don't set up any jobs
+     before a second window arrives. */
+  if (window && eb->jobs == NULL && eb->held_window == NULL)
+    {
+      if (eb->held_pool == NULL)
+        eb->held_pool = svn_pool_create(eb->scratch_pool);
+
+      eb->held_window = svn_txdelta_window_dup(window, eb->held_pool);
+      return SVN_NO_ERROR;
+    }
+
+  if (eb->held_window)
+    {
+      err = window ? queue_window(eb, eb->held_window)
+                   : write_held_window(eb);
+
+      svn_pool_clear(eb->held_pool);
+      eb->held_window = NULL;
+    }
+
+  if (window)
+    {
+      if (!err)
+        err = queue_window(eb, window);
+    }
+  else
+    {
+      /* We're done; flush all windows and clean up. */
+      while (eb->pending && !err)
+        err = write_oldest_job(eb);
+
+      if (!err)
+        err = svn_stream_close(eb->output);
+    }
+
+  /* Don't leave jobs running after an error. */
+  if (err)
+    err = svn_error_compose_create(err, discard_pending_jobs(eb));
+
+  if (window == NULL)
+    svn_pool_destroy(eb->scratch_pool);
+
+  return svn_error_trace(err);
+}
+
+#endif
+
 void
-svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
+svn_txdelta_to_svndiff4(svn_txdelta_window_handler_t *handler,
                         void **handler_baton,
                         svn_stream_t *output,
                         int svndiff_version,
                         int compression_level,
+                        int max_threads,
                         apr_pool_t *pool)
 {
   struct encoder_baton *eb;
 
-  eb = apr_palloc(pool, sizeof(*eb));
+  eb = apr_pcalloc(pool, sizeof(*eb));
   eb->output = output;
   eb->header_done = FALSE;
   eb->scratch_pool = svn_pool_create(pool);
@@ -321,6 +748,29 @@ svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
 
   *handler = window_handler;
   *handler_baton = eb;
+
+#if APR_HAS_THREADS
+  /* Uncompressed windows are cheap to encode. */
+  if (max_threads > 1 && svndiff_version > 0)
+    {
+      eb->max_jobs = max_threads < MAX_ENCODER_THREADS
+                   ? max_threads
+                   : MAX_ENCODER_THREADS;
+      *handler = concurrent_window_handler;
+    }
+#endif
+}
+
+void
+svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
+                        void **handler_baton,
+                        svn_stream_t *output,
+                        int svndiff_version,
+                        int compression_level,
+                        apr_pool_t *pool)
+{
+  svn_txdelta_to_svndiff4(handler, handler_baton, output, svndiff_version,
+                          compression_level, 1, pool);
 }
 
 void
@@ -330,8 +780,8 @@ svn_txdelta_to_svndiff2(svn_txdelta_window_handler_t *handler,
                         int svndiff_version,
                         apr_pool_t *pool)
 {
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  svn_txdelta_to_svndiff4(handler, handler_baton, output, svndiff_version,
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1, pool);
 }
 
 void
@@ -340,8 +790,8 @@ svn_txdelta_to_svndiff(svn_stream_t *output,
                        svn_txdelta_window_handler_t *handler,
                        void **handler_baton)
 {
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, 0,
-                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  svn_txdelta_to_svndiff4(handler, handler_baton, output, 0,
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1, pool);
 }
 
 
@@ -565,7 +1015,23 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
+      svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__decompress_zstd(insend, newlen, ndout,
+                                   SVN_DELTA_WINDOW_SIZE));
+      SVN_ERR(svn__decompress_zstd(data, insend - data, instout,
+                                   MAX_INSTRUCTION_SECTION_LEN));
+
+      newlen = ndout->len;
+      data = (unsigned char *)instout->data;
+      insend = (unsigned char *)instout->data + instout->len;
+
+      new_data = svn_stringbuf__morph_into_string(ndout);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
@@ -653,6 +1119,8 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -1084,15 +1552,15 @@ svn_txdelta_to_svndiff_stream(svn_txdelta_stream_t *txstream,
   push_stream = svn_stream_create(baton, pool);
   svn_stream_set_write(push_stream, svndiff_stream_write_fn);
 
-  /* We rely on the implementation detail of the svn_txdelta_to_svndiff3()
+  /* We rely on the implementation detail of the svn_txdelta_to_svndiff4()
      function, namely, on how the window_handler() function behaves.
      As long as it writes one svndiff window at a time to the target
      stream, the memory usage of this function (in other words, how
      much data can be accumulated in the internal 'window_buffer')
-     is limited.  */
-  svn_txdelta_to_svndiff3(&baton->handler, &baton->handler_baton,
+     is limited.  Hence, no concurrent encoding here. */
+  svn_txdelta_to_svndiff4(&baton->handler, &baton->handler_baton,
                           push_stream, svndiff_version,
-                          compression_level, pool);
+                          compression_level, 1, pool);
 
   pull_stream = svn_stream_create(baton, pool);
   svn_stream_set_read2(pull_stream, NULL, svndiff_stream_read_fn);
@@ -31,6 +31,16 @@
 #include "svn_delta.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
+
+/* SSE2 is part of the x86-64 baseline, i.e. compilers targeting it will
+   define __SSE2__ and we don't need any run-time CPU detection.  All other
+   platforms use the portable code. */
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define USE_SSE2 1
+#else
+#  define USE_SSE2 0
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -76,12 +86,68 @@ adler32_replace(apr_uint32_t adler32, const char c_out, const char c_in)
   return adler32 + adler32 * 0x10000;
 }
 
+/* Return the value that adler32_replace() would add to the checksum when
+ * removing C_OUT and adding C_IN, before the final multiplication.
+ *
+ * Because the multiplication is with (1 + 0x10000) and 0x10000 squared
+ * vanishes in 32 bit arithmetic, applying N consecutive replacements to a
+ * checksum is a simple linear combination of the initial checksum and the
+ * N deltas with the factors (1 + k * 0x10000).  That allows us to calculate
+ * the checksums for several consecutive positions independently.
+ */
+static APR_INLINE apr_uint32_t
+adler32_delta(const char c_out, const char c_in)
+{
+  return (unsigned char)c_in
+       - (unsigned char)c_out * (MATCH_BLOCKSIZE * 0x10000u + 1);
+}
+
 /* Calculate an pseudo-adler32 checksum for MATCH_BLOCKSIZE bytes starting
    at DATA.  Return the checksum value.  */
 
 static APR_INLINE apr_uint32_t
 init_adler32(const char *data)
 {
+#if USE_SSE2
+
+  /* S1 is the plain sum of all bytes while S2 weights byte I with
+   * (MATCH_BLOCKSIZE - I).  Sum up 16 bytes at a time for S1 and
+   * multiply-add 8 zero-extended bytes at a time with their weights
+   * for S2.  Neither can overflow the 16 / 32 bit lanes. */
+  const __m128i zero = _mm_setzero_si128();
+  __m128i s1 = zero;
+  __m128i s2 = zero;
+  __m128i weights = _mm_set_epi16(MATCH_BLOCKSIZE - 7, MATCH_BLOCKSIZE - 6,
+                                  MATCH_BLOCKSIZE - 5, MATCH_BLOCKSIZE - 4,
+                                  MATCH_BLOCKSIZE - 3, MATCH_BLOCKSIZE - 2,
+                                  MATCH_BLOCKSIZE - 1, MATCH_BLOCKSIZE);
+  const __m128i step = _mm_set1_epi16(8);
+  int i;
+
+  for (i = 0; i < MATCH_BLOCKSIZE; i += 16)
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+
+      s1 = _mm_add_epi64(s1, _mm_sad_epu8(chunk, zero));
+
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(chunk, zero),
+                                            weights));
+      weights = _mm_sub_epi16(weights, step);
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpackhi_epi8(chunk, zero),
+                                            weights));
+      weights = _mm_sub_epi16(weights, step);
+    }
+
+  /* Fold the partial sums. */
+  s1 = _mm_add_epi64(s1, _mm_unpackhi_epi64(s1, s1));
+  s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, _MM_SHUFFLE(1, 0, 3, 2)));
+  s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1);
+
+#else
+
   const unsigned char *input = (const unsigned char *)data;
   const unsigned char *last = input + MATCH_BLOCKSIZE;
 
@@ -101,6 +167,35 @@ init_adler32(const char *data)
     }
 
   return s2 * 0x10000 + s1;
+
+#endif
+}
+
+/* Return the length of the common prefix of A and B, but no more than
+   MAX_LEN.  This is svn_cstring__match_length() but processes 16 bytes
+   at a time where supported, since long matches are the norm for e.g.
+   slightly modified binary files. */
+static APR_INLINE apr_size_t
+match_length(const char *a,
+             const char *b,
+             apr_size_t max_len)
+{
+#if USE_SSE2
+  apr_size_t pos = 0;
+
+  for (; max_len - pos >= 16; pos += 16)
+    {
+      __m128i a_chunk = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i b_chunk = _mm_loadu_si128((const __m128i *)(b + pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(a_chunk, b_chunk)) != 0xffff)
+        break;
+    }
+
+  /* The remainder is less than 16 bytes or contains the first mismatch. */
+  return pos + svn_cstring__match_length(a + pos, b + pos, max_len - pos);
+#else
+  return svn_cstring__match_length(a, b, max_len);
+#endif
 }
 
 /* Information for a block of the delta source.  The length of the
@@ -290,9 +385,9 @@ find_match(const struct blocks *blocks,
   max_delta = asize - apos - MATCH_BLOCKSIZE < bsize - bpos - MATCH_BLOCKSIZE
             ? asize - apos - MATCH_BLOCKSIZE
             : bsize - bpos - MATCH_BLOCKSIZE;
-  delta = svn_cstring__match_length(a + apos + MATCH_BLOCKSIZE,
-                                    b + bpos + MATCH_BLOCKSIZE,
-                                    max_delta);
+  delta = match_length(a + apos + MATCH_BLOCKSIZE,
+                       b + bpos + MATCH_BLOCKSIZE,
+                       max_delta);
 
   /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
      content has been sampled only every MATCH_BLOCKSIZE positions).  */
@@ -309,6 +404,66 @@ find_match(const struct blocks *blocks,
   return MATCH_BLOCKSIZE + delta;
 }
 
+/* Return TRUE if BLOCKS may contain a block with the adler32 checksum SUM,
+   i.e. if it is worth to look for a match.  Return FALSE, if there is no
+   such block. */
+static APR_INLINE svn_boolean_t
+may_match(const struct blocks *blocks, apr_uint32_t sum)
+{
+  return (blocks->flags[hash_flags(sum)] & (1 << (sum & 7))) != 0;
+}
+
+/* Starting with the checksum *ROLLING for the block at *LO in B, move *LO
+   forward to the first position before UPPER that may match one of the
+   BLOCKS and update *ROLLING accordingly.  If there is no such position,
+   *LO will be UPPER upon return.
+
+   This is the hot loop for new / unrelated target data.  We process
+   4 positions per iteration with independent checksum calculations (see
+   adler32_delta()) instead of a long chain of dependent ones. */
+static APR_INLINE void
+skip_non_matches(const struct blocks *blocks,
+                 const char *b,
+                 apr_size_t *lo,
+                 apr_size_t upper,
+                 apr_uint32_t *rolling)
+{
+  apr_size_t pos = *lo;
+  apr_uint32_t sum = *rolling;
+
+  while (pos + 4 <= upper)
+    {
+      const char *out = b + pos;
+      const char *in = out + MATCH_BLOCKSIZE;
+      apr_uint32_t d0 = sum + adler32_delta(out[0], in[0]);
+      apr_uint32_t d1 = adler32_delta(out[1], in[1]);
+      apr_uint32_t d2 = adler32_delta(out[2], in[2]);
+      apr_uint32_t d3 = adler32_delta(out[3], in[3]);
+
+      /* Checksums for POS+1 .. POS+3. */
+      apr_uint32_t sum1 = d0 * 0x10001;
+      apr_uint32_t sum2 = d0 * 0x20001 + d1 * 0x10001;
+      apr_uint32_t sum3 = d0 * 0x30001 + d1 * 0x20001 + d2 * 0x10001;
+
+      if (   may_match(blocks, sum) || may_match(blocks, sum1)
+          || may_match(blocks, sum2) || may_match(blocks, sum3))
+        break;
+
+      sum = d0 * 0x40001 + d1 * 0x30001 + d2 * 0x20001 + d3 * 0x10001;
+      pos += 4;
+    }
+
+  /* Find the exact position and handle the last few positions. */
+  while (!may_match(blocks, sum) && pos < upper)
+    {
+      sum = adler32_replace(sum, b[pos], b[pos + MATCH_BLOCKSIZE]);
+      pos++;
+    }
+
+  *lo = pos;
+  *rolling = sum;
+}
+
 /* Utility for compute_delta() that compares the range B[START,BSIZE) with
  * the range of similar size before A[ASIZE]. Create corresponding copy and
  * insert operations.
@@ -414,12 +569,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
 
       /* Quickly skip positions whose respective ROLLING checksums
          definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
-             && lo < upper)
-        {
-          rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
-          lo++;
-        }
+      skip_non_matches(&blocks, b, &lo, upper, &rolling);
 
       /* LO is still <= UPPER, i.e. the following lookup is legal:
          Closely check whether we've got a match for the current location.
@@ -1468,13 +1468,13 @@ svn_fs_base__rep_deltify(svn_fs_t *fs,
   svn_txdelta2(&txdelta_stream, source_stream, target_stream, TRUE, pool);
 
   if (bfd->format >= SVN_FS_BASE__MIN_SVNDIFF1_FORMAT)
-    svn_txdelta_to_svndiff3(&new_target_handler, &new_target_handler_baton,
+    svn_txdelta_to_svndiff4(&new_target_handler, &new_target_handler_baton,
                             new_target_stream, 1,
-                            SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+                            SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1, pool);
   else
-    svn_txdelta_to_svndiff3(&new_target_handler, &new_target_handler_baton,
+    svn_txdelta_to_svndiff4(&new_target_handler, &new_target_handler_baton,
                             new_target_stream, 0,
-                            SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+                            SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1, pool);
 
   /* subpool for the windows */
   wpool = svn_pool_create(pool);
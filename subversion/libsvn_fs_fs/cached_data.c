@@ -46,6 +46,13 @@
 
 #include "svn_private_config.h"
 
+/* In long delta chains, the combined windows of every
+ * COMBINED_WINDOW_CHECKPOINT_DISTANCE-th representation (counted from the
+ * base of the chain) get cached for every chunk, not just for single-chunk
+ * representations.  Reconstructing any rep further up the chain can then
+ * start from the nearest cached checkpoint instead of the chain's base. */
+#define COMBINED_WINDOW_CHECKPOINT_DISTANCE 4
+
 /* forward-declare. See implementation for the docstring */
 static svn_error_t *
 block_read(void **result,
@@ -193,21 +200,6 @@ dbg_log_access(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Convenience wrapper around svn_io_file_aligned_seek, taking filesystem
-   FS instead of a block size. */
-static svn_error_t *
-aligned_seek(svn_fs_t *fs,
-             apr_file_t *file,
-             apr_off_t *buffer_start,
-             apr_off_t offset,
-             apr_pool_t *pool)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(file, ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
-}
-
 /* Open the revision file for revision REV in filesystem FS and store
    the newly opened file in FILE.  Seek to location OFFSET before
    returning.  Perform temporary allocations in POOL. */
@@ -227,7 +219,7 @@ open_and_seek_revision(svn_fs_fs__revision_file_t **file,
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL, item,
                                  pool));
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
   *file = rev_file;
 
@@ -249,7 +241,7 @@ open_and_seek_transaction(svn_fs_fs__revision_file_t **file,
 
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, NULL, SVN_INVALID_REVNUM,
                                  &rep->txn_id, rep->item_index, pool));
-  SVN_ERR(aligned_seek(fs, (*file)->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(*file, NULL, offset));
 
   return SVN_NO_ERROR;
 }
@@ -547,7 +539,7 @@ get_fs_id_at_offset(svn_fs_id_t **id_p,
 {
   node_revision_t *noderev;
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev,
                                   rev_file->stream,
                                   pool, pool));
@@ -581,7 +573,6 @@ get_root_changes_offset(apr_off_t *root_offset,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_off_t rev_offset;
-  apr_seek_where_t seek_relative;
   svn_stringbuf_t *trailer;
   char buffer[64];
   apr_off_t start;
@@ -598,15 +589,9 @@ get_root_changes_offset(apr_off_t *root_offset,
      just seek to the end of the pack file -- just like we do in the
      non-packed case. */
   if (rev_file->is_packed && ((rev + 1) % ffd->max_files_per_dir != 0))
-    {
-      SVN_ERR(svn_fs_fs__get_packed_offset(&end, fs, rev + 1, pool));
-      seek_relative = APR_SET;
-    }
+    SVN_ERR(svn_fs_fs__get_packed_offset(&end, fs, rev + 1, pool));
   else
-    {
-      seek_relative = APR_END;
-      end = 0;
-    }
+    SVN_ERR(svn_fs_fs__rev_file_size(&end, rev_file));
 
   /* Offset of the revision from the start of the pack file, if applicable. */
   if (rev_file->is_packed)
@@ -616,8 +601,6 @@ get_root_changes_offset(apr_off_t *root_offset,
 
   /* We will assume that the last line containing the two offsets
      will never be longer than 64 characters. */
-  SVN_ERR(svn_io_file_seek(rev_file->file, seek_relative, &end, pool));
-
   if (end < sizeof(buffer))
     {
       len = (apr_size_t)end;
@@ -630,9 +613,8 @@ get_root_changes_offset(apr_off_t *root_offset,
     }
 
   /* Read in this last block, from which we will identify the last line. */
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, start, pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len, NULL, NULL,
-                                 pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, start));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len));
 
   /* Parse the last line. */
   trailer = svn_stringbuf_ncreate(buffer, len, pool);
@@ -746,29 +728,25 @@ typedef struct rep_state_t
   int chunk_index;  /* number of the window to read */
 } rep_state_t;
 
-/* Simple wrapper around svn_io_file_get_offset to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_offset to simplify callers. */
 static svn_error_t *
 get_file_offset(apr_off_t *offset,
                 rep_state_t *rs,
                 apr_pool_t *pool)
 {
-  return svn_error_trace(svn_io_file_get_offset(offset,
-                                                rs->sfile->rfile->file,
-                                                pool));
+  return svn_error_trace(svn_fs_fs__rev_file_offset(offset,
+                                                   rs->sfile->rfile));
 }
 
-/* Simple wrapper around svn_io_file_aligned_seek to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_seek to simplify callers. */
 static svn_error_t *
 rs_aligned_seek(rep_state_t *rs,
                 apr_off_t *buffer_start,
                 apr_off_t offset,
                 apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(rs->sfile->rfile->file,
-                                                  ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
+  return svn_error_trace(svn_fs_fs__rev_file_seek(rs->sfile->rfile,
+                                                 buffer_start, offset));
 }
 
 /* Open FILE->FILE and FILE->STREAM if they haven't been opened, yet. */
@@ -809,8 +787,7 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
     {
       char buf[4];
       SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
-      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                     sizeof(buf), NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, sizeof(buf)));
 
       /* ### Layering violation */
       if (! ((buf[0] == 'S') && (buf[1] == 'V') && (buf[2] == 'N')))
@@ -1369,15 +1346,16 @@ set_cached_window(svn_txdelta_window_t *window,
   return SVN_NO_ERROR;
 }
 
-/* Read the WINDOW_P for the rep state RS from the current FSFS session's
- * cache. This will be a no-op and IS_CACHED will be set to FALSE if no
- * cache has been given. If a cache is available IS_CACHED will inform
- * the caller about the success of the lookup. Allocations (of the window
- * in particular) will be made from POOL.
+/* Read the WINDOW_P number CHUNK_INDEX for the rep state RS from the
+ * current FSFS session's cache. This will be a no-op and IS_CACHED will
+ * be set to FALSE if no cache has been given. If a cache is available
+ * IS_CACHED will inform the caller about the success of the lookup.
+ * Allocations (of the window in particular) will be made from POOL.
  */
 static svn_error_t *
 get_cached_combined_window(svn_stringbuf_t **window_p,
                            rep_state_t *rs,
+                           int chunk_index,
                            svn_boolean_t *is_cached,
                            apr_pool_t *pool)
 {
@@ -1390,10 +1368,12 @@ get_cached_combined_window(svn_stringbuf_t **window_p,
     {
       /* ask the cache for the desired txdelta window */
       window_cache_key_t key = { 0 };
+      get_window_key(&key, rs);
+      key.chunk_index = chunk_index;
       return svn_cache__get((void **)window_p,
                             is_cached,
                             rs->combined_cache,
-                            get_window_key(&key, rs),
+                            &key,
                             pool);
     }
 
@@ -1464,7 +1444,8 @@ build_rep_list(apr_array_header_t **list,
       /* for txn reps, there won't be a cached combined window */
       if (   !svn_fs_fs__id_txn_used(&rep.txn_id)
           && rep.expanded_size < SVN_DELTA_WINDOW_SIZE)
-        SVN_ERR(get_cached_combined_window(window_p, rs, &is_cached, pool));
+        SVN_ERR(get_cached_combined_window(window_p, rs, 0, &is_cached,
+                                           pool));
 
       if (is_cached)
         {
@@ -1597,15 +1578,21 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   start_offset = rs->start + rs->current;
   SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, scratch_pool));
 
-  /* Skip windows to reach the current chunk if we aren't there yet. */
+  /* Skip windows to reach the current chunk if we aren't there yet.
+   * Only the window headers need to be parsed for that. */
   iterpool = svn_pool_create(scratch_pool);
   while (rs->chunk_index < this_chunk)
     {
+      apr_size_t window_len;
+
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
-                                              rs->ver, iterpool));
+      SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
+                                               rs->sfile->rfile->stream,
+                                               iterpool));
+      start_offset += window_len;
+      SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
+
       rs->chunk_index++;
-      SVN_ERR(get_file_offset(&start_offset, rs, iterpool));
       rs->current = start_offset - rs->start;
       if (rs->current >= rs->size)
         return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
@@ -1651,8 +1638,7 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, (*nwin)->data, size));
   (*nwin)->data[size] = 0;
 
   /* Update RS. */
@@ -1672,6 +1658,23 @@ skip_plain_window(rep_state_t *rs,
   return SVN_NO_ERROR;
 }
 
+/* Return TRUE, if the combined windows of the representation at index
+   IDX in RB->RS_LIST shall be cached for every chunk, i.e. if that rep
+   is a checkpoint in a delta chain that starts at its full base.
+   Because the delta base of any committed rep never changes, the same
+   reps will be checkpoints no matter which rep we start reading from. */
+static svn_boolean_t
+is_combined_window_checkpoint(struct rep_read_baton *rb,
+                              int idx)
+{
+  rep_state_t *rs = APR_ARRAY_IDX(rb->rs_list, idx, rep_state_t *);
+
+  return rb->base_window == NULL
+      && rs->combined_cache
+      && SVN_IS_VALID_REVNUM(rs->revision)
+      && (rb->rs_list->nelts - idx) % COMBINED_WINDOW_CHECKPOINT_DISTANCE == 0;
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
    base representation.  Store the window in *RESULT. */
@@ -1689,10 +1692,14 @@ get_combined_window(svn_stringbuf_t **result,
   /* Read all windows that we need to combine. This is fine because
      the size of each window is relatively small (100kB) and skip-
      delta limits the number of deltas in a chain to well under 100.
-     Stop early if one of them does not depend on its predecessors. */
+     Stop early if one of them does not depend on its predecessors or
+     if we find the combined window of a checkpoint rep in our cache.
+     In the latter case, the checkpoint's chunk becomes the source
+     for the windows read so far and BUF will not be NULL. */
   window_pool = svn_pool_create(rb->pool);
   windows = apr_array_make(window_pool, 0, sizeof(svn_txdelta_window_t *));
   iterpool = svn_pool_create(rb->pool);
+  pool = svn_pool_create(rb->pool);
   for (i = 0; i < rb->rs_list->nelts; ++i)
     {
       svn_txdelta_window_t *window;
@@ -1700,6 +1707,17 @@ get_combined_window(svn_stringbuf_t **result,
       svn_pool_clear(iterpool);
 
       rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+      if (buf == NULL && is_combined_window_checkpoint(rb, i))
+        {
+          svn_boolean_t is_cached;
+          SVN_ERR(get_cached_combined_window(&buf, rs, rb->chunk_index,
+                                             &is_cached, pool));
+          if (is_cached)
+            break;
+
+          buf = NULL;
+        }
+
       SVN_ERR(read_delta_window(&window, rb->chunk_index, rs, window_pool,
                                 iterpool));
 
@@ -1711,8 +1729,9 @@ get_combined_window(svn_stringbuf_t **result,
         }
     }
 
-  /* Combine in the windows from the other delta reps. */
-  pool = svn_pool_create(rb->pool);
+  /* Combine in the windows from the other delta reps.  Reps below a
+     checkpoint hit will skip this chunk; read_delta_window will catch
+     up with them when they are needed again. */
   for (--i; i >= 0; --i)
     {
       svn_txdelta_window_t *window;
@@ -1733,11 +1752,15 @@ get_combined_window(svn_stringbuf_t **result,
         {
           /* Even if we don't need the source rep now, we still must keep
            * its read offset in sync with what we might need for the next
-           * window. */
+           * window.  Since checkpoints may have let us skip the PLAIN rep
+           * for previous chunks, position explicitly at the source view. */
           if (window->src_ops)
-            SVN_ERR(read_plain_window(&source, rb->src_state,
-                                      window->sview_len,
-                                      pool, iterpool));
+            {
+              rb->src_state->current = window->sview_offset;
+              SVN_ERR(read_plain_window(&source, rb->src_state,
+                                        window->sview_len,
+                                        pool, iterpool));
+            }
           else
             SVN_ERR(skip_plain_window(rb->src_state, window->sview_len));
         }
@@ -1756,10 +1779,13 @@ get_combined_window(svn_stringbuf_t **result,
 
       /* Cache windows only if the whole rep content could be read as a
          single chunk.  Only then will no other chunk need a deeper RS
-         list than the cached chunk. */
+         list than the cached chunk.  Checkpoints are the exception as
+         they get looked up per chunk while walking the RS list. */
       if (   (rb->chunk_index == 0) && (rs->current == rs->size)
           && SVN_IS_VALID_REVNUM(rs->revision))
         SVN_ERR(set_cached_combined_window(buf, rs, new_pool));
+      else if (is_combined_window_checkpoint(rb, i))
+        SVN_ERR(set_cached_combined_window(buf, rs, new_pool));
 
       rs->chunk_index++;
 
@@ -1840,8 +1866,7 @@ get_contents_from_windows(struct rep_read_baton *rb,
 
           offset = rs->start + rs->current;
           SVN_ERR(rs_aligned_seek(rs, NULL, offset, rb->pool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, cur,
-                                         copy_len, NULL, NULL, rb->pool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, cur, copy_len));
         }
 
       rs->current += copy_len;
@@ -2294,9 +2319,11 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   rs->sfile->rfile->start_revision = SVN_INVALID_REVNUM;
   rs->sfile->rfile->file = file;
   rs->sfile->rfile->stream = svn_stream_from_aprfile2(file, TRUE, pool);
+  rs->sfile->rfile->block_size = ((fs_fs_data_t *)fs->fsap_data)->block_size;
+  rs->sfile->rfile->pool = pool;
 
   /* Read the rep header. */
-  SVN_ERR(aligned_seek(fs, file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rs->sfile->rfile, NULL, offset));
   SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
                                      pool, pool));
   SVN_ERR(get_file_offset(&rs->start, rs, pool));
@@ -3142,9 +3169,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
             }
 
           /* Actual reading and parsing are the same, though. */
-          SVN_ERR(aligned_seek(context->fs, context->revision_file->file,
-                               NULL, changes_offset + context->next_offset,
-                               scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(context->revision_file, NULL,
+                                           changes_offset
+                                           + context->next_offset));
 
           SVN_ERR(svn_fs_fs__read_changes(changes,
                                           context->revision_file->stream,
@@ -3153,9 +3180,8 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
 
           /* Construct the info object for the entries block we just read. */
           changes_list = apr_pcalloc(scratch_pool, sizeof(*changes_list));
-          SVN_ERR(svn_io_file_get_offset(&changes_list->end_offset,
-                                         context->revision_file->file,
-                                         scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_offset(&changes_list->end_offset,
+                                             context->revision_file));
           changes_list->end_offset -= changes_offset;
           changes_list->start_offset = context->next_offset;
           changes_list->count = (*changes)->nelts;
@@ -3338,8 +3364,8 @@ cache_windows(svn_fs_t *fs,
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
           SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf,
+                                           window_len));
           buf[window_len] = 0;
 
           /* update relative offset in representation */
@@ -3415,12 +3441,12 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       /* for larger reps, the header may have crossed a block boundary.
        * make sure we still read blocks properly aligned, i.e. don't use
        * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
       plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, plaintext->data,
+                                       (apr_size_t)rs.size));
+      plaintext->len = (apr_size_t)rs.size;
       plaintext->data[plaintext->len] = 0;
       rs.current += rs.size;
 
@@ -3515,8 +3541,7 @@ read_item(svn_stream_t **stream,
   svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
   text->len = entry->size;
   text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, text->data, text->len));
 
   /* Return (construct, calculate) stream and checksum. */
   *stream = svn_stream_from_stringbuf(text, pool);
@@ -3658,6 +3683,40 @@ block_read_noderev(node_revision_t **noderev_p,
   return SVN_NO_ERROR;
 }
 
+/* Block-read just fetched the block starting at BLOCK_START in
+ * REVISION_FILE of FS.  If that continues a sequential scan through the
+ * file, in either direction, ask the OS to prefetch the next few blocks
+ * along that direction so that they are available once we parse them.
+ */
+static void
+auto_read_ahead(svn_fs_t *fs,
+                svn_fs_fs__revision_file_t *revision_file,
+                apr_off_t block_start)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_off_t block_size = ffd->block_size;
+  apr_off_t distance = block_start - ffd->last_block_start;
+
+  if (   ffd->read_ahead > 0
+      && revision_file->start_revision == ffd->last_block_rev)
+    {
+      apr_off_t size = ffd->read_ahead * block_size;
+
+      /* 'svn log' walks revisions backwards, i.e. towards the start of
+       * pack files.  Most other scans go the other way. */
+      if (distance > 0 && distance <= 2 * block_size)
+        svn_fs_fs__rev_file_prefetch(revision_file,
+                                     block_start + block_size, size);
+      else if (distance < 0 && distance >= -2 * block_size)
+        svn_fs_fs__rev_file_prefetch(revision_file,
+                                     MAX(block_start - size, 0),
+                                     MIN(block_start, size));
+    }
+
+  ffd->last_block_rev = revision_file->start_revision;
+  ffd->last_block_start = block_start;
+}
+
 /* Read the whole (e.g. 64kB) block containing ITEM_INDEX of REVISION in FS
  * and put all data into cache.  If necessary and depending on heuristics,
  * neighboring blocks may also get read.  The data is being read from
@@ -3718,8 +3777,7 @@ block_read(void **result,
                                           ffd->block_size, scratch_pool,
                                           scratch_pool));
 
-      SVN_ERR(aligned_seek(fs, revision_file->file, &block_start, offset,
-                           iterpool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, &block_start, offset));
 
       /* read all items from the block */
       for (i = 0; i < entries->nelts; ++i)
@@ -3751,8 +3809,8 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
-              SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET,
-                                       &entry->offset, iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, NULL,
+                                               entry->offset));
               switch (entry->type)
                 {
                   case SVN_FS_FS__ITEM_TYPE_FILE_REP:
@@ -3798,6 +3856,9 @@ block_read(void **result,
   while(run_count++ == 1); /* can only be true once and only if a block
                             * boundary got crossed */
 
+  /* Overlap the I/O for the next blocks with parsing them. */
+  auto_read_ahead(fs, revision_file, block_start);
+
   /* if the caller requested a result, we must have provided one by now */
   assert(!result || *result);
   svn_pool_destroy(iterpool);
@@ -284,6 +284,9 @@ init_callbacks(svn_cache__t *cache,
  * is 0, then use the default priority class.  HAS_NAMESPACE indicates
  * whether we prefixed this cache instance with a namespace.
  *
+ * If DISK is not NULL and the cache has no namespace, put DISK behind
+ * the cache as its persistent second-level cache.
+ *
  * Unless NO_HANDLER is true, register an error handler that reports errors
  * as warnings to the FS warning callback.
  *
@@ -293,6 +296,7 @@ static svn_error_t *
 create_cache(svn_cache__t **cache_p,
              svn_memcache_t *memcache,
              svn_membuffer_t *membuffer,
+             svn_cache__disk_t *disk,
              apr_int64_t pages,
              apr_int64_t items_per_page,
              svn_cache__serialize_func_t serializer,
@@ -341,6 +345,21 @@ create_cache(svn_cache__t **cache_p,
       *cache_p = NULL;
     }
 
+  if (*cache_p && disk && !has_namespace)
+    {
+      /* The data on disk may outlive this repository.  Distinguish it
+       * from e.g. reloaded repositories that reuse UUID and path.
+       * read_config() only enables the disk tier for formats that have
+       * a real instance ID. */
+      fs_fs_data_t *ffd = fs->fsap_data;
+      const char *disk_prefix = apr_pstrcat(scratch_pool, prefix, "--",
+                                            ffd->instance_id, SVN_VA_NULL);
+
+      SVN_ERR(svn_cache__create_disk_tier(cache_p, *cache_p, disk,
+                                          serializer, deserializer, klen,
+                                          disk_prefix, result_pool));
+    }
+
   SVN_ERR(init_callbacks(*cache_p, fs, error_handler, result_pool));
 
   return SVN_NO_ERROR;
@@ -408,6 +427,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->rev_root_id_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 50,
                        svn_fs_fs__serialize_id,
                        svn_fs_fs__deserialize_id,
@@ -424,6 +444,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->rev_node_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 8,
                        svn_fs_fs__dag_serialize,
                        svn_fs_fs__dag_deserialize,
@@ -442,6 +463,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->dir_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 8,
                        svn_fs_fs__serialize_dir_entries,
                        svn_fs_fs__deserialize_dir_entries,
@@ -458,6 +480,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->packed_offset_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 1,
                        svn_fs_fs__serialize_manifest,
                        svn_fs_fs__deserialize_manifest,
@@ -474,6 +497,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->node_revision_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        2, 16, /* ~500 byte / entry; 32 entries total */
                        svn_fs_fs__serialize_node_revision,
                        svn_fs_fs__deserialize_node_revision,
@@ -489,6 +513,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->rep_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 200, /* ~40 bytes / entry; 200 entries total */
                        svn_fs_fs__serialize_rep_header,
                        svn_fs_fs__deserialize_rep_header,
@@ -504,6 +529,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->changes_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 8, /* 1k / entry; 8 entries total, rarely used */
                        svn_fs_fs__serialize_changes,
                        svn_fs_fs__deserialize_changes,
@@ -519,6 +545,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->revprop_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 20, /* ~400 bytes / entry, capa for ~2 packs */
                        svn_fs_fs__serialize_revprops,
                        svn_fs_fs__deserialize_revprops,
@@ -536,6 +563,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->fulltext_cache),
                            ffd->memcache,
                            membuffer,
+                           ffd->disk_cache,
                            0, 0, /* Do not use the inprocess cache */
                            /* Values are svn_stringbuf_t */
                            NULL, NULL,
@@ -550,6 +578,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_mergeinfo,
                            svn_fs_fs__deserialize_mergeinfo,
@@ -565,6 +594,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->mergeinfo_existence_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            /* Values are svn_stringbuf_t */
                            NULL, NULL,
@@ -590,6 +620,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->properties_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_properties,
                            svn_fs_fs__deserialize_properties,
@@ -613,6 +644,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->raw_window_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_raw_window,
                            svn_fs_fs__deserialize_raw_window,
@@ -628,6 +660,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->txdelta_window_cache),
                            NULL,
                            membuffer,
+                           ffd->disk_cache,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_txdelta_window,
                            svn_fs_fs__deserialize_txdelta_window,
@@ -643,6 +676,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->combined_window_cache),
                            NULL,
                            membuffer,
+                           ffd->disk_cache,
                            0, 0, /* Do not use the inprocess cache */
                            /* Values are svn_stringbuf_t */
                            NULL, NULL,
@@ -664,6 +698,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->l2p_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 16, /* entry size varies but we must cover a
                                  reasonable number of rev / pack files
                                  to allow for delta chains to be walked
@@ -681,6 +716,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->l2p_page_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 16, /* entry size varies but we must cover a
                                  reasonable number of rev / pack files
                                  to allow for delta chains to be walked
@@ -698,6 +734,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->p2l_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        4, 1, /* Large entries. Rarely used. */
                        svn_fs_fs__serialize_p2l_header,
                        svn_fs_fs__deserialize_p2l_header,
@@ -712,6 +749,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->p2l_page_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        4, 1, /* Variably sized entries. Rarely used. */
                        svn_fs_fs__serialize_p2l_page,
                        svn_fs_fs__deserialize_p2l_page,
@@ -871,6 +909,7 @@ svn_fs_fs__initialize_txn_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&ffd->txn_dir_cache,
                        NULL,
                        svn_cache__get_global_membuffer_cache(),
+                       NULL,
                        1024, 8,
                        svn_fs_fs__serialize_txndir_entries,
                        svn_fs_fs__deserialize_dir_entries,
@@ -28,6 +28,7 @@
 #include <apr_network_io.h>
 #include <apr_md5.h>
 #include <apr_sha1.h>
+#include <apr_thread_cond.h>
 
 #include "svn_fs.h"
 #include "svn_config.h"
@@ -53,6 +54,7 @@ extern "C" {
 #define PATH_FORMAT           "format"           /* Contains format number */
 #define PATH_UUID             "uuid"             /* Contains UUID */
 #define PATH_CURRENT          "current"          /* Youngest revision */
+#define PATH_NEXT             "next"             /* Revision being written */
 #define PATH_LOCK_FILE        "write-lock"       /* Revision lock file */
 #define PATH_PACK_LOCK_FILE   "pack-lock"        /* Pack lock file */
 #define PATH_REVS_DIR         "revs"             /* Directory of revisions */
@@ -100,6 +102,8 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_DISK_CACHE_PATH    "disk-cache-path"
+#define CONFIG_OPTION_DISK_CACHE_SIZE    "disk-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -115,6 +119,9 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_READ_AHEAD         "read-ahead"
+#define CONFIG_SECTION_COMMITS           "commits"
+#define CONFIG_OPTION_GROUP_COMMIT       "group-commit"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
@@ -127,7 +134,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -188,6 +195,9 @@ extern "C" {
 /* The minimum format number that supports svndiff version 2. */
 #define SVN_FS_FS__MIN_SVNDIFF2_FORMAT 8
 
+/* The minimum format number that supports svndiff version 3. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
 /* The minimum format number that supports the special notation ("-")
    for optional values that are not present in the representation strings,
    such as SHA1 or the uniquifier.  For example:
@@ -258,7 +268,10 @@ typedef struct fs_fs_shared_data_t
      declaration here.  Any subset may be acquired and held at any given
      time but their relative acquisition order must not change.
 
-     (lock 'txn-current' before 'pack' before 'write' before 'txn-list') */
+     (lock 'txn-current' before 'pack' before 'write' before 'txn-list')
+
+     The GROUP_COMMIT_LOCK below is never held while acquiring any of
+     the others. */
 
   /* A lock for intra-process synchronization when accessing the TXNS list. */
   svn_mutex__t *txn_list_lock;
@@ -275,6 +288,25 @@ typedef struct fs_fs_shared_data_t
      txn-current file. */
   svn_mutex__t *txn_current_lock;
 
+  /* Group commit support.  All members below are synchronised under
+     GROUP_COMMIT_LOCK.  COMMIT_QUEUE_HEAD and COMMIT_QUEUE_TAIL are the
+     FIFO of COMMIT_QUEUE_LENGTH commits waiting to be processed,
+     COMMIT_LEADER_ACTIVE is set while one of the waiting threads works
+     through that queue and COMMIT_GROUP_DONE gets signalled whenever it
+     is done with a group.  COMMIT_GROUPS counts those groups, for the
+     benefit of our tests.  COMMIT_GROUP_BROKEN is set after we failed
+     to make a group of new revisions visible.  See svn_fs_fs__commit(). */
+  svn_mutex__t *group_commit_lock;
+#if APR_HAS_THREADS
+  apr_thread_cond_t *commit_group_done;
+#endif
+  struct commit_baton *commit_queue_head;
+  struct commit_baton *commit_queue_tail;
+  int commit_queue_length;
+  apr_uint64_t commit_groups;
+  svn_boolean_t commit_leader_active;
+  svn_boolean_t commit_group_broken;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -315,7 +347,8 @@ typedef enum compression_type_t
 {
   compression_type_none,
   compression_type_zlib,
-  compression_type_lz4
+  compression_type_lz4,
+  compression_type_zstd
 } compression_type_t;
 
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
@@ -347,6 +380,19 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* Number of blocks to prefetch once block-read detects a sequential
+   * scan through a rev / pack file.  0 disables read-ahead. */
+  apr_int64_t read_ahead;
+
+  /* Start revision of the rev / pack file and start offset of the block
+   * that block-read got from disk last.  Used to detect sequential scans. */
+  svn_revnum_t last_block_rev;
+  apr_off_t last_block_start;
+
+  /* If set, read-only access to pack files will use memory mappings
+   * instead of buffered file I/O whenever possible. */
+  svn_boolean_t use_mmap;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -360,6 +406,9 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Persistent second-level cache for revision contents.  May be NULL. */
+  svn_cache__disk_t *disk_cache;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -496,7 +545,8 @@ typedef struct fs_fs_data_t
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
-  /* Compression level (currently, only used with compression_type_zlib). */
+  /* Compression level (currently, only used with compression_type_zlib
+     and compression_type_zstd). */
   int delta_compression_level;
 
   /* Pack after every commit. */
@@ -514,6 +564,10 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Let concurrent commits from within this process be processed in
+     groups.  See SVN_FS_CONFIG_GROUP_COMMIT. */
+  svn_boolean_t group_commit;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
@@ -692,7 +692,8 @@ parse_compression_option(compression_type_t *compression_type_p,
   int level;
   svn_boolean_t is_valid = TRUE;
 
-  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9 */
+  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9 | zstd
+   *               | zstd-1 ... zstd-19 */
   if (strcmp(value, "none") == 0)
     {
       type = compression_type_none;
@@ -722,6 +723,25 @@ parse_compression_option(compression_type_t *compression_type_p,
       else
         is_valid = FALSE;
     }
+  else if (strncmp(value, "zstd", 4) == 0)
+    {
+      const char *p = value + 4;
+
+      type = compression_type_zstd;
+      if (*p == 0)
+        {
+          level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+        }
+      else if (*p == '-')
+        {
+          p++;
+          SVN_ERR(svn_cstring_atoi(&level, p));
+          if (level < 1 || level > 19)
+            is_valid = FALSE;
+        }
+      else
+        is_valid = FALSE;
+    }
   else
     {
       is_valid = FALSE;
@@ -747,6 +767,8 @@ read_config(fs_fs_data_t *ffd,
             apr_pool_t *scratch_pool)
 {
   svn_config_t *config;
+  const char *disk_cache_path;
+  apr_int64_t disk_cache_size;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -824,6 +846,10 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_IO,
                                    CONFIG_OPTION_P2L_PAGE_SIZE,
                                    0x400));
+      SVN_ERR(svn_config_get_int64(config, &ffd->read_ahead,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_READ_AHEAD,
+                                   4));
 
       /* Don't accept unreasonable or illegal values.
        * Block size and P2L page size are in kbytes;
@@ -839,6 +865,10 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size *= 0x400;
       ffd->p2l_page_size *= 0x400;
       /* L2P pages are in entries - not in (k)Bytes */
+
+      /* Negative read-ahead simply means "none". */
+      if (ffd->read_ahead < 0)
+        ffd->read_ahead = 0;
     }
   else
     {
@@ -846,6 +876,7 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size = 0x1000; /* Matches default APR file buffer size. */
       ffd->l2p_page_size = 0x2000;    /* Matches above default. */
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
+      ffd->read_ahead = 0;            /* No block-read without log. addr. */
     }
 
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
@@ -890,6 +921,18 @@ read_config(fs_fs_data_t *ffd,
                                       _("Compression type 'lz4' requires "
                                         "filesystem format 8 or higher"));
             }
+          if (ffd->delta_compression_type == compression_type_zstd)
+            {
+              if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' requires "
+                                          "filesystem format 9 or higher"));
+              if (!svn_zstd__is_available())
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' is not "
+                                          "supported by this build of "
+                                          "Subversion"));
+            }
         }
       else if (compression_level_val)
         {
@@ -925,6 +968,11 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->group_commit,
+                              CONFIG_SECTION_COMMITS,
+                              CONFIG_OPTION_GROUP_COMMIT,
+                              FALSE));
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -945,6 +993,39 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* persistent second-level cache */
+  svn_config_get(config, &disk_cache_path, CONFIG_SECTION_CACHES,
+                 CONFIG_OPTION_DISK_CACHE_PATH, NULL);
+  SVN_ERR(svn_config_get_int64(config, &disk_cache_size,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_DISK_CACHE_SIZE, 1024));
+  ffd->disk_cache = NULL;
+
+  /* Older formats have no instance ID to tell a reloaded repository with
+   * the same UUID and path apart from its predecessor.  Stale entries on
+   * disk would then be served as current data. */
+  if (disk_cache_path && disk_cache_size > 0
+      && ffd->format >= SVN_FS_FS__MIN_INSTANCE_ID_FORMAT)
+    {
+      svn_error_t *err
+        = svn_cache__disk_open(&ffd->disk_cache,
+                               svn_dirent_join(fs_path, disk_cache_path,
+                                               scratch_pool),
+                               (apr_uint64_t)disk_cache_size * 0x100000,
+                               scratch_pool);
+
+      /* Like all caches, this one is optional. */
+      if (err && !ffd->fail_stop)
+        {
+          svn_error_clear(err);
+          ffd->disk_cache = NULL;
+        }
+      else
+        {
+          SVN_ERR(err);
+        }
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -978,6 +1059,17 @@ write_config(svn_fs_t *fs,
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
 ""                                                                           NL
+"### The following options enable a persistent second-level cache for"       NL
+"### file contents and deltas.  It is kept in a memory-mapped file that"     NL
+"### survives server restarts, so that a freshly started server does not"    NL
+"### have to read everything from the repository again.  Relative paths"     NL
+"### are relative to this repository's db directory.  The size is given"     NL
+"### in MB and defaults to 1024.  Several repositories and server"           NL
+"### processes may use the same file but should then agree on its size."     NL
+"### This cache is only used with repositories of format 7 and later."       NL
+"# " CONFIG_OPTION_DISK_CACHE_PATH " = /var/cache/svn/fsfs-cache"            NL
+"# " CONFIG_OPTION_DISK_CACHE_SIZE " = 1024"                                 NL
+""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
 "### duplicate representations.  This comes at a slight cost in"             NL
@@ -1058,19 +1150,26 @@ write_config(svn_fs_t *fs,
 "### After deltification, we compress the data to minimize on-disk size."    NL
 "### This setting controls the compression algorithm, which will be used in" NL
 "### future revisions.  It can be used to either disable compression or to"  NL
-"### select between available algorithms (zlib, lz4).  zlib is a general-"   NL
-"### purpose compression algorithm.  lz4 is a fast compression algorithm"    NL
-"### which should be preferred for repositories with large and, possibly,"   NL
-"### incompressible files.  Note that the compression ratio of lz4 is"       NL
-"### usually lower than the one provided by zlib, but using it can"          NL
+"### select between available algorithms (zlib, lz4, zstd).  zlib is a"      NL
+"### general-purpose compression algorithm.  lz4 is a fast compression"      NL
+"### algorithm which should be preferred for repositories with large and,"   NL
+"### possibly, incompressible files.  Note that the compression ratio of"    NL
+"### lz4 is usually lower than the one provided by zlib, but using it can"   NL
 "### significantly speed up commits as well as reading the data."            NL
 "### lz4 compression algorithm is supported, starting from format 8"         NL
 "### repositories, available in Subversion 1.10 and higher."                 NL
+"### zstd (Zstandard) provides compression ratios similar to zlib's at a"    NL
+"### decompression speed close to lz4's.  It is supported, starting from"    NL
+"### format 9 repositories, available in Subversion 1.11 and higher, but"    NL
+"### only if Subversion has been built with zstd support.  Builds without"   NL
+"### it will not be able to read data written with this setting."            NL
 "### The syntax of this option is:"                                          NL
 "###   " CONFIG_OPTION_COMPRESSION " = none | lz4 | zlib | zlib-1 ... zlib-9" NL
+"###                 | zstd | zstd-1 ... zstd-19"                            NL
 "### Versions prior to Subversion 1.10 will ignore this option."             NL
 "### The default value is 'lz4' if supported by the repository format and"   NL
-"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5'."         NL
+"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5' and"      NL
+"### 'zstd' to 'zstd-5'."                                                    NL
 "# " CONFIG_OPTION_COMPRESSION " = lz4"                                      NL
 "###"                                                                        NL
 "### DEPRECATED: The new '" CONFIG_OPTION_COMPRESSION "' option deprecates previously used" NL
@@ -1147,6 +1246,25 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### When block-read finds that the blocks of a rev or pack file are being"  NL
+"### read one after the other, e.g. during 'svn log -v' or a checkout, it"   NL
+"### asks the OS to fetch the next few blocks in the background.  This"      NL
+"### overlaps disk latency with parsing but may waste I/O bandwidth on"      NL
+"### otherwise random access patterns.  Set it to 0 to disable this."        NL
+"### read-ahead is given in blocks and with a default of 4 blocks."          NL
+"# " CONFIG_OPTION_READ_AHEAD " = 4"                                         NL
+""                                                                           NL
+"[" CONFIG_SECTION_COMMITS "]"                                               NL
+"### Set this to 'true' to let concurrent commits within the same server"    NL
+"### process be written as one group that is made durable with a single"     NL
+"### combined disk flush.  This increases commit throughput on busy"         NL
+"### servers where flushes are slow, at the expense of some latency for"     NL
+"### the individual commit.  Commits are never grouped while memcached or"   NL
+"### the persistent disk cache is in use."                                   NL
+"### The '" SVN_FS_CONFIG_GROUP_COMMIT "' filesystem configuration option"   NL
+"### overrides this setting."                                                NL
+"# " CONFIG_OPTION_GROUP_COMMIT " = false"                                   NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1173,6 +1291,12 @@ read_global_config(svn_fs_t *fs)
   ffd->flush_to_disk = !svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
+  ffd->use_mmap = svn_hash__get_bool(fs->config,
+                                     SVN_FS_CONFIG_FSFS_MMAP_PACKED,
+                                     FALSE);
+  ffd->group_commit = svn_hash__get_bool(fs->config,
+                                         SVN_FS_CONFIG_GROUP_COMMIT,
+                                         ffd->group_commit);
 
   /* Ignore the user-specified larger block size if we don't use block-read.
      Defaulting to 4k gives us the same access granularity in format 7 as in
@@ -1950,6 +2074,8 @@ svn_fs_fs__create(svn_fs_t *fs,
                   break;
           case 9: format = 7;
                   break;
+          case 10: format = 8;
+                  break;
 
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
@@ -2322,8 +2448,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 11;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -48,6 +48,25 @@ svn_error_t *svn_fs_fs__initialize_shared_data(svn_fs_t *fs,
                                                apr_pool_t *pool,
                                                apr_pool_t *common_pool);
 
+/* Open another instance of the already opened fsfs filesystem FS and
+   return it in *NEW_FS.  The new instance has the same configuration and
+   shares the process-wide data with FS but has its own cache front-ends,
+   file handles etc.  Hence, both may be used concurrently from different
+   threads.  Allocate *NEW_FS in RESULT_POOL and use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *svn_fs_fs__open_instance(svn_fs_t **new_fs,
+                                      svn_fs_t *fs,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool);
+
+/* Implements svn_task__thread_context_constructor_t.
+   Set *THREAD_CONTEXT to a new instance of the svn_fs_t given as BATON,
+   as returned by svn_fs_fs__open_instance(). */
+svn_error_t *svn_fs_fs__open_task_instance(void **thread_context,
+                                           void *baton,
+                                           apr_pool_t *result_pool,
+                                           apr_pool_t *scratch_pool);
+
 /* Upgrade the fsfs filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
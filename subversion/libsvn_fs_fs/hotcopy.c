@@ -22,6 +22,7 @@
 #include "svn_pools.h"
 #include "svn_path.h"
 #include "svn_dirent_uri.h"
+#include "svn_sorts.h"
 
 #include "fs_fs.h"
 #include "hotcopy.h"
@@ -32,15 +33,77 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "private/svn_io_private.h"
+#include "private/svn_task.h"
+
 #include "svn_private_config.h"
 
+/* Number of non-packed revisions that we copy before we fsync them.
+ * This limits the number of open file handles per thread. */
+#define FSYNC_BATCH_REVS 32
+
+/* Number of revisions to copy per task in a non-sharded repository. */
+#define UNSHARDED_REVS_PER_TASK 1000
+
+/* Copy FILE from SRC_PATH to DST_PATH like svn_io_dir_file_copy() does
+ * but schedule the result to be fsync'ed in BATCH.  Where supported by
+ * the OS, let the kernel copy the file contents.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+batched_dir_file_copy(svn_io__batch_fsync_t *batch,
+                      const char *src_path,
+                      const char *dst_path,
+                      const char *file,
+                      apr_pool_t *scratch_pool)
+{
+  const char *src_target = svn_dirent_join(src_path, file, scratch_pool);
+  const char *dst_target = svn_dirent_join(dst_path, file, scratch_pool);
+
+#ifdef SVN_ON_POSIX
+
+  /* Copy to a temporary file and then rename it into place, just like
+   * svn_io_copy_file().  We can keep the handle open across the rename
+   * and fsync it later. */
+  apr_file_t *src_file;
+  apr_file_t *tmp_file;
+  const char *tmp_path;
+
+  SVN_ERR(svn_io_open_unique_file3(NULL, &tmp_path, dst_path,
+                                   svn_io_file_del_none,
+                                   scratch_pool, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_open_file(&tmp_file, batch, tmp_path,
+                                        scratch_pool));
+
+  SVN_ERR(svn_io_file_open(&src_file, src_target, APR_READ,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io__file_copy_contents(tmp_file, src_file, scratch_pool));
+  SVN_ERR(svn_io_file_close(src_file, scratch_pool));
+
+  SVN_ERR(svn_io_copy_perms(src_target, tmp_path, scratch_pool));
+  SVN_ERR(svn_io_file_rename2(tmp_path, dst_target, FALSE, scratch_pool));
+
+#else
+
+  /* Renaming open files is not generally supported here.  Copy the file
+   * as usual and fsync the result. */
+  SVN_ERR(svn_io_dir_file_copy(src_path, dst_path, file, scratch_pool));
+
+#endif
+
+  /* Make sure the new directory entry gets fsync'ed as well. */
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, dst_target, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Like svn_io_dir_file_copy(), but doesn't copy files that exist at
  * the destination and do not differ in terms of kind, size, and mtime.
  * Set *SKIPPED_P to FALSE only if the file was copied, do not change
  * the value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not
- * required. */
+ * required.  If BATCH is not NULL, schedule the copy for fsync in it. */
 static svn_error_t *
 hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
+                         svn_io__batch_fsync_t *batch,
                          const char *src_path,
                          const char *dst_path,
                          const char *file,
@@ -72,6 +135,10 @@ hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
   if (skipped_p)
     *skipped_p = FALSE;
 
+  if (batch)
+    return svn_error_trace(batched_dir_file_copy(batch, src_path, dst_path,
+                                                 file, scratch_pool));
+
   return svn_error_trace(svn_io_dir_file_copy(src_path, dst_path, file,
                                               scratch_pool));
 }
@@ -115,9 +182,11 @@ entry_name_to_utf8(const char **name_p,
  * exist in the destination and do not differ from the source in terms of
  * kind, size, and mtime. Set *SKIPPED_P to FALSE only if at least one
  * file was copied, do not change the value in *SKIPPED_P otherwise.
- * SKIPPED_P may be NULL if not required. */
+ * SKIPPED_P may be NULL if not required.  If BATCH is not NULL, schedule
+ * all copied files for fsync in it. */
 static svn_error_t *
 hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
+                                svn_io__batch_fsync_t *batch,
                                 const char *src,
                                 const char *dst_parent,
                                 const char *dst_basename,
@@ -158,6 +227,8 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
   /* Create the new directory. */
   /* ### TODO: copy permissions (needs apr_file_attrs_get()) */
   SVN_ERR(svn_io_make_dir_recursively(dst_path, pool));
+  if (batch)
+    SVN_ERR(svn_io__batch_fsync_new_path(batch, dst_path, pool));
 
   /* Loop over the dirents in SRC.  ('.' and '..' are auto-excluded) */
   SVN_ERR(svn_io_dir_open(&this_dir, src, subpool));
@@ -184,8 +255,9 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
                                      src, subpool));
           if (this_entry.filetype == APR_REG) /* regular file */
             {
-              SVN_ERR(hotcopy_io_dir_file_copy(skipped_p, src, dst_path,
-                                               entryname_utf8, subpool));
+              SVN_ERR(hotcopy_io_dir_file_copy(skipped_p, batch, src,
+                                               dst_path, entryname_utf8,
+                                               subpool));
             }
           else if (this_entry.filetype == APR_LNK) /* symlink */
             {
@@ -209,6 +281,7 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
 
               src_target = svn_dirent_join(src, entryname_utf8, subpool);
               SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p,
+                                                      batch,
                                                       src_target,
                                                       dst_path,
                                                       entryname_utf8,
@@ -241,9 +314,11 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
  * to DST_SUBDIR. Assume a sharding layout based on MAX_FILES_PER_DIR.
  * Set *SKIPPED_P to FALSE only if the file was copied, do not change the
  * value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not required.
+ * If BATCH is not NULL, schedule the copy for fsync in it.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
+                        svn_io__batch_fsync_t *batch,
                         const char *src_subdir,
                         const char *dst_subdir,
                         svn_revnum_t rev,
@@ -265,10 +340,13 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
           SVN_ERR(svn_io_make_dir_recursively(dst_subdir_shard, scratch_pool));
           SVN_ERR(svn_io_copy_perms(dst_subdir, dst_subdir_shard,
                                     scratch_pool));
+          if (batch)
+            SVN_ERR(svn_io__batch_fsync_new_path(batch, dst_subdir_shard,
+                                                 scratch_pool));
         }
     }
 
-  SVN_ERR(hotcopy_io_dir_file_copy(skipped_p,
+  SVN_ERR(hotcopy_io_dir_file_copy(skipped_p, batch,
                                    src_subdir_shard, dst_subdir_shard,
                                    apr_psprintf(scratch_pool, "%ld", rev),
                                    scratch_pool));
@@ -279,19 +357,22 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
 
 /* Copy a packed shard containing revision REV, and which contains
  * MAX_FILES_PER_DIR revisions, from SRC_FS to DST_FS.
- * Update *DST_MIN_UNPACKED_REV in case the shard is new in DST_FS.
  * Do not re-copy data which already exists in DST_FS.
  * Set *SKIPPED_P to FALSE only if at least one part of the shard
  * was copied, do not change the value in *SKIPPED_P otherwise.
- * SKIPPED_P may be NULL if not required.
+ * SKIPPED_P may be NULL if not required.  Schedule all copies for fsync
+ * in BATCH, which may get run multiple times.  This function will not
+ * access any shared data, i.e. it may be called from any thread.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
-                          svn_revnum_t *dst_min_unpacked_rev,
+                          svn_io__batch_fsync_t *batch,
                           svn_fs_t *src_fs,
                           svn_fs_t *dst_fs,
                           svn_revnum_t rev,
                           int max_files_per_dir,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
                           apr_pool_t *scratch_pool)
 {
   const char *src_subdir;
@@ -309,10 +390,11 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                               rev / max_files_per_dir);
   src_subdir_packed_shard = svn_dirent_join(src_subdir, packed_shard,
                                             scratch_pool);
-  SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p, src_subdir_packed_shard,
+  SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p, batch,
+                                          src_subdir_packed_shard,
                                           dst_subdir, packed_shard,
                                           TRUE /* copy_perms */,
-                                          NULL /* cancel_func */, NULL,
+                                          cancel_func, cancel_baton,
                                           scratch_pool));
 
   /* Copy revprops belonging to revisions in this pack. */
@@ -330,9 +412,17 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
         {
           svn_pool_clear(iterpool);
 
-          SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          SVN_ERR(hotcopy_copy_shard_file(skipped_p, batch,
+                                          src_subdir, dst_subdir,
                                           revprop_rev, max_files_per_dir,
                                           iterpool));
+
+          /* Limit the number of open file handles. */
+          if ((revprop_rev + 1) % FSYNC_BATCH_REVS == 0)
+            SVN_ERR(svn_io__batch_fsync_run(batch, iterpool));
         }
       svn_pool_destroy(iterpool);
     }
@@ -340,7 +430,8 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
     {
       /* revprop for revision 0 will never be packed */
       if (rev == 0)
-        SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
+        SVN_ERR(hotcopy_copy_shard_file(skipped_p, batch,
+                                        src_subdir, dst_subdir,
                                         0, max_files_per_dir,
                                         scratch_pool));
 
@@ -349,23 +440,14 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                                   rev / max_files_per_dir);
       src_subdir_packed_shard = svn_dirent_join(src_subdir, packed_shard,
                                                 scratch_pool);
-      SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p,
+      SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p, batch,
                                               src_subdir_packed_shard,
                                               dst_subdir, packed_shard,
                                               TRUE /* copy_perms */,
-                                              NULL /* cancel_func */, NULL,
+                                              cancel_func, cancel_baton,
                                               scratch_pool));
     }
 
-  /* If necessary, update the min-unpacked rev file in the hotcopy. */
-  if (*dst_min_unpacked_rev < rev + max_files_per_dir)
-    {
-      *dst_min_unpacked_rev = rev + max_files_per_dir;
-      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
-                                                *dst_min_unpacked_rev,
-                                                scratch_pool));
-    }
-
   return SVN_NO_ERROR;
 }
 
@@ -532,6 +614,274 @@ remove_folder(const char *path,
   return svn_error_trace(err);
 }
 
+/* Baton for the hotcopy_revisions_process() and hotcopy_revisions_output()
+ * callbacks. */
+typedef struct hotcopy_revisions_baton_t
+{
+  svn_fs_t *src_fs;
+  svn_fs_t *dst_fs;
+  svn_revnum_t src_youngest;
+  svn_revnum_t dst_youngest;
+  svn_boolean_t incremental;
+  const char *src_revs_dir;
+  const char *dst_revs_dir;
+  const char *src_revprops_dir;
+  const char *dst_revprops_dir;
+  int max_files_per_dir;
+
+  /* The first tasks copy that many packed shards. */
+  apr_int64_t packed_shards;
+
+  /* First non-packed revision in the source. */
+  svn_revnum_t src_min_unpacked_rev;
+
+  /* Number of non-packed revisions copied by each of the remaining tasks.
+   * This is aligned with the shard size, if there is sharding. */
+  svn_revnum_t revs_per_task;
+
+  /* Current value of the destination's 'min-unpacked-rev' file.
+   * Only accessed by hotcopy_revisions_output(). */
+  svn_revnum_t dst_min_unpacked_rev;
+
+  svn_fs_hotcopy_notify_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} hotcopy_revisions_baton_t;
+
+/* Result of a hotcopy_revisions_process() task. */
+typedef struct hotcopy_task_result_t
+{
+  /* Range of revisions covered by the task, END_REV being exclusive. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+
+  /* Whether this was a packed shard. */
+  svn_boolean_t packed;
+
+  /* Per-revision flags indicating that nothing needed to be copied.
+   * For packed shards, there is only a single flag for the whole shard. */
+  svn_boolean_t *skipped;
+} hotcopy_task_result_t;
+
+/* Implements svn_task__process_func_t.  Copy all files belonging to the
+ * packed shard or range of non-packed revisions identified by TASK_INDEX
+ * and fsync them.  PROCESS_BATON is a hotcopy_revisions_baton_t.  Return
+ * a hotcopy_task_result_t in *RESULT.
+ */
+static svn_error_t *
+hotcopy_revisions_process(void **result,
+                          void *process_baton,
+                          void *thread_context,
+                          apr_int64_t task_index,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  hotcopy_revisions_baton_t *baton = process_baton;
+  fs_fs_data_t *dst_ffd = baton->dst_fs->fsap_data;
+  hotcopy_task_result_t *task_result;
+  svn_io__batch_fsync_t *batch;
+
+  task_result = apr_pcalloc(result_pool, sizeof(*task_result));
+  SVN_ERR(svn_io__batch_fsync_create(&batch, dst_ffd->flush_to_disk,
+                                     scratch_pool));
+
+  if (task_index < baton->packed_shards)
+    {
+      task_result->packed = TRUE;
+      task_result->start_rev
+        = (svn_revnum_t)task_index * baton->max_files_per_dir;
+      task_result->end_rev
+        = task_result->start_rev + baton->max_files_per_dir;
+      task_result->skipped = apr_palloc(result_pool,
+                                        sizeof(*task_result->skipped));
+      task_result->skipped[0] = TRUE;
+
+      /* Copy the packed shard. */
+      SVN_ERR(hotcopy_copy_packed_shard(&task_result->skipped[0], batch,
+                                        baton->src_fs, baton->dst_fs,
+                                        task_result->start_rev,
+                                        baton->max_files_per_dir,
+                                        cancel_func, cancel_baton,
+                                        scratch_pool));
+    }
+  else
+    {
+      svn_revnum_t rev;
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+      task_result->start_rev
+        = baton->src_min_unpacked_rev
+        + (svn_revnum_t)(task_index - baton->packed_shards)
+          * baton->revs_per_task;
+      task_result->end_rev = MIN(task_result->start_rev
+                                   + baton->revs_per_task,
+                                 baton->src_youngest + 1);
+      task_result->skipped
+        = apr_palloc(result_pool,
+                     (task_result->end_rev - task_result->start_rev)
+                       * sizeof(*task_result->skipped));
+
+      for (rev = task_result->start_rev; rev < task_result->end_rev; rev++)
+        {
+          svn_boolean_t *skipped
+            = &task_result->skipped[rev - task_result->start_rev];
+
+          svn_pool_clear(iterpool);
+
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          /* Copying non-packed revisions is racy in case the source
+           * repository is being packed concurrently with this hotcopy
+           * operation. The race can happen with FS formats prior to
+           * SVN_FS_FS__MIN_PACK_LOCK_FORMAT that support packed revisions.
+           * With the pack lock, however, the race is impossible, because
+           * hotcopy and pack operations block each other.
+           *
+           * We assume that all revisions coming after 'min-unpacked-rev'
+           * really are unpacked and that's not necessarily true with
+           * concurrent packing.  Don't try to be smart in this edge case,
+           * because handling it properly might require copying *everything*
+           * from the start. Just abort the hotcopy with an ENOENT (revision
+           * file moved to a pack, so it is no longer where we expect it to
+           * be). */
+
+          *skipped = TRUE;
+
+          /* Copy the rev file. */
+          SVN_ERR(hotcopy_copy_shard_file(skipped, batch,
+                                          baton->src_revs_dir,
+                                          baton->dst_revs_dir, rev,
+                                          baton->max_files_per_dir,
+                                          iterpool));
+          /* Copy the revprop file. */
+          SVN_ERR(hotcopy_copy_shard_file(skipped, batch,
+                                          baton->src_revprops_dir,
+                                          baton->dst_revprops_dir, rev,
+                                          baton->max_files_per_dir,
+                                          iterpool));
+
+          /* Limit the number of open file handles. */
+          if ((rev + 1) % FSYNC_BATCH_REVS == 0)
+            SVN_ERR(svn_io__batch_fsync_run(batch, iterpool));
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
+  /* The data must be on disk before we bump 'current'. */
+  SVN_ERR(svn_io__batch_fsync_run(batch, scratch_pool));
+
+  *result = task_result;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Update the checkpoints in the
+ * destination repository for the hotcopy_task_result_t RESULT, send
+ * notifications and clean up obsolete files.  OUTPUT_BATON is a
+ * hotcopy_revisions_baton_t.
+ */
+static svn_error_t *
+hotcopy_revisions_output(void *result,
+                         void *output_baton,
+                         apr_int64_t task_index,
+                         apr_pool_t *scratch_pool)
+{
+  hotcopy_revisions_baton_t *baton = output_baton;
+  hotcopy_task_result_t *task_result = result;
+  svn_fs_t *dst_fs = baton->dst_fs;
+  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
+  int max_files_per_dir = baton->max_files_per_dir;
+  svn_revnum_t rev = task_result->start_rev;
+
+  if (task_result->packed)
+    {
+      svn_revnum_t pack_end_rev = task_result->end_rev - 1;
+
+      /* If necessary, update the min-unpacked rev file in the hotcopy. */
+      if (baton->dst_min_unpacked_rev < task_result->end_rev)
+        {
+          baton->dst_min_unpacked_rev = task_result->end_rev;
+          SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
+                                                    task_result->end_rev,
+                                                    scratch_pool));
+        }
+
+      /* Whenever this pack did not previously exist in the destination,
+       * update 'current' to the most recent packed rev (so readers can see
+       * new revisions which arrived in this pack). */
+      if (pack_end_rev > baton->dst_youngest)
+        {
+          SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
+                                           scratch_pool));
+        }
+
+      /* When notifying about packed shards, make things simpler by either
+       * reporting a full revision range, i.e [pack start, pack end] or
+       * reporting nothing. There is one case when this approach might not
+       * be exact (incremental hotcopy with a pack replacing last unpacked
+       * revisions), but generally this is good enough. */
+      if (baton->notify_func && !task_result->skipped[0])
+        baton->notify_func(baton->notify_baton, rev, pack_end_rev,
+                           scratch_pool);
+
+      /* Remove revision files which are now packed. */
+      if (baton->incremental)
+        {
+          SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
+                                           rev + max_files_per_dir,
+                                           max_files_per_dir, scratch_pool));
+          if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+            SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
+                                                 rev + max_files_per_dir,
+                                                 max_files_per_dir,
+                                                 scratch_pool));
+        }
+
+      /* Now that all revisions have moved into the pack, the original
+       * rev dir can be removed. */
+      SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev,
+                                                      scratch_pool),
+                            baton->cancel_func, baton->cancel_baton,
+                            scratch_pool));
+      if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+        SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
+                                                             scratch_pool),
+                              baton->cancel_func, baton->cancel_baton,
+                              scratch_pool));
+    }
+  else
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      for (; rev < task_result->end_rev; rev++)
+        {
+          svn_pool_clear(iterpool);
+
+          /* Whenever this revision did not previously exist in the
+           * destination, checkpoint the progress via 'current' (do that
+           * once per full shard in order not to slow things down). */
+          if (rev > baton->dst_youngest)
+            {
+              if (max_files_per_dir && (rev % max_files_per_dir == 0))
+                {
+                  SVN_ERR(svn_fs_fs__write_current(dst_fs, rev, 0, 0,
+                                                   iterpool));
+                }
+            }
+
+          if (baton->notify_func
+              && !task_result->skipped[rev - task_result->start_rev])
+            baton->notify_func(baton->notify_baton, rev, rev, iterpool);
+        }
+      svn_pool_destroy(iterpool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy the revision and revprop files (possibly sharded / packed) from
  * SRC_FS to DST_FS.  Do not re-copy data which already exists in DST_FS.
  * When copying packed or unpacked shards, checkpoint the result in DST_FS
@@ -539,6 +889,10 @@ remove_folder(const char *path,
  * the >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT filesystem format without
  * global next-ID counters.  Indicate progress via the optional NOTIFY_FUNC
  * callback using NOTIFY_BATON.  Use POOL for temporary allocations.
+ *
+ * Shards get copied concurrently by as many threads as SRC_FS has been
+ * configured for.  The copied files are fsync'ed in batches before they
+ * become visible through 'current'.
  */
 static svn_error_t *
 hotcopy_revisions(svn_fs_t *src_fs,
@@ -557,12 +911,12 @@ hotcopy_revisions(svn_fs_t *src_fs,
                   apr_pool_t *pool)
 {
   fs_fs_data_t *src_ffd = src_fs->fsap_data;
-  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
   int max_files_per_dir = src_ffd->max_files_per_dir;
   svn_revnum_t src_min_unpacked_rev;
   svn_revnum_t dst_min_unpacked_rev;
-  svn_revnum_t rev;
-  apr_pool_t *iterpool;
+  hotcopy_revisions_baton_t baton;
+  apr_int64_t unpacked_tasks;
+  int jobs;
 
   /* Copy the min unpacked rev, and read its value. */
   if (src_ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
@@ -598,129 +952,45 @@ hotcopy_revisions(svn_fs_t *src_fs,
 
   /*
    * Copy the necessary rev files.
+   *
+   * The first tasks copy one packed shard each.  The remaining ones copy
+   * pairs of non-packed revisions and revprop files, one shard at a time.
    */
-
-  iterpool = svn_pool_create(pool);
-  /* First, copy packed shards. */
-  for (rev = 0; rev < src_min_unpacked_rev; rev += max_files_per_dir)
-    {
-      svn_boolean_t skipped = TRUE;
-      svn_revnum_t pack_end_rev;
-
-      svn_pool_clear(iterpool);
-
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Copy the packed shard. */
-      SVN_ERR(hotcopy_copy_packed_shard(&skipped, &dst_min_unpacked_rev,
-                                        src_fs, dst_fs,
-                                        rev, max_files_per_dir,
-                                        iterpool));
-
-      pack_end_rev = rev + max_files_per_dir - 1;
-
-      /* Whenever this pack did not previously exist in the destination,
-       * update 'current' to the most recent packed rev (so readers can see
-       * new revisions which arrived in this pack). */
-      if (pack_end_rev > dst_youngest)
-        {
-          SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
-                                           iterpool));
-        }
-
-      /* When notifying about packed shards, make things simpler by either
-       * reporting a full revision range, i.e [pack start, pack end] or
-       * reporting nothing. There is one case when this approach might not
-       * be exact (incremental hotcopy with a pack replacing last unpacked
-       * revisions), but generally this is good enough. */
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, pack_end_rev, iterpool);
-
-      /* Remove revision files which are now packed. */
-      if (incremental)
-        {
-          SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
-                                           rev + max_files_per_dir,
-                                           max_files_per_dir, iterpool));
-          if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-            SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
-                                                 rev + max_files_per_dir,
-                                                 max_files_per_dir,
-                                                 iterpool));
-        }
-
-      /* Now that all revisions have moved into the pack, the original
-       * rev dir can be removed. */
-      SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, iterpool),
-                            cancel_func, cancel_baton, iterpool));
-      if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-        SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
-                                                             iterpool),
-                              cancel_func, cancel_baton, iterpool));
-    }
-
-  if (cancel_func)
-    SVN_ERR(cancel_func(cancel_baton));
-
-  SVN_ERR_ASSERT(rev == src_min_unpacked_rev);
-  SVN_ERR_ASSERT(src_min_unpacked_rev == dst_min_unpacked_rev);
-
-  /* Now, copy pairs of non-packed revisions and revprop files.
-   * If necessary, update 'current' after copying all files from a shard. */
-  for (; rev <= src_youngest; rev++)
-    {
-      svn_boolean_t skipped = TRUE;
-
-      svn_pool_clear(iterpool);
-
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Copying non-packed revisions is racy in case the source repository is
-       * being packed concurrently with this hotcopy operation. The race can
-       * happen with FS formats prior to SVN_FS_FS__MIN_PACK_LOCK_FORMAT that
-       * support packed revisions. With the pack lock, however, the race is
-       * impossible, because hotcopy and pack operations block each other.
-       *
-       * We assume that all revisions coming after 'min-unpacked-rev' really
-       * are unpacked and that's not necessarily true with concurrent packing.
-       * Don't try to be smart in this edge case, because handling it properly
-       * might require copying *everything* from the start. Just abort the
-       * hotcopy with an ENOENT (revision file moved to a pack, so it is no
-       * longer where we expect it to be). */
-
-      /* Copy the rev file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revs_dir, dst_revs_dir, rev,
-                                      max_files_per_dir,
-                                      iterpool));
-      /* Copy the revprop file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revprops_dir, dst_revprops_dir,
-                                      rev, max_files_per_dir,
-                                      iterpool));
-
-      /* Whenever this revision did not previously exist in the destination,
-       * checkpoint the progress via 'current' (do that once per full shard
-       * in order not to slow things down). */
-      if (rev > dst_youngest)
-        {
-          if (max_files_per_dir && (rev % max_files_per_dir == 0))
-            {
-              SVN_ERR(svn_fs_fs__write_current(dst_fs, rev, 0, 0,
-                                               iterpool));
-            }
-        }
-
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, rev, iterpool);
-    }
-  svn_pool_destroy(iterpool);
-
-  /* We assume that all revisions were copied now, i.e. we didn't exit the
-   * above loop early. 'rev' was last incremented during exit of the loop. */
-  SVN_ERR_ASSERT(rev == src_youngest + 1);
+  baton.src_fs = src_fs;
+  baton.dst_fs = dst_fs;
+  baton.src_youngest = src_youngest;
+  baton.dst_youngest = dst_youngest;
+  baton.incremental = incremental;
+  baton.src_revs_dir = src_revs_dir;
+  baton.dst_revs_dir = dst_revs_dir;
+  baton.src_revprops_dir = src_revprops_dir;
+  baton.dst_revprops_dir = dst_revprops_dir;
+  baton.max_files_per_dir = max_files_per_dir;
+  baton.packed_shards = max_files_per_dir
+                      ? src_min_unpacked_rev / max_files_per_dir
+                      : 0;
+  baton.src_min_unpacked_rev = src_min_unpacked_rev;
+  baton.revs_per_task = max_files_per_dir
+                      ? max_files_per_dir
+                      : UNSHARDED_REVS_PER_TASK;
+  baton.dst_min_unpacked_rev = dst_min_unpacked_rev;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  unpacked_tasks = (src_youngest - src_min_unpacked_rev + baton.revs_per_task)
+                 / baton.revs_per_task;
+
+  SVN_ERR(svn_fs_fs__get_parallel_jobs(&jobs, src_fs));
+  SVN_ERR(svn_task__run(jobs, baton.packed_shards + unpacked_tasks,
+                        NULL, NULL,
+                        hotcopy_revisions_process, &baton,
+                        hotcopy_revisions_output, &baton,
+                        cancel_func, cancel_baton, pool));
+
+  /* We assume that all revisions were copied now. */
+  SVN_ERR_ASSERT(src_min_unpacked_rev == baton.dst_min_unpacked_rev);
 
   return SVN_NO_ERROR;
 }
@@ -759,10 +1029,11 @@ hotcopy_revisions_old(svn_fs_t *src_fs,
       if (cancel_func)
         SVN_ERR(cancel_func(cancel_baton));
 
-      SVN_ERR(hotcopy_io_dir_file_copy(&skipped, src_revs_dir, dst_revs_dir,
+      SVN_ERR(hotcopy_io_dir_file_copy(&skipped, NULL,
+                                       src_revs_dir, dst_revs_dir,
                                        apr_psprintf(iterpool, "%ld", rev),
                                        iterpool));
-      SVN_ERR(hotcopy_io_dir_file_copy(&skipped, src_revprops_dir,
+      SVN_ERR(hotcopy_io_dir_file_copy(&skipped, NULL, src_revprops_dir,
                                        dst_revprops_dir,
                                        apr_psprintf(iterpool, "%ld", rev),
                                        iterpool));
@@ -963,7 +1234,8 @@ hotcopy_body(void *baton, apr_pool_t *pool)
   src_subdir = svn_dirent_join(src_fs->path, PATH_NODE_ORIGINS_DIR, pool);
   SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
   if (kind == svn_node_dir)
-    SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, src_subdir, dst_fs->path,
+    SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, NULL, src_subdir,
+                                            dst_fs->path,
                                             PATH_NODE_ORIGINS_DIR, TRUE,
                                             cancel_func, cancel_baton, pool));
 
@@ -30,7 +30,10 @@
  * exists in DST_FS.  Indicate progress via the optional NOTIFY_FUNC
  * callback using NOTIFY_BATON.  Use COMMON_POOL for process-wide and
  * POOL for temporary allocations.  Use COMMON_POOL_LOCK to ensure
- * that the initialization of the shared data is serialized. */
+ * that the initialization of the shared data is serialized.
+ *
+ * Revision and revprop shards will be copied by as many threads as
+ * SRC_FS has been configured for via SVN_FS_CONFIG_PARALLEL_JOBS. */
 svn_error_t * svn_fs_fs__hotcopy(svn_fs_t *src_fs,
                                  svn_fs_t *dst_fs,
                                  const char *src_path,
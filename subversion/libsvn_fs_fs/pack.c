@@ -30,6 +30,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
+#include "private/svn_task.h"
 
 #include "fs_fs.h"
 #include "pack.h"
@@ -1957,6 +1958,28 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Set *PACK_FILE_DIR and *SHARD_PATH to the paths of the packed and the
+ * non-packed revision SHARD within REVS_DIR, respectively.  Allocate the
+ * results in RESULT_POOL.
+ */
+static void
+get_rev_shard_paths(const char **pack_file_dir,
+                    const char **shard_path,
+                    const char *revs_dir,
+                    apr_int64_t shard,
+                    apr_pool_t *result_pool)
+{
+  *pack_file_dir = svn_dirent_join(revs_dir,
+                  apr_psprintf(result_pool,
+                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                               shard),
+                  result_pool);
+  *shard_path = svn_dirent_join(revs_dir,
+                                apr_psprintf(result_pool, "%" APR_INT64_T_FMT,
+                                             shard),
+                                result_pool);
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1975,16 +1998,8 @@ pack_shard(struct pack_baton *baton,
                                svn_fs_pack_notify_start, pool));
 
   /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
-  baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
-                                          apr_psprintf(pool,
-                                                       "%" APR_INT64_T_FMT,
-                                                       baton->shard),
-                                          pool);
+  get_rev_shard_paths(&rev_pack_file_dir, &baton->rev_shard_path,
+                      baton->revs_dir, baton->shard, pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
@@ -2009,6 +2024,121 @@ pack_shard(struct pack_baton *baton,
   return SVN_NO_ERROR;
 }
 
+/* Baton type used by the callbacks of pack_shards_concurrently(). */
+typedef struct concurrent_pack_baton_t
+{
+  /* The pack operation state, including the main FS instance.
+     Only the output function may modify it. */
+  struct pack_baton *pb;
+
+  /* Folder containing the revision shards.  Constant. */
+  const char *revs_dir;
+
+  /* The shard to be packed by task 0. */
+  apr_int64_t first_shard;
+
+  /* Temporary memory limit for each concurrent pack_rev_shard() call. */
+  apr_size_t max_mem;
+} concurrent_pack_baton_t;
+
+/* Implements svn_task__process_func_t.
+ * Pack the revision contents of the shard given by TASK_INDEX and the
+ * concurrent_pack_baton_t PROCESS_BATON using the svn_fs_t THREAD_CONTEXT.
+ * The result is always NULL. */
+static svn_error_t *
+pack_rev_shard_task(void **result,
+                    void *process_baton,
+                    void *thread_context,
+                    apr_int64_t task_index,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  concurrent_pack_baton_t *baton = process_baton;
+  svn_fs_t *fs = thread_context;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_int64_t shard = baton->first_shard + task_index;
+  const char *rev_pack_file_dir, *rev_shard_path;
+
+  get_rev_shard_paths(&rev_pack_file_dir, &rev_shard_path, baton->revs_dir,
+                      shard, scratch_pool);
+  SVN_ERR(pack_rev_shard(fs, rev_pack_file_dir, rev_shard_path, shard,
+                         ffd->max_files_per_dir, baton->max_mem,
+                         ffd->flush_to_disk, cancel_func, cancel_baton,
+                         scratch_pool));
+
+  *result = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * The revision contents of the shard given by TASK_INDEX and the
+ * concurrent_pack_baton_t OUTPUT_BATON has been packed.  Pack its
+ * revprops and switch the repository over to the packed shard while
+ * holding the write lock.  Send the notifications for that shard. */
+static svn_error_t *
+switch_to_packed_shard(void *result,
+                       void *output_baton,
+                       apr_int64_t task_index,
+                       apr_pool_t *scratch_pool)
+{
+  concurrent_pack_baton_t *baton = output_baton;
+  struct pack_baton *pb = baton->pb;
+  const char *rev_pack_file_dir;
+
+  pb->shard = baton->first_shard + task_index;
+  get_rev_shard_paths(&rev_pack_file_dir, &pb->rev_shard_path, pb->revs_dir,
+                      pb->shard, scratch_pool);
+
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, pb->shard,
+                            svn_fs_pack_notify_start, scratch_pool));
+
+  SVN_ERR(svn_fs_fs__with_write_lock(pb->fs, synced_pack_shard, pb,
+                                     scratch_pool));
+
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, pb->shard,
+                            svn_fs_pack_notify_end, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Pack the shards FIRST_SHARD up to but not including END_SHARD as
+ * described by PB using up to JOBS threads.  Each thread packs the
+ * revision contents of one shard at a time, using its own svn_fs_t
+ * instance and its share of PB->MAX_MEM.  The switch to the packed
+ * shards, including the revprop packing, happens strictly in shard
+ * order from the calling thread.  Use SCRATCH_POOL for temporaries.
+ *
+ * This requires the FS format to support the pack lock.
+ */
+static svn_error_t *
+pack_shards_concurrently(struct pack_baton *pb,
+                         apr_int64_t first_shard,
+                         apr_int64_t end_shard,
+                         int jobs,
+                         apr_pool_t *scratch_pool)
+{
+  concurrent_pack_baton_t baton;
+
+  if (jobs > end_shard - first_shard)
+    jobs = (int)(end_shard - first_shard);
+
+  baton.pb = pb;
+  baton.revs_dir = pb->revs_dir;
+  baton.first_shard = first_shard;
+  baton.max_mem = pb->max_mem / jobs;
+
+  return svn_error_trace(svn_task__run(jobs, end_shard - first_shard,
+                                       svn_fs_fs__open_task_instance, pb->fs,
+                                       pack_rev_shard_task, &baton,
+                                       switch_to_packed_shard, &baton,
+                                       pb->cancel_func, pb->cancel_baton,
+                                       scratch_pool));
+}
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2060,6 +2190,7 @@ pack_body(void *baton,
   apr_int64_t completed_shards;
   apr_pool_t *iterpool;
   svn_boolean_t fully_packed;
+  int jobs;
 
   /* Since another process might have already packed the repo,
      we need to re-read the pack status. */
@@ -2080,6 +2211,15 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+  /* Packing the revision contents does not modify the repository state.
+     Do that concurrently, if allowed.  This relies on the pack lock to
+     keep other packers out while the shard switch-over happens later. */
+  SVN_ERR(svn_fs_fs__get_parallel_jobs(&jobs, pb->fs));
+  if (jobs > 1 && ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    return svn_error_trace(pack_shards_concurrently(pb,
+                              ffd->min_unpacked_rev / ffd->max_files_per_dir,
+                              completed_shards, jobs, pool));
+
   iterpool = svn_pool_create(pool);
   for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
        pb->shard < completed_shards;
@@ -32,6 +32,11 @@
    MAX_MEM limits the size of in-memory data structures needed for reordering
    items in format 7 repositories.  0 means use the built-in default.
 
+   If FS' configuration allows for multiple SVN_FS_CONFIG_PARALLEL_JOBS,
+   shards may be packed concurrently, splitting MAX_MEM evenly between
+   the threads.  The switch-over to the packed shards is still done in
+   shard order.
+
    If given, NOTIFY_FUNC will be called with NOTIFY_BATON to report progress.
    Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.
 
@@ -163,7 +163,7 @@ recover_find_max_ids(svn_fs_t *fs,
   svn_error_t *err;
 
   baton.stream = rev_file->stream;
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev, baton.stream, pool, pool));
 
   /* Check that this is a directory.  It should be. */
@@ -186,7 +186,7 @@ recover_find_max_ids(svn_fs_t *fs,
      rely on directory entries being stored as PLAIN reps, though. */
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL,
                                  noderev->data_rep->item_index, pool));
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_rep_header(&header, baton.stream, pool, pool));
   if (header->type != svn_fs_fs__rep_plain)
     return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
@@ -307,8 +307,7 @@ recover_get_root_offset(apr_off_t *root_offset,
   /* We will assume that the last line containing the two offsets (to the root
      node-id and to the changed path information) will never be longer than 64
      characters. */
-  end = 0;
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_END, &end, pool));
+  SVN_ERR(svn_fs_fs__rev_file_size(&end, rev_file));
 
   if (end < sizeof(buffer))
     {
@@ -321,9 +320,8 @@ recover_get_root_offset(apr_off_t *root_offset,
       start = end - sizeof(buffer);
     }
 
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &start, pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len,
-                                 NULL, NULL, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, start));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len));
 
   trailer = svn_stringbuf_ncreate(buffer, len, pool);
   SVN_ERR(svn_fs_fs__parse_revision_trailer(root_offset, NULL, trailer, rev));
@@ -20,6 +20,17 @@
  * ====================================================================
  */
 
+#include <apr_mmap.h>
+#include <apr_portable.h>
+
+#if APR_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#if APR_HAS_MMAP && !defined(WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "rev_file.h"
 #include "fs_fs.h"
 #include "index.h"
@@ -28,6 +39,9 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+
 #include "private/svn_io_private.h"
 #include "svn_private_config.h"
 
@@ -46,6 +60,8 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
+  file->mmap_offset = 0;
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -120,6 +136,135 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_MMAP
+
+/* Return an error for reading beyond the end of the mapped FILE. */
+static svn_error_t *
+mapped_eof_error(svn_fs_fs__revision_file_t *file)
+{
+  const char *file_name;
+
+  SVN_ERR(svn_io_file_name_get(&file_name, file->file, file->pool));
+  return svn_error_wrap_apr(APR_EOF, _("Can't read file '%s'"),
+                            svn_dirent_local_style(file_name, file->pool));
+}
+
+/* Mark type for mapped rev file streams. */
+typedef struct mapped_mark_t
+{
+  apr_off_t offset;
+} mapped_mark_t;
+
+/* Implements svn_read_fn_t for mapped rev files.
+ * BATON is a svn_fs_fs__revision_file_t. */
+static svn_error_t *
+read_handler_mapped(void *baton,
+                    char *buffer,
+                    apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t remaining = (apr_off_t)file->mmap->size - file->mmap_offset;
+
+  if (remaining <= 0)
+    *len = 0;
+  else if ((apr_off_t)*len > remaining)
+    *len = (apr_size_t)remaining;
+
+  memcpy(buffer, (const char *)file->mmap->mm + file->mmap_offset, *len);
+  file->mmap_offset += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_skip_fn_t for mapped rev files.
+ * BATON is a svn_fs_fs__revision_file_t. */
+static svn_error_t *
+skip_handler_mapped(void *baton,
+                    apr_size_t len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mmap_offset = MIN(file->mmap_offset + (apr_off_t)len,
+                          (apr_off_t)file->mmap->size);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_mark_fn_t for mapped rev files.
+ * BATON is a svn_fs_fs__revision_file_t. */
+static svn_error_t *
+mark_handler_mapped(void *baton,
+                    svn_stream_mark_t **mark,
+                    apr_pool_t *pool)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  mapped_mark_t *mapped_mark = apr_palloc(pool, sizeof(*mapped_mark));
+
+  mapped_mark->offset = file->mmap_offset;
+  *mark = (svn_stream_mark_t *)mapped_mark;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_seek_fn_t for mapped rev files.
+ * BATON is a svn_fs_fs__revision_file_t. */
+static svn_error_t *
+seek_handler_mapped(void *baton,
+                    const svn_stream_mark_t *mark)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mmap_offset = mark ? ((const mapped_mark_t *)mark)->offset : 0;
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+/* If enabled in FS, try to map the whole packed FILE into memory and
+ * replace its stream with one that reads from the mapping.  Keep FILE
+ * unchanged if mapping is not supported or fails.  Allocate the mapping
+ * in RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+auto_map_file(svn_fs_fs__revision_file_t *file,
+              svn_fs_t *fs,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_finfo_t finfo;
+
+  if (!ffd->use_mmap || !file->is_packed)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file->file,
+                               scratch_pool));
+
+  /* Don't exhaust the address space of 32 bit processes. */
+  if (finfo.size <= 0 || (apr_uint64_t)finfo.size > APR_SIZE_MAX / 4)
+    return SVN_NO_ERROR;
+
+  /* Mapping is an optimization only.  Silently fall back to buffered
+   * file I/O if the OS won't let us. */
+  if (apr_mmap_create(&file->mmap, file->file, 0, (apr_size_t)finfo.size,
+                      APR_MMAP_READ, result_pool))
+    {
+      file->mmap = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  file->mmap_offset = 0;
+  file->stream = svn_stream_create(file, result_pool);
+  svn_stream_set_read2(file->stream, read_handler_mapped,
+                       read_handler_mapped);
+  svn_stream_set_skip(file->stream, skip_handler_mapped);
+  svn_stream_set_mark(file->stream, mark_handler_mapped);
+  svn_stream_set_seek(file->stream, seek_handler_mapped);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -160,6 +305,9 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          if (!writable)
+            SVN_ERR(auto_map_file(file, fs, result_pool, scratch_pool));
+
           return SVN_NO_ERROR;
         }
 
@@ -237,22 +385,19 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       svn_stringbuf_t *footer;
 
       /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_size(&filesize, file));
 
       /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL, filesize - 1));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, &footer_length,
+                                       sizeof(footer_length)));
 
       /* Read footer. */
       footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1 - footer_length,
-                                       file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL,
+                                       filesize - 1 - footer_length));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, footer->data, footer_length));
+      footer->len = footer_length;
       footer->data[footer->len] = '\0';
 
       /* Extract index locations. */
@@ -286,20 +431,149 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   (*file)->is_packed = FALSE;
   (*file)->start_revision = SVN_INVALID_REVNUM;
   (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
+  (*file)->block_size = ((fs_fs_data_t *)fs->fsap_data)->block_size;
+  (*file)->pool = result_pool;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset)
+{
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      /* There is no buffer to fill, just report the block boundary. */
+      if (buffer_start)
+        *buffer_start = offset - (offset % file->block_size);
+
+      file->mmap_offset = offset;
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  return svn_error_trace(svn_io_file_aligned_seek(file->file,
+                                                  file->block_size,
+                                                  buffer_start, offset,
+                                                  file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file)
+{
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      *offset = file->mmap_offset;
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  return svn_error_trace(svn_io_file_get_offset(offset, file->file,
+                                                file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes)
+{
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      if (   file->mmap_offset < 0
+          || (apr_off_t)nbytes > (apr_off_t)file->mmap->size
+                                 - file->mmap_offset)
+        return svn_error_trace(mapped_eof_error(file));
+
+      memcpy(buf, (const char *)file->mmap->mm + file->mmap_offset, nbytes);
+      file->mmap_offset += nbytes;
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  return svn_error_trace(svn_io_file_read_full2(file->file, buf, nbytes,
+                                                NULL, NULL, file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_size(apr_off_t *size,
+                         svn_fs_fs__revision_file_t *file)
+{
+  svn_filesize_t file_size;
+
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      *size = (apr_off_t)file->mmap->size;
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  SVN_ERR(svn_io_file_size_get(&file_size, file->file, file->pool));
+  *size = (apr_off_t)file_size;
 
   return SVN_NO_ERROR;
 }
 
+void
+svn_fs_fs__rev_file_prefetch(svn_fs_fs__revision_file_t *file,
+                             apr_off_t offset,
+                             apr_off_t size)
+{
+  if (offset < 0 || size <= 0)
+    return;
+
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+#if defined(MADV_WILLNEED)
+      /* madvise() wants page-aligned addresses and the mapping itself
+       * starts at a page boundary.  Stay within the mapping. */
+      apr_off_t page_size = (apr_off_t)sysconf(_SC_PAGESIZE);
+      apr_off_t start = page_size > 0 ? offset - (offset % page_size) : 0;
+      apr_off_t end = MIN(offset + size, (apr_off_t)file->mmap->size);
+
+      if (start < end)
+        madvise((char *)file->mmap->mm + start, (size_t)(end - start),
+                MADV_WILLNEED);
+#endif
+      return;
+    }
+#endif
+
+#if defined(POSIX_FADV_WILLNEED)
+  if (file->file)
+    {
+      apr_os_file_t fd;
+      if (apr_os_file_get(&fd, file->file) == APR_SUCCESS)
+        posix_fadvise(fd, offset, size, POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
   if (file->stream)
     SVN_ERR(svn_stream_close(file->stream));
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      apr_status_t status = apr_mmap_delete(file->mmap);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap revision file"));
+    }
+#endif
   if (file->file)
     SVN_ERR(svn_io_file_close(file->file, file->pool));
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
   file->l2p_stream = NULL;
   file->p2l_stream = NULL;
 
@@ -54,9 +54,19 @@ typedef struct svn_fs_fs__revision_file_t
   /* rev / pack file */
   apr_file_t *file;
 
-  /* stream based on FILE and not NULL exactly when FILE is not NULL */
+  /* stream based on FILE and not NULL exactly when FILE is not NULL.
+   * If MMAP is not NULL, this reads from the mapped data instead. */
   svn_stream_t *stream;
 
+  /* Read-only memory mapping of the whole FILE or NULL.  Only packed
+   * files get mapped and only if enabled in the FS config.  If set, all
+   * reads must go through the svn_fs_fs__rev_file_* functions or STREAM
+   * and FILE's own file pointer is undefined. */
+  struct apr_mmap_t *mmap;
+
+  /* Current read position within MMAP.  Undefined if MMAP is NULL. */
+  apr_off_t mmap_offset;
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -137,6 +147,40 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool);
 
+/* File manipulation.  These work for mapped as well as for buffered
+ * files and must be used instead of accessing FILE->FILE directly. */
+
+/* Convenience wrapper around svn_io_file_aligned_seek. */
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset);
+
+/* Convenience wrapper around svn_io_file_get_offset. */
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file);
+
+/* Convenience wrapper around svn_io_file_read_full2. */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes);
+
+/* Set *SIZE to the total size of FILE in bytes, including index data. */
+svn_error_t *
+svn_fs_fs__rev_file_size(apr_off_t *size,
+                         svn_fs_fs__revision_file_t *file);
+
+/* Tell the OS that SIZE bytes starting at OFFSET in FILE will be read
+ * soon, so it may start fetching them in the background.  This is only
+ * a hint: it does not move the read position, does not wait for any I/O
+ * and silently does nothing where not supported. */
+void
+svn_fs_fs__rev_file_prefetch(svn_fs_fs__revision_file_t *file,
+                             apr_off_t offset,
+                             apr_off_t size);
+
 /* Close all files and streams in FILE.
  */
 svn_error_t *
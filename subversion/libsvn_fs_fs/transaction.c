@@ -2169,7 +2169,12 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
   fs_fs_data_t *ffd = fs->fsap_data;
   int svndiff_version;
 
-  if (ffd->delta_compression_type == compression_type_lz4)
+  if (ffd->delta_compression_type == compression_type_zstd)
+    {
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = 3;
+    }
+  else if (ffd->delta_compression_type == compression_type_lz4)
     {
       SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
       svndiff_version = 2;
@@ -2184,8 +2189,9 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
       svndiff_version = 0;
     }
 
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          ffd->delta_compression_level, pool);
+  svn_txdelta_to_svndiff4(handler, handler_baton, output, svndiff_version,
+                          ffd->delta_compression_level,
+                          SVN_DELTA_ENCODER_THREADS_DEFAULT, pool);
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -3493,13 +3499,15 @@ verify_before_commit(svn_fs_t *fs,
 
 /* Update the 'current' file to hold the correct next node and copy_ids
    from transaction TXN_ID in filesystem FS.  The current revision is
-   set to REV.  Perform temporary allocations in POOL. */
+   set to REV.  Flush everything scheduled in BATCH before that.
+   Perform temporary allocations in POOL. */
 static svn_error_t *
 write_final_current(svn_fs_t *fs,
                     const svn_fs_fs__id_part_t *txn_id,
                     svn_revnum_t rev,
                     apr_uint64_t start_node_id,
                     apr_uint64_t start_copy_id,
+                    svn_io__batch_fsync_t *batch,
                     apr_pool_t *pool)
 {
   apr_uint64_t txn_node_id;
@@ -3507,7 +3515,7 @@ write_final_current(svn_fs_t *fs,
   fs_fs_data_t *ffd = fs->fsap_data;
 
   if (ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
-    return svn_fs_fs__write_current(fs, rev, 0, 0, pool);
+    return svn_fs_fs__bump_current(fs, rev, 0, 0, batch, pool);
 
   /* To find the next available ids, we add the id that used to be in
      the 'current' file, to the next ids from the transaction file. */
@@ -3516,8 +3524,8 @@ write_final_current(svn_fs_t *fs,
   start_node_id += txn_node_id;
   start_copy_id += txn_copy_id;
 
-  return svn_fs_fs__write_current(fs, rev, start_node_id, start_copy_id,
-                                  pool);
+  return svn_fs_fs__bump_current(fs, rev, start_node_id, start_copy_id,
+                                 batch, pool);
 }
 
 /* Verify that the user registered with FS has all the locks necessary to
@@ -3594,12 +3602,13 @@ verify_locks(svn_fs_t *fs,
 
 /* Writes final revision properties to file PATH applying permissions
    from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   removing any temporary properties associated with the commit flags.
+   Schedule the necessary fsyncs in BATCH. */
 static svn_error_t *
 write_final_revprop(const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
+                    svn_io__batch_fsync_t *batch,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3629,21 +3638,17 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
-  /* Create new revprops file. Tell OS to truncate existing file,
-     since  file may already exists from failed transaction. */
-  SVN_ERR(svn_io_file_open(&revprop_file, path,
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  /* Create new revprops file. Truncate the existing file, since file
+     may already exists from failed transaction.  BATCH will close it. */
+  SVN_ERR(svn_io__batch_fsync_open_file(&revprop_file, batch, path, pool));
+  SVN_ERR(svn_io_file_trunc(revprop_file, 0, pool));
 
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
-  SVN_ERR(svn_io_file_close(revprop_file, pool));
-
   SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, path, pool));
 
   return SVN_NO_ERROR;
 }
@@ -3732,52 +3737,60 @@ struct commit_baton {
   apr_array_header_t *reps_to_cache;
   apr_hash_t *reps_hash;
   apr_pool_t *reps_pool;
+
+  /* Keys of the directories cached while writing the new revision.
+     Set by write_revision(). */
+  apr_array_header_t *directory_ids;
+
+  /* The following members are only used for group commits. */
+
+  /* Callback and baton to bring TXN up to date with later revisions. */
+  svn_fs_fs__commit_merge_func_t merge_func;
+  void *merge_baton;
+
+  /* Pool of the thread that wants to commit TXN.  All processing of this
+     commit will use this pool, even if done by some other thread. */
+  apr_pool_t *pool;
+
+  /* The revision written for TXN. */
+  svn_revnum_t new_rev;
+
+  /* Set once this commit has been processed, with the result in ERR. */
+  svn_boolean_t done;
+  svn_error_t *err;
+
+  /* Next commit in the same queue or group. */
+  struct commit_baton *next;
 };
 
-/* The work-horse for svn_fs_fs__commit, called with the FS write lock.
-   This implements the svn_fs_fs__with_write_lock() 'body' callback
-   type.  BATON is a 'struct commit_baton *'. */
+/* Write the contents of the transaction given in CB as the revision
+   following OLD_REV, which must be the youngest revision in CB->FS.
+   START_NODE_ID and START_COPY_ID are the next node and copy ids as read
+   from the 'current' file.  Schedule everything that needs to be flushed
+   to disk in BATCH but leave updating 'current' to the caller.
+
+   The FS write lock is assumed to be held by the caller.  Perform
+   temporary allocations in POOL. */
 static svn_error_t *
-commit_body(void *baton, apr_pool_t *pool)
+write_revision(struct commit_baton *cb,
+               svn_revnum_t old_rev,
+               apr_uint64_t start_node_id,
+               apr_uint64_t start_copy_id,
+               svn_io__batch_fsync_t *batch,
+               apr_pool_t *pool)
 {
-  struct commit_baton *cb = baton;
   fs_fs_data_t *ffd = cb->fs->fsap_data;
   const char *old_rev_filename, *rev_filename, *proto_filename;
   const char *revprop_filename;
   const svn_fs_id_t *root_id, *new_root_id;
-  apr_uint64_t start_node_id;
-  apr_uint64_t start_copy_id;
-  svn_revnum_t old_rev, new_rev;
+  svn_revnum_t new_rev;
   apr_file_t *proto_file;
   void *proto_file_lockcookie;
   apr_off_t initial_offset, changed_path_offset;
   const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
   apr_hash_t *changed_paths;
-  apr_array_header_t *directory_ids = apr_array_make(pool, 4,
-                                                     sizeof(pair_cache_key_t));
 
-  /* Re-Read the current repository format.  All our repo upgrade and
-     config evaluation strategies are such that existing information in
-     FS and FFD remains valid.
-
-     Although we don't recommend upgrading hot repositories, people may
-     still do it and we must make sure to either handle them gracefully
-     or to error out.
-
-     Committing pre-format 3 txns will fail after upgrade to format 3+
-     because the proto-rev cannot be found; no further action needed.
-     Upgrades from pre-f7 to f7+ means a potential change in addressing
-     mode for the final rev.  We must be sure to detect that cause because
-     the failure would only manifest once the new revision got committed.
-   */
-  SVN_ERR(svn_fs_fs__read_format_file(cb->fs, pool));
-
-  /* Read the current youngest revision and, possibly, the next available
-     node id and copy id (for old format filesystems).  Update the cached
-     value for the youngest revision, because we have just checked it. */
-  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
-                                  cb->fs, pool));
-  ffd->youngest_rev_cache = old_rev;
+  cb->directory_ids = apr_array_make(pool, 4, sizeof(pair_cache_key_t));
 
   /* Check to make sure this transaction is based off the most recent
      revision. */
@@ -3808,7 +3821,7 @@ commit_body(void *baton, apr_pool_t *pool)
   root_id = svn_fs_fs__id_txn_create_root(txn_id, pool);
   SVN_ERR(write_final_rev(&new_root_id, proto_file, new_rev, cb->fs, root_id,
                           start_node_id, start_copy_id, initial_offset,
-                          directory_ids, cb->reps_to_cache, cb->reps_hash,
+                          cb->directory_ids, cb->reps_to_cache, cb->reps_hash,
                           cb->reps_pool, TRUE, pool));
 
   /* Write the changed-path information. */
@@ -3837,14 +3850,16 @@ commit_body(void *baton, apr_pool_t *pool)
                                      NULL, pool));
     }
 
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
   SVN_ERR(svn_io_file_close(proto_file, pool));
 
   /* We don't unlock the prototype revision file immediately to avoid a
      race with another caller writing to the prototype revision file
      before we commit it. */
 
+  /* From here on, collect all files and directories that need to be
+     flushed to disk in BATCH.  The caller will flush them concurrently
+     right before bumping 'current'. */
+
   /* Create the shard for the rev and revprop file, if we're sharding and
      this is the first revision of a new shard.  We don't care if this
      fails because the shard already existed for some reason. */
@@ -3863,6 +3878,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_io__batch_fsync_new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3879,6 +3895,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_io__batch_fsync_new_path(batch, new_dir, pool));
         }
     }
 
@@ -3890,9 +3907,10 @@ commit_body(void *baton, apr_pool_t *pool)
   old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
   proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
-  SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
-                                     pool));
+  SVN_ERR(svn_fs_fs__move_into_place_batched(proto_filename, rev_filename,
+                                             old_rev_filename,
+                                             ffd->flush_to_disk, batch,
+                                             pool));
 
   /* Now that we've moved the prototype revision file out of the way,
      we can unlock it (since further attempts to write to the file
@@ -3904,7 +3922,7 @@ commit_body(void *baton, apr_pool_t *pool)
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
   SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+                              cb->txn, batch, pool));
 
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
@@ -3912,9 +3930,17 @@ commit_body(void *baton, apr_pool_t *pool)
       SVN_ERR(verify_before_commit(cb->fs, new_rev, pool));
     }
 
-  /* Update the 'current' file. */
-  SVN_ERR(write_final_current(cb->fs, txn_id, new_rev, start_node_id,
-                              start_copy_id, pool));
+  return SVN_NO_ERROR;
+}
+
+/* Finish the commit given in CB after NEW_REV, which has been written
+   for it, has been made visible.  Use POOL for temporary allocations. */
+static svn_error_t *
+finish_commit(struct commit_baton *cb,
+              svn_revnum_t new_rev,
+              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
 
   /* At this point the new revision is committed and globally visible
      so let the caller know it succeeded by giving it the new revision
@@ -3927,7 +3953,7 @@ commit_body(void *baton, apr_pool_t *pool)
 
   /* Make the directory contents alreday cached for the new revision
    * visible. */
-  SVN_ERR(promote_cached_directories(cb->fs, directory_ids, pool));
+  SVN_ERR(promote_cached_directories(cb->fs, cb->directory_ids, pool));
 
   /* Remove this transaction directory. */
   SVN_ERR(svn_fs_fs__purge_txn(cb->fs, cb->txn->id, pool));
@@ -3935,6 +3961,410 @@ commit_body(void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* The work-horse for svn_fs_fs__commit, called with the FS write lock.
+   This implements the svn_fs_fs__with_write_lock() 'body' callback
+   type.  BATON is a 'struct commit_baton *'. */
+static svn_error_t *
+commit_body(void *baton, apr_pool_t *pool)
+{
+  struct commit_baton *cb = baton;
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+  apr_uint64_t start_node_id;
+  apr_uint64_t start_copy_id;
+  svn_revnum_t old_rev, new_rev;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+  svn_io__batch_fsync_t *batch;
+
+  /* Re-Read the current repository format.  All our repo upgrade and
+     config evaluation strategies are such that existing information in
+     FS and FFD remains valid.
+
+     Although we don't recommend upgrading hot repositories, people may
+     still do it and we must make sure to either handle them gracefully
+     or to error out.
+
+     Committing pre-format 3 txns will fail after upgrade to format 3+
+     because the proto-rev cannot be found; no further action needed.
+     Upgrades from pre-f7 to f7+ means a potential change in addressing
+     mode for the final rev.  We must be sure to detect that cause because
+     the failure would only manifest once the new revision got committed.
+   */
+  SVN_ERR(svn_fs_fs__read_format_file(cb->fs, pool));
+
+  /* Read the current youngest revision and, possibly, the next available
+     node id and copy id (for old format filesystems).  Update the cached
+     value for the youngest revision, because we have just checked it. */
+  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
+                                  cb->fs, pool));
+  ffd->youngest_rev_cache = old_rev;
+
+  /* Collect all files and directories that need to be flushed to disk
+     and flush them concurrently right before we bump 'current'.  On
+     high-latency storage, this cuts the time spent on fsyncs roughly to
+     that of a single one. */
+  SVN_ERR(svn_io__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+
+  SVN_ERR(write_revision(cb, old_rev, start_node_id, start_copy_id, batch,
+                         pool));
+  new_rev = old_rev + 1;
+
+  /* Flush everything to disk and update the 'current' file. */
+  SVN_ERR(write_final_current(cb->fs, txn_id, new_rev, start_node_id,
+                              start_copy_id, batch, pool));
+
+  return svn_error_trace(finish_commit(cb, new_rev, pool));
+}
+
+#if APR_HAS_THREADS
+
+/* Maximum number of commits that a single group may contain. */
+#define MAX_COMMIT_GROUP_SIZE 64
+
+/* Baton used for group_commit_body below. */
+struct group_commit_baton {
+  /* The filesystem object of the group leader. */
+  svn_fs_t *fs;
+
+  /* All commits taken from the queue, in queue order. */
+  struct commit_baton *processed;
+
+  /* Set if the new revisions could not be made visible. */
+  svn_boolean_t broken;
+};
+
+/* Wait for the next signal on FFSD's COMMIT_GROUP_DONE.  The caller must
+ * hold FFSD's GROUP_COMMIT_LOCK. */
+static svn_error_t *
+wait_for_commit_group(fs_fs_shared_data_t *ffsd)
+{
+  apr_status_t status
+    = apr_thread_cond_wait(ffsd->commit_group_done,
+                           svn_mutex__get(ffsd->group_commit_lock));
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't wait for condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Append CB to FFSD's commit queue.  The caller must hold FFSD's
+ * GROUP_COMMIT_LOCK. */
+static svn_error_t *
+enqueue_commit(fs_fs_shared_data_t *ffsd,
+               struct commit_baton *cb)
+{
+  cb->next = NULL;
+  if (ffsd->commit_queue_tail)
+    ffsd->commit_queue_tail->next = cb;
+  else
+    ffsd->commit_queue_head = cb;
+
+  ffsd->commit_queue_tail = cb;
+  ffsd->commit_queue_length++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove CB from FFSD's commit queue.  CB must be in that queue.  The
+ * caller must hold FFSD's GROUP_COMMIT_LOCK. */
+static void
+remove_commit(fs_fs_shared_data_t *ffsd,
+              struct commit_baton *cb)
+{
+  struct commit_baton **link = &ffsd->commit_queue_head;
+  struct commit_baton *prev = NULL;
+
+  while (*link != cb)
+    {
+      prev = *link;
+      link = &prev->next;
+    }
+
+  *link = cb->next;
+  if (ffsd->commit_queue_tail == cb)
+    ffsd->commit_queue_tail = prev;
+
+  ffsd->commit_queue_length--;
+  cb->next = NULL;
+}
+
+/* Implement take_next_commit.  The caller must hold FFSD's
+ * GROUP_COMMIT_LOCK. */
+static svn_error_t *
+dequeue_commit(struct commit_baton **cb,
+               fs_fs_shared_data_t *ffsd)
+{
+  /* Don't risk reusing revision numbers that we may already have handed
+     out to readers within this process. */
+  if (ffsd->commit_group_broken)
+    return svn_error_create(SVN_ERR_FS_GENERAL, NULL,
+                            _("A previous group commit could not be "
+                              "completed; restart the process to "
+                              "commit again"));
+
+  *cb = ffsd->commit_queue_head;
+  if (*cb)
+    remove_commit(ffsd, *cb);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *CB to the commit at the front of FFSD's commit queue and remove it
+ * from there.  Set *CB to NULL if the queue is empty. */
+static svn_error_t *
+take_next_commit(struct commit_baton **cb,
+                 fs_fs_shared_data_t *ffsd)
+{
+  SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock, dequeue_commit(cb, ffsd));
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait until either CB has been processed or nobody else is processing
+ * FFSD's commit queue anymore.  In the latter case, make the caller the
+ * group leader and set *LEAD.  Otherwise, reset *LEAD.  The caller must
+ * hold FFSD's GROUP_COMMIT_LOCK. */
+static svn_error_t *
+wait_for_turn(svn_boolean_t *lead,
+              fs_fs_shared_data_t *ffsd,
+              struct commit_baton *cb)
+{
+  while (!cb->done && ffsd->commit_leader_active)
+    SVN_ERR(wait_for_commit_group(ffsd));
+
+  *lead = !cb->done;
+  if (*lead)
+    ffsd->commit_leader_active = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark all commits processed in GB as done, end LEADER's leadership and
+ * wake up all waiting commits.  ERR is the result of processing the group.
+ * If LEADER's own commit did not get processed due to ERR, remove it from
+ * FFSD's queue and make it fail with ERR.  The caller must hold FFSD's
+ * GROUP_COMMIT_LOCK. */
+static svn_error_t *
+end_commit_group(fs_fs_shared_data_t *ffsd,
+                 struct group_commit_baton *gb,
+                 struct commit_baton *leader,
+                 svn_error_t *err)
+{
+  struct commit_baton *cb, *next;
+  apr_status_t status;
+
+  if (gb->processed)
+    ffsd->commit_groups++;
+
+  /* Waiting commits may return as soon as we release the lock, so don't
+     access them after marking them as done. */
+  for (cb = gb->processed; cb; cb = next)
+    {
+      next = cb->next;
+      cb->done = TRUE;
+    }
+
+  if (!leader->done && err)
+    {
+      remove_commit(ffsd, leader);
+      leader->err = err;
+      leader->done = TRUE;
+    }
+  else if (err)
+    {
+      leader->err = svn_error_compose_create(leader->err, err);
+    }
+
+  if (gb->broken)
+    ffsd->commit_group_broken = TRUE;
+
+  ffsd->commit_leader_active = FALSE;
+
+  status = apr_thread_cond_broadcast(ffsd->commit_group_done);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't signal condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Prepare the queued commit CB to become the revision following YOUNGEST,
+ * which is not necessarily visible yet.  The FS write lock is assumed to
+ * be held by the caller. */
+static svn_error_t *
+prepare_queued_commit(struct commit_baton *cb,
+                      svn_revnum_t youngest)
+{
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+
+  /* Only the group leader's FS got updated when acquiring the lock.
+     Do the same for all others. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
+    SVN_ERR(svn_fs_fs__update_min_unpacked_rev(cb->fs, cb->pool));
+
+  /* Allow merging with revisions written by this group. */
+  ffd->youngest_rev_cache = youngest;
+
+  if (cb->txn->base_rev != youngest)
+    {
+      if (!cb->merge_func)
+        return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
+                                _("Transaction out of date"));
+
+      SVN_ERR(cb->merge_func(cb->merge_baton, youngest, cb->pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* The revisions following PUBLISHED that the group GB wrote could not be
+ * made visible.  Make the FS instances of all commits in GB forget about
+ * them again and drop everything that their merges may have cached about
+ * those revisions, which may get written again with different contents.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+forget_unpublished_revisions(struct group_commit_baton *gb,
+                             svn_revnum_t published,
+                             apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  struct commit_baton *cb;
+
+  for (cb = gb->processed; cb; cb = cb->next)
+    {
+      fs_fs_data_t *ffd = cb->fs->fsap_data;
+      ffd->youngest_rev_cache = published;
+
+      /* Replaces the instance-local caches, e.g. the DAG node cache. */
+      SVN_ERR(svn_fs_fs__initialize_caches(cb->fs, scratch_pool));
+    }
+
+  /* Entries in the process-wide cache are keyed by revision.  Shared
+   * caches beyond this process are never used with group commits. */
+  if (membuffer)
+    SVN_ERR(svn_cache__membuffer_clear(membuffer));
+
+  return SVN_NO_ERROR;
+}
+
+/* Take up to MAX_COMMIT_GROUP_SIZE commits from the commit queue of the
+ * filesystem given in the 'struct group_commit_baton *' BATON, write them
+ * as consecutive revisions and make all of them visible at once, after
+ * a single flush to disk.  Commits that fail to merge will not get a
+ * revision but don't affect the other commits.  If writing a revision
+ * fails, leave the remaining queue for the next group.
+ *
+ * This implements the svn_fs_fs__with_write_lock() 'body' callback type.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+group_commit_body(void *baton,
+                  apr_pool_t *pool)
+{
+  struct group_commit_baton *gb = baton;
+  fs_fs_data_t *ffd = gb->fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  struct commit_baton **last = &gb->processed;
+  struct commit_baton *cb;
+  svn_io__batch_fsync_t *batch;
+  apr_uint64_t start_node_id;
+  apr_uint64_t start_copy_id;
+  svn_revnum_t old_rev, youngest;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  /* See commit_body. */
+  SVN_ERR(svn_fs_fs__read_format_file(gb->fs, pool));
+  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
+                                  gb->fs, pool));
+  SVN_ERR(svn_io__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+
+  youngest = old_rev;
+  for (i = 0; i < MAX_COMMIT_GROUP_SIZE; ++i)
+    {
+      err = take_next_commit(&cb, ffsd);
+      if (err || !cb)
+        break;
+
+      *last = cb;
+      last = &cb->next;
+
+      cb->err = prepare_queued_commit(cb, youngest);
+      if (cb->err)
+        continue;
+
+      cb->err = write_revision(cb, youngest, start_node_id, start_copy_id,
+                               batch, cb->pool);
+      if (cb->err)
+        break;
+
+      cb->new_rev = ++youngest;
+    }
+
+  if (youngest > old_rev)
+    {
+      /* Flush all revisions to disk and make them visible. */
+      svn_error_t *bump_err = svn_fs_fs__bump_current(gb->fs, youngest,
+                                                      0, 0, batch, pool);
+      for (cb = gb->processed; cb; cb = cb->next)
+        if (!cb->err)
+          cb->err = bump_err ? svn_error_dup(bump_err)
+                             : finish_commit(cb, cb->new_rev, cb->pool);
+
+      /* Other processes may reuse the revision numbers that we handed
+         out to merges.  Don't let this process commit again. */
+      if (bump_err)
+        {
+          gb->broken = TRUE;
+          bump_err = svn_error_compose_create(
+                       bump_err,
+                       forget_unpublished_revisions(gb, old_rev,
+                                                    pool));
+        }
+
+      svn_error_clear(bump_err);
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Queue the commit CB in the list of commits waiting for the write lock.
+ * Wait for it to get processed by the current group leader or become
+ * the group leader and process as many queued commits as possible.
+ * Return the result of committing CB. */
+static svn_error_t *
+group_commit(struct commit_baton *cb)
+{
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  svn_boolean_t lead;
+
+  cb->done = FALSE;
+  cb->err = SVN_NO_ERROR;
+  cb->new_rev = SVN_INVALID_REVNUM;
+  SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock, enqueue_commit(ffsd, cb));
+
+  /* Our commit may not be part of the first group that we lead. */
+  do
+    {
+      SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock,
+                           wait_for_turn(&lead, ffsd, cb));
+      if (lead)
+        {
+          struct group_commit_baton gb = { 0 };
+          svn_error_t *err;
+
+          gb.fs = cb->fs;
+          err = svn_fs_fs__with_write_lock(cb->fs, group_commit_body, &gb,
+                                           cb->pool);
+          SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock,
+                               end_commit_group(ffsd, &gb, cb, err));
+        }
+    }
+  while (lead);
+
+  return svn_error_trace(cb->err);
+}
+
+#endif /* APR_HAS_THREADS */
+
 /* Add the representations in REPS_TO_CACHE (an array of representation_t *)
  * to the rep-cache database of FS. */
 static svn_error_t *
@@ -3958,6 +4388,8 @@ svn_error_t *
 svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   svn_fs_t *fs,
                   svn_fs_txn_t *txn,
+                  svn_fs_fs__commit_merge_func_t merge_func,
+                  void *merge_baton,
                   apr_pool_t *pool)
 {
   struct commit_baton cb;
@@ -3980,7 +4412,23 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
       cb.reps_pool = NULL;
     }
 
-  SVN_ERR(svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool));
+#if APR_HAS_THREADS
+  /* Old formats keep track of global ids in 'current', which would need
+     to be updated with every revision.  Merges within a group see revisions
+     that are not published yet.  If publishing them fails, we can only
+     purge what got cached about them within this process. */
+  if (ffd->group_commit
+      && ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT
+      && !ffd->memcache && !ffd->disk_cache)
+    {
+      cb.merge_func = merge_func;
+      cb.merge_baton = merge_baton;
+      cb.pool = pool;
+      SVN_ERR(group_commit(&cb));
+    }
+  else
+#endif
+    SVN_ERR(svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool));
 
   /* At this point, *NEW_REV_P has been set, so errors below won't affect
      the success of the commit.  (See svn_fs_commit_txn().)  */
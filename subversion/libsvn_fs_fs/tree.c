@@ -2196,6 +2196,40 @@ merge_changes(dag_node_t *ancestor_node,
   return SVN_NO_ERROR;
 }
 
+/* Baton type used by commit_merge. */
+typedef struct commit_merge_baton_t
+{
+  /* The transaction to bring up to date. */
+  svn_fs_txn_t *txn;
+
+  /* Receives the description of any merge conflicts. */
+  svn_stringbuf_t *conflict;
+} commit_merge_baton_t;
+
+/* Merge all changes up to REVISION into the transaction given in the
+   commit_merge_baton_t BATON and make REVISION its new base revision.
+   Implements svn_fs_fs__commit_merge_func_t. */
+static svn_error_t *
+commit_merge(void *baton,
+             svn_revnum_t revision,
+             apr_pool_t *scratch_pool)
+{
+  commit_merge_baton_t *b = baton;
+  svn_fs_root_t *root;
+  dag_node_t *root_node;
+
+  SVN_ERR(svn_fs_fs__revision_root(&root, b->txn->fs, revision,
+                                   scratch_pool));
+  SVN_ERR(get_root(&root_node, root, scratch_pool));
+
+  svn_stringbuf_setempty(b->conflict);
+  SVN_ERR(merge_changes(NULL, root_node, b->txn, b->conflict,
+                        scratch_pool));
+  b->txn->base_rev = revision;
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_fs_fs__commit_txn(const char **conflict_p,
@@ -2247,6 +2281,7 @@ svn_fs_fs__commit_txn(const char **conflict_p,
   svn_stringbuf_t *conflict = svn_stringbuf_create_empty(pool);
   svn_fs_t *fs = txn->fs;
   fs_fs_data_t *ffd = fs->fsap_data;
+  commit_merge_baton_t merge_baton;
 
   /* Limit memory usage when the repository has a high commit rate and
      needs to run the following while loop multiple times.  The memory
@@ -2259,6 +2294,11 @@ svn_fs_fs__commit_txn(const char **conflict_p,
   if (conflict_p)
     *conflict_p = NULL;
 
+  /* With group commit, our txn may need to be merged again while
+     waiting for the write lock. */
+  merge_baton.txn = txn;
+  merge_baton.conflict = conflict;
+
   while (1729)
     {
       svn_revnum_t youngish_rev;
@@ -2298,7 +2338,8 @@ svn_fs_fs__commit_txn(const char **conflict_p,
       txn->base_rev = youngish_rev;
 
       /* Try to commit. */
-      err = svn_fs_fs__commit(new_rev, fs, txn, iterpool);
+      err = svn_fs_fs__commit(new_rev, fs, txn, commit_merge, &merge_baton,
+                              iterpool);
       if (err && (err->apr_err == SVN_ERR_FS_TXN_OUT_OF_DATE))
         {
           /* Did someone else finish committing a new revision while we
@@ -2315,6 +2356,8 @@ svn_fs_fs__commit_txn(const char **conflict_p,
         }
       else if (err)
         {
+          if ((err->apr_err == SVN_ERR_FS_CONFLICT) && conflict_p)
+            *conflict_p = conflict->data;
           goto cleanup;
         }
       else
@@ -23,6 +23,7 @@
 #include <assert.h>
 
 #include "svn_ctype.h"
+#include "svn_hash.h"
 #include "svn_dirent_uri.h"
 #include "private/svn_string_private.h"
 
@@ -492,21 +493,21 @@ svn_fs_fs__read_current(svn_revnum_t *rev,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__write_current(svn_fs_t *fs,
-                         svn_revnum_t rev,
-                         apr_uint64_t next_node_id,
-                         apr_uint64_t next_copy_id,
-                         apr_pool_t *pool)
+/* Return the contents of the 'current' file in FS for REV, NEXT_NODE_ID
+   and NEXT_COPY_ID as described for svn_fs_fs__write_current.  Allocate
+   the result in RESULT_POOL. */
+static const char *
+unparse_current(svn_fs_t *fs,
+                svn_revnum_t rev,
+                apr_uint64_t next_node_id,
+                apr_uint64_t next_copy_id,
+                apr_pool_t *result_pool)
 {
-  char *buf;
-  const char *name;
   fs_fs_data_t *ffd = fs->fsap_data;
 
-  /* Now we can just write out this line. */
   if (ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
     {
-      buf = apr_psprintf(pool, "%ld\n", rev);
+      return apr_psprintf(result_pool, "%ld\n", rev);
     }
   else
     {
@@ -515,9 +516,24 @@ svn_fs_fs__write_current(svn_fs_t *fs,
       svn__ui64tobase36(node_id_str, next_node_id);
       svn__ui64tobase36(copy_id_str, next_copy_id);
 
-      buf = apr_psprintf(pool, "%ld %s %s\n", rev, node_id_str, copy_id_str);
+      return apr_psprintf(result_pool, "%ld %s %s\n", rev, node_id_str,
+                          copy_id_str);
     }
+}
+
+svn_error_t *
+svn_fs_fs__write_current(svn_fs_t *fs,
+                         svn_revnum_t rev,
+                         apr_uint64_t next_node_id,
+                         apr_uint64_t next_copy_id,
+                         apr_pool_t *pool)
+{
+  const char *buf;
+  const char *name;
+  fs_fs_data_t *ffd = fs->fsap_data;
 
+  /* Now we can just write out this line. */
+  buf = unparse_current(fs, rev, next_node_id, next_copy_id, pool);
   name = svn_fs_fs__path_current(fs, pool);
   SVN_ERR(svn_io_write_atomic2(name, buf, strlen(buf),
                                name /* copy_perms_path */,
@@ -526,6 +542,42 @@ svn_fs_fs__write_current(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__bump_current(svn_fs_t *fs,
+                        svn_revnum_t rev,
+                        apr_uint64_t next_node_id,
+                        apr_uint64_t next_copy_id,
+                        svn_io__batch_fsync_t *batch,
+                        apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *buf = unparse_current(fs, rev, next_node_id, next_copy_id,
+                                    scratch_pool);
+  const char *name = svn_fs_fs__path_current(fs, scratch_pool);
+  const char *next_name = svn_dirent_join(fs->path, PATH_NEXT, scratch_pool);
+
+  /* Write the 'next' file.  It may be a leftover from a failed commit. */
+  SVN_ERR(svn_io__batch_fsync_open_file(&file, batch, next_name,
+                                        scratch_pool));
+  SVN_ERR(svn_io_file_trunc(file, 0, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, buf, strlen(buf), NULL,
+                                 scratch_pool));
+
+  /* Commit all changes to disk. */
+  SVN_ERR(svn_io__batch_fsync_run(batch, scratch_pool));
+
+  /* Make the revision visible to all processes and threads. */
+  SVN_ERR(svn_fs_fs__move_into_place_batched(next_name, name, name,
+                                             ffd->flush_to_disk, batch,
+                                             scratch_pool));
+
+  /* Make the new revision permanently visible. */
+  SVN_ERR(svn_io__batch_fsync_run(batch, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__try_stringbuf_from_file(svn_stringbuf_t **content,
                                    svn_boolean_t *missing,
@@ -673,9 +725,77 @@ svn_fs_fs__move_into_place(const char *old_filename,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__move_into_place_batched(const char *old_filename,
+                                   const char *new_filename,
+                                   const char *perms_reference,
+                                   svn_boolean_t flush_to_disk,
+                                   svn_io__batch_fsync_t *batch,
+                                   apr_pool_t *scratch_pool)
+{
+  /* Like svn_fs_x__move_into_place, use the "immediate" fsyncs of
+   * svn_io_file_rename2 on non-POSIX platforms and the "scheduled" fsyncs
+   * on POSIX only.  There, the file handle remains valid across renames,
+   * so we can take it out before moving the file. */
+#if defined(SVN_ON_POSIX)
+  apr_file_t *file;
+  svn_error_t *err;
+
+  SVN_ERR(svn_io__batch_fsync_open_file(&file, batch, old_filename,
+                                        scratch_pool));
+
+  /* Copying permissions is a no-op on WIN32. */
+  SVN_ERR(svn_io_copy_perms(perms_reference, old_filename, scratch_pool));
+
+  /* Move the file into place. */
+  err = svn_io_file_rename2(old_filename, new_filename, FALSE, scratch_pool);
+  if (err && APR_STATUS_IS_EXDEV(err->apr_err))
+    {
+      /* Can't rename across devices; the fallback flushes immediately. */
+      svn_error_clear(err);
+      return svn_error_trace(svn_fs_fs__move_into_place(old_filename,
+                                                        new_filename,
+                                                        perms_reference,
+                                                        flush_to_disk,
+                                                        scratch_pool));
+    }
+  else if (err)
+    return svn_error_trace(err);
+
+  /* Schedule the directory update for synchronization. */
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, new_filename, scratch_pool));
+#else
+  SVN_ERR(svn_fs_fs__move_into_place(old_filename, new_filename,
+                                     perms_reference, flush_to_disk,
+                                     scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   return ffd->use_log_addressing;
 }
+
+svn_error_t *
+svn_fs_fs__get_parallel_jobs(int *jobs,
+                             svn_fs_t *fs)
+{
+  const char *jobs_str = fs->config
+                       ? svn_hash_gets(fs->config, SVN_FS_CONFIG_PARALLEL_JOBS)
+                       : NULL;
+
+  *jobs = 1;
+  if (jobs_str)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, jobs_str, APR_INT32_MIN,
+                                   APR_INT32_MAX, 10));
+      *jobs = val > 1 ? (int)val : 1;
+    }
+
+  return SVN_NO_ERROR;
+}
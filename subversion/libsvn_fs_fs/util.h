@@ -26,6 +26,8 @@
 #include "svn_fs.h"
 #include "id.h"
 
+#include "private/svn_io_private.h"
+
 /* Functions for dealing with recoverable errors on mutable files
  *
  * Revprops, current, and txn-current files are mutable; that is, they
@@ -347,6 +349,19 @@ svn_fs_fs__write_current(svn_fs_t *fs,
                          apr_uint64_t next_copy_id,
                          apr_pool_t *pool);
 
+/* Like svn_fs_fs__write_current but write the new contents to the 'next'
+   file first and flush it together with everything else scheduled in
+   BATCH.  Only once all of that is on disk, move 'next' into place as
+   the new 'current' file and flush that, too.  Afterwards, BATCH will
+   be empty.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__bump_current(svn_fs_t *fs,
+                        svn_revnum_t rev,
+                        apr_uint64_t next_node_id,
+                        apr_uint64_t next_copy_id,
+                        svn_io__batch_fsync_t *batch,
+                        apr_pool_t *scratch_pool);
+
 /* Read the file at PATH and return its content in *CONTENT. *CONTENT will
  * not be modified unless the whole file was read successfully.
  *
@@ -396,8 +411,28 @@ svn_fs_fs__move_into_place(const char *old_filename,
                            svn_boolean_t flush_to_disk,
                            apr_pool_t *pool);
 
+/* Like svn_fs_fs__move_into_place but, where supported, don't flush
+   anything immediately.  Instead, schedule fsyncs for the file contents
+   and its new directory entry in BATCH.  FLUSH_TO_DISK is only used when
+   falling back to svn_fs_fs__move_into_place.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_fs_fs__move_into_place_batched(const char *old_filename,
+                                   const char *new_filename,
+                                   const char *perms_reference,
+                                   svn_boolean_t flush_to_disk,
+                                   svn_io__batch_fsync_t *batch,
+                                   apr_pool_t *scratch_pool);
+
 /* Return TRUE, iff FS uses logical addressing. */
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs);
 
+/* Set *JOBS to the number of threads that FS' configuration allows
+ * long-running operations like verify or pack to use.  The value will
+ * be at least 1. */
+svn_error_t *
+svn_fs_fs__get_parallel_jobs(int *jobs,
+                             svn_fs_t *fs);
+
 #endif
@@ -24,6 +24,7 @@
 #include "svn_checksum.h"
 #include "svn_time.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_task.h"
 
 #include "verify.h"
 #include "fs_fs.h"
@@ -166,7 +167,7 @@ verify_rep_cache(svn_fs_t *fs,
  * indedx NAME in the error message.  Supports cancellation with CANCEL_FUNC
  * and CANCEL_BATON.  SCRATCH_POOL is for temporary allocations. */
 static svn_error_t *
-verify_index_checksum(apr_file_t *file,
+verify_index_checksum(svn_fs_fs__revision_file_t *file,
                       const char *name,
                       apr_off_t start,
                       apr_off_t end,
@@ -182,14 +183,13 @@ verify_index_checksum(apr_file_t *file,
     = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
 
   /* Calculate the index checksum. */
-  SVN_ERR(svn_io_file_seek(file, APR_SET, &start, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL, start));
   while (size > 0)
     {
       apr_size_t to_read = size > sizeof(buffer)
                          ? sizeof(buffer)
                          : (apr_size_t)size;
-      SVN_ERR(svn_io_file_read_full2(file, buffer, to_read, NULL, NULL,
-                                     scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, buffer, to_read));
       SVN_ERR(svn_checksum_update(context, buffer, to_read));
       size -= to_read;
 
@@ -204,7 +204,7 @@ verify_index_checksum(apr_file_t *file,
     {
       const char *file_name;
 
-      SVN_ERR(svn_io_file_name_get(&file_name, file, scratch_pool));
+      SVN_ERR(svn_io_file_name_get(&file_name, file->file, scratch_pool));
       SVN_ERR(svn_checksum_mismatch_err(expected, actual, scratch_pool,
                                         _("%s checksum mismatch in file %s"),
                                         name, file_name));
@@ -233,11 +233,11 @@ verify_index_checksums(svn_fs_t *fs,
   SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
 
   /* Verify the index contents against the checksum from the footer. */
-  SVN_ERR(verify_index_checksum(rev_file->file, "L2P index",
+  SVN_ERR(verify_index_checksum(rev_file, "L2P index",
                                 rev_file->l2p_offset, rev_file->p2l_offset,
                                 rev_file->l2p_checksum,
                                 cancel_func, cancel_baton, scratch_pool));
-  SVN_ERR(verify_index_checksum(rev_file->file, "P2L index",
+  SVN_ERR(verify_index_checksum(rev_file, "P2L index",
                                 rev_file->p2l_offset, rev_file->footer_offset,
                                 rev_file->p2l_checksum,
                                 cancel_func, cancel_baton, scratch_pool));
@@ -449,7 +449,7 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
  * SIZE must not exceed STREAM_THRESHOLD.  Use POOL for allocations.
  */
 static svn_error_t *
-expect_buffer_nul(apr_file_t *file,
+expect_buffer_nul(svn_fs_fs__revision_file_t *file,
                   apr_off_t size,
                   apr_pool_t *pool)
 {
@@ -464,8 +464,7 @@ expect_buffer_nul(apr_file_t *file,
 
   /* read the whole data block; error out on failure */
   data.chunks[(size - 1)/ sizeof(apr_uint64_t)] = 0;
-  SVN_ERR(svn_io_file_read_full2(file, data.buffer, (apr_size_t)size, NULL,
-                                 NULL, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(file, data.buffer, (apr_size_t)size));
 
   /* chunky check */
   for (i = 0; i < size / sizeof(apr_uint64_t); ++i)
@@ -479,8 +478,8 @@ expect_buffer_nul(apr_file_t *file,
         const char *file_name;
         apr_off_t offset;
 
-        SVN_ERR(svn_io_file_name_get(&file_name, file, pool));
-        SVN_ERR(svn_io_file_get_offset(&offset, file, pool));
+        SVN_ERR(svn_io_file_name_get(&file_name, file->file, pool));
+        SVN_ERR(svn_fs_fs__rev_file_offset(&offset, file));
         offset -= size - i;
 
         return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
@@ -496,7 +495,7 @@ expect_buffer_nul(apr_file_t *file,
  * Use POOL for allocations.
  */
 static svn_error_t *
-read_all_nul(apr_file_t *file,
+read_all_nul(svn_fs_fs__revision_file_t *file,
              apr_off_t size,
              apr_pool_t *pool)
 {
@@ -514,7 +513,7 @@ read_all_nul(apr_file_t *file,
  * in error message.  Allocate data in POOL.
  */
 static svn_error_t *
-expected_checksum(apr_file_t *file,
+expected_checksum(svn_fs_fs__revision_file_t *file,
                   svn_fs_fs__p2l_entry_t *entry,
                   apr_uint32_t actual,
                   apr_pool_t *pool)
@@ -523,7 +522,7 @@ expected_checksum(apr_file_t *file,
     {
       const char *file_name;
 
-      SVN_ERR(svn_io_file_name_get(&file_name, file, pool));
+      SVN_ERR(svn_io_file_name_get(&file_name, file->file, pool));
       return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
                                _("Checksum mismatch in item at offset %s of "
                                  "length %s bytes in file %s"),
@@ -539,15 +538,14 @@ expected_checksum(apr_file_t *file,
  * exceed STREAM_THRESHOLD.  Use POOL for allocations.
  */
 static svn_error_t *
-expected_buffered_checksum(apr_file_t *file,
+expected_buffered_checksum(svn_fs_fs__revision_file_t *file,
                            svn_fs_fs__p2l_entry_t *entry,
                            apr_pool_t *pool)
 {
   unsigned char buffer[STREAM_THRESHOLD];
   SVN_ERR_ASSERT(entry->size <= STREAM_THRESHOLD);
 
-  SVN_ERR(svn_io_file_read_full2(file, buffer, (apr_size_t)entry->size,
-                                 NULL, NULL, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(file, buffer, (apr_size_t)entry->size));
   SVN_ERR(expected_checksum(file, entry,
                             svn__fnv1a_32x4(buffer, (apr_size_t)entry->size),
                             pool));
@@ -559,7 +557,7 @@ expected_buffered_checksum(apr_file_t *file,
  * FILE will match ENTRY's expected checksum.  Use POOL for allocations.
  */
 static svn_error_t *
-expected_streamed_checksum(apr_file_t *file,
+expected_streamed_checksum(svn_fs_fs__revision_file_t *file,
                            svn_fs_fs__p2l_entry_t *entry,
                            apr_pool_t *pool)
 {
@@ -574,8 +572,7 @@ expected_streamed_checksum(apr_file_t *file,
       apr_size_t to_read = size > sizeof(buffer)
                          ? sizeof(buffer)
                          : (apr_size_t)size;
-      SVN_ERR(svn_io_file_read_full2(file, buffer, to_read, NULL, NULL,
-                                     pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, buffer, to_read));
       SVN_ERR(svn_checksum_update(context, buffer, to_read));
       size -= to_read;
     }
@@ -626,8 +623,7 @@ compare_p2l_to_rev(svn_fs_t *fs,
                              apr_off_t_toa(pool, rev_file->l2p_offset), start,
                              apr_off_t_toa(pool, max_offset));
 
-  SVN_ERR(svn_io_file_aligned_seek(rev_file->file, ffd->block_size, NULL, 0,
-                                   pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, 0));
 
   /* for all offsets in the file, get the P2L index entries and check
      them against the L2P index */
@@ -645,8 +641,7 @@ compare_p2l_to_rev(svn_fs_t *fs,
 
       /* The above might have moved the file pointer.
        * Ensure we actually start reading at OFFSET.  */
-      SVN_ERR(svn_io_file_aligned_seek(rev_file->file, ffd->block_size,
-                                       NULL, offset, iterpool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
       /* process all entries (and later continue with the next block) */
       for (i = 0; i < entries->nelts; ++i)
@@ -707,16 +702,16 @@ compare_p2l_to_rev(svn_fs_t *fs,
               /* Empty sections must contain NUL bytes only.
                * Beware of the filler at the end of the p2l index. */
               if (entry->offset != max_offset)
-                SVN_ERR(read_all_nul(rev_file->file, entry->size, pool));
+                SVN_ERR(read_all_nul(rev_file, entry->size, pool));
             }
           else
             {
               /* Generic contents check against checksum. */
               if (entry->size < STREAM_THRESHOLD)
-                SVN_ERR(expected_buffered_checksum(rev_file->file, entry,
+                SVN_ERR(expected_buffered_checksum(rev_file, entry,
                                                    pool));
               else
-                SVN_ERR(expected_streamed_checksum(rev_file->file, entry,
+                SVN_ERR(expected_streamed_checksum(rev_file, entry,
                                                    pool));
             }
 
@@ -883,6 +878,118 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Number of revisions per task in verify_f7_metadata_concurrently() for
+ * non-sharded repositories. */
+#define LINEAR_LAYOUT_TASK_SIZE 1000
+
+/* Baton type used by verify_f7_metadata_concurrently(). */
+typedef struct verify_f7_baton_t
+{
+  /* First and last revision to verify. */
+  svn_revnum_t start;
+  svn_revnum_t end;
+
+  /* Number of revisions per task.  Each task but the first starts at a
+   * multiple of it. */
+  svn_revnum_t task_size;
+
+  /* Progress notification, only used from the main thread. */
+  svn_fs_progress_notify_func_t notify_func;
+  void *notify_baton;
+} verify_f7_baton_t;
+
+/* Return the revision range START to END covered by TASK_INDEX in BATON.
+ */
+static void
+get_task_range(svn_revnum_t *start,
+               svn_revnum_t *end,
+               verify_f7_baton_t *baton,
+               apr_int64_t task_index)
+{
+  svn_revnum_t first_task = baton->start / baton->task_size;
+  svn_revnum_t task = first_task + (svn_revnum_t)task_index;
+
+  *start = MAX(baton->start, task * baton->task_size);
+  *end = MIN(baton->end, (task + 1) * baton->task_size - 1);
+}
+
+/* Implements svn_task__process_func_t.
+ * Verify the revision range of the task given by TASK_INDEX in the
+ * verify_f7_baton_t PROCESS_BATON using the svn_fs_t THREAD_CONTEXT. */
+static svn_error_t *
+verify_f7_task(void **result,
+               void *process_baton,
+               void *thread_context,
+               apr_int64_t task_index,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_revnum_t start, end;
+  get_task_range(&start, &end, process_baton, task_index);
+
+  *result = NULL;
+  return svn_error_trace(verify_f7_metadata_consistency(thread_context,
+                                                        start, end,
+                                                        NULL, NULL,
+                                                        cancel_func,
+                                                        cancel_baton,
+                                                        scratch_pool));
+}
+
+/* Implements svn_task__output_func_t.
+ * Send the progress notification for TASK_INDEX in the verify_f7_baton_t
+ * OUTPUT_BATON. */
+static svn_error_t *
+verify_f7_notify(void *result,
+                 void *output_baton,
+                 apr_int64_t task_index,
+                 apr_pool_t *scratch_pool)
+{
+  verify_f7_baton_t *baton = output_baton;
+  svn_revnum_t start, end;
+
+  get_task_range(&start, &end, baton, task_index);
+  if (baton->notify_func)
+    baton->notify_func(start, baton->notify_baton, scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Like verify_f7_metadata_consistency but verify the shards in parallel,
+ * using up to THREAD_COUNT threads.  Each thread uses its own instance of
+ * FS.  Errors are reported in revision order. */
+static svn_error_t *
+verify_f7_metadata_concurrently(svn_fs_t *fs,
+                                svn_revnum_t start,
+                                svn_revnum_t end,
+                                int thread_count,
+                                svn_fs_progress_notify_func_t notify_func,
+                                void *notify_baton,
+                                svn_cancel_func_t cancel_func,
+                                void *cancel_baton,
+                                apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  verify_f7_baton_t baton;
+
+  baton.start = start;
+  baton.end = end;
+  baton.task_size = ffd->max_files_per_dir ? ffd->max_files_per_dir
+                                           : LINEAR_LAYOUT_TASK_SIZE;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+
+  return svn_error_trace(svn_task__run(thread_count,
+                                       end / baton.task_size
+                                         - start / baton.task_size + 1,
+                                       svn_fs_fs__open_task_instance, fs,
+                                       verify_f7_task, &baton,
+                                       verify_f7_notify, &baton,
+                                       cancel_func, cancel_baton, pool));
+}
+
 svn_error_t *
 svn_fs_fs__verify(svn_fs_t *fs,
                   svn_revnum_t start,
@@ -894,6 +1001,7 @@ svn_fs_fs__verify(svn_fs_t *fs,
                   apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  int jobs;
 
   /* Input validation. */
   if (! SVN_IS_VALID_REVNUM(start))
@@ -908,7 +1016,12 @@ svn_fs_fs__verify(svn_fs_t *fs,
 
   /* log/phys index consistency.  We need to check them first to make
      sure we can access the rev / pack files in format7. */
-  if (svn_fs_fs__use_log_addressing(fs))
+  SVN_ERR(svn_fs_fs__get_parallel_jobs(&jobs, fs));
+  if (svn_fs_fs__use_log_addressing(fs) && jobs > 1)
+    SVN_ERR(verify_f7_metadata_concurrently(fs, start, end, jobs,
+                                            notify_func, notify_baton,
+                                            cancel_func, cancel_baton, pool));
+  else if (svn_fs_fs__use_log_addressing(fs))
     SVN_ERR(verify_f7_metadata_consistency(fs, start, end,
                                            notify_func, notify_baton,
                                            cancel_func, cancel_baton, pool));
@@ -306,6 +306,9 @@ init_callbacks(svn_cache__t *cache,
  * use the default priority class. HAS_NAMESPACE indicates whether we
  * prefixed this cache instance with a namespace.
  *
+ * If DISK is not NULL and the cache has no namespace, put DISK behind
+ * the cache as its persistent second-level cache.
+ *
  * Unless NO_HANDLER is true, register an error handler that reports errors
  * as warnings to the FS warning callback.
  *
@@ -315,6 +318,7 @@ static svn_error_t *
 create_cache(svn_cache__t **cache_p,
              svn_memcache_t *memcache,
              svn_membuffer_t *membuffer,
+             svn_cache__disk_t *disk,
              apr_int64_t pages,
              apr_int64_t items_per_page,
              svn_cache__serialize_func_t serializer,
@@ -368,6 +372,11 @@ create_cache(svn_cache__t **cache_p,
       SVN_ERR(svn_cache__create_null(cache_p, prefix, result_pool));
     }
 
+  if (disk && !dummy_cache && !has_namespace)
+    SVN_ERR(svn_cache__create_disk_tier(cache_p, *cache_p, disk,
+                                        serializer, deserializer, klen,
+                                        prefix, result_pool));
+
   SVN_ERR(init_callbacks(*cache_p, fs, error_handler, result_pool));
 
   return SVN_NO_ERROR;
@@ -437,6 +446,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->dir_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1024, 8,
                        svn_fs_x__serialize_dir_entries,
                        svn_fs_x__deserialize_dir_entries,
@@ -452,6 +462,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->node_revision_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        32, 32, /* ~200 byte / entry; 1k entries total */
                        svn_fs_x__serialize_node_revision,
                        svn_fs_x__deserialize_node_revision,
@@ -468,6 +479,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->rep_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 1000, /* ~8 bytes / entry; 1k entries total */
                        svn_fs_x__serialize_rep_header,
                        svn_fs_x__deserialize_rep_header,
@@ -484,6 +496,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->changes_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 8, /* 1k / entry; 8 entries total, rarely used */
                        svn_fs_x__serialize_changes,
                        svn_fs_x__deserialize_changes,
@@ -500,6 +513,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->fulltext_cache),
                        ffd->memcache,
                        membuffer,
+                       ffd->disk_cache,
                        0, 0, /* Do not use inprocess cache */
                        /* Values are svn_stringbuf_t */
                        NULL, NULL,
@@ -515,6 +529,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->properties_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        0, 0, /* Do not use inprocess cache */
                        svn_fs_x__serialize_properties,
                        svn_fs_x__deserialize_properties,
@@ -531,6 +546,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->revprop_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        0, 0, /* Do not use inprocess cache */
                        svn_fs_x__serialize_properties,
                        svn_fs_x__deserialize_properties,
@@ -547,6 +563,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->txdelta_window_cache),
                        NULL,
                        membuffer,
+                       ffd->disk_cache,
                        0, 0, /* Do not use inprocess cache */
                        svn_fs_x__serialize_txdelta_window,
                        svn_fs_x__deserialize_txdelta_window,
@@ -562,6 +579,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->combined_window_cache),
                        NULL,
                        membuffer,
+                       ffd->disk_cache,
                        0, 0, /* Do not use inprocess cache */
                        /* Values are svn_stringbuf_t */
                        NULL, NULL,
@@ -578,6 +596,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->noderevs_container_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        16, 4, /* Important, largish objects */
                        svn_fs_x__serialize_noderevs_container,
                        svn_fs_x__deserialize_noderevs_container,
@@ -592,6 +611,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->changes_container_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        0, 0, /* Do not use inprocess cache */
                        svn_fs_x__serialize_changes_container,
                        svn_fs_x__deserialize_changes_container,
@@ -606,6 +626,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->reps_container_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        0, 0, /* Do not use inprocess cache */
                        svn_fs_x__serialize_reps_container,
                        svn_fs_x__deserialize_reps_container,
@@ -622,6 +643,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->l2p_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        64, 16, /* entry size varies but we must cover
                                   a reasonable number of revisions (1k) */
                        svn_fs_x__serialize_l2p_header,
@@ -637,6 +659,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->l2p_page_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        64, 16, /* entry size varies but we must cover
                                   a reasonable number of revisions (1k) */
                        svn_fs_x__serialize_l2p_page,
@@ -652,6 +675,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->p2l_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        4, 1, /* Large entries. Rarely used. */
                        svn_fs_x__serialize_p2l_header,
                        svn_fs_x__deserialize_p2l_header,
@@ -666,6 +690,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->p2l_page_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        4, 16, /* Variably sized entries. Rarely used. */
                        svn_fs_x__serialize_p2l_page,
                        svn_fs_x__deserialize_p2l_page,
@@ -28,6 +28,7 @@
 #include <apr_network_io.h>
 #include <apr_md5.h>
 #include <apr_sha1.h>
+#include <apr_thread_cond.h>
 
 #include "svn_fs.h"
 #include "svn_config.h"
@@ -98,6 +99,8 @@ extern "C" {
 /* Names of sections and options in fsx.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_DISK_CACHE_PATH    "disk-cache-path"
+#define CONFIG_OPTION_DISK_CACHE_SIZE    "disk-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -111,6 +114,8 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_SECTION_COMMITS           "commits"
+#define CONFIG_OPTION_GROUP_COMMIT       "group-commit"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 
@@ -185,7 +190,10 @@ typedef struct svn_fs_x__shared_data_t
      declaration here.  Any subset may be acquired and held at any given
      time but their relative acquisition order must not change.
 
-     (lock 'pack' before 'write' before 'txn-current' before 'txn-list') */
+     (lock 'pack' before 'write' before 'txn-current' before 'txn-list')
+
+     The GROUP_COMMIT_LOCK below is never held while acquiring any of
+     the others. */
 
   /* A lock for intra-process synchronization when accessing the TXNS list. */
   svn_mutex__t *txn_list_lock;
@@ -202,6 +210,22 @@ typedef struct svn_fs_x__shared_data_t
      repository pack operation lock. */
   svn_mutex__t *fs_pack_lock;
 
+  /* Group commit support.  All members below are synchronised under
+     GROUP_COMMIT_LOCK.  COMMIT_QUEUE_HEAD and COMMIT_QUEUE_TAIL are the
+     FIFO of commits waiting to be processed, COMMIT_LEADER_ACTIVE is set
+     while one of the waiting threads works through that queue and
+     COMMIT_GROUP_DONE gets signalled whenever it is done with a group.
+     COMMIT_GROUP_BROKEN is set after we failed to make a group of new
+     revisions visible.  See svn_fs_x__commit(). */
+  svn_mutex__t *group_commit_lock;
+#if APR_HAS_THREADS
+  apr_thread_cond_t *commit_group_done;
+#endif
+  struct commit_baton_t *commit_queue_head;
+  struct commit_baton_t *commit_queue_tail;
+  svn_boolean_t commit_leader_active;
+  svn_boolean_t commit_group_broken;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -287,6 +311,9 @@ typedef struct svn_fs_x__data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Persistent second-level cache for revision contents.  May be NULL. */
+  svn_cache__disk_t *disk_cache;
+
   /* Caches native dag_node_t* instances */
   svn_fs_x__dag_cache_t *dag_node_cache;
 
@@ -406,6 +433,10 @@ typedef struct svn_fs_x__data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Let concurrent commits from within this process be processed in
+     groups.  See SVN_FS_CONFIG_GROUP_COMMIT. */
+  svn_boolean_t group_commit;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
@@ -262,6 +262,8 @@ read_config(svn_fs_x__data_t *ffd,
 {
   svn_config_t *config;
   apr_int64_t compression_level;
+  const char *disk_cache_path;
+  apr_int64_t disk_cache_size;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -332,6 +334,11 @@ read_config(svn_fs_x__data_t *ffd,
   ffd->p2l_page_size *= 0x400;
   /* L2P pages are in entries - not in (k)Bytes */
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->group_commit,
+                              CONFIG_SECTION_COMMITS,
+                              CONFIG_OPTION_GROUP_COMMIT,
+                              FALSE));
+
   /* Debug options. */
   SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
                               CONFIG_SECTION_DEBUG,
@@ -346,6 +353,34 @@ read_config(svn_fs_x__data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* persistent second-level cache */
+  svn_config_get(config, &disk_cache_path, CONFIG_SECTION_CACHES,
+                 CONFIG_OPTION_DISK_CACHE_PATH, NULL);
+  SVN_ERR(svn_config_get_int64(config, &disk_cache_size,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_DISK_CACHE_SIZE, 1024));
+  ffd->disk_cache = NULL;
+  if (disk_cache_path && disk_cache_size > 0)
+    {
+      svn_error_t *err
+        = svn_cache__disk_open(&ffd->disk_cache,
+                               svn_dirent_join(fs_path, disk_cache_path,
+                                               scratch_pool),
+                               (apr_uint64_t)disk_cache_size * 0x100000,
+                               scratch_pool);
+
+      /* Like all caches, this one is optional. */
+      if (err && !ffd->fail_stop)
+        {
+          svn_error_clear(err);
+          ffd->disk_cache = NULL;
+        }
+      else
+        {
+          SVN_ERR(err);
+        }
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -381,6 +416,16 @@ write_config(svn_fs_t *fs,
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
 ""                                                                           NL
+"### The following options enable a persistent second-level cache for"       NL
+"### file contents and deltas.  It is kept in a memory-mapped file that"     NL
+"### survives server restarts, so that a freshly started server does not"    NL
+"### have to read everything from the repository again.  Relative paths"     NL
+"### are relative to this repository's db directory.  The size is given"     NL
+"### in MB and defaults to 1024.  Several repositories and server"           NL
+"### processes may use the same file but should then agree on its size."     NL
+"# " CONFIG_OPTION_DISK_CACHE_PATH " = /var/cache/svn/fsx-cache"             NL
+"# " CONFIG_OPTION_DISK_CACHE_SIZE " = 1024"                                 NL
+""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
 "### duplicate representations.  This comes at a slight cost in"             NL
@@ -528,6 +573,17 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+""                                                                           NL
+"[" CONFIG_SECTION_COMMITS "]"                                               NL
+"### Set this to 'true' to let concurrent commits within the same server"    NL
+"### process be written as one group that is made durable with a single"     NL
+"### combined disk flush.  This increases commit throughput on busy"         NL
+"### servers where flushes are slow, at the expense of some latency for"     NL
+"### the individual commit.  Commits are never grouped while memcached or"   NL
+"### the persistent disk cache is in use."                                   NL
+"### The '" SVN_FS_CONFIG_GROUP_COMMIT "' filesystem configuration option"   NL
+"### overrides this setting."                                                NL
+"# " CONFIG_OPTION_GROUP_COMMIT " = false"                                   NL
 ;
 #undef NL
   return svn_io_file_create(svn_dirent_join(fs->path, PATH_CONFIG,
@@ -545,6 +601,9 @@ read_global_config(svn_fs_t *fs)
   ffd->flush_to_disk = !svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
+  ffd->group_commit = svn_hash__get_bool(fs->config,
+                                         SVN_FS_CONFIG_GROUP_COMMIT,
+                                         ffd->group_commit);
 
   return SVN_NO_ERROR;
 }
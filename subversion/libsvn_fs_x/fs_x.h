@@ -51,6 +51,18 @@ svn_fs_x__initialize_shared_data(svn_fs_t *fs,
                                  apr_pool_t *scratch_pool,
                                  apr_pool_t *common_pool);
 
+/* Open another instance of the already opened fsx filesystem FS and
+   return it in *NEW_FS.  The new instance has the same configuration and
+   shares the process-wide data with FS but has its own cache front-ends,
+   file handles etc.  Hence, both may be used concurrently from different
+   threads.  Allocate *NEW_FS in RESULT_POOL and use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_fs_x__open_instance(svn_fs_t **new_fs,
+                        svn_fs_t *fs,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool);
+
 /* Upgrade the fsx filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
@@ -28,6 +28,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_temp_serializer.h"
+#include "private/svn_task.h"
 
 #include "fs_x.h"
 #include "pack.h"
@@ -244,7 +245,7 @@ initialize_pack_context(pack_context_t *context,
                         const char *shard_dir,
                         svn_revnum_t shard_rev,
                         int max_items,
-                        svn_fs_x__batch_fsync_t *batch,
+                        svn_io__batch_fsync_t *batch,
                         svn_cancel_func_t cancel_func,
                         void *cancel_baton,
                         apr_pool_t *pool)
@@ -274,8 +275,8 @@ initialize_pack_context(pack_context_t *context,
   context->pack_file_path
     = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
 
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&context->pack_file, batch,
-                                          context->pack_file_path, pool));
+  SVN_ERR(svn_io__batch_fsync_open_file(&context->pack_file, batch,
+                                        context->pack_file_path, pool));
 
   /* Proto index files */
   SVN_ERR(svn_fs_x__l2p_proto_index_open(
@@ -1919,7 +1920,7 @@ pack_log_addressed(svn_fs_t *fs,
                    const char *shard_dir,
                    svn_revnum_t shard_rev,
                    apr_size_t max_mem,
-                   svn_fs_x__batch_fsync_t *batch,
+                   svn_io__batch_fsync_t *batch,
                    svn_cancel_func_t cancel_func,
                    void *cancel_baton,
                    apr_pool_t *scratch_pool)
@@ -2019,7 +2020,7 @@ pack_rev_shard(svn_fs_t *fs,
                apr_int64_t shard,
                int max_files_per_dir,
                apr_size_t max_mem,
-               svn_fs_x__batch_fsync_t *batch,
+               svn_io__batch_fsync_t *batch,
                svn_cancel_func_t cancel_func,
                void *cancel_baton,
                apr_pool_t *scratch_pool)
@@ -2036,7 +2037,7 @@ pack_rev_shard(svn_fs_t *fs,
 
   /* Create the new directory and pack file. */
   SVN_ERR(svn_io_dir_make(pack_file_dir, APR_OS_DEFAULT, scratch_pool));
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, pack_file_dir, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, pack_file_dir, scratch_pool));
 
   /* Index information files */
   SVN_ERR(pack_log_addressed(fs, pack_file_dir, shard_path, shard_rev,
@@ -2049,53 +2050,65 @@ pack_rev_shard(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* In the file system at FS_PATH, pack the SHARD in DIR containing exactly
- * MAX_FILES_PER_DIR revisions, using SCRATCH_POOL temporary for allocations.
- * COMPRESSION_LEVEL and MAX_PACK_SIZE will be ignored in that case.
- * An attempt will be made to keep memory usage below MAX_MEM.
+/* Set *PACK_FILE_DIR and *SHARD_PATH to the paths of the packed and the
+ * non-packed revision SHARD within DIR, respectively.  Allocate the
+ * results in RESULT_POOL.
+ */
+static void
+get_shard_paths(const char **pack_file_dir,
+                const char **shard_path,
+                const char *dir,
+                apr_int64_t shard,
+                apr_pool_t *result_pool)
+{
+  *pack_file_dir = svn_dirent_join(dir,
+                  apr_psprintf(result_pool,
+                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                               shard),
+                  result_pool);
+  *shard_path = svn_dirent_join(dir,
+                      apr_psprintf(result_pool, "%" APR_INT64_T_FMT, shard),
+                      result_pool);
+}
+
+/* In the file system at FS_PATH, pack the revision contents and revprops
+ * of the SHARD in DIR containing exactly MAX_FILES_PER_DIR revisions,
+ * using SCRATCH_POOL temporary for allocations.  Revprops will be packed
+ * using COMPRESSION_LEVEL and MAX_PACK_SIZE.  An attempt will be made to
+ * keep memory usage below MAX_MEM.  Return only after all data has been
+ * written to disk.
  *
- * CANCEL_FUNC and CANCEL_BATON are what you think they are; similarly
- * NOTIFY_FUNC and NOTIFY_BATON.
+ * This does not modify the repository state, i.e. the pack data will not
+ * be used until switch_to_packed_shard() has been called.  Hence, shards
+ * may be processed concurrently using separate FS instances.
+ *
+ * CANCEL_FUNC and CANCEL_BATON are what you think they are.
  *
  * If for some reason we detect a partial packing already performed, we
  * remove the pack file and start again.
  */
 static svn_error_t *
-pack_shard(const char *dir,
-           svn_fs_t *fs,
-           apr_int64_t shard,
-           int max_files_per_dir,
-           apr_off_t max_pack_size,
-           int compression_level,
-           apr_size_t max_mem,
-           svn_fs_pack_notify_t notify_func,
-           void *notify_baton,
-           svn_cancel_func_t cancel_func,
-           void *cancel_baton,
-           apr_pool_t *scratch_pool)
+pack_shard_contents(const char *dir,
+                    svn_fs_t *fs,
+                    apr_int64_t shard,
+                    int max_files_per_dir,
+                    apr_off_t max_pack_size,
+                    int compression_level,
+                    apr_size_t max_mem,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
 {
   svn_fs_x__data_t *ffd = fs->fsap_data;
   const char *shard_path, *pack_file_dir;
-  svn_fs_x__batch_fsync_t *batch;
-
-  /* Notify caller we're starting to pack this shard. */
-  if (notify_func)
-    SVN_ERR(notify_func(notify_baton, shard, svn_fs_pack_notify_start,
-                        scratch_pool));
+  svn_io__batch_fsync_t *batch;
 
   /* Perform all fsyncs through this instance. */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
-                                       scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                     scratch_pool));
 
   /* Some useful paths. */
-  pack_file_dir = svn_dirent_join(dir,
-                  apr_psprintf(scratch_pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               shard),
-                  scratch_pool);
-  shard_path = svn_dirent_join(dir,
-                      apr_psprintf(scratch_pool, "%" APR_INT64_T_FMT, shard),
-                      scratch_pool);
+  get_shard_paths(&pack_file_dir, &shard_path, dir, shard, scratch_pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(fs, pack_file_dir, shard_path,
@@ -2112,19 +2125,83 @@ pack_shard(const char *dir,
                                         cancel_func, cancel_baton,
                                         scratch_pool));
 
+  /* Ensure that packed file is written to disk.*/
+  SVN_ERR(svn_io__batch_fsync_run(batch, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* In the file system FS, make the packed SHARD in DIR containing exactly
+ * MAX_FILES_PER_DIR revisions the current one and remove the non-packed
+ * data.  pack_shard_contents() must have been called for SHARD before.
+ * Shards must be switched over in ascending order.
+ *
+ * CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+switch_to_packed_shard(const char *dir,
+                       svn_fs_t *fs,
+                       apr_int64_t shard,
+                       int max_files_per_dir,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+  const char *shard_path, *pack_file_dir;
+
+  get_shard_paths(&pack_file_dir, &shard_path, dir, shard, scratch_pool);
+
   /* Update the min-unpacked-rev file to reflect our newly packed shard. */
   SVN_ERR(svn_fs_x__write_min_unpacked_rev(fs,
                           (svn_revnum_t)((shard + 1) * max_files_per_dir),
                           scratch_pool));
   ffd->min_unpacked_rev = (svn_revnum_t)((shard + 1) * max_files_per_dir);
 
-  /* Ensure that packed file is written to disk.*/
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
-
   /* Finally, remove the existing shard directories. */
   SVN_ERR(svn_io_remove_dir2(shard_path, TRUE,
                              cancel_func, cancel_baton, scratch_pool));
 
+  return SVN_NO_ERROR;
+}
+
+/* In the file system at FS_PATH, pack the SHARD in DIR containing exactly
+ * MAX_FILES_PER_DIR revisions, using SCRATCH_POOL temporary for allocations.
+ * COMPRESSION_LEVEL and MAX_PACK_SIZE will be ignored in that case.
+ * An attempt will be made to keep memory usage below MAX_MEM.
+ *
+ * CANCEL_FUNC and CANCEL_BATON are what you think they are; similarly
+ * NOTIFY_FUNC and NOTIFY_BATON.
+ *
+ * If for some reason we detect a partial packing already performed, we
+ * remove the pack file and start again.
+ */
+static svn_error_t *
+pack_shard(const char *dir,
+           svn_fs_t *fs,
+           apr_int64_t shard,
+           int max_files_per_dir,
+           apr_off_t max_pack_size,
+           int compression_level,
+           apr_size_t max_mem,
+           svn_fs_pack_notify_t notify_func,
+           void *notify_baton,
+           svn_cancel_func_t cancel_func,
+           void *cancel_baton,
+           apr_pool_t *scratch_pool)
+{
+  /* Notify caller we're starting to pack this shard. */
+  if (notify_func)
+    SVN_ERR(notify_func(notify_baton, shard, svn_fs_pack_notify_start,
+                        scratch_pool));
+
+  SVN_ERR(pack_shard_contents(dir, fs, shard, max_files_per_dir,
+                              max_pack_size, compression_level, max_mem,
+                              cancel_func, cancel_baton, scratch_pool));
+  SVN_ERR(switch_to_packed_shard(dir, fs, shard, max_files_per_dir,
+                                 cancel_func, cancel_baton, scratch_pool));
+
   /* Notify caller we're starting to pack this shard. */
   if (notify_func)
     SVN_ERR(notify_func(notify_baton, shard, svn_fs_pack_notify_end,
@@ -2171,6 +2248,134 @@ typedef struct pack_baton_t
   void *cancel_baton;
 } pack_baton_t;
 
+/* Baton type used by the callbacks of pack_shards_concurrently(). */
+typedef struct concurrent_pack_baton_t
+{
+  /* The pack operation parameters, including the main FS instance. */
+  pack_baton_t *pb;
+
+  /* Folder containing the revision shards. */
+  const char *data_path;
+
+  /* The shard to be packed by task 0. */
+  apr_int64_t first_shard;
+
+  /* Temporary memory limit for each concurrent pack_shard_contents()
+     call. */
+  apr_size_t max_mem;
+} concurrent_pack_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Return another instance of the svn_fs_t given as BATON. */
+static svn_error_t *
+open_fs_instance(void **thread_context,
+                 void *baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs;
+  SVN_ERR(svn_fs_x__open_instance(&fs, baton, result_pool, scratch_pool));
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Pack the contents of the shard given by TASK_INDEX and the
+ * concurrent_pack_baton_t PROCESS_BATON using the svn_fs_t THREAD_CONTEXT.
+ * The result is always NULL. */
+static svn_error_t *
+pack_shard_task(void **result,
+                void *process_baton,
+                void *thread_context,
+                apr_int64_t task_index,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  concurrent_pack_baton_t *baton = process_baton;
+  svn_fs_t *fs = thread_context;
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+
+  SVN_ERR(pack_shard_contents(baton->data_path, fs,
+                              baton->first_shard + task_index,
+                              ffd->max_files_per_dir,
+                              ffd->revprop_pack_size,
+                              ffd->compress_packed_revprops
+                                ? SVN__COMPRESSION_ZLIB_DEFAULT
+                                : SVN__COMPRESSION_NONE,
+                              baton->max_mem, cancel_func, cancel_baton,
+                              scratch_pool));
+
+  *result = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * The contents of the shard given by TASK_INDEX and the
+ * concurrent_pack_baton_t OUTPUT_BATON has been packed.  Switch the
+ * repository over to the packed shard and send the notifications. */
+static svn_error_t *
+switch_to_packed_shard_task(void *result,
+                            void *output_baton,
+                            apr_int64_t task_index,
+                            apr_pool_t *scratch_pool)
+{
+  concurrent_pack_baton_t *baton = output_baton;
+  pack_baton_t *pb = baton->pb;
+  svn_fs_x__data_t *ffd = pb->fs->fsap_data;
+  apr_int64_t shard = baton->first_shard + task_index;
+
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, shard,
+                            svn_fs_pack_notify_start, scratch_pool));
+
+  SVN_ERR(switch_to_packed_shard(baton->data_path, pb->fs, shard,
+                                 ffd->max_files_per_dir,
+                                 pb->cancel_func, pb->cancel_baton,
+                                 scratch_pool));
+
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, shard,
+                            svn_fs_pack_notify_end, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Pack the shards FIRST_SHARD up to but not including END_SHARD in
+ * DATA_PATH as described by PB using up to JOBS threads.  Each thread
+ * packs one shard at a time, using its own svn_fs_t instance and its
+ * share of PB->MAX_MEM.  The switch to the packed shards happens strictly
+ * in shard order from the calling thread.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+pack_shards_concurrently(pack_baton_t *pb,
+                         const char *data_path,
+                         apr_int64_t first_shard,
+                         apr_int64_t end_shard,
+                         int jobs,
+                         apr_pool_t *scratch_pool)
+{
+  concurrent_pack_baton_t baton;
+
+  if (jobs > end_shard - first_shard)
+    jobs = (int)(end_shard - first_shard);
+
+  baton.pb = pb;
+  baton.data_path = data_path;
+  baton.first_shard = first_shard;
+  baton.max_mem = pb->max_mem / jobs;
+
+  return svn_error_trace(svn_task__run(jobs, end_shard - first_shard,
+                                       open_fs_instance, pb->fs,
+                                       pack_shard_task, &baton,
+                                       switch_to_packed_shard_task, &baton,
+                                       pb->cancel_func, pb->cancel_baton,
+                                       scratch_pool));
+}
+
 
 /* The work-horse for svn_fs_x__pack, called with the FS write lock.
    This implements the svn_fs_x__with_write_lock() 'body' callback
@@ -2197,6 +2402,7 @@ pack_body(void *baton,
   apr_pool_t *iterpool;
   const char *data_path;
   svn_boolean_t fully_packed;
+  int jobs;
 
   /* Since another process might have already packed the repo,
      we need to re-read the pack status. */
@@ -2214,6 +2420,14 @@ pack_body(void *baton,
   completed_shards = (ffd->youngest_rev_cache + 1) / ffd->max_files_per_dir;
   data_path = svn_dirent_join(pb->fs->path, PATH_REVS_DIR, scratch_pool);
 
+  /* Packing the shard contents does not modify the repository state.
+     Do that concurrently, if allowed. */
+  SVN_ERR(svn_fs_x__get_parallel_jobs(&jobs, pb->fs));
+  if (jobs > 1)
+    return svn_error_trace(pack_shards_concurrently(pb, data_path,
+                              ffd->min_unpacked_rev / ffd->max_files_per_dir,
+                              completed_shards, jobs, scratch_pool));
+
   iterpool = svn_pool_create(scratch_pool);
   for (i = ffd->min_unpacked_rev / ffd->max_files_per_dir;
        i < completed_shards;
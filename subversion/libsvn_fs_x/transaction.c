@@ -42,7 +42,6 @@
 #include "lock.h"
 #include "rep-cache.h"
 #include "index.h"
-#include "batch_fsync.h"
 #include "revprops.h"
 
 #include "private/svn_fs_util.h"
@@ -2309,11 +2308,12 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
                             apr_pool_cleanup_null);
 
   /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&wh,
+  svn_txdelta_to_svndiff4(&wh,
                           &whb,
                           svn_stream_disown(b->rep_stream, b->result_pool),
                           diff_version,
                           ffd->delta_compression_level,
+                          SVN_DELTA_ENCODER_THREADS_DEFAULT,
                           result_pool);
 
   b->delta_stream = svn_txdelta_target_push(wh, whb, source,
@@ -2918,11 +2918,12 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   SVN_ERR(svn_io_file_get_offset(&delta_start, file, scratch_pool));
 
   /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&diff_wh,
+  svn_txdelta_to_svndiff4(&diff_wh,
                           &diff_whb,
                           svn_stream_disown(file_stream, scratch_pool),
                           diff_version,
                           ffd->delta_compression_level,
+                          1,
                           scratch_pool);
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
@@ -3481,7 +3482,7 @@ static svn_error_t *
 write_final_revprop(const char **path,
                     svn_fs_txn_t *txn,
                     svn_revnum_t revision,
-                    svn_fs_x__batch_fsync_t *batch,
+                    svn_io__batch_fsync_t *batch,
                     apr_pool_t *result_pool,
                     apr_pool_t *scratch_pool)
 {
@@ -3514,7 +3515,7 @@ write_final_revprop(const char **path,
 
   /* Create a file at the final revprops location. */
   *path = svn_fs_x__path_revprops(txn->fs, revision, result_pool);
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, *path, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_open_file(&file, batch, *path, scratch_pool));
 
   /* Write the new contents to the final revprops file. */
   SVN_ERR(svn_fs_x__write_non_packed_revprops(file, props, scratch_pool));
@@ -3571,7 +3572,7 @@ svn_fs_x__add_index_data(svn_fs_t *fs,
 static svn_error_t *
 auto_create_shard(svn_fs_t *fs,
                   svn_revnum_t revision,
-                  svn_fs_x__batch_fsync_t *batch,
+                  svn_io__batch_fsync_t *batch,
                   apr_pool_t *scratch_pool)
 {
   svn_fs_x__data_t *ffd = fs->fsap_data;
@@ -3588,7 +3589,7 @@ auto_create_shard(svn_fs_t *fs,
       SVN_ERR(svn_io_copy_perms(svn_dirent_join(fs->path, PATH_REVS_DIR,
                                                 scratch_pool),
                                 new_dir, scratch_pool));
-      SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, new_dir, scratch_pool));
+      SVN_ERR(svn_io__batch_fsync_new_path(batch, new_dir, scratch_pool));
     }
 
   return SVN_NO_ERROR;
@@ -3600,7 +3601,7 @@ auto_create_shard(svn_fs_t *fs,
 
    Note that the lifetime of *FILE is determined by BATCH instead of
    SCRATCH_POOL.  It will be invalidated by either BATCH being cleaned up
-   itself of by running svn_fs_x__batch_fsync_run on it.
+   itself of by running svn_io__batch_fsync_run on it.
 
    This function will "destroy" the transaction by removing its prototype
    revision file, so it can at most be called once per transaction.  Also,
@@ -3615,7 +3616,7 @@ get_writable_final_rev(apr_file_t **file,
                        svn_fs_t *fs,
                        svn_fs_x__txn_id_t txn_id,
                        svn_revnum_t revision,
-                       svn_fs_x__batch_fsync_t *batch,
+                       svn_io__batch_fsync_t *batch,
                        apr_pool_t *scratch_pool)
 {
   get_writable_proto_rev_baton_t baton;
@@ -3642,13 +3643,13 @@ get_writable_final_rev(apr_file_t **file,
                                                        scratch_pool),
                                    unlock_proto_rev(fs, txn_id, lockcookie,
                                                     scratch_pool)));
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, final_rev_filename,
-                                         scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, final_rev_filename,
+                                       scratch_pool));
 
   /* Now open the prototype revision file and seek to the end.
      Note that BATCH always seeks to position 0 before returning the file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(file, batch, final_rev_filename,
-                                          scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_open_file(file, batch, final_rev_filename,
+                                        scratch_pool));
   SVN_ERR(svn_io_file_seek(*file, APR_END, &end_offset, scratch_pool));
 
   /* We don't want unused sections (such as leftovers from failed delta
@@ -3665,7 +3666,7 @@ get_writable_final_rev(apr_file_t **file,
 static svn_error_t *
 write_next_file(svn_fs_t *fs,
                 svn_revnum_t revision,
-                svn_fs_x__batch_fsync_t *batch,
+                svn_io__batch_fsync_t *batch,
                 apr_pool_t *scratch_pool)
 {
   apr_file_t *file;
@@ -3674,7 +3675,7 @@ write_next_file(svn_fs_t *fs,
   char *buf;
 
   /* Create / open the 'next' file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_open_file(&file, batch, path, scratch_pool));
 
   /* Write its contents. */
   buf = apr_psprintf(scratch_pool, "%ld\n", revision);
@@ -3691,7 +3692,7 @@ write_next_file(svn_fs_t *fs,
 static svn_error_t *
 bump_current(svn_fs_t *fs,
              svn_revnum_t new_rev,
-             svn_fs_x__batch_fsync_t *batch,
+             svn_io__batch_fsync_t *batch,
              apr_pool_t *scratch_pool)
 {
   const char *current_filename;
@@ -3700,7 +3701,7 @@ bump_current(svn_fs_t *fs,
   SVN_ERR(write_next_file(fs, new_rev, batch, scratch_pool));
 
   /* Commit all changes to disk. */
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_run(batch, scratch_pool));
 
   /* Make the revision visible to all processes and threads. */
   current_filename = svn_fs_x__path_current(fs, scratch_pool);
@@ -3709,7 +3710,7 @@ bump_current(svn_fs_t *fs,
                                     batch, scratch_pool));
 
   /* Make the new revision permanently visible. */
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_run(batch, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -3757,47 +3758,61 @@ typedef struct commit_baton_t {
   apr_array_header_t *reps_to_cache;
   apr_hash_t *reps_hash;
   apr_pool_t *reps_pool;
+
+  /* Keys of the directories cached while writing the new revision.
+     Set by write_revision(). */
+  apr_array_header_t *directory_ids;
+
+  /* The following members are only used for group commits. */
+
+  /* Callback and baton to bring TXN up to date with later revisions. */
+  svn_fs_x__commit_merge_func_t merge_func;
+  void *merge_baton;
+
+  /* Pool of the thread that wants to commit TXN.  All processing of this
+     commit will use this pool, even if done by some other thread. */
+  apr_pool_t *pool;
+
+  /* The revision written for TXN. */
+  svn_revnum_t new_rev;
+
+  /* Set once this commit has been processed, with the result in ERR. */
+  svn_boolean_t done;
+  svn_error_t *err;
+
+  /* Next commit in the same queue or group. */
+  struct commit_baton_t *next;
 } commit_baton_t;
 
-/* The work-horse for svn_fs_x__commit, called with the FS write lock.
-   This implements the svn_fs_x__with_write_lock() 'body' callback
-   type.  BATON is a 'commit_baton_t *'. */
+/* Write the contents of the transaction given in CB as the revision
+   following OLD_REV, which must be the youngest revision in CB->FS.
+   Schedule everything that needs to be flushed to disk in BATCH but leave
+   updating 'current' to the caller.
+
+   The FS write lock is assumed to be held by the caller.  Perform
+   temporary allocations in SCRATCH_POOL. */
 static svn_error_t *
-commit_body(void *baton,
-            apr_pool_t *scratch_pool)
+write_revision(commit_baton_t *cb,
+               svn_revnum_t old_rev,
+               svn_io__batch_fsync_t *batch,
+               apr_pool_t *scratch_pool)
 {
-  commit_baton_t *cb = baton;
-  svn_fs_x__data_t *ffd = cb->fs->fsap_data;
   const char *old_rev_filename, *rev_filename;
   const char *revprop_filename;
   svn_fs_x__id_t root_id, new_root_id;
-  svn_revnum_t old_rev, new_rev;
+  svn_revnum_t new_rev;
   apr_file_t *proto_file;
   apr_off_t initial_offset, changed_path_offset;
   svn_fs_x__txn_id_t txn_id = svn_fs_x__txn_get_id(cb->txn);
   apr_hash_t *changed_paths;
-  svn_fs_x__batch_fsync_t *batch;
-  apr_array_header_t *directory_ids
-    = apr_array_make(scratch_pool, 4, sizeof(svn_fs_x__pair_cache_key_t));
 
   /* We perform a sequence of (potentially) large allocations.
      Keep the peak memory usage low by using a SUBPOOL and cleaning it
      up frequently. */
   apr_pool_t *subpool = svn_pool_create(scratch_pool);
 
-  /* Re-Read the current repository format.  All our repo upgrade and
-     config evaluation strategies are such that existing information in
-     FS and FFD remains valid.
-
-     Although we don't recommend upgrading hot repositories, people may
-     still do it and we must make sure to either handle them gracefully
-     or to error out.
-   */
-  SVN_ERR(svn_fs_x__read_format_file(cb->fs, subpool));
-
-  /* Get the current youngest revision. */
-  SVN_ERR(svn_fs_x__youngest_rev(&old_rev, cb->fs, subpool));
-  svn_pool_clear(subpool);
+  cb->directory_ids = apr_array_make(scratch_pool, 4,
+                                     sizeof(svn_fs_x__pair_cache_key_t));
 
   /* Check to make sure this transaction is based off the most recent
      revision. */
@@ -3820,11 +3835,6 @@ commit_body(void *baton,
   /* We are going to be one better than this puny old revision. */
   new_rev = old_rev + 1;
 
-  /* Use this to force all data to be flushed to physical storage
-     (to the degree our environment will allow). */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
-                                       scratch_pool));
-
   /* Set up the target directory. */
   SVN_ERR(auto_create_shard(cb->fs, new_rev, batch, subpool));
 
@@ -3841,7 +3851,8 @@ commit_body(void *baton,
   /* Write out all the node-revisions and directory contents. */
   svn_fs_x__init_txn_root(&root_id, txn_id);
   SVN_ERR(write_final_rev(&new_root_id, proto_file, new_rev, cb->fs, &root_id,
-                          initial_offset, directory_ids, cb->reps_to_cache,
+                          initial_offset, cb->directory_ids,
+                          cb->reps_to_cache,
                           cb->reps_hash, cb->reps_pool, TRUE, changed_paths,
                           subpool));
   svn_pool_clear(subpool);
@@ -3876,8 +3887,19 @@ commit_body(void *baton,
   SVN_ERR(verify_as_revision_before_current_plus_plus(cb->fs, new_rev,
                                                       subpool));
 
-  /* Bump 'current'. */
-  SVN_ERR(bump_current(cb->fs, new_rev, batch, subpool));
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+/* Finish the commit given in CB after NEW_REV, which has been written
+   for it, has been made visible.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+finish_commit(commit_baton_t *cb,
+              svn_revnum_t new_rev,
+              apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = cb->fs->fsap_data;
 
   /* At this point the new revision is committed and globally visible
      so let the caller know it succeeded by giving it the new revision
@@ -3890,15 +3912,395 @@ commit_body(void *baton,
 
   /* Make the directory contents already cached for the new revision
    * visible. */
-  SVN_ERR(promote_cached_directories(cb->fs, directory_ids, subpool));
+  SVN_ERR(promote_cached_directories(cb->fs, cb->directory_ids,
+                                     scratch_pool));
 
   /* Remove this transaction directory. */
-  SVN_ERR(svn_fs_x__purge_txn(cb->fs, cb->txn->id, subpool));
+  SVN_ERR(svn_fs_x__purge_txn(cb->fs, cb->txn->id, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* The work-horse for svn_fs_x__commit, called with the FS write lock.
+   This implements the svn_fs_x__with_write_lock() 'body' callback
+   type.  BATON is a 'commit_baton_t *'. */
+static svn_error_t *
+commit_body(void *baton,
+            apr_pool_t *scratch_pool)
+{
+  commit_baton_t *cb = baton;
+  svn_fs_x__data_t *ffd = cb->fs->fsap_data;
+  svn_revnum_t old_rev, new_rev;
+  svn_io__batch_fsync_t *batch;
+
+  /* Re-Read the current repository format.  All our repo upgrade and
+     config evaluation strategies are such that existing information in
+     FS and FFD remains valid.
+
+     Although we don't recommend upgrading hot repositories, people may
+     still do it and we must make sure to either handle them gracefully
+     or to error out.
+   */
+  SVN_ERR(svn_fs_x__read_format_file(cb->fs, scratch_pool));
+
+  /* Get the current youngest revision. */
+  SVN_ERR(svn_fs_x__youngest_rev(&old_rev, cb->fs, scratch_pool));
+
+  /* Use this to force all data to be flushed to physical storage
+     (to the degree our environment will allow). */
+  SVN_ERR(svn_io__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                     scratch_pool));
+
+  SVN_ERR(write_revision(cb, old_rev, batch, scratch_pool));
+  new_rev = old_rev + 1;
+
+  /* Bump 'current'. */
+  SVN_ERR(bump_current(cb->fs, new_rev, batch, scratch_pool));
+
+  return svn_error_trace(finish_commit(cb, new_rev, scratch_pool));
+}
+
+#if APR_HAS_THREADS
+
+/* Maximum number of commits that a single group may contain. */
+#define MAX_COMMIT_GROUP_SIZE 64
+
+/* Baton used for group_commit_body below. */
+typedef struct group_commit_baton_t {
+  /* The filesystem object of the group leader. */
+  svn_fs_t *fs;
+
+  /* All commits taken from the queue, in queue order. */
+  commit_baton_t *processed;
+
+  /* Set if the new revisions could not be made visible. */
+  svn_boolean_t broken;
+} group_commit_baton_t;
+
+/* Wait for the next signal on FFSD's COMMIT_GROUP_DONE.  The caller must
+ * hold FFSD's GROUP_COMMIT_LOCK. */
+static svn_error_t *
+wait_for_commit_group(svn_fs_x__shared_data_t *ffsd)
+{
+  apr_status_t status
+    = apr_thread_cond_wait(ffsd->commit_group_done,
+                           svn_mutex__get(ffsd->group_commit_lock));
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't wait for condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Append CB to FFSD's commit queue.  The caller must hold FFSD's
+ * GROUP_COMMIT_LOCK. */
+static svn_error_t *
+enqueue_commit(svn_fs_x__shared_data_t *ffsd,
+               commit_baton_t *cb)
+{
+  cb->next = NULL;
+  if (ffsd->commit_queue_tail)
+    ffsd->commit_queue_tail->next = cb;
+  else
+    ffsd->commit_queue_head = cb;
+
+  ffsd->commit_queue_tail = cb;
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove CB from FFSD's commit queue.  CB must be in that queue.  The
+ * caller must hold FFSD's GROUP_COMMIT_LOCK. */
+static void
+remove_commit(svn_fs_x__shared_data_t *ffsd,
+              commit_baton_t *cb)
+{
+  commit_baton_t **link = &ffsd->commit_queue_head;
+  commit_baton_t *prev = NULL;
+
+  while (*link != cb)
+    {
+      prev = *link;
+      link = &prev->next;
+    }
+
+  *link = cb->next;
+  if (ffsd->commit_queue_tail == cb)
+    ffsd->commit_queue_tail = prev;
+
+  cb->next = NULL;
+}
+
+/* Implement take_next_commit.  The caller must hold FFSD's
+ * GROUP_COMMIT_LOCK. */
+static svn_error_t *
+dequeue_commit(commit_baton_t **cb,
+               svn_fs_x__shared_data_t *ffsd)
+{
+  /* Don't risk reusing revision numbers that we may already have handed
+     out to readers within this process. */
+  if (ffsd->commit_group_broken)
+    return svn_error_create(SVN_ERR_FS_GENERAL, NULL,
+                            _("A previous group commit could not be "
+                              "completed; restart the process to "
+                              "commit again"));
+
+  *cb = ffsd->commit_queue_head;
+  if (*cb)
+    remove_commit(ffsd, *cb);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *CB to the commit at the front of FFSD's commit queue and remove it
+ * from there.  Set *CB to NULL if the queue is empty. */
+static svn_error_t *
+take_next_commit(commit_baton_t **cb,
+                 svn_fs_x__shared_data_t *ffsd)
+{
+  SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock, dequeue_commit(cb, ffsd));
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait until either CB has been processed or nobody else is processing
+ * FFSD's commit queue anymore.  In the latter case, make the caller the
+ * group leader and set *LEAD.  Otherwise, reset *LEAD.  The caller must
+ * hold FFSD's GROUP_COMMIT_LOCK. */
+static svn_error_t *
+wait_for_turn(svn_boolean_t *lead,
+              svn_fs_x__shared_data_t *ffsd,
+              commit_baton_t *cb)
+{
+  while (!cb->done && ffsd->commit_leader_active)
+    SVN_ERR(wait_for_commit_group(ffsd));
+
+  *lead = !cb->done;
+  if (*lead)
+    ffsd->commit_leader_active = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark all commits processed in GB as done, end LEADER's leadership and
+ * wake up all waiting commits.  ERR is the result of processing the group.
+ * If LEADER's own commit did not get processed due to ERR, remove it from
+ * FFSD's queue and make it fail with ERR.  The caller must hold FFSD's
+ * GROUP_COMMIT_LOCK. */
+static svn_error_t *
+end_commit_group(svn_fs_x__shared_data_t *ffsd,
+                 group_commit_baton_t *gb,
+                 commit_baton_t *leader,
+                 svn_error_t *err)
+{
+  commit_baton_t *cb, *next;
+  apr_status_t status;
+
+  /* Waiting commits may return as soon as we release the lock, so don't
+     access them after marking them as done. */
+  for (cb = gb->processed; cb; cb = next)
+    {
+      next = cb->next;
+      cb->done = TRUE;
+    }
+
+  if (!leader->done && err)
+    {
+      remove_commit(ffsd, leader);
+      leader->err = err;
+      leader->done = TRUE;
+    }
+  else if (err)
+    {
+      leader->err = svn_error_compose_create(leader->err, err);
+    }
+
+  if (gb->broken)
+    ffsd->commit_group_broken = TRUE;
+
+  ffsd->commit_leader_active = FALSE;
+
+  status = apr_thread_cond_broadcast(ffsd->commit_group_done);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't signal condition variable"));
 
-  svn_pool_destroy(subpool);
   return SVN_NO_ERROR;
 }
 
+/* Prepare the queued commit CB to become the revision following YOUNGEST,
+ * which is not necessarily visible yet.  The FS write lock is assumed to
+ * be held by the caller. */
+static svn_error_t *
+prepare_queued_commit(commit_baton_t *cb,
+                      svn_revnum_t youngest)
+{
+  svn_fs_x__data_t *ffd = cb->fs->fsap_data;
+
+  /* Only the group leader's FS got updated when acquiring the lock.
+     Do the same for all others. */
+  SVN_ERR(svn_fs_x__update_min_unpacked_rev(cb->fs, cb->pool));
+
+  /* Allow merging with revisions written by this group. */
+  ffd->youngest_rev_cache = youngest;
+
+  if (cb->txn->base_rev != youngest)
+    {
+      if (!cb->merge_func)
+        return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
+                                _("Transaction out of date"));
+
+      SVN_ERR(cb->merge_func(cb->merge_baton, youngest, cb->pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* The revisions following PUBLISHED that the group GB wrote could not be
+ * made visible.  Make the FS instances of all commits in GB forget about
+ * them again and drop everything that their merges may have cached about
+ * those revisions, which may get written again with different contents.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+forget_unpublished_revisions(group_commit_baton_t *gb,
+                             svn_revnum_t published,
+                             apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  commit_baton_t *cb;
+
+  for (cb = gb->processed; cb; cb = cb->next)
+    {
+      svn_fs_x__data_t *ffd = cb->fs->fsap_data;
+      ffd->youngest_rev_cache = published;
+
+      /* Replaces the instance-local caches, e.g. the DAG node cache. */
+      SVN_ERR(svn_fs_x__initialize_caches(cb->fs, scratch_pool));
+    }
+
+  /* Entries in the process-wide cache are keyed by revision.  Shared
+   * caches beyond this process are never used with group commits. */
+  if (membuffer)
+    SVN_ERR(svn_cache__membuffer_clear(membuffer));
+
+  return SVN_NO_ERROR;
+}
+
+/* Take up to MAX_COMMIT_GROUP_SIZE commits from the commit queue of the
+ * filesystem given in the 'group_commit_baton_t *' BATON, write them
+ * as consecutive revisions and make all of them visible at once, after
+ * a single flush to disk.  Commits that fail to merge will not get a
+ * revision but don't affect the other commits.  If writing a revision
+ * fails, leave the remaining queue for the next group.
+ *
+ * This implements the svn_fs_x__with_write_lock() 'body' callback type.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+group_commit_body(void *baton,
+                  apr_pool_t *scratch_pool)
+{
+  group_commit_baton_t *gb = baton;
+  svn_fs_x__data_t *ffd = gb->fs->fsap_data;
+  svn_fs_x__shared_data_t *ffsd = ffd->shared;
+  commit_baton_t **last = &gb->processed;
+  commit_baton_t *cb;
+  svn_io__batch_fsync_t *batch;
+  svn_revnum_t old_rev, youngest;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  /* See commit_body. */
+  SVN_ERR(svn_fs_x__read_format_file(gb->fs, scratch_pool));
+  SVN_ERR(svn_fs_x__youngest_rev(&old_rev, gb->fs, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                     scratch_pool));
+
+  youngest = old_rev;
+  for (i = 0; i < MAX_COMMIT_GROUP_SIZE; ++i)
+    {
+      err = take_next_commit(&cb, ffsd);
+      if (err || !cb)
+        break;
+
+      *last = cb;
+      last = &cb->next;
+
+      cb->err = prepare_queued_commit(cb, youngest);
+      if (cb->err)
+        continue;
+
+      cb->err = write_revision(cb, youngest, batch, cb->pool);
+      if (cb->err)
+        break;
+
+      cb->new_rev = ++youngest;
+    }
+
+  if (youngest > old_rev)
+    {
+      /* Flush all revisions to disk and make them visible. */
+      svn_error_t *bump_err = bump_current(gb->fs, youngest, batch,
+                                           scratch_pool);
+      for (cb = gb->processed; cb; cb = cb->next)
+        if (!cb->err)
+          cb->err = bump_err ? svn_error_dup(bump_err)
+                             : finish_commit(cb, cb->new_rev, cb->pool);
+
+      /* Other processes may reuse the revision numbers that we handed
+         out to merges.  Don't let this process commit again. */
+      if (bump_err)
+        {
+          gb->broken = TRUE;
+          bump_err = svn_error_compose_create(
+                       bump_err,
+                       forget_unpublished_revisions(gb, old_rev,
+                                                    scratch_pool));
+        }
+
+      svn_error_clear(bump_err);
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Queue the commit CB in the list of commits waiting for the write lock.
+ * Wait for it to get processed by the current group leader or become
+ * the group leader and process as many queued commits as possible.
+ * Return the result of committing CB. */
+static svn_error_t *
+group_commit(commit_baton_t *cb)
+{
+  svn_fs_x__data_t *ffd = cb->fs->fsap_data;
+  svn_fs_x__shared_data_t *ffsd = ffd->shared;
+  svn_boolean_t lead;
+
+  cb->done = FALSE;
+  cb->err = SVN_NO_ERROR;
+  cb->new_rev = SVN_INVALID_REVNUM;
+  SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock, enqueue_commit(ffsd, cb));
+
+  /* Our commit may not be part of the first group that we lead. */
+  do
+    {
+      SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock,
+                           wait_for_turn(&lead, ffsd, cb));
+      if (lead)
+        {
+          group_commit_baton_t gb = { 0 };
+          svn_error_t *err;
+
+          gb.fs = cb->fs;
+          err = svn_fs_x__with_write_lock(cb->fs, group_commit_body, &gb,
+                                          cb->pool);
+          SVN_MUTEX__WITH_LOCK(ffsd->group_commit_lock,
+                               end_commit_group(ffsd, &gb, cb, err));
+        }
+    }
+  while (lead);
+
+  return svn_error_trace(cb->err);
+}
+
+#endif /* APR_HAS_THREADS */
+
 /* Add the representations in REPS_TO_CACHE (an array of
  * svn_fs_x__representation_t *) to the rep-cache database of FS. */
 static svn_error_t *
@@ -3925,6 +4327,8 @@ svn_error_t *
 svn_fs_x__commit(svn_revnum_t *new_rev_p,
                  svn_fs_t *fs,
                  svn_fs_txn_t *txn,
+                 svn_fs_x__commit_merge_func_t merge_func,
+                 void *merge_baton,
                  apr_pool_t *scratch_pool)
 {
   commit_baton_t cb;
@@ -3948,7 +4352,20 @@ svn_fs_x__commit(svn_revnum_t *new_rev_p,
       cb.reps_pool = NULL;
     }
 
-  SVN_ERR(svn_fs_x__with_write_lock(fs, commit_body, &cb, scratch_pool));
+#if APR_HAS_THREADS
+  /* Merges within a group see revisions that are not published yet.
+     If publishing them fails, we can only purge what got cached about
+     them within this process. */
+  if (ffd->group_commit && !ffd->memcache && !ffd->disk_cache)
+    {
+      cb.merge_func = merge_func;
+      cb.merge_baton = merge_baton;
+      cb.pool = scratch_pool;
+      SVN_ERR(group_commit(&cb));
+    }
+  else
+#endif
+    SVN_ERR(svn_fs_x__with_write_lock(fs, commit_body, &cb, scratch_pool));
 
   /* At this point, *NEW_REV_P has been set, so errors below won't affect
      the success of the commit.  (See svn_fs_commit_txn().)  */
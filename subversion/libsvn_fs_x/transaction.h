@@ -235,14 +235,32 @@ svn_fs_x__add_index_data(svn_fs_t *fs,
                          svn_revnum_t revision,
                          apr_pool_t *scratch_pool);
 
+/* Callback type used by svn_fs_x__commit to merge all changes between
+   the base revision of a transaction and REVISION into that transaction.
+   Upon success, the base revision of the transaction must be REVISION.
+   BATON is the MERGE_BATON given to svn_fs_x__commit.  Use SCRATCH_POOL
+   for temporary allocations. */
+typedef svn_error_t *
+(*svn_fs_x__commit_merge_func_t)(void *baton,
+                                 svn_revnum_t revision,
+                                 apr_pool_t *scratch_pool);
+
 /* Commit the transaction TXN in filesystem FS and return its new
    revision number in *REV.  If the transaction is out of date, return
    the error SVN_ERR_FS_TXN_OUT_OF_DATE. Use SCRATCH_POOL for temporary
-   allocations. */
+   allocations.
+
+   If group commit has been enabled for FS, concurrent commits from within
+   this process may get committed together by whichever thread gets the
+   write lock first.  Transactions that turn out to be out of date by then
+   will be brought up to date by calling MERGE_FUNC with MERGE_BATON, if
+   MERGE_FUNC is not NULL. */
 svn_error_t *
 svn_fs_x__commit(svn_revnum_t *new_rev_p,
                  svn_fs_t *fs,
                  svn_fs_txn_t *txn,
+                 svn_fs_x__commit_merge_func_t merge_func,
+                 void *merge_baton,
                  apr_pool_t *scratch_pool);
 
 /* Set *NAMES_P to an array of names which are all the active
@@ -23,6 +23,7 @@
 #include <assert.h>
 
 #include "svn_ctype.h"
+#include "svn_hash.h"
 #include "svn_dirent_uri.h"
 #include "private/svn_string_private.h"
 
@@ -704,7 +705,7 @@ svn_error_t *
 svn_fs_x__move_into_place(const char *old_filename,
                           const char *new_filename,
                           const char *perms_reference,
-                          svn_fs_x__batch_fsync_t *batch,
+                          svn_io__batch_fsync_t *batch,
                           apr_pool_t *scratch_pool)
 {
   /* Copying permissions is a no-op on WIN32. */
@@ -723,7 +724,7 @@ svn_fs_x__move_into_place(const char *old_filename,
                               scratch_pool));
 
   /* Schedule for synchronization. */
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, new_filename, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, new_filename, scratch_pool));
 #else
   SVN_ERR(svn_io_file_rename2(old_filename, new_filename, TRUE,
                               scratch_pool));
@@ -731,3 +732,23 @@ svn_fs_x__move_into_place(const char *old_filename,
 
   return SVN_NO_ERROR;
 }
+
+svn_error_t *
+svn_fs_x__get_parallel_jobs(int *jobs,
+                            svn_fs_t *fs)
+{
+  const char *jobs_str = fs->config
+                       ? svn_hash_gets(fs->config, SVN_FS_CONFIG_PARALLEL_JOBS)
+                       : NULL;
+
+  *jobs = 1;
+  if (jobs_str)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, jobs_str, APR_INT32_MIN,
+                                   APR_INT32_MAX, 10));
+      *jobs = val > 1 ? (int)val : 1;
+    }
+
+  return SVN_NO_ERROR;
+}
@@ -25,7 +25,8 @@
 
 #include "svn_fs.h"
 #include "id.h"
-#include "batch_fsync.h"
+
+#include "private/svn_io_private.h"
 
 /* Functions for dealing with recoverable errors on mutable files
  *
@@ -454,7 +455,14 @@ svn_error_t *
 svn_fs_x__move_into_place(const char *old_filename,
                           const char *new_filename,
                           const char *perms_reference,
-                          svn_fs_x__batch_fsync_t *batch,
+                          svn_io__batch_fsync_t *batch,
                           apr_pool_t *scratch_pool);
 
+/* Set *JOBS to the number of threads that FS' configuration allows
+ * long-running operations like pack to use.  The value will be at
+ * least 1. */
+svn_error_t *
+svn_fs_x__get_parallel_jobs(int *jobs,
+                            svn_fs_t *fs);
+
 #endif
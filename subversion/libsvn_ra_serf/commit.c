@@ -1964,9 +1964,10 @@ apply_textdelta(void *file_baton,
   negotiate_put_encoding(&svndiff_version, &compression_level,
                          ctx->commit_ctx->session);
   /* Disown the stream; we'll close it explicitly in close_file(). */
-  svn_txdelta_to_svndiff3(handler, handler_baton,
+  svn_txdelta_to_svndiff4(handler, handler_baton,
                           svn_stream_disown(ctx->stream, pool),
-                          svndiff_version, compression_level, pool);
+                          svndiff_version, compression_level,
+                          SVN_DELTA_ENCODER_THREADS_DEFAULT, pool);
 
   if (base_checksum)
     ctx->base_checksum = apr_pstrdup(ctx->pool, base_checksum);
@@ -144,6 +144,13 @@ struct svn_ra_serf__session_t {
      requests may come in any order */
   svn_boolean_t http20;
 
+  /* Offer http/2 during the TLS handshake (ALPN). */
+  svn_boolean_t negotiate_http2;
+
+  /* The maximum number of requests to keep in flight on a single http/2
+     connection, instead of opening more connections. */
+  apr_int64_t max_streams;
+
   /* Should we use Transfer-Encoding: chunked for HTTP/1.1 servers. */
   svn_boolean_t using_chunked_requests;
 
@@ -273,6 +280,10 @@ struct svn_ra_serf__session_t {
    * to a successful PUT request. */
   svn_boolean_t supports_put_result_checksum;
 
+  /* Indicates whether the server can deliver many files in a single
+   * get-files REPORT. */
+  svn_boolean_t supports_get_files;
+
   apr_interval_time_t conn_latency;
 };
 
@@ -715,6 +726,13 @@ svn_ra_serf__create_expat_handler(svn_ra_serf__session_t *session,
                                   const int *expected_status,
                                   apr_pool_t *result_pool);
 
+/* Prepare HANDLER, created by svn_ra_serf__create_expat_handler(), to
+   parse the response to a re-sent request from its start, e.g. from its
+   response_error callback after the connection got closed.  Callbacks
+   already invoked for the previous response are not undone.  */
+void
+svn_ra_serf__expat_handler_reset(svn_ra_serf__handler_t *handler);
+
 
 /* Allocated within XES->STATE_POOL. Changes are not allowd (callers
    should make a deep copy if they need to make changes).
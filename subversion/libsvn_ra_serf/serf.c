@@ -245,6 +245,16 @@ load_config(svn_ra_serf__session_t *session,
                                SVN_CONFIG_OPTION_HTTP_MAX_CONNECTIONS,
                                SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_CONNECTIONS));
 
+  /* Should we offer http/2 and how many streams may we use. */
+  SVN_ERR(svn_config_get_bool(config, &session->negotiate_http2,
+                              SVN_CONFIG_SECTION_GLOBAL,
+                              SVN_CONFIG_OPTION_HTTP_HTTP2,
+                              FALSE));
+  SVN_ERR(svn_config_get_int64(config, &session->max_streams,
+                               SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_HTTP_MAX_STREAMS,
+                               SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_STREAMS));
+
   /* Should we use chunked transfer encoding. */
   SVN_ERR(svn_config_get_tristate(config, &chunked_requests,
                                   SVN_CONFIG_SECTION_GLOBAL,
@@ -312,6 +322,16 @@ load_config(svn_ra_serf__session_t *session,
                                    SVN_CONFIG_OPTION_HTTP_MAX_CONNECTIONS,
                                    session->max_connections));
 
+      /* Load the group http/2 settings. */
+      SVN_ERR(svn_config_get_bool(config, &session->negotiate_http2,
+                                  server_group,
+                                  SVN_CONFIG_OPTION_HTTP_HTTP2,
+                                  session->negotiate_http2));
+      SVN_ERR(svn_config_get_int64(config, &session->max_streams,
+                                   server_group,
+                                   SVN_CONFIG_OPTION_HTTP_MAX_STREAMS,
+                                   session->max_streams));
+
       /* Should we use chunked transfer encoding. */
       SVN_ERR(svn_config_get_tristate(config, &chunked_requests,
                                       server_group,
@@ -357,6 +377,18 @@ load_config(svn_ra_serf__session_t *session,
   if (session->max_connections < 2)
     session->max_connections = 2;
 
+  /* Multiplexing all requests over a single connection means that their
+     responses may get interleaved in any order.  Respect the request to
+     limit ourselves to a single auxiliary connection, see
+     get_best_connection() in update.c, by sticking to HTTP/1.1. */
+  if (session->max_connections == 2)
+    session->negotiate_http2 = FALSE;
+
+  /* With http/2, we keep at least as many requests in flight as we would
+     distribute over separate HTTP/1.1 connections. */
+  if (session->max_streams < session->max_connections)
+    session->max_streams = session->max_connections;
+
   /* Parse the connection timeout value, if any. */
   session->timeout = apr_time_from_sec(DEFAULT_HTTP_TIMEOUT);
   if (timeout_str)
@@ -639,6 +671,8 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
                                    result_pool));
 
   /* max_connections */
+  /* negotiate_http2 */
+  /* max_streams */
   /* using_ssl */
   /* using_compression */
   /* http10 */
@@ -759,6 +793,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* supports_svndiff1 */
   /* supports_svndiff2 */
   /* supports_put_result_checksum */
+  /* supports_get_files */
   /* conn_latency */
 
   new_sess->context = serf_context_create(result_pool);
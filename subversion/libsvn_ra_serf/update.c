@@ -40,11 +40,13 @@
 #include "svn_path.h"
 #include "svn_base64.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 
 #include "svn_private_config.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_serf.h"
 #include "../libsvn_ra/ra_loader.h"
@@ -94,7 +96,11 @@ typedef enum report_state_e {
 
   VERSION_NAME,
   CREATIONDATE,
-  CREATOR_DISPLAYNAME
+  CREATOR_DISPLAYNAME,
+
+  /* States of the get-files REPORT response */
+  GET_FILES_REPORT,
+  GET_FILES_FILE
 } report_state_e;
 
 
@@ -238,6 +244,19 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
   { 0 }
 };
 
+static const svn_ra_serf__xml_transition_t get_files_ttable[] = {
+  { INITIAL, S_, "get-files-report", GET_FILES_REPORT,
+    FALSE, { NULL }, FALSE },
+
+  { GET_FILES_REPORT, S_, "file", GET_FILES_FILE,
+    FALSE, { "href", NULL }, TRUE },
+
+  { GET_FILES_FILE, S_, "txdelta", TXDELTA,
+    FALSE, { NULL }, FALSE },
+
+  { 0 }
+};
+
 /* While we process the REPORT response, we will queue up GET and PROPFIND
    requests. For a very large checkout, it is very easy to queue requests
    faster than they are resolved. Thus, we need to pause the XML processing
@@ -251,10 +270,27 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
    can make the measurements quite imprecise.
 
    We measure outstanding requests as the sum of NUM_ACTIVE_FETCHES and
-   NUM_ACTIVE_PROPFINDS in the report_context_t structure.  */
+   NUM_ACTIVE_PROPFINDS in the report_context_t structure.
+
+   REQUEST_COUNT_TO_RESUME is only the starting point.  Over a high latency
+   link, 40 requests are not enough to keep the pipes filled, so the actual
+   limit is tuned from the observed request round trip times; see
+   update_request_window().  With http/2, all requests share a single
+   connection as separate streams and the session's MAX_STREAMS caps the
+   window.  */
 #define REQUEST_COUNT_TO_PAUSE 50
 #define REQUEST_COUNT_TO_RESUME 40
 
+/* Re-evaluate the request window after this many completed requests, but
+   not more often than once per REQUEST_WINDOW_INTERVAL.  */
+#define REQUEST_WINDOW_SAMPLE 32
+#define REQUEST_WINDOW_INTERVAL apr_time_from_msec(100)
+
+/* A GET that has transferred (or announced) at least this many bytes is
+   considered a large download.  Small requests are preferably scheduled
+   on other connections, so they don't queue up behind it.  */
+#define LARGE_FETCH_SIZE (1024 * 1024)
+
 #define SPILLBUF_BLOCKSIZE 4096
 #define SPILLBUF_MAXBUFFSIZE 131072
 
@@ -388,8 +424,34 @@ typedef struct fetch_ctx_t {
   /* The base-rev header  */
   const char *delta_base;
 
+  /* Index of the connection this GET was scheduled on.  */
+  int conn_idx;
+
+  /* Has this GET been accounted as a large download?  */
+  svn_boolean_t large_fetch;
+
 } fetch_ctx_t;
 
+/*
+ * This structure represents a single get-files REPORT, which fetches the
+ * contents of several files at once instead of issuing a GET per file.
+ */
+typedef struct get_files_ctx_t {
+  apr_pool_t *pool;
+
+  report_context_t *report;
+
+  /* The handler representing the REPORT request.  */
+  svn_ra_serf__handler_t *handler;
+
+  /* The fetch_ctx_t * of the requested files, in request order.  */
+  apr_array_header_t *fetches;
+
+  /* Index in FETCHES of the file that is currently being received.  */
+  int cur;
+
+} get_files_ctx_t;
+
 /*
  * The master structure for a REPORT request and response.
  */
@@ -445,6 +507,23 @@ struct report_context_t {
   /* number of pending PROPFIND requests */
   unsigned int num_active_propfinds;
 
+  /* Maximum number of GET and PROPFIND requests to keep in flight.  */
+  unsigned int request_window;
+
+  /* Requests completed since WINDOW_START, when the current sample
+     period started.  */
+  unsigned int window_completed;
+  apr_time_t window_start;
+
+  /* Lowest average request round trip time observed so far, or -1.  */
+  apr_interval_time_t min_rtt;
+
+  /* Number of large GETs currently being received per connection.  */
+  unsigned int large_fetches[SVN_RA_SERF__MAX_CONNECTIONS_LIMIT];
+
+  /* Files waiting to be requested with a get-files REPORT, or NULL.  */
+  get_files_ctx_t *pending_files;
+
   /* Are we done parsing the REPORT response? */
   svn_boolean_t done;
 
@@ -548,13 +627,97 @@ create_file_baton(file_baton_t **new_file,
  *  opened. */
 #define REQS_PER_CONN 8
 
+/** Maximum nr. of files to fetch with a single get-files REPORT. */
+#define GET_FILES_MAX 32
+
+/* Return the largest request window that makes sense for CTX. */
+static unsigned int
+max_request_window(report_context_t *ctx)
+{
+  /* http/2 multiplexes all requests over the REPORT's connection; don't
+     exceed the stream window the server grants. */
+  if (ctx->sess->http20)
+    return (unsigned int)ctx->sess->max_streams;
+
+  return (unsigned int)(REQUEST_COUNT_TO_RESUME
+                        * MAX(ctx->sess->max_connections, 1));
+}
+
+/* Return the number of GET and PROPFIND requests that the update report
+ * in CTX shall keep in flight. */
+static unsigned int
+request_window(report_context_t *ctx)
+{
+  if (ctx->request_window == 0)
+    ctx->request_window = MIN(REQUEST_COUNT_TO_RESUME,
+                              max_request_window(ctx));
+
+  return ctx->request_window;
+}
+
+/* Note that a GET or PROPFIND of the update report in CTX has completed,
+ * and tune the request window from the observed round trip times.
+ *
+ * By Little's law, the average time a request spends in flight is the
+ * number of requests in flight divided by the completion rate.  See
+ * svn_request_window__adjust() for how that translates into the window. */
+static void
+update_request_window(report_context_t *ctx)
+{
+  apr_time_t now;
+  apr_interval_time_t elapsed;
+  apr_interval_time_t rtt;
+  unsigned int in_flight;
+
+  if (++ctx->window_completed < REQUEST_WINDOW_SAMPLE)
+    return;
+
+  now = apr_time_now();
+  if (ctx->window_start == 0)
+    {
+      /* First sample; just start measuring. */
+      ctx->window_start = now;
+      ctx->window_completed = 0;
+      ctx->min_rtt = ctx->sess->conn_latency;
+      return;
+    }
+
+  elapsed = now - ctx->window_start;
+  if (elapsed < REQUEST_WINDOW_INTERVAL)
+    return;
+
+  /* Include the request that just completed. */
+  in_flight = ctx->num_active_fetches + ctx->num_active_propfinds + 1;
+  rtt = elapsed * in_flight / ctx->window_completed;
+
+  ctx->window_start = now;
+  ctx->window_completed = 0;
+
+  if (rtt <= 0)
+    return;
+
+  if (ctx->min_rtt < 0 || rtt < ctx->min_rtt)
+    ctx->min_rtt = rtt;
+
+  ctx->request_window = svn_request_window__adjust(request_window(ctx),
+                                                   in_flight, rtt,
+                                                   ctx->min_rtt,
+                                                   REQUEST_COUNT_TO_RESUME,
+                                                   max_request_window(ctx));
+}
+
 /** This function creates a new connection for this serf session, but only
  * if the number of NUM_ACTIVE_REQS > REQS_PER_CONN or if there currently is
- * only one main connection open.
+ * only one main connection open.  With http/2, no extra connections will
+ * be opened.
  */
 static svn_error_t *
 open_connection_if_needed(svn_ra_serf__session_t *sess, int num_active_reqs)
 {
+  /* All requests can share the first connection. */
+  if (sess->http20)
+    return SVN_NO_ERROR;
+
   /* For each REQS_PER_CONN outstanding requests open a new connection, with
    * a minimum of 1 extra connection. */
   if (sess->num_conns == 1 ||
@@ -585,6 +748,20 @@ open_connection_if_needed(svn_ra_serf__session_t *sess, int num_active_reqs)
   return SVN_NO_ERROR;
 }
 
+/* Return the index of CONN in the connections of SESS. */
+static int
+conn_index(svn_ra_serf__session_t *sess,
+           svn_ra_serf__connection_t *conn)
+{
+  int i;
+
+  for (i = 0; i < sess->num_conns; i++)
+    if (sess->conns[i] == conn)
+      return i;
+
+  return 0;
+}
+
 /* Returns best connection for fetching files/properties. */
 static svn_ra_serf__connection_t *
 get_best_connection(report_context_t *ctx)
@@ -592,6 +769,11 @@ get_best_connection(report_context_t *ctx)
   svn_ra_serf__connection_t *conn;
   int first_conn = 1;
 
+  /* With http/2, the REPORT response does not block other requests on
+     the same connection, so use that one for everything. */
+  if (ctx->sess->http20)
+    return ctx->sess->conns[0];
+
   /* Skip the first connection if the REPORT response hasn't been completely
      received yet or if we're being told to limit our connections to
      2 (because this could be an attempt to ensure that we do all our
@@ -633,6 +815,13 @@ get_best_connection(report_context_t *ctx)
         {
           serf_connection_t *sc = ctx->sess->conns[i]->conn;
           unsigned int pending = serf_connection_pending_requests(sc);
+
+          /* Requests pipelined behind a large download have to wait for
+             all of it, so count such a download as a full connection's
+             worth of requests.  That keeps the small requests flowing on
+             the other connections while the large ones are received. */
+          pending += ctx->large_fetches[i] * REQS_PER_CONN;
+
           if (pending < min)
             {
               min = pending;
@@ -642,11 +831,19 @@ get_best_connection(report_context_t *ctx)
       conn = ctx->sess->conns[best_conn];
 #else
     /* We don't know how many requests are pending per connection, so just
-       cycle them. */
-      conn = ctx->sess->conns[ctx->sess->cur_conn];
-      ctx->sess->cur_conn++;
-      if (ctx->sess->cur_conn >= ctx->sess->num_conns)
-        ctx->sess->cur_conn = first_conn;
+       cycle them, skipping those that are busy with a large download. */
+      int i;
+
+      for (i = first_conn; i < ctx->sess->num_conns; i++)
+        {
+          conn = ctx->sess->conns[ctx->sess->cur_conn];
+          ctx->sess->cur_conn++;
+          if (ctx->sess->cur_conn >= ctx->sess->num_conns)
+            ctx->sess->cur_conn = first_conn;
+
+          if (ctx->large_fetches[conn_index(ctx->sess, conn)] == 0)
+            break;
+        }
 #endif
     }
   return conn;
@@ -941,6 +1138,16 @@ close_file(file_baton_t *file,
   return SVN_NO_ERROR;
 }
 
+/* Account the GET of FETCH_CTX as a large download on its connection. */
+static void
+mark_large_fetch(fetch_ctx_t *fetch_ctx)
+{
+  report_context_t *ctx = fetch_ctx->file->parent_dir->ctx;
+
+  fetch_ctx->large_fetch = TRUE;
+  ctx->large_fetches[fetch_ctx->conn_idx]++;
+}
+
 /* Implements svn_ra_serf__response_handler_t */
 static svn_error_t *
 handle_fetch(serf_request_t *request,
@@ -1004,6 +1211,17 @@ handle_fetch(serf_request_t *request,
           fetch_ctx->result_stream = NULL;
         }
 
+      val = serf_bucket_headers_get(hdrs, "Content-Length");
+      if (val && !fetch_ctx->large_fetch)
+        {
+          apr_int64_t content_length;
+          svn_error_t *err = svn_cstring_atoi64(&content_length, val);
+
+          if (!err && content_length >= LARGE_FETCH_SIZE)
+            mark_large_fetch(fetch_ctx);
+          svn_error_clear(err);
+        }
+
       fetch_ctx->read_headers = TRUE;
     }
 
@@ -1021,6 +1239,10 @@ handle_fetch(serf_request_t *request,
 
       fetch_ctx->read_size += len;
 
+      /* Chunked or compressed responses don't announce their size. */
+      if (fetch_ctx->read_size >= LARGE_FETCH_SIZE && !fetch_ctx->large_fetch)
+        mark_large_fetch(fetch_ctx);
+
       if (fetch_ctx->aborted_read)
         {
           apr_off_t skip;
@@ -1158,6 +1380,7 @@ file_props_done(serf_request_t *request,
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
   file->parent_dir->ctx->num_active_propfinds--;
+  update_request_window(file->parent_dir->ctx);
 
   file->fetch_props = FALSE;
 
@@ -1173,6 +1396,25 @@ file_props_done(serf_request_t *request,
   return svn_error_trace(close_file(file, scratch_pool));
 }
 
+/* Note that the contents of the file of FETCH_CTX have been delivered,
+ * and close the file if nothing else is pending for it. */
+static svn_error_t *
+file_contents_done(fetch_ctx_t *fetch_ctx,
+                   apr_pool_t *scratch_pool)
+{
+  file_baton_t *file = fetch_ctx->file;
+
+  file->parent_dir->ctx->num_active_fetches--;
+  update_request_window(file->parent_dir->ctx);
+
+  file->fetch_file = FALSE;
+
+  if (file->fetch_props)
+    return SVN_NO_ERROR; /* Still processing PROPFIND request */
+
+  return svn_error_trace(close_file(file, scratch_pool));
+}
+
 static svn_error_t *
 file_fetch_done(serf_request_t *request,
                 void *baton,
@@ -1189,12 +1431,8 @@ file_fetch_done(serf_request_t *request,
   if (handler->sline.code != 200)
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
-  file->parent_dir->ctx->num_active_fetches--;
-
-  file->fetch_file = FALSE;
-
-  if (file->fetch_props)
-    return SVN_NO_ERROR; /* Still processing PROPFIND request */
+  if (fetch_ctx->large_fetch)
+    file->parent_dir->ctx->large_fetches[fetch_ctx->conn_idx]--;
 
   /* Closing the file will automatically deliver the propfind props.
    *
@@ -1202,7 +1440,340 @@ file_fetch_done(serf_request_t *request,
    * handler, fetch_ctx, etc. which is only a valid operation in this
    * callback, as only after this callback our serf plumbing assumes the
    * request is done. */
-  return svn_error_trace(close_file(file, scratch_pool));
+  return svn_error_trace(file_contents_done(fetch_ctx, scratch_pool));
+}
+
+/* Conforms to svn_ra_serf__xml_opened_t  */
+static svn_error_t *
+get_files_opened(svn_ra_serf__xml_estate_t *xes,
+                 void *baton,
+                 int entered_state,
+                 const svn_ra_serf__dav_props_t *tag,
+                 apr_pool_t *scratch_pool)
+{
+  get_files_ctx_t *gf_ctx = baton;
+
+  if (entered_state == GET_FILES_FILE)
+    {
+      fetch_ctx_t *fetch_ctx;
+      file_baton_t *file;
+      const char *href;
+      svn_stream_t *decoder;
+
+      href = svn_hash_gets(svn_ra_serf__xml_gather_since(xes, entered_state),
+                           "href");
+
+      if (gf_ctx->cur >= gf_ctx->fetches->nelts)
+        return svn_error_create(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                                _("The get-files REPORT response contains "
+                                  "more files than requested"));
+
+      fetch_ctx = APR_ARRAY_IDX(gf_ctx->fetches, gf_ctx->cur, fetch_ctx_t *);
+      file = fetch_ctx->file;
+
+      if (!href || strcmp(href, file->url) != 0)
+        return svn_error_createf(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                                 _("The get-files REPORT response returned "
+                                   "'%s' instead of '%s'"),
+                                 href ? href : "", file->url);
+
+      /* After a re-send, continue to feed the partially received
+         delta into the stream that we already set up. */
+      if (!fetch_ctx->aborted_read)
+        {
+          decoder = svn_txdelta_parse_svndiff(file->txdelta,
+                                              file->txdelta_baton,
+                                              TRUE /* error early close*/,
+                                              file->pool);
+
+          file->txdelta_stream = svn_base64_decode(decoder, file->pool);
+          fetch_ctx->read_size = 0;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Conforms to svn_ra_serf__xml_closed_t  */
+static svn_error_t *
+get_files_closed(svn_ra_serf__xml_estate_t *xes,
+                 void *baton,
+                 int leaving_state,
+                 const svn_string_t *cdata,
+                 apr_hash_t *attrs,
+                 apr_pool_t *scratch_pool)
+{
+  get_files_ctx_t *gf_ctx = baton;
+
+  if (leaving_state == GET_FILES_FILE)
+    {
+      fetch_ctx_t *fetch_ctx = APR_ARRAY_IDX(gf_ctx->fetches, gf_ctx->cur,
+                                             fetch_ctx_t *);
+      file_baton_t *file = fetch_ctx->file;
+
+      /* Closing the stream verifies that we received a complete delta. */
+      SVN_ERR(svn_stream_close(file->txdelta_stream));
+      file->txdelta_stream = NULL;
+
+      gf_ctx->cur++;
+
+      SVN_ERR(file_contents_done(fetch_ctx, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Conforms to svn_ra_serf__xml_cdata_t  */
+static svn_error_t *
+get_files_cdata(svn_ra_serf__xml_estate_t *xes,
+                void *baton,
+                int current_state,
+                const char *data,
+                apr_size_t len,
+                apr_pool_t *scratch_pool)
+{
+  get_files_ctx_t *gf_ctx = baton;
+
+  if (current_state == TXDELTA)
+    {
+      fetch_ctx_t *fetch_ctx = APR_ARRAY_IDX(gf_ctx->fetches, gf_ctx->cur,
+                                             fetch_ctx_t *);
+
+      fetch_ctx->read_size += len;
+
+      /* Skip what we have received before the connection got closed.
+         See handle_fetch(). */
+      if (fetch_ctx->aborted_read)
+        {
+          apr_off_t skip;
+
+          if (fetch_ctx->read_size < fetch_ctx->aborted_read_size)
+            return SVN_NO_ERROR;
+
+          fetch_ctx->aborted_read = FALSE;
+
+          skip = len - (fetch_ctx->read_size - fetch_ctx->aborted_read_size);
+          data += skip;
+          len -= (apr_size_t)skip;
+        }
+
+      if (len)
+        SVN_ERR(svn_stream_write(fetch_ctx->file->txdelta_stream,
+                                 data, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__request_body_delegate_t */
+static svn_error_t *
+create_get_files_body(serf_bucket_t **body_bkt,
+                      void *baton,
+                      serf_bucket_alloc_t *alloc,
+                      apr_pool_t *pool /* request pool */,
+                      apr_pool_t *scratch_pool)
+{
+  get_files_ctx_t *gf_ctx = baton;
+  serf_bucket_t *buckets;
+  int i;
+
+  buckets = serf_bucket_aggregate_create(alloc);
+
+  svn_ra_serf__add_open_tag_buckets(buckets, alloc,
+                                    "S:get-files-report",
+                                    "xmlns:S", SVN_XML_NAMESPACE,
+                                    SVN_VA_NULL);
+
+  for (i = 0; i < gf_ctx->fetches->nelts; i++)
+    {
+      fetch_ctx_t *fetch_ctx = APR_ARRAY_IDX(gf_ctx->fetches, i,
+                                             fetch_ctx_t *);
+
+      svn_ra_serf__add_open_tag_buckets(buckets, alloc, "S:file",
+                                        SVN_VA_NULL);
+      svn_ra_serf__add_tag_buckets(buckets, "S:href",
+                                   fetch_ctx->file->url, alloc);
+      if (fetch_ctx->delta_base)
+        svn_ra_serf__add_tag_buckets(buckets, "S:delta-base",
+                                     fetch_ctx->delta_base, alloc);
+      svn_ra_serf__add_close_tag_buckets(buckets, alloc, "S:file");
+    }
+
+  svn_ra_serf__add_close_tag_buckets(buckets, alloc,
+                                     "S:get-files-report");
+
+  *body_bkt = buckets;
+  return SVN_NO_ERROR;
+}
+
+/* Serf callback to setup get-files request headers. */
+static svn_error_t *
+setup_get_files_headers(serf_bucket_t *headers,
+                        void *baton,
+                        apr_pool_t *pool /* request pool */,
+                        apr_pool_t *scratch_pool)
+{
+  get_files_ctx_t *gf_ctx = baton;
+
+  svn_ra_serf__setup_svndiff_accept_encoding(headers, gf_ctx->report->sess);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__response_error_t for get-files REPORTs.
+ * Like cancel_fetch(), but the connection may have died after delivering
+ * some of the requested files.  Only re-request the others. */
+static svn_error_t *
+cancel_get_files(serf_request_t *request,
+                 serf_bucket_t *response,
+                 int status_code,
+                 void *baton)
+{
+  get_files_ctx_t *gf_ctx = baton;
+  apr_array_header_t *fetches = gf_ctx->fetches;
+  int i;
+
+  if (response)
+    {
+      /* We have no idea what went wrong. */
+      SVN_ERR_MALFUNCTION();
+    }
+
+  /* Files before CUR have been delivered completely and must not be
+   * requested again.  The body delegate sends what remains in FETCHES. */
+  for (i = gf_ctx->cur; i < fetches->nelts; i++)
+    APR_ARRAY_IDX(fetches, i - gf_ctx->cur, fetch_ctx_t *)
+      = APR_ARRAY_IDX(fetches, i, fetch_ctx_t *);
+  fetches->nelts -= gf_ctx->cur;
+  gf_ctx->cur = 0;
+
+  /* The delta of the first remaining file may have been cut off in the
+   * middle.  Its editor stream can't be restarted, so skip the part that
+   * we have already seen when it gets sent again. */
+  if (fetches->nelts)
+    {
+      fetch_ctx_t *fetch_ctx = APR_ARRAY_IDX(fetches, 0, fetch_ctx_t *);
+
+      if (fetch_ctx->file->txdelta_stream)
+        {
+          if (!fetch_ctx->aborted_read && fetch_ctx->read_size)
+            {
+              fetch_ctx->aborted_read = TRUE;
+              fetch_ctx->aborted_read_size = fetch_ctx->read_size;
+            }
+          fetch_ctx->read_size = 0;
+        }
+    }
+
+  svn_ra_serf__expat_handler_reset(gf_ctx->handler);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__response_done_delegate_t */
+static svn_error_t *
+get_files_done(serf_request_t *request,
+               void *baton,
+               apr_pool_t *scratch_pool)
+{
+  get_files_ctx_t *gf_ctx = baton;
+  svn_ra_serf__handler_t *handler = gf_ctx->handler;
+
+  if (handler->server_error)
+    return svn_error_trace(svn_ra_serf__server_error_create(handler,
+                                                            scratch_pool));
+
+  if (handler->sline.code != 200)
+    return svn_error_trace(svn_ra_serf__unexpected_status(handler));
+
+  if (gf_ctx->cur < gf_ctx->fetches->nelts)
+    return svn_error_create(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                            _("The get-files REPORT response does not "
+                              "contain all requested files"));
+
+  /* All files have been delivered.  As with closing directories in the
+   * other done handlers, disposing the pool containing the handler is
+   * only a valid operation in this callback. */
+  svn_pool_destroy(gf_ctx->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the get-files REPORT for the files queued in CTX, if any. */
+static svn_error_t *
+send_pending_files(report_context_t *ctx,
+                   apr_pool_t *scratch_pool)
+{
+  get_files_ctx_t *gf_ctx = ctx->pending_files;
+  svn_ra_serf__handler_t *handler;
+  svn_ra_serf__xml_context_t *xmlctx;
+  const char *report_target;
+
+  if (!gf_ctx)
+    return SVN_NO_ERROR;
+
+  ctx->pending_files = NULL;
+
+  SVN_ERR(svn_ra_serf__report_resource(&report_target, ctx->sess,
+                                       gf_ctx->pool));
+
+  xmlctx = svn_ra_serf__xml_context_create(get_files_ttable,
+                                           get_files_opened,
+                                           get_files_closed,
+                                           get_files_cdata,
+                                           gf_ctx,
+                                           gf_ctx->pool);
+  handler = svn_ra_serf__create_expat_handler(ctx->sess, xmlctx, NULL,
+                                              gf_ctx->pool);
+
+  handler->method = "REPORT";
+  handler->path = report_target;
+  handler->body_delegate = create_get_files_body;
+  handler->body_delegate_baton = gf_ctx;
+  handler->body_type = "text/xml";
+  handler->custom_accept_encoding = TRUE;
+  handler->header_delegate = setup_get_files_headers;
+  handler->header_delegate_baton = gf_ctx;
+
+  handler->conn = get_best_connection(ctx); /* Explicit scheduling */
+
+  handler->response_error = cancel_get_files;
+  handler->response_error_baton = gf_ctx;
+
+  handler->done_delegate = get_files_done;
+  handler->done_delegate_baton = gf_ctx;
+
+  gf_ctx->handler = handler;
+
+  svn_ra_serf__request_create(handler);
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue the fetch described by FETCH_CTX for the next get-files REPORT
+ * of CTX, sending the REPORT once it holds GET_FILES_MAX files. */
+static svn_error_t *
+queue_file_fetch(report_context_t *ctx,
+                 fetch_ctx_t *fetch_ctx,
+                 apr_pool_t *scratch_pool)
+{
+  if (!ctx->pending_files)
+    {
+      apr_pool_t *pool = svn_pool_create(ctx->pool);
+
+      ctx->pending_files = apr_pcalloc(pool, sizeof(*ctx->pending_files));
+      ctx->pending_files->pool = pool;
+      ctx->pending_files->report = ctx;
+      ctx->pending_files->fetches = apr_array_make(pool, GET_FILES_MAX,
+                                                   sizeof(fetch_ctx_t *));
+    }
+
+  APR_ARRAY_PUSH(ctx->pending_files->fetches, fetch_ctx_t *) = fetch_ctx;
+
+  if (ctx->pending_files->fetches->nelts >= GET_FILES_MAX)
+    SVN_ERR(send_pending_files(ctx, scratch_pool));
+
+  return SVN_NO_ERROR;
 }
 
 /* Initiates additional requests needed for a file when not in "send-all" mode.
@@ -1278,6 +1849,7 @@ fetch_for_file(file_baton_t *file,
           fetch_ctx = apr_pcalloc(file->pool, sizeof(*fetch_ctx));
           fetch_ctx->file = file;
           fetch_ctx->session = ctx->sess;
+          fetch_ctx->conn_idx = conn_index(ctx->sess, conn);
 
           /* Can we somehow get away with just obtaining a DIFF? */
           if (SVN_RA_SERF__HAVE_HTTPV2_SUPPORT(ctx->sess))
@@ -1324,30 +1896,39 @@ fetch_for_file(file_baton_t *file,
                                         : NULL;
             }
 
-          handler = svn_ra_serf__create_handler(ctx->sess, file->pool);
+          /* Servers that support it deliver many files in one response,
+             which saves the per-request overhead for small files. */
+          if (ctx->sess->supports_get_files)
+            {
+              SVN_ERR(queue_file_fetch(ctx, fetch_ctx, scratch_pool));
+            }
+          else
+            {
+              handler = svn_ra_serf__create_handler(ctx->sess, file->pool);
 
-          handler->method = "GET";
-          handler->path = file->url;
+              handler->method = "GET";
+              handler->path = file->url;
 
-          handler->conn = conn; /* Explicit scheduling */
+              handler->conn = conn; /* Explicit scheduling */
 
-          handler->custom_accept_encoding = TRUE;
-          handler->no_dav_headers = TRUE;
-          handler->header_delegate = headers_fetch;
-          handler->header_delegate_baton = fetch_ctx;
+              handler->custom_accept_encoding = TRUE;
+              handler->no_dav_headers = TRUE;
+              handler->header_delegate = headers_fetch;
+              handler->header_delegate_baton = fetch_ctx;
 
-          handler->response_handler = handle_fetch;
-          handler->response_baton = fetch_ctx;
+              handler->response_handler = handle_fetch;
+              handler->response_baton = fetch_ctx;
 
-          handler->response_error = cancel_fetch;
-          handler->response_error_baton = fetch_ctx;
+              handler->response_error = cancel_fetch;
+              handler->response_error_baton = fetch_ctx;
 
-          handler->done_delegate = file_fetch_done;
-          handler->done_delegate_baton = fetch_ctx;
+              handler->done_delegate = file_fetch_done;
+              handler->done_delegate_baton = fetch_ctx;
 
-          fetch_ctx->handler = handler;
+              fetch_ctx->handler = handler;
 
-          svn_ra_serf__request_create(handler);
+              svn_ra_serf__request_create(handler);
+            }
 
           ctx->num_active_fetches++;
         }
@@ -1424,6 +2005,7 @@ dir_props_done(serf_request_t *request,
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
   dir->ctx->num_active_propfinds--;
+  update_request_window(dir->ctx);
 
   /* Closing the directory will automatically deliver the propfind props.
    *
@@ -2251,7 +2833,7 @@ update_delay_handler(serf_request_t *request,
         }
 
       while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-                 < REQUEST_COUNT_TO_RESUME)
+                 < request_window(udb->report))
         {
           const char *data;
           apr_size_t len;
@@ -2335,7 +2917,7 @@ process_pending(update_delay_baton_t *udb,
   serf_bucket_alloc_t *alloc = NULL;
 
   while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-            < REQUEST_COUNT_TO_RESUME)
+            < request_window(udb->report))
     {
       const char *data;
       apr_size_t len;
@@ -2406,10 +2988,10 @@ process_editor_report(report_context_t *ctx,
   handler->response_handler = update_delay_handler;
   handler->response_baton = ud;
 
-  /* Open the first extra connection. */
+  /* Open the first extra connection, unless we use http/2. */
   SVN_ERR(open_connection_if_needed(sess, 0));
 
-  sess->cur_conn = 1;
+  sess->cur_conn = sess->num_conns > 1 ? 1 : 0;
 
   /* Note that we may have no active GET or PROPFIND requests, yet the
      processing has not been completed. This could be from a delay on the
@@ -2426,6 +3008,9 @@ process_editor_report(report_context_t *ctx,
 
       svn_pool_clear(iterpool);
 
+      /* Don't leave queued files waiting while we wait for the network. */
+      SVN_ERR(send_pending_files(ctx, iterpool));
+
       err = svn_ra_serf__context_run(sess, &waittime_left, iterpool);
 
       if (handler->done && handler->server_error)
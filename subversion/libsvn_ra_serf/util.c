@@ -480,7 +480,7 @@ load_authorities(svn_ra_serf__connection_t *conn, const char *authorities,
   return SVN_NO_ERROR;
 }
 
-#if SERF_VERSION_AT_LEAST(1, 4, 0) && defined(SVN__SERF_TEST_HTTP2)
+#if SERF_VERSION_AT_LEAST(1, 4, 0)
 /* Implements serf_ssl_protocol_result_cb_t */
 static apr_status_t
 conn_negotiate_protocol(void *data,
@@ -557,10 +557,14 @@ conn_setup(apr_socket_t *sock,
               SVN_ERR(load_authorities(conn, conn->session->ssl_authorities,
                                        conn->session->pool));
             }
-#if SERF_VERSION_AT_LEAST(1, 4, 0) && defined(SVN__SERF_TEST_HTTP2)
-          if (APR_SUCCESS ==
-                serf_ssl_negotiate_protocol(conn->ssl_context, "h2,http/1.1",
-                                            conn_negotiate_protocol, conn))
+#if SERF_VERSION_AT_LEAST(1, 4, 0)
+          /* Offer http/2 via ALPN, if enabled.  We switch framing once
+             the server has made its choice. */
+          if (conn->session->negotiate_http2
+              && APR_SUCCESS ==
+                   serf_ssl_negotiate_protocol(conn->ssl_context,
+                                               "h2,http/1.1",
+                                               conn_negotiate_protocol, conn))
             {
                 serf_connection_set_framing_type(
                             conn->conn,
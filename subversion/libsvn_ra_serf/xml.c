@@ -65,7 +65,9 @@ struct svn_ra_serf__xml_context_t {
   svn_ra_serf__xml_cdata_t cdata_cb;
   void *baton;
 
-  /* Linked list of free states.  */
+  /* Linked list of free states.  Popped states are kept here and reused
+     for the next element, together with their (cleared) pools, so that
+     parsing a long response doesn't allocate per element.  */
   svn_ra_serf__xml_estate_t *free_states;
 
 #ifdef SVN_DEBUG
@@ -113,6 +115,12 @@ struct svn_ra_serf__xml_estate_t {
   /* A pool may be constructed for this state.  */
   apr_pool_t *state_pool;
 
+  /* A cleared pool, left over from an earlier use of this structure, to
+     be used as STATE_POOL when this state needs one.  It is a child of
+     the root state's pool, so clearing an outer state's pool won't
+     destroy it.  */
+  apr_pool_t *spare_pool;
+
   /* The namespaces extent for this state/element. This will start with
      the parent's NS_LIST, and we will push new namespaces into our
      local list. The parent will be unaffected by our locally-scoped data. */
@@ -454,11 +462,29 @@ xes_pool(const svn_ra_serf__xml_estate_t *xes)
 }
 
 
+/* Return the pool of the root state of XES.  */
+static apr_pool_t *
+root_pool(const svn_ra_serf__xml_estate_t *xes)
+{
+  while (xes->prev != NULL)
+    xes = xes->prev;
+  return xes->state_pool;
+}
+
+
 static void
 ensure_pool(svn_ra_serf__xml_estate_t *xes)
 {
   if (xes->state_pool == NULL)
-    xes->state_pool = svn_pool_create(xes_pool(xes));
+    {
+      if (xes->spare_pool)
+        {
+          xes->state_pool = xes->spare_pool;
+          xes->spare_pool = NULL;
+        }
+      else
+        xes->state_pool = svn_pool_create(root_pool(xes));
+    }
 }
 
 
@@ -690,22 +716,30 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
 
   /* Found a transition. Make it happen.  */
 
-  /* ### todo. push state  */
+  /* Prep the new state, reusing a previously popped one if possible.
+     States live as long as the context, so the free list holds at most
+     as many of them as the document is deep.  */
+  if (xmlctx->free_states)
+    {
+      apr_pool_t *spare_pool;
+
+      new_xes = xmlctx->free_states;
+      xmlctx->free_states = new_xes->prev;
 
-  /* ### how to use free states?  */
-  /* This state should be allocated in the extent pool. If we will be
-     collecting information for this state, then construct a subpool.
+      spare_pool = new_xes->spare_pool;
+      memset(new_xes, 0, sizeof(*new_xes));
+      new_xes->spare_pool = spare_pool;
+    }
+  else
+    new_xes = apr_pcalloc(root_pool(current), sizeof(*new_xes));
 
-     ### potentially optimize away the subpool if none of the
-     ### attributes are present. subpools are cheap, tho...  */
-  new_pool = xes_pool(current);
+  /* If we will be collecting information for this state, then it needs
+     its own pool.  */
   if (scan->collect_cdata || scan->collect_attrs[0])
     {
-      new_pool = svn_pool_create(new_pool);
-
-      /* Prep the new state.  */
-      new_xes = apr_pcalloc(new_pool, sizeof(*new_xes));
-      new_xes->state_pool = new_pool;
+      new_xes->prev = current;
+      ensure_pool(new_xes);
+      new_pool = new_xes->state_pool;
 
       /* If we're supposed to collect cdata, then set up a buffer for
          this. The existence of this buffer will instruct our cdata
@@ -748,15 +782,20 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
     }
   else
     {
-      /* Prep the new state.  */
-      new_xes = apr_pcalloc(new_pool, sizeof(*new_xes));
+      new_pool = xes_pool(current);
       /* STATE_POOL remains NULL.  */
     }
 
-  /* Some basic copies to set up the new estate.  */
+  /* Some basic copies to set up the new estate.  The namespace URL lives
+     in an outer state, and unless the transition is a wildcard, the name
+     is the one in the transition table.  Only a wildcard name needs to
+     be copied out of the parser's buffer.  */
   new_xes->state = scan->to_state;
-  new_xes->tag.name = apr_pstrdup(new_pool, elemname.name);
-  new_xes->tag.xmlns = apr_pstrdup(new_pool, elemname.xmlns);
+  if (*scan->name == '*')
+    new_xes->tag.name = apr_pstrdup(new_pool, elemname.name);
+  else
+    new_xes->tag.name = scan->name;
+  new_xes->tag.xmlns = elemname.xmlns;
   new_xes->custom_close = scan->custom_close;
 
   /* Start with the parent's namespace set.  */
@@ -780,6 +819,29 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
 }
 
 
+/* Pop the current state of XMLCTX and put it on the free list. */
+static void
+pop_state(svn_ra_serf__xml_context_t *xmlctx)
+{
+  svn_ra_serf__xml_estate_t *xes = xmlctx->current;
+
+  xmlctx->current = xes->prev;
+
+  /* If there is a STATE_POOL, then clear it. This releases everything
+     allocated for this state, but keeps the pool around for the next
+     state that reuses XES.  */
+  if (xes->state_pool)
+    {
+      svn_pool_clear(xes->state_pool);
+      xes->spare_pool = xes->state_pool;
+      xes->state_pool = NULL;
+    }
+
+  xes->prev = xmlctx->free_states;
+  xmlctx->free_states = xes;
+}
+
+
 static svn_error_t *
 xml_cb_end(svn_ra_serf__xml_context_t *xmlctx,
            const char *raw_name)
@@ -817,19 +879,7 @@ xml_cb_end(svn_ra_serf__xml_context_t *xmlctx,
       svn_pool_clear(xmlctx->scratch_pool);
     }
 
-  /* Pop the state.  */
-  xmlctx->current = xes->prev;
-
-  /* ### not everything should go on the free state list. XES may go
-     ### away with the state pool.  */
-  xes->prev = xmlctx->free_states;
-  xmlctx->free_states = xes;
-
-  /* If there is a STATE_POOL, then toss it. This will get rid of as much
-     memory as possible. Potentially the XES (if we didn't create a pool
-     right away, then XES may be in a parent pool).  */
-  if (xes->state_pool)
-    svn_pool_destroy(xes->state_pool);
+  pop_state(xmlctx);
 
   return SVN_NO_ERROR;
 }
@@ -1028,3 +1078,23 @@ svn_ra_serf__create_expat_handler(svn_ra_serf__session_t *session,
 
   return handler;
 }
+
+void
+svn_ra_serf__expat_handler_reset(svn_ra_serf__handler_t *handler)
+{
+  struct expat_ctx_t *ectx = handler->response_baton;
+  svn_ra_serf__xml_context_t *xmlctx = ectx->xmlctx;
+
+  /* A new parser will be created for the next response. */
+  if (ectx->parser)
+    {
+      svn_xml_free_parser(ectx->parser);
+      ectx->parser = NULL;
+    }
+
+  /* Return to the initial state without calling any callbacks. */
+  while (xmlctx->current->prev)
+    pop_state(xmlctx);
+
+  xmlctx->waiting = 0;
+}
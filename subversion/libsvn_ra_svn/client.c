@@ -239,6 +239,28 @@ svn_error_t *svn_ra_svn__auth_response(svn_ra_svn_conn_t *conn,
   return svn_error_trace(svn_ra_svn__write_tuple(conn, pool, "w(?c)", mech, mech_arg));
 }
 
+/* Return a copy of MECHLIST without the mechanism MECH.
+ * Allocate the result in POOL. */
+static svn_ra_svn__list_t *
+remove_mech(const svn_ra_svn__list_t *mechlist,
+            const char *mech,
+            apr_pool_t *pool)
+{
+  svn_ra_svn__list_t *result = apr_pcalloc(pool, sizeof(*result));
+  int i;
+
+  result->items = apr_pcalloc(pool, (mechlist->nelts + 1)
+                                      * sizeof(*result->items));
+  for (i = 0; i < mechlist->nelts; i++)
+    {
+      svn_ra_svn__item_t *elt = &SVN_RA_SVN__LIST_ITEM(mechlist, i);
+      if (elt->kind != SVN_RA_SVN_WORD || strcmp(elt->u.word.data, mech))
+        result->items[result->nelts++] = *elt;
+    }
+
+  return result;
+}
+
 static svn_error_t *handle_auth_request(svn_ra_svn__session_baton_t *sess,
                                         apr_pool_t *pool)
 {
@@ -249,7 +271,16 @@ static svn_error_t *handle_auth_request(svn_ra_svn__session_baton_t *sess,
   SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "lc", &mechlist, &realm));
   if (mechlist->nelts == 0)
     return SVN_NO_ERROR;
-  return DO_AUTH(sess, mechlist, realm, pool);
+
+  /* Once we have told the server who we are, stick to that identity. */
+  if (sess->identified)
+    mechlist = remove_mech(mechlist, "ANONYMOUS", pool);
+
+  SVN_ERR(DO_AUTH(sess, mechlist, realm, pool));
+  if (!svn_ra_svn__find_mech(mechlist, "ANONYMOUS"))
+    sess->identified = TRUE;
+
+  return SVN_NO_ERROR;
 }
 
 /* --- REPORTER IMPLEMENTATION --- */
@@ -604,12 +635,51 @@ static apr_status_t close_tunnel_cleanup(void *baton)
   return APR_SUCCESS; /* ignored */
 }
 
+/* Set *MAX_CONNECTIONS to the number of connections that we may open to
+   HOSTNAME for a single operation, according to the "servers" category
+   in CONFIG, but at least 1 and at most SVN_RA_SVN__MAX_CONNECTIONS_LIMIT.
+   Use SCRATCH_POOL for temporary allocations.
+*/
+static svn_error_t *
+get_max_connections(apr_int64_t *max_connections,
+                    apr_hash_t *config,
+                    const char *hostname,
+                    apr_pool_t *scratch_pool)
+{
+  svn_config_t *cfg = config
+                    ? svn_hash_gets(config, SVN_CONFIG_CATEGORY_SERVERS)
+                    : NULL;
+  const char *server_group = NULL;
+
+  if (cfg && hostname)
+    server_group = svn_config_find_group(cfg, hostname,
+                                         SVN_CONFIG_SECTION_GROUPS,
+                                         scratch_pool);
+
+  SVN_ERR(svn_config_get_server_setting_int(
+            cfg, server_group,
+            SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+            SVN_CONFIG_DEFAULT_OPTION_SVN_MAX_CONNECTIONS,
+            max_connections, scratch_pool));
+
+  /* Every connection is a separate server process or thread.  Don't let
+     a single client tie up an arbitrary number of them. */
+  if (*max_connections > SVN_RA_SVN__MAX_CONNECTIONS_LIMIT)
+    *max_connections = SVN_RA_SVN__MAX_CONNECTIONS_LIMIT;
+  if (*max_connections < 1)
+    *max_connections = 1;
+
+  return SVN_NO_ERROR;
+}
+
 /* Open a session to URL, returning it in *SESS_P, allocating it in POOL.
    URI is a parsed version of URL.  CALLBACKS and CALLBACKS_BATON
    are provided by the caller of ra_svn_open. If TUNNEL_NAME is not NULL,
    it is the name of the tunnel type parsed from the URL scheme.
    If TUNNEL_ARGV is not NULL, it points to a program argument list to use
-   when invoking the tunnel agent.
+   when invoking the tunnel agent.  If IDENTIFIED is set, authenticate
+   the same way as a session that already told the server who we are,
+   i.e. don't fall back to anonymous access.
 */
 static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                  const char *url,
@@ -620,6 +690,7 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                  const svn_ra_callbacks2_t *callbacks,
                                  void *callbacks_baton,
                                  svn_auth_baton_t *auth_baton,
+                                 svn_boolean_t identified,
                                  apr_pool_t *result_pool,
                                  apr_pool_t *scratch_pool)
 {
@@ -649,12 +720,16 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   sess->callbacks_baton = callbacks_baton;
   sess->bytes_read = sess->bytes_written = 0;
   sess->auth_baton = auth_baton;
+  sess->identified = identified;
 
   if (config)
     SVN_ERR(svn_config_copy_config(&sess->config, config, pool));
   else
     sess->config = NULL;
 
+  SVN_ERR(get_max_connections(&sess->max_connections, config, uri->hostname,
+                              scratch_pool));
+
   if (tunnel_name)
     {
       sess->realm_prefix = apr_psprintf(pool, "<svn+%s://%s:%d>",
@@ -747,7 +822,7 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww?w)cc(?c)",
                                   (apr_uint64_t) 2,
                                   SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                   SVN_RA_SVN_CAP_SVNDIFF1,
@@ -756,6 +831,9 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                   SVN_RA_SVN_CAP_DEPTH,
                                   SVN_RA_SVN_CAP_MERGEINFO,
                                   SVN_RA_SVN_CAP_LOG_REVPROPS,
+                                  svn_zstd__is_available()
+                                    ? SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED
+                                    : NULL,
                                   url,
                                   SVN_RA_SVN__DEFAULT_USERAGENT,
                                   client_string));
@@ -899,7 +977,7 @@ static svn_error_t *ra_svn_open(svn_ra_session_t *session,
      reparent with a server that doesn't support reparenting. */
   SVN_ERR(open_session(&sess, url, &uri, tunnel, tunnel_argv, config,
                        callbacks, callback_baton,
-                       auth_baton, sess_pool, scratch_pool));
+                       auth_baton, FALSE, sess_pool, scratch_pool));
   session->priv = sess;
 
   return SVN_NO_ERROR;
@@ -958,7 +1036,7 @@ reparent_server(svn_ra_session_t *ra_session,
   if (! err)
     err = open_session(&new_sess, url, &uri, sess->tunnel_name, sess->tunnel_argv,
                        sess->config, sess->callbacks, sess->callbacks_baton,
-                       sess->auth_baton, sess_pool, sess_pool);
+                       sess->auth_baton, FALSE, sess_pool, sess_pool);
   /* We destroy the new session pool on error, since it is allocated in
      the main session pool. */
   if (err)
@@ -1433,23 +1511,27 @@ parse_iproplist(apr_array_header_t **inherited_props,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
-                                    svn_revnum_t rev, svn_stream_t *stream,
-                                    svn_revnum_t *fetched_rev,
-                                    apr_hash_t **props,
-                                    apr_pool_t *pool)
+/* Read the response to a get-file request for PATH from SESS_BATON's
+ * connection.  Set *FETCHED_REV and *PROPS (if not NULL) and write the
+ * file contents to STREAM (if not NULL).  The latter two must match the
+ * flags given in the get-file request.  Use POOL for all allocations.
+ */
+static svn_error_t *
+receive_file(svn_ra_svn__session_baton_t *sess_baton,
+             const char *path,
+             svn_stream_t *stream,
+             svn_revnum_t *fetched_rev,
+             apr_hash_t **props,
+             apr_pool_t *pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_ra_svn__list_t *proplist;
   const char *expected_digest;
   svn_checksum_t *expected_checksum = NULL;
   svn_checksum_ctx_t *checksum_ctx;
   apr_pool_t *iterpool;
+  svn_revnum_t rev;
 
-  path = reparent_path(session, path, pool);
-  SVN_ERR(svn_ra_svn__write_cmd_get_file(conn, pool, path, rev,
-                                         (props != NULL), (stream != NULL)));
   SVN_ERR(handle_auth_request(sess_baton, pool));
   SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "(?c)rl",
                                         &expected_digest,
@@ -1510,6 +1592,22 @@ static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
+                                    svn_revnum_t rev, svn_stream_t *stream,
+                                    svn_revnum_t *fetched_rev,
+                                    apr_hash_t **props,
+                                    apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+
+  path = reparent_path(session, path, pool);
+  SVN_ERR(svn_ra_svn__write_cmd_get_file(conn, pool, path, rev,
+                                         (props != NULL), (stream != NULL)));
+  return svn_error_trace(receive_file(sess_baton, path, stream,
+                                      fetched_rev, props, pool));
+}
+
 /* Write the protocol words that correspond to DIRENT_FIELDS to CONN
  * and use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
@@ -1703,6 +1801,675 @@ static svn_error_t *ra_svn_get_mergeinfo(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+/* --- PARALLEL FILE FETCHING --- */
+
+/* If the server announces SVN_RA_SVN_CAP_SKELETON_UPDATE, ra_svn_update()
+ * asks it to omit all text deltas and wraps the caller's editor in a
+ * "fetch editor".  For every file whose contents changed, that editor
+ * sends a get-file request over one of several additional connections to
+ * the same URL.  Meanwhile, all editor calls get queued and are replayed
+ * against the caller's editor in their original order, with the contents
+ * received for the respective get-file request standing in for the empty
+ * text delta.
+ *
+ * Since the requests are pipelined, the server keeps reading and sending
+ * file contents while we process the editor drive and earlier files.  We
+ * limit the number of outstanding requests per connection as well as the
+ * total number of queued calls to keep memory usage bounded.
+ */
+
+/* Maximum number of get-file requests to have in flight per connection. */
+#define FETCH_MAX_REQUESTS_PER_CONN 16
+
+/* Maximum number of editor calls to hold back. */
+#define FETCH_MAX_QUEUED_OPS 4096
+
+/* Kinds of editor calls that the fetch editor may queue. */
+typedef enum fetch_op_kind_t
+{
+  fetch_op_open_root,
+  fetch_op_delete_entry,
+  fetch_op_add_directory,
+  fetch_op_open_directory,
+  fetch_op_change_dir_prop,
+  fetch_op_close_directory,
+  fetch_op_absent_directory,
+  fetch_op_add_file,
+  fetch_op_open_file,
+  fetch_op_apply_textdelta,
+  fetch_op_change_file_prop,
+  fetch_op_close_file,
+  fetch_op_absent_file
+} fetch_op_kind_t;
+
+typedef struct fetch_edit_baton_t fetch_edit_baton_t;
+
+/* A directory or file opened during the edit.  This is the baton type
+ * that the fetch editor hands out for both. */
+typedef struct fetch_node_t
+{
+  /* The edit this node belongs to. */
+  fetch_edit_baton_t *eb;
+
+  /* Path relative to the edit anchor. */
+  const char *path;
+
+  /* The wrapped editor's baton for this node.  Only valid once the call
+     that opens this node has been replayed. */
+  void *baton;
+
+  /* Holds BATON as well as all queued calls that operate on this node.
+     Gets destroyed once the node has been closed in the wrapped editor. */
+  apr_pool_t *pool;
+} fetch_node_t;
+
+/* A queued editor call. */
+typedef struct fetch_op_t
+{
+  fetch_op_kind_t kind;
+
+  /* The node to operate on.  For add / open / delete / absent calls,
+     this is the parent directory. */
+  fetch_node_t *node;
+
+  /* The node being added or opened; NULL for all other calls. */
+  fetch_node_t *child;
+
+  /* Call parameters, as far as applicable to KIND. */
+  const char *path;
+  const char *copyfrom_path;
+  svn_revnum_t revision;
+  const char *name;
+  const svn_string_t *value;
+  const char *checksum;
+
+  /* For fetch_op_apply_textdelta: the session that the file contents
+     have been requested from. */
+  svn_ra_svn__session_baton_t *fetch_sess;
+
+  /* Next call in the queue. */
+  struct fetch_op_t *next;
+} fetch_op_t;
+
+struct fetch_edit_baton_t
+{
+  /* The wrapped editor. */
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+
+  /* The session running the update and the URL that it is parented at. */
+  svn_ra_svn__session_baton_t *sess;
+  const char *url;
+
+  /* Additional sessions (svn_ra_svn__session_baton_t *) that we fetch
+     the file contents from.  They are opened on demand, up to
+     MAX_SESSIONS of them, and get allocated in SESSIONS_POOL.
+     NEXT_SESSION is the index of the one to send the next request to. */
+  apr_array_header_t *sessions;
+  int max_sessions;
+  int next_session;
+  apr_pool_t *sessions_pool;
+
+  /* Revision to fetch the file contents from. */
+  svn_revnum_t target_rev;
+
+  /* Queue of calls not yet passed on to EDITOR, the total number of
+     calls in it and how many of them are waiting for file contents. */
+  fetch_op_t *head;
+  fetch_op_t *tail;
+  int queued_ops;
+  int queued_fetches;
+
+  /* Pool to allocate the root node in. */
+  apr_pool_t *pool;
+};
+
+/* Return a new node for PATH within EB.  Allocate it in a new sub-pool
+ * of PARENT's pool or, if PARENT is NULL, of EB's pool.
+ */
+static fetch_node_t *
+make_fetch_node(fetch_edit_baton_t *eb,
+                fetch_node_t *parent,
+                const char *path)
+{
+  apr_pool_t *pool = svn_pool_create(parent ? parent->pool : eb->pool);
+  fetch_node_t *node = apr_pcalloc(pool, sizeof(*node));
+
+  node->eb = eb;
+  node->path = apr_pstrdup(pool, path);
+  node->pool = pool;
+
+  return node;
+}
+
+/* Append a call of type KIND operating on NODE to the queue in NODE's
+ * edit and return it.  Allocate it in POOL, which must live at least as
+ * long as NODE.
+ */
+static fetch_op_t *
+queue_op(fetch_node_t *node,
+         fetch_op_kind_t kind,
+         apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = node->eb;
+  fetch_op_t *op = apr_pcalloc(pool, sizeof(*op));
+
+  op->kind = kind;
+  op->node = node;
+  op->revision = SVN_INVALID_REVNUM;
+
+  if (eb->tail)
+    eb->tail->next = op;
+  else
+    eb->head = op;
+
+  eb->tail = op;
+  ++eb->queued_ops;
+
+  return op;
+}
+
+/* Pass the queued call OP on to the editor wrapped by EB.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+replay_op(fetch_edit_baton_t *eb,
+          fetch_op_t *op,
+          apr_pool_t *scratch_pool)
+{
+  const svn_delta_editor_t *editor = eb->editor;
+  fetch_node_t *node = op->node;
+  fetch_node_t *child = op->child;
+
+  switch (op->kind)
+    {
+      case fetch_op_open_root:
+        SVN_ERR(editor->open_root(eb->edit_baton, op->revision, node->pool,
+                                  &node->baton));
+        break;
+
+      case fetch_op_delete_entry:
+        SVN_ERR(editor->delete_entry(op->path, op->revision, node->baton,
+                                     scratch_pool));
+        break;
+
+      case fetch_op_add_directory:
+        SVN_ERR(editor->add_directory(op->path, node->baton,
+                                      op->copyfrom_path, op->revision,
+                                      child->pool, &child->baton));
+        break;
+
+      case fetch_op_open_directory:
+        SVN_ERR(editor->open_directory(op->path, node->baton, op->revision,
+                                       child->pool, &child->baton));
+        break;
+
+      case fetch_op_change_dir_prop:
+        SVN_ERR(editor->change_dir_prop(node->baton, op->name, op->value,
+                                        scratch_pool));
+        break;
+
+      case fetch_op_close_directory:
+        SVN_ERR(editor->close_directory(node->baton, scratch_pool));
+        svn_pool_destroy(node->pool);
+        break;
+
+      case fetch_op_absent_directory:
+        SVN_ERR(editor->absent_directory(op->path, node->baton,
+                                         scratch_pool));
+        break;
+
+      case fetch_op_add_file:
+        SVN_ERR(editor->add_file(op->path, node->baton, op->copyfrom_path,
+                                 op->revision, child->pool, &child->baton));
+        break;
+
+      case fetch_op_open_file:
+        SVN_ERR(editor->open_file(op->path, node->baton, op->revision,
+                                  child->pool, &child->baton));
+        break;
+
+      case fetch_op_apply_textdelta:
+        {
+          svn_txdelta_window_handler_t handler;
+          void *handler_baton;
+          svn_stream_t *stream;
+
+          /* Send the fulltext as a delta against the empty stream. */
+          SVN_ERR(editor->apply_textdelta(node->baton, op->checksum,
+                                          node->pool, &handler,
+                                          &handler_baton));
+          stream = svn_txdelta_target_push(handler, handler_baton,
+                                           svn_stream_empty(scratch_pool),
+                                           scratch_pool);
+          SVN_ERR(receive_file(op->fetch_sess, op->path, stream, NULL, NULL,
+                               scratch_pool));
+          SVN_ERR(svn_stream_close(stream));
+
+          --eb->queued_fetches;
+        }
+        break;
+
+      case fetch_op_change_file_prop:
+        SVN_ERR(editor->change_file_prop(node->baton, op->name, op->value,
+                                         scratch_pool));
+        break;
+
+      case fetch_op_close_file:
+        SVN_ERR(editor->close_file(node->baton, op->checksum, scratch_pool));
+        svn_pool_destroy(node->pool);
+        break;
+
+      case fetch_op_absent_file:
+        SVN_ERR(editor->absent_file(op->path, node->baton, scratch_pool));
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Replay calls from the head of EB's queue until it holds no more than
+ * MAX_OPS calls and MAX_FETCHES of them wait for file contents.  Calls
+ * that don't need to wait for file contents are replayed as soon as they
+ * reach the head of the queue.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+replay_queue(fetch_edit_baton_t *eb,
+             int max_ops,
+             int max_fetches,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (eb->head
+         && (   eb->head->kind != fetch_op_apply_textdelta
+             || eb->queued_ops > max_ops
+             || eb->queued_fetches > max_fetches))
+    {
+      /* Replaying OP may destroy the pool that it got allocated in. */
+      fetch_op_t *op = eb->head;
+
+      eb->head = op->next;
+      if (eb->head == NULL)
+        eb->tail = NULL;
+      --eb->queued_ops;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(replay_op(eb, op, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Replay as many calls from EB's queue as its limits require.
+ * Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+replay_excess_ops(fetch_edit_baton_t *eb,
+                  apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(replay_queue(eb, FETCH_MAX_QUEUED_OPS,
+                                      eb->max_sessions
+                                        * FETCH_MAX_REQUESTS_PER_CONN,
+                                      scratch_pool));
+}
+
+/* Set *SESS_P to the session within EB that the next get-file request
+ * shall be sent to.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+get_fetch_session(svn_ra_svn__session_baton_t **sess_p,
+                  fetch_edit_baton_t *eb,
+                  apr_pool_t *scratch_pool)
+{
+  if (eb->sessions->nelts < eb->max_sessions)
+    {
+      svn_ra_svn__session_baton_t *sess = eb->sess;
+      apr_uri_t uri;
+
+      /* svnserve asks for authentication in the middle of a command if
+         the client may not access a path anonymously, and would take our
+         next pipelined get-file for the response.  Connect with the same
+         identity as the main session, which the server used to decide
+         which files to tell us about, so that it never has to ask. */
+      SVN_ERR(parse_url(eb->url, &uri, eb->sessions_pool));
+      SVN_ERR(open_session(sess_p, eb->url, &uri, sess->tunnel_name,
+                           sess->tunnel_argv, sess->config, sess->callbacks,
+                           sess->callbacks_baton, sess->auth_baton,
+                           sess->identified, eb->sessions_pool,
+                           scratch_pool));
+      APR_ARRAY_PUSH(eb->sessions, svn_ra_svn__session_baton_t *) = *sess_p;
+    }
+  else
+    {
+      *sess_p = APR_ARRAY_IDX(eb->sessions, eb->next_session,
+                              svn_ra_svn__session_baton_t *);
+      eb->next_session = (eb->next_session + 1) % eb->sessions->nelts;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_set_target_revision(void *edit_baton,
+                          svn_revnum_t target_revision,
+                          apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  /* This precedes all other calls, so there is nothing to queue. */
+  eb->target_rev = target_revision;
+  return svn_error_trace(eb->editor->set_target_revision(eb->edit_baton,
+                                                         target_revision,
+                                                         pool));
+}
+
+static svn_error_t *
+fetch_open_root(void *edit_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **root_baton)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+  fetch_node_t *node = make_fetch_node(eb, NULL, "");
+  fetch_op_t *op = queue_op(node, fetch_op_open_root, node->pool);
+
+  op->revision = base_revision;
+  *root_baton = node;
+
+  return svn_error_trace(replay_excess_ops(eb, pool));
+}
+
+static svn_error_t *
+fetch_delete_entry(const char *path,
+                   svn_revnum_t revision,
+                   void *parent_baton,
+                   apr_pool_t *pool)
+{
+  fetch_node_t *parent = parent_baton;
+  fetch_op_t *op = queue_op(parent, fetch_op_delete_entry, parent->pool);
+
+  op->path = apr_pstrdup(parent->pool, path);
+  op->revision = revision;
+
+  return svn_error_trace(replay_excess_ops(parent->eb, pool));
+}
+
+/* Queue a call of type KIND that adds or opens PATH below PARENT_BATON
+ * and return the new node in *CHILD_BATON.  COPYFROM_PATH and REVISION
+ * are the respective call parameters.  Use POOL for temporaries. */
+static svn_error_t *
+queue_add_or_open(fetch_op_kind_t kind,
+                  const char *path,
+                  void *parent_baton,
+                  const char *copyfrom_path,
+                  svn_revnum_t revision,
+                  apr_pool_t *pool,
+                  void **child_baton)
+{
+  fetch_node_t *parent = parent_baton;
+  fetch_node_t *child = make_fetch_node(parent->eb, parent, path);
+  fetch_op_t *op = queue_op(parent, kind, child->pool);
+
+  op->child = child;
+  op->path = child->path;
+  op->copyfrom_path = apr_pstrdup(child->pool, copyfrom_path);
+  op->revision = revision;
+  *child_baton = child;
+
+  return svn_error_trace(replay_excess_ops(parent->eb, pool));
+}
+
+static svn_error_t *
+fetch_add_directory(const char *path,
+                    void *parent_baton,
+                    const char *copyfrom_path,
+                    svn_revnum_t copyfrom_revision,
+                    apr_pool_t *pool,
+                    void **child_baton)
+{
+  return svn_error_trace(queue_add_or_open(fetch_op_add_directory, path,
+                                           parent_baton, copyfrom_path,
+                                           copyfrom_revision, pool,
+                                           child_baton));
+}
+
+static svn_error_t *
+fetch_open_directory(const char *path,
+                     void *parent_baton,
+                     svn_revnum_t base_revision,
+                     apr_pool_t *pool,
+                     void **child_baton)
+{
+  return svn_error_trace(queue_add_or_open(fetch_op_open_directory, path,
+                                           parent_baton, NULL,
+                                           base_revision, pool,
+                                           child_baton));
+}
+
+/* Queue a prop change of type KIND for NAME and VALUE on NODE_BATON.
+ * Use POOL for temporaries. */
+static svn_error_t *
+queue_prop_change(fetch_op_kind_t kind,
+                  void *node_baton,
+                  const char *name,
+                  const svn_string_t *value,
+                  apr_pool_t *pool)
+{
+  fetch_node_t *node = node_baton;
+  fetch_op_t *op = queue_op(node, kind, node->pool);
+
+  op->name = apr_pstrdup(node->pool, name);
+  op->value = value ? svn_string_dup(value, node->pool) : NULL;
+
+  return svn_error_trace(replay_excess_ops(node->eb, pool));
+}
+
+static svn_error_t *
+fetch_change_dir_prop(void *dir_baton,
+                      const char *name,
+                      const svn_string_t *value,
+                      apr_pool_t *pool)
+{
+  return svn_error_trace(queue_prop_change(fetch_op_change_dir_prop,
+                                           dir_baton, name, value, pool));
+}
+
+static svn_error_t *
+fetch_close_directory(void *dir_baton,
+                      apr_pool_t *pool)
+{
+  fetch_node_t *node = dir_baton;
+
+  queue_op(node, fetch_op_close_directory, node->pool);
+  return svn_error_trace(replay_excess_ops(node->eb, pool));
+}
+
+/* Queue an absent call of type KIND for PATH below PARENT_BATON.
+ * Use POOL for temporaries. */
+static svn_error_t *
+queue_absent(fetch_op_kind_t kind,
+             const char *path,
+             void *parent_baton,
+             apr_pool_t *pool)
+{
+  fetch_node_t *parent = parent_baton;
+  fetch_op_t *op = queue_op(parent, kind, parent->pool);
+
+  op->path = apr_pstrdup(parent->pool, path);
+  return svn_error_trace(replay_excess_ops(parent->eb, pool));
+}
+
+static svn_error_t *
+fetch_absent_directory(const char *path,
+                       void *parent_baton,
+                       apr_pool_t *pool)
+{
+  return svn_error_trace(queue_absent(fetch_op_absent_directory, path,
+                                      parent_baton, pool));
+}
+
+static svn_error_t *
+fetch_add_file(const char *path,
+               void *parent_baton,
+               const char *copyfrom_path,
+               svn_revnum_t copyfrom_revision,
+               apr_pool_t *pool,
+               void **file_baton)
+{
+  return svn_error_trace(queue_add_or_open(fetch_op_add_file, path,
+                                           parent_baton, copyfrom_path,
+                                           copyfrom_revision, pool,
+                                           file_baton));
+}
+
+static svn_error_t *
+fetch_open_file(const char *path,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **file_baton)
+{
+  return svn_error_trace(queue_add_or_open(fetch_op_open_file, path,
+                                           parent_baton, NULL,
+                                           base_revision, pool,
+                                           file_baton));
+}
+
+static svn_error_t *
+fetch_apply_textdelta(void *file_baton,
+                      const char *base_checksum,
+                      apr_pool_t *pool,
+                      svn_txdelta_window_handler_t *handler,
+                      void **handler_baton)
+{
+  fetch_node_t *node = file_baton;
+  fetch_edit_baton_t *eb = node->eb;
+  fetch_op_t *op = queue_op(node, fetch_op_apply_textdelta, node->pool);
+  svn_ra_svn__session_baton_t *sess;
+
+  op->path = node->path;
+  op->checksum = apr_pstrdup(node->pool, base_checksum);
+
+  /* Request the contents right away but don't wait for them. */
+  SVN_ERR(get_fetch_session(&sess, eb, pool));
+  SVN_ERR(svn_ra_svn__write_cmd_get_file(sess->conn, pool, node->path,
+                                         eb->target_rev, FALSE, TRUE));
+  SVN_ERR(svn_ra_svn__flush(sess->conn, pool));
+  op->fetch_sess = sess;
+  ++eb->queued_fetches;
+
+  /* The server sends no delta windows in a skeleton update. */
+  *handler = svn_delta_noop_window_handler;
+  *handler_baton = NULL;
+
+  return svn_error_trace(replay_excess_ops(eb, pool));
+}
+
+static svn_error_t *
+fetch_change_file_prop(void *file_baton,
+                       const char *name,
+                       const svn_string_t *value,
+                       apr_pool_t *pool)
+{
+  return svn_error_trace(queue_prop_change(fetch_op_change_file_prop,
+                                           file_baton, name, value, pool));
+}
+
+static svn_error_t *
+fetch_close_file(void *file_baton,
+                 const char *text_checksum,
+                 apr_pool_t *pool)
+{
+  fetch_node_t *node = file_baton;
+  fetch_op_t *op = queue_op(node, fetch_op_close_file, node->pool);
+
+  op->checksum = apr_pstrdup(node->pool, text_checksum);
+  return svn_error_trace(replay_excess_ops(node->eb, pool));
+}
+
+static svn_error_t *
+fetch_absent_file(const char *path,
+                  void *parent_baton,
+                  apr_pool_t *pool)
+{
+  return svn_error_trace(queue_absent(fetch_op_absent_file, path,
+                                      parent_baton, pool));
+}
+
+static svn_error_t *
+fetch_close_edit(void *edit_baton,
+                 apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  SVN_ERR(replay_queue(eb, 0, 0, pool));
+  svn_pool_destroy(eb->sessions_pool);
+
+  return svn_error_trace(eb->editor->close_edit(eb->edit_baton, pool));
+}
+
+static svn_error_t *
+fetch_abort_edit(void *edit_baton,
+                 apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  /* Drop the queue as well as any responses still in flight. */
+  eb->head = eb->tail = NULL;
+  svn_pool_destroy(eb->sessions_pool);
+
+  return svn_error_trace(eb->editor->abort_edit(eb->edit_baton, pool));
+}
+
+/* Set *EDITOR and *EDIT_BATON to a fetch editor that wraps WRAPPED_EDITOR
+ * and WRAPPED_BATON and fetches file contents via additional connections
+ * to SESS_BATON's server.  Allocate the result in POOL.
+ */
+static void
+get_fetch_editor(const svn_delta_editor_t **editor,
+                 void **edit_baton,
+                 svn_ra_svn__session_baton_t *sess_baton,
+                 const svn_delta_editor_t *wrapped_editor,
+                 void *wrapped_baton,
+                 apr_pool_t *pool)
+{
+  svn_delta_editor_t *fetch_editor = svn_delta_default_editor(pool);
+  fetch_edit_baton_t *eb = apr_pcalloc(pool, sizeof(*eb));
+
+  eb->editor = wrapped_editor;
+  eb->edit_baton = wrapped_baton;
+  eb->sess = sess_baton;
+  eb->url = apr_pstrdup(pool, sess_baton->parent->server_url->data);
+  eb->max_sessions = (int)(sess_baton->max_connections - 1);
+  eb->sessions = apr_array_make(pool, eb->max_sessions,
+                                sizeof(svn_ra_svn__session_baton_t *));
+  eb->sessions_pool = svn_pool_create(pool);
+  eb->target_rev = SVN_INVALID_REVNUM;
+  eb->pool = pool;
+
+  fetch_editor->set_target_revision = fetch_set_target_revision;
+  fetch_editor->open_root = fetch_open_root;
+  fetch_editor->delete_entry = fetch_delete_entry;
+  fetch_editor->add_directory = fetch_add_directory;
+  fetch_editor->open_directory = fetch_open_directory;
+  fetch_editor->change_dir_prop = fetch_change_dir_prop;
+  fetch_editor->close_directory = fetch_close_directory;
+  fetch_editor->absent_directory = fetch_absent_directory;
+  fetch_editor->add_file = fetch_add_file;
+  fetch_editor->open_file = fetch_open_file;
+  fetch_editor->apply_textdelta = fetch_apply_textdelta;
+  fetch_editor->change_file_prop = fetch_change_file_prop;
+  fetch_editor->close_file = fetch_close_file;
+  fetch_editor->absent_file = fetch_absent_file;
+  fetch_editor->close_edit = fetch_close_edit;
+  fetch_editor->abort_edit = fetch_abort_edit;
+
+  *editor = fetch_editor;
+  *edit_baton = eb;
+}
+
 static svn_error_t *ra_svn_update(svn_ra_session_t *session,
                                   const svn_ra_reporter3_t **reporter,
                                   void **report_baton, svn_revnum_t rev,
@@ -1717,14 +2484,27 @@ static svn_error_t *ra_svn_update(svn_ra_session_t *session,
   svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  svn_boolean_t fetch_contents = FALSE;
 
   /* Callbacks may assume that all data is relative the sessions's URL. */
   SVN_ERR(ensure_exact_server_parent(session, scratch_pool));
 
+  /* If the server lets us, have it send only the tree changes and fetch
+   * the file contents over additional connections.  Don't do that for
+   * tunnels as each connection would start a new tunnel agent. */
+  if (   !sess_baton->is_tunneled
+      && sess_baton->max_connections > 1
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SKELETON_UPDATE))
+    {
+      get_fetch_editor(&update_editor, &update_baton, sess_baton,
+                       update_editor, update_baton, pool);
+      fetch_contents = TRUE;
+    }
+
   /* Tell the server we want to start an update. */
   SVN_ERR(svn_ra_svn__write_cmd_update(conn, pool, rev, target, recurse,
                                        depth, send_copyfrom_args,
-                                       ignore_ancestry));
+                                       ignore_ancestry, !fetch_contents));
   SVN_ERR(handle_auth_request(sess_baton, pool));
 
   /* Fetch a reporter for the caller to drive.  The reporter will drive
@@ -351,9 +351,10 @@ static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
   svn_stream_set_write(diff_stream, ra_svn_svndiff_handler);
   svn_stream_set_close(diff_stream, ra_svn_svndiff_close_handler);
 
-  svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream,
+  svn_txdelta_to_svndiff4(wh, wh_baton, diff_stream,
                           svn_ra_svn__svndiff_version(b->conn),
-                          b->conn->compression_level, pool);
+                          b->conn->compression_level,
+                          SVN_DELTA_ENCODER_THREADS_DEFAULT, pool);
   return SVN_NO_ERROR;
 }
 
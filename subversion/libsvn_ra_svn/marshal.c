@@ -27,6 +27,7 @@
 #include <stdlib.h>
 
 #define APR_WANT_STRFUNC
+#define APR_WANT_IOVEC
 #include <apr_want.h>
 #include <apr_general.h>
 #include <apr_lib.h>
@@ -200,6 +201,10 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->encrypted = FALSE;
 #endif
   conn->session = NULL;
+  conn->read_buf_size = SVN_RA_SVN__READBUF_SIZE;
+  conn->read_buf = apr_palloc(result_pool, conn->read_buf_size);
+  conn->write_buf_size = SVN_RA_SVN__WRITEBUF_SIZE;
+  conn->write_buf = apr_palloc(result_pool, conn->write_buf_size);
   conn->read_ptr = conn->read_buf;
   conn->read_end = conn->read_buf;
   conn->write_pos = 0;
@@ -215,6 +220,10 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->capabilities = apr_hash_make(result_pool);
   conn->compression_level = compression_level;
   conn->zero_copy_limit = zero_copy_limit;
+  conn->write_buf_pool = NULL;
+  conn->read_buf_pool = NULL;
+  conn->initial_write_buf = conn->write_buf;
+  conn->initial_read_buf = conn->read_buf;
   conn->pool = result_pool;
 
   if (sock != NULL)
@@ -273,13 +282,17 @@ svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
   if (svn_ra_svn_compression_level(conn) <= 0)
     return 0;
 
-  /* Prefer SVNDIFF2 over SVNDIFF1. */
+  /* Prefer SVNDIFF3 over SVNDIFF2 over SVNDIFF1.  SVNDIFF3 requires zstd
+   * support on both sides. */
+  if (svn_zstd__is_available()
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED))
+    return 3;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
     return 2;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
     return 1;
 
-  /* The connection does not support SVNDIFF1/2; default to "version 0". */
+  /* The connection does not support SVNDIFF1/2/3; default to "version 0". */
   return 0;
 }
 
@@ -289,6 +302,15 @@ svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn)
   return conn->pool;
 }
 
+void
+svn_ra_svn__get_io_stats(svn_ra_svn__io_stats_t *stats,
+                         svn_ra_svn_conn_t *conn)
+{
+  *stats = conn->io_stats;
+  stats->read_buf_size = conn->read_buf_size;
+  stats->write_buf_size = conn->write_buf_size;
+}
+
 svn_error_t *
 svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
                                svn_delta_shim_callbacks_t *shim_callbacks)
@@ -363,14 +385,21 @@ check_io_limits(svn_ra_svn_conn_t *conn)
   return SVN_NO_ERROR;
 }
 
-/* Write data to socket or output file as appropriate. */
-static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
-                                    const char *data, apr_size_t len)
+/* Write the NVEC data blocks in VEC to socket or output file as
+ * appropriate.  The contents of VEC will be modified. */
+static svn_error_t *writebuf_output_vec(svn_ra_svn_conn_t *conn,
+                                        apr_pool_t *pool,
+                                        struct iovec *vec,
+                                        int nvec)
 {
-  const char *end = data + len;
   apr_size_t count;
+  apr_size_t len = 0;
   apr_pool_t *subpool = NULL;
   svn_ra_svn__session_baton_t *session = conn->session;
+  int i;
+
+  for (i = 0; i < nvec; ++i)
+    len += vec[i].iov_len;
 
   /* Limit the size of the response, if a limit has been configured.
    * This is to limit the server load in case users e.g. accidentally ran
@@ -378,14 +407,15 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   conn->current_out += len;
   SVN_ERR(check_io_limits(conn));
 
-  while (data < end)
+  while (nvec > 0)
     {
-      count = end - data;
-
       if (session && session->callbacks && session->callbacks->cancel_func)
         SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
 
-      SVN_ERR(svn_ra_svn__stream_write(conn->stream, data, &count));
+      SVN_ERR(svn_ra_svn__stream_writev(conn->stream, vec, nvec, &count));
+      conn->io_stats.bytes_written += count;
+      conn->io_stats.write_calls++;
+
       if (count == 0)
         {
           if (!subpool)
@@ -394,7 +424,6 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
             svn_pool_clear(subpool);
           SVN_ERR(conn->block_handler(conn, subpool, conn->block_baton));
         }
-      data += count;
 
       if (session)
         {
@@ -405,6 +434,20 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
             (cb->progress_func)(session->bytes_written + session->bytes_read,
                                 -1, cb->progress_baton, subpool);
         }
+
+      /* Skip the data that has been written. */
+      while (nvec > 0 && count >= vec->iov_len)
+        {
+          count -= vec->iov_len;
+          ++vec;
+          --nvec;
+        }
+
+      if (nvec > 0)
+        {
+          vec->iov_base = (char *)vec->iov_base + count;
+          vec->iov_len -= count;
+        }
     }
 
   conn->written_since_error_check += len;
@@ -416,6 +459,92 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Write data to socket or output file as appropriate. */
+static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                                    const char *data, apr_size_t len)
+{
+  struct iovec vec;
+  vec.iov_base = (void *)data;
+  vec.iov_len = len;
+
+  return svn_error_trace(writebuf_output_vec(conn, pool, &vec, 1));
+}
+
+/* Allocate a buffer of SIZE bytes in a new sub-pool of CONN's pool and
+ * return it.  Destroy *BUF_POOL, which holds the buffer to be replaced,
+ * unless it is NULL, and set it to the new sub-pool. */
+static char *
+replace_buffer(svn_ra_svn_conn_t *conn,
+               apr_pool_t **buf_pool,
+               apr_size_t size)
+{
+  apr_pool_t *new_pool = svn_pool_create(conn->pool);
+  char *buf = apr_palloc(new_pool, size);
+
+  if (*buf_pool)
+    svn_pool_destroy(*buf_pool);
+
+  *buf_pool = new_pool;
+  return buf;
+}
+
+/* Double the size of the write buffer in CONN, unless it has reached
+ * its maximum size.  The write buffer must be empty. */
+static void writebuf_grow(svn_ra_svn_conn_t *conn)
+{
+  if (conn->write_buf_size < SVN_RA_SVN__MAX_BUF_SIZE)
+    {
+      conn->write_buf_size *= 2;
+      conn->write_buf = replace_buffer(conn, &conn->write_buf_pool,
+                                       conn->write_buf_size);
+    }
+}
+
+/* Return the I/O buffers of CONN to their initial sizes if they have grown
+ * during some bulk data transfer, such that idle connections don't hold
+ * on to large buffers.  Unread input and pending output are retained.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+shrink_buffers(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
+{
+  apr_size_t unread = conn->read_end - conn->read_ptr;
+
+  if (conn->write_buf_pool)
+    {
+      /* Send what does not fit into the initial buffer. */
+      if (conn->write_pos > SVN_RA_SVN__WRITEBUF_SIZE)
+        {
+          apr_size_t write_pos = conn->write_pos;
+
+          /* Clear conn->write_pos first in case the block handler does
+           * a read. */
+          conn->write_pos = 0;
+          SVN_ERR(writebuf_output(conn, pool, conn->write_buf, write_pos));
+        }
+
+      memcpy(conn->initial_write_buf, conn->write_buf, conn->write_pos);
+      conn->write_buf = conn->initial_write_buf;
+      conn->write_buf_size = SVN_RA_SVN__WRITEBUF_SIZE;
+      svn_pool_destroy(conn->write_buf_pool);
+      conn->write_buf_pool = NULL;
+    }
+
+  /* Pipelined requests may leave more unread data than we could move.
+   * Try again after the next command then. */
+  if (conn->read_buf_pool && unread <= SVN_RA_SVN__READBUF_SIZE)
+    {
+      memcpy(conn->initial_read_buf, conn->read_ptr, unread);
+      conn->read_buf = conn->initial_read_buf;
+      conn->read_buf_size = SVN_RA_SVN__READBUF_SIZE;
+      conn->read_ptr = conn->read_buf;
+      conn->read_end = conn->read_buf + unread;
+      svn_pool_destroy(conn->read_buf_pool);
+      conn->read_buf_pool = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Write data from the write buffer out to the socket. */
 static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
 {
@@ -424,23 +553,42 @@ static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
   /* Clear conn->write_pos first in case the block handler does a read. */
   conn->write_pos = 0;
   SVN_ERR(writebuf_output(conn, pool, conn->write_buf, write_pos));
+
+  /* Nearly full buffers mean that we are sending bulk data.  Use larger
+   * buffers to reduce the number of syscalls. */
+  if (write_pos > conn->write_buf_size / 4 * 3)
+    writebuf_grow(conn);
+
   return SVN_NO_ERROR;
 }
 
 static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                    const char *data, apr_size_t len)
 {
-  /* data >= 8k is sent immediately */
-  if (len >= sizeof(conn->write_buf) / 2)
+  /* data >= 8k is sent immediately, without copying it.  This does not
+   * depend on the current buffer size, i.e. large text delta chunks will
+   * always be passed through. */
+  if (len >= SVN_RA_SVN__WRITEBUF_SIZE / 2)
     {
-      if (conn->write_pos > 0)
-        SVN_ERR(writebuf_flush(conn, pool));
-
-      return writebuf_output(conn, pool, data, len);
+      struct iovec vec[2];
+      apr_size_t write_pos = conn->write_pos;
+
+      /* Send any buffered data together with DATA in one call.
+         Clear conn->write_pos first in case the block handler does a
+         read. */
+      conn->write_pos = 0;
+      vec[0].iov_base = conn->write_buf;
+      vec[0].iov_len = write_pos;
+      vec[1].iov_base = (void *)data;
+      vec[1].iov_len = len;
+
+      return svn_error_trace(write_pos
+                               ? writebuf_output_vec(conn, pool, vec, 2)
+                               : writebuf_output_vec(conn, pool, vec + 1, 1));
     }
 
   /* ensure room for the data to add */
-  if (conn->write_pos + len > sizeof(conn->write_buf))
+  if (conn->write_pos + len > conn->write_buf_size)
     SVN_ERR(writebuf_flush(conn, pool));
 
   /* buffer the new data block as well */
@@ -461,7 +609,7 @@ static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 static APR_INLINE svn_error_t *
 writebuf_writechar(svn_ra_svn_conn_t *conn, apr_pool_t *pool, char data)
 {
-  if (conn->write_pos < sizeof(conn->write_buf))
+  if (conn->write_pos < conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = data;
     conn->write_pos++;
@@ -509,6 +657,8 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   if (*len == 0)
     return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
   conn->current_in += *len;
+  conn->io_stats.bytes_read += *len;
+  conn->io_stats.read_calls++;
 
   if (session)
     {
@@ -535,10 +685,12 @@ static svn_error_t *readbuf_skip(svn_ra_svn_conn_t *conn, apr_uint64_t len)
     if (len == 0)
       break;
 
-    buflen = sizeof(conn->read_buf);
+    buflen = conn->read_buf_size;
     SVN_ERR(svn_ra_svn__stream_read(conn->stream, conn->read_buf, &buflen));
     if (buflen == 0)
       return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
+    conn->io_stats.bytes_read += buflen;
+    conn->io_stats.read_calls++;
 
     conn->read_end = conn->read_buf + buflen;
     conn->read_ptr = conn->read_buf;
@@ -560,8 +712,18 @@ static svn_error_t *readbuf_fill(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
   if (conn->write_pos)
     SVN_ERR(writebuf_flush(conn, pool));
 
+  /* If the last read filled the whole buffer, there is probably more data
+   * coming.  Read larger chunks then. */
+  if (   conn->read_end == conn->read_buf + conn->read_buf_size
+      && conn->read_buf_size < SVN_RA_SVN__MAX_BUF_SIZE)
+    {
+      conn->read_buf_size *= 2;
+      conn->read_buf = replace_buffer(conn, &conn->read_buf_pool,
+                                      conn->read_buf_size);
+    }
+
   /* Fill (some of the) buffer. */
-  len = sizeof(conn->read_buf);
+  len = conn->read_buf_size;
   SVN_ERR(readbuf_input(conn, conn->read_buf, &len, pool));
   conn->read_ptr = conn->read_buf;
   conn->read_end = conn->read_buf + len;
@@ -602,7 +764,7 @@ static svn_error_t *readbuf_read(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   data = readbuf_drain(conn, data, end);
 
   /* Read large chunks directly into buffer. */
-  while (end - data > (apr_ssize_t)sizeof(conn->read_buf))
+  while (end - data > (apr_ssize_t)conn->read_buf_size)
     {
       SVN_ERR(writebuf_flush(conn, pool));
       count = end - data;
@@ -624,7 +786,7 @@ static svn_error_t *readbuf_read(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 static svn_error_t *readbuf_skip_leading_garbage(svn_ra_svn_conn_t *conn,
                                                  apr_pool_t *pool)
 {
-  char buf[256];  /* Must be smaller than sizeof(conn->read_buf) - 1. */
+  char buf[256];  /* Must be smaller than SVN_RA_SVN__READBUF_SIZE - 1. */
   const char *p, *end;
   apr_size_t len;
   svn_boolean_t lparen = FALSE;
@@ -668,7 +830,7 @@ static svn_error_t *write_number(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 
   /* SVN_INT64_BUFFER_SIZE includes space for a terminating NUL that
    * svn__ui64toa will always append. */
-  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= sizeof(conn->write_buf))
+  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= conn->write_buf_size)
     SVN_ERR(writebuf_flush(conn, pool));
 
   written = svn__ui64toa(conn->write_buf + conn->write_pos, number);
@@ -728,13 +890,16 @@ svn_ra_svn__write_ncstring(svn_ra_svn_conn_t *conn,
 {
   /* Apart from LEN bytes of string contents, we need room for a number,
      a colon and a space. */
-  apr_size_t max_fill = sizeof(conn->write_buf) - SVN_INT64_BUFFER_SIZE - 2;
+  apr_size_t max_fill = conn->write_buf_size - SVN_INT64_BUFFER_SIZE - 2;
 
   /* In most cases, there is enough left room in the WRITE_BUF
      the we can serialize directly into it.  On platforms with
      segmented memory, LEN might actually be close to APR_SIZE_MAX.
-     Blindly doing arithmetic on it might cause an overflow. */
-  if ((len <= max_fill) && (conn->write_pos <= max_fill - len))
+     Blindly doing arithmetic on it might cause an overflow.
+     Strings that writebuf_write() would pass through must not be copied
+     just because the buffer has grown, though. */
+  if (   (len < SVN_RA_SVN__WRITEBUF_SIZE / 2)
+      && (len <= max_fill) && (conn->write_pos <= max_fill - len))
     {
       /* Quick path. */
       conn->write_pos = write_ncstring_quick(conn->write_buf
@@ -830,7 +995,7 @@ svn_error_t *
 svn_ra_svn__start_list(svn_ra_svn_conn_t *conn,
                        apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
     {
       conn->write_buf[conn->write_pos] = '(';
       conn->write_buf[conn->write_pos+1] = ' ';
@@ -845,7 +1010,7 @@ svn_error_t *
 svn_ra_svn__end_list(svn_ra_svn_conn_t *conn,
                      apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = ')';
     conn->write_buf[conn->write_pos+1] = ' ';
@@ -866,6 +1031,15 @@ svn_ra_svn__flush(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__write_raw(svn_ra_svn_conn_t *conn,
+                      apr_pool_t *pool,
+                      const char *data,
+                      apr_size_t len)
+{
+  return svn_error_trace(writebuf_write(conn, pool, data, len));
+}
+
 /* --- WRITING TUPLES --- */
 
 static svn_error_t *
@@ -990,15 +1164,17 @@ write_tuple_string_opt_list(svn_ra_svn_conn_t *conn,
 
   /* If this how far we can fill the WRITE_BUF with string data and still
      guarantee that the length info will fit in as well. */
-  max_fill = sizeof(conn->write_buf)
+  max_fill = conn->write_buf_size
            - 2                       /* open list */
            - SVN_INT64_BUFFER_SIZE   /* string length + separator */
            - 2;                      /* close list */
 
    /* On platforms with segmented memory, STR->LEN might actually be
       close to APR_SIZE_MAX.  Blindly doing arithmetic on it might
-      cause an overflow. */
-  if ((str->len <= max_fill) && (conn->write_pos <= max_fill - str->len))
+      cause an overflow.  See svn_ra_svn__write_ncstring() for the
+      size limit. */
+  if (   (str->len < SVN_RA_SVN__WRITEBUF_SIZE / 2)
+      && (str->len <= max_fill) && (conn->write_pos <= max_fill - str->len))
     {
       /* Quick path. */
       /* Open list. */
@@ -1974,9 +2150,13 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
                       conn, pool,
                       svn_ra_svn__locate_real_error_child(err));
       svn_error_clear(err);
-      return write_err ? write_err : SVN_NO_ERROR;
+      err = write_err;
     }
 
+  /* The connection may stay idle for a long time now. */
+  if (!err)
+    err = shrink_buffers(conn, pool);
+
   return err;
 }
 
@@ -2463,7 +2643,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry)
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t send_text_deltas)
 {
   SVN_ERR(writebuf_write_literal(conn, pool, "( update ( "));
   SVN_ERR(write_tuple_start_list(conn, pool));
@@ -2474,6 +2655,7 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
   SVN_ERR(write_tuple_depth(conn, pool, depth));
   SVN_ERR(write_tuple_boolean(conn, pool, send_copyfrom_args));
   SVN_ERR(write_tuple_boolean(conn, pool, ignore_ancestry));
+  SVN_ERR(write_tuple_boolean(conn, pool, send_text_deltas));
   SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
 
   return SVN_NO_ERROR;
@@ -2848,7 +3030,7 @@ svn_ra_svn__write_data_log_changed_path(svn_ra_svn_conn_t *conn,
   apr_size_t flags_len = flags_str->len;
 
   /* How much buffer space can we use for non-string data (worst case)? */
-  apr_size_t max_fill = sizeof(conn->write_buf)
+  apr_size_t max_fill = conn->write_buf_size
                       - 2                          /* list start */
                       - 2 - SVN_INT64_BUFFER_SIZE  /* path */
                       - 2                          /* action */
@@ -62,11 +62,20 @@ typedef svn_error_t *(*ra_svn_block_handler_t)(svn_ra_svn_conn_t *conn,
 #define SVN_RA_SVN__DEFAULT_USERAGENT  "SVN/" SVN_VER_NUMBER\
                                        " (" SVN_BUILD_TARGET ")"
 
-/* The size of our per-connection read and write buffers. */
+/* The initial size of our per-connection read and write buffers. */
 #define SVN_RA_SVN__PAGE_SIZE 4096
 #define SVN_RA_SVN__READBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 #define SVN_RA_SVN__WRITEBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 
+/* The buffers double in size whenever they got filled completely by a
+ * single I/O operation, i.e. while bulk data is being transferred.  This
+ * is the size at which they stop growing.  They return to their initial
+ * size after each command handled by svn_ra_svn__handle_command(). */
+#define SVN_RA_SVN__MAX_BUF_SIZE (64 * SVN_RA_SVN__PAGE_SIZE)
+
+/* Upper limit for SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS. */
+#define SVN_RA_SVN__MAX_CONNECTIONS_LIMIT 8
+
 /* Create forward reference */
 typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
 
@@ -74,13 +83,18 @@ typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
  * first few fields during setup and cleanup. */
 struct svn_ra_svn_conn_st {
 
-  /* I/O buffers */
-  char write_buf[SVN_RA_SVN__WRITEBUF_SIZE];
-  char read_buf[SVN_RA_SVN__READBUF_SIZE];
+  /* I/O buffers and their current sizes */
+  char *write_buf;
+  apr_size_t write_buf_size;
+  char *read_buf;
+  apr_size_t read_buf_size;
   char *read_ptr;
   char *read_end;
   apr_size_t write_pos;
 
+  /* I/O statistics, see svn_ra_svn__get_io_stats() */
+  svn_ra_svn__io_stats_t io_stats;
+
   svn_ra_svn__stream_t *stream;
   svn_ra_svn__session_baton_t *session;
 #ifdef SVN_HAVE_SASL
@@ -121,6 +135,16 @@ struct svn_ra_svn_conn_st {
   /* EV2 support*/
   svn_delta_shim_callbacks_t *shim_callbacks;
 
+  /* Sub-pools of POOL holding the grown I/O buffers, NULL while the
+     initial buffers are in use.  Replaced whenever a buffer grows. */
+  apr_pool_t *write_buf_pool;
+  apr_pool_t *read_buf_pool;
+
+  /* The initial I/O buffers, to be used again once the grown ones are
+     no longer needed. */
+  char *initial_write_buf;
+  char *initial_read_buf;
+
   /* our pool */
   apr_pool_t *pool;
 };
@@ -160,6 +184,12 @@ struct svn_ra_svn__session_baton_t {
   apr_off_t bytes_read, bytes_written; /* apr_off_t's because that's what
                                           the callback interface uses */
   const char *useragent;
+  /* Maximum number of connections to use for a single update,
+     see SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS. */
+  apr_int64_t max_connections;
+  /* Set once we authenticated with a mechanism other than ANONYMOUS.
+     If set, we will not fall back to anonymous access. */
+  svn_boolean_t identified;
 };
 
 /* Set a callback for blocked writes on conn.  This handler may
@@ -222,6 +252,15 @@ svn_ra_svn__stream_t *svn_ra_svn__stream_create(svn_stream_t *in_stream,
 svn_error_t *svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                                       const char *data, apr_size_t *len);
 
+/* Write the NVEC data blocks in VEC to STREAM using a single gather write
+ * where supported.  Return the total number of bytes written in *LEN.
+ * Like svn_ra_svn__stream_write, this may write less than all the data.
+ */
+svn_error_t *svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                                       const struct iovec *vec,
+                                       int nvec,
+                                       apr_size_t *len);
+
 /* Read *LEN bytes from STREAM into DATA, returning the number of bytes
  * read in *LEN.
  */
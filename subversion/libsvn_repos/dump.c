@@ -44,6 +44,8 @@
 #include "private/svn_sorts_private.h"
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
+#include "private/svn_task.h"
+#include "private/svn_subr_private.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -341,8 +343,8 @@ store_delta(apr_file_t **tempfile, svn_filesize_t *len,
   /* Compute the delta and send it to the temporary file. */
   SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, oldroot, oldpath,
                                        newroot, newpath, pool));
-  svn_txdelta_to_svndiff3(&wh, &whb, temp_stream, 0,
-                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  svn_txdelta_to_svndiff4(&wh, &whb, temp_stream, 0,
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1, pool);
   SVN_ERR(svn_txdelta_send_txstream(delta_stream, wh, whb, pool));
 
   /* Get the length of the temporary file and rewind it. */
@@ -1978,9 +1980,318 @@ dump_filter_authz_func(svn_boolean_t *allowed,
 
 
 
+/* Implements svn_repos_notify_func_t.
+ * Append a copy of NOTIFY to the array of svn_repos_notify_t * given
+ * by BATON.  Used to send the notifications of concurrently processed
+ * revisions in revision order from the calling thread. */
+static void
+buffer_notification(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *notifications = baton;
+  apr_pool_t *result_pool = notifications->pool;
+  svn_repos_notify_t *copy = apr_pmemdup(result_pool, notify,
+                                         sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(result_pool, notify->warning_str);
+  copy->path = apr_pstrdup(result_pool, notify->path);
+
+  APR_ARRAY_PUSH(notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Parameters of a dump that are the same for all revisions. */
+typedef struct dump_params_t
+{
+  /* As passed to svn_repos_dump_fs5(), with defaults applied. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_boolean_t incremental;
+  svn_boolean_t use_deltas;
+  svn_boolean_t include_revprops;
+  svn_boolean_t include_changes;
+
+  /* Authz callback and baton implementing the dump filter. */
+  svn_repos_authz_func_t authz_func;
+  dump_filter_baton_t *authz_baton;
+} dump_params_t;
+
+/* Write revision REV of REPOS to STREAM as specified by PARAMS.  Set
+   *FOUND_OLD_REFERENCE and *FOUND_OLD_MERGEINFO if the respective
+   warnings have been issued.  Send warnings to NOTIFY_FUNC with
+   NOTIFY_BATON.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+dump_one_revision(svn_repos_t *repos,
+                  svn_revnum_t rev,
+                  const dump_params_t *params,
+                  svn_stream_t *stream,
+                  svn_boolean_t *found_old_reference,
+                  svn_boolean_t *found_old_mergeinfo,
+                  svn_repos_notify_func_t notify_func,
+                  void *notify_baton,
+                  apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  const svn_delta_editor_t *dump_editor;
+  void *dump_edit_baton = NULL;
+  svn_fs_root_t *to_root;
+  svn_boolean_t use_deltas_for_rev;
+
+  /* Write the revision record. */
+  SVN_ERR(write_revision_record(stream, repos, rev, params->include_revprops,
+                                params->authz_func, params->authz_baton,
+                                scratch_pool));
+
+  /* When dumping revision 0, we just write out the revision record.
+     The parser might want to use its properties.
+     If we don't want revision changes at all, skip in any case. */
+  if (rev == 0 || !params->include_changes)
+    return SVN_NO_ERROR;
+
+  /* Fetch the editor which dumps nodes to a file.  Regardless of
+     what we've been told, don't use deltas for the first rev of a
+     non-incremental dump. */
+  use_deltas_for_rev = params->use_deltas
+                    && (params->incremental || rev != params->start_rev);
+  SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, rev,
+                          "", stream, found_old_reference,
+                          found_old_mergeinfo, NULL,
+                          notify_func, notify_baton,
+                          params->start_rev, use_deltas_for_rev,
+                          FALSE, FALSE, scratch_pool));
+
+  /* Drive the editor in one way or another. */
+  SVN_ERR(svn_fs_revision_root(&to_root, fs, rev, scratch_pool));
+
+  /* If this is the first revision of a non-incremental dump,
+     we're in for a full tree dump.  Otherwise, we want to simply
+     replay the revision.  */
+  if ((rev == params->start_rev) && (! params->incremental))
+    {
+      /* Compare against revision 0, so everything appears to be added. */
+      svn_fs_root_t *from_root;
+      SVN_ERR(svn_fs_revision_root(&from_root, fs, 0, scratch_pool));
+      SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
+                                   to_root, "",
+                                   dump_editor, dump_edit_baton,
+                                   params->authz_func, params->authz_baton,
+                                   FALSE, /* don't send text-deltas */
+                                   svn_depth_infinity,
+                                   FALSE, /* don't send entry props */
+                                   FALSE, /* don't ignore ancestry */
+                                   scratch_pool));
+    }
+  else
+    {
+      /* The normal case: compare consecutive revs. */
+      SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
+                                dump_editor, dump_edit_baton,
+                                params->authz_func, params->authz_baton,
+                                scratch_pool));
+
+      /* While our editor close_edit implementation is a no-op, we still
+         do this for completeness. */
+      SVN_ERR(dump_editor->close_edit(dump_edit_baton, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Amount of dump data per revision to keep in memory while dumping
+   concurrently.  Anything beyond that goes to a temporary file. */
+#define DUMP_BUFFER_SIZE (1024 * 1024)
+
+/* Baton type used for dumping revisions concurrently. */
+typedef struct dump_revs_baton_t
+{
+  /* Repository to open in each worker thread. */
+  const char *repos_path;
+  apr_hash_t *fs_config;
+
+  /* What to dump. */
+  const dump_params_t *params;
+
+  /* Target stream and notification callback as passed to
+     svn_repos_dump_fs5(). */
+  svn_stream_t *stream;
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+
+  /* Re-used notification object for svn_repos_notify_dump_rev_end. */
+  svn_repos_notify_t *notify;
+
+  /* Combined warning flags of all revisions written so far. */
+  svn_boolean_t found_old_reference;
+  svn_boolean_t found_old_mergeinfo;
+} dump_revs_baton_t;
+
+/* Result of dumping a single revision in a worker thread. */
+typedef struct dump_rev_result_t
+{
+  /* The dump data of the revision. */
+  svn_spillbuf_t *contents;
+
+  /* Notifications (svn_repos_notify_t *) to send for the revision. */
+  apr_array_header_t *notifications;
+
+  /* Warning flags for this revision. */
+  svn_boolean_t found_old_reference;
+  svn_boolean_t found_old_mergeinfo;
+} dump_rev_result_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Open a private instance of the repository given by the
+ * dump_revs_baton_t BATON. */
+static svn_error_t *
+open_repos_instance(void **thread_context,
+                    void *baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t *db = baton;
+  svn_repos_t *repos;
+
+  SVN_ERR(svn_repos_open3(&repos, db->repos_path, db->fs_config,
+                          result_pool, scratch_pool));
+  *thread_context = repos;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Dump the revision given by TASK_INDEX relative to the start revision
+ * in the dump_revs_baton_t PROCESS_BATON from the svn_repos_t given by
+ * THREAD_CONTEXT into a spill buffer. */
+static svn_error_t *
+dump_rev_task(void **result,
+              void *process_baton,
+              void *thread_context,
+              apr_int64_t task_index,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t *db = process_baton;
+  dump_rev_result_t *rev_result = apr_pcalloc(result_pool,
+                                              sizeof(*rev_result));
+  svn_stream_t *stream;
+
+  if (cancel_func)
+    SVN_ERR(cancel_func(cancel_baton));
+
+  rev_result->contents = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE,
+                                              DUMP_BUFFER_SIZE,
+                                              result_pool);
+  rev_result->notifications = apr_array_make(result_pool, 0,
+                                             sizeof(svn_repos_notify_t *));
+  stream = svn_stream__from_spillbuf(rev_result->contents, scratch_pool);
+
+  SVN_ERR(dump_one_revision(thread_context,
+                            db->params->start_rev + (svn_revnum_t)task_index,
+                            db->params, stream,
+                            &rev_result->found_old_reference,
+                            &rev_result->found_old_mergeinfo,
+                            db->notify_func ? buffer_notification : NULL,
+                            rev_result->notifications,
+                            scratch_pool));
+
+  *result = rev_result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Copy the dump data in the dump_rev_result_t RESULT to the stream
+ * given by the dump_revs_baton_t OUTPUT_BATON and send the buffered
+ * notifications for the revision given by TASK_INDEX. */
+static svn_error_t *
+write_rev_result(void *result,
+                 void *output_baton,
+                 apr_int64_t task_index,
+                 apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t *db = output_baton;
+  dump_rev_result_t *rev_result = result;
+  int i;
+
+  while (TRUE)
+    {
+      const char *data;
+      apr_size_t len;
+
+      SVN_ERR(svn_spillbuf__read(&data, &len, rev_result->contents,
+                                 scratch_pool));
+      if (data == NULL)
+        break;
+
+      SVN_ERR(svn_stream_write(db->stream, data, &len));
+    }
+
+  db->found_old_reference |= rev_result->found_old_reference;
+  db->found_old_mergeinfo |= rev_result->found_old_mergeinfo;
+
+  if (db->notify_func)
+    {
+      for (i = 0; i < rev_result->notifications->nelts; ++i)
+        db->notify_func(db->notify_baton,
+                        APR_ARRAY_IDX(rev_result->notifications, i,
+                                      svn_repos_notify_t *),
+                        scratch_pool);
+
+      db->notify->revision = db->params->start_rev
+                           + (svn_revnum_t)task_index;
+      db->notify_func(db->notify_baton, db->notify, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Dump the revisions given by PARAMS from REPOS to STREAM using up to
+ * JOBS threads.  Set *FOUND_OLD_REFERENCE and *FOUND_OLD_MERGEINFO if
+ * the respective warnings have been issued for any revision.  NOTIFY is
+ * the object to use for svn_repos_notify_dump_rev_end.  The remaining
+ * parameters are the same as for svn_repos_dump_fs5(). */
+static svn_error_t *
+dump_revisions_concurrently(svn_repos_t *repos,
+                            const dump_params_t *params,
+                            svn_stream_t *stream,
+                            int jobs,
+                            svn_boolean_t *found_old_reference,
+                            svn_boolean_t *found_old_mergeinfo,
+                            svn_repos_notify_func_t notify_func,
+                            void *notify_baton,
+                            svn_repos_notify_t *notify,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t db = { 0 };
+
+  db.repos_path = svn_repos_path(repos, scratch_pool);
+  db.fs_config = svn_fs_config(svn_repos_fs(repos), scratch_pool);
+  db.params = params;
+  db.stream = stream;
+  db.notify_func = notify_func;
+  db.notify_baton = notify_baton;
+  db.notify = notify;
+
+  SVN_ERR(svn_task__run(jobs, params->end_rev - params->start_rev + 1,
+                        open_repos_instance, &db,
+                        dump_rev_task, &db,
+                        write_rev_result, &db,
+                        cancel_func, cancel_baton,
+                        scratch_pool));
+
+  *found_old_reference = db.found_old_reference;
+  *found_old_mergeinfo = db.found_old_mergeinfo;
+
+  return SVN_NO_ERROR;
+}
+
 /* The main dumper. */
 svn_error_t *
-svn_repos_dump_fs4(svn_repos_t *repos,
+svn_repos_dump_fs5(svn_repos_t *repos,
                    svn_stream_t *stream,
                    svn_revnum_t start_rev,
                    svn_revnum_t end_rev,
@@ -1988,6 +2299,7 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                    svn_boolean_t use_deltas,
                    svn_boolean_t include_revprops,
                    svn_boolean_t include_changes,
+                   int jobs,
                    svn_repos_notify_func_t notify_func,
                    void *notify_baton,
                    svn_repos_dump_filter_func_t filter_func,
@@ -1996,8 +2308,6 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                    void *cancel_baton,
                    apr_pool_t *pool)
 {
-  const svn_delta_editor_t *dump_editor;
-  void *dump_edit_baton = NULL;
   svn_revnum_t rev;
   svn_fs_t *fs = svn_repos_fs(repos);
   apr_pool_t *iterpool = svn_pool_create(pool);
@@ -2007,8 +2317,8 @@ svn_repos_dump_fs4(svn_repos_t *repos,
   svn_boolean_t found_old_reference = FALSE;
   svn_boolean_t found_old_mergeinfo = FALSE;
   svn_repos_notify_t *notify;
-  svn_repos_authz_func_t authz_func;
   dump_filter_baton_t authz_baton = {0};
+  dump_params_t params;
 
   /* Make sure we catch up on the latest revprop changes.  This is the only
    * time we will refresh the revprop data in this query. */
@@ -2037,18 +2347,26 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                                "(youngest revision is %ld)"),
                              end_rev, youngest);
 
+  params.start_rev = start_rev;
+  params.end_rev = end_rev;
+  params.incremental = incremental;
+  params.use_deltas = use_deltas;
+  params.include_revprops = include_revprops;
+  params.include_changes = include_changes;
+  params.authz_baton = &authz_baton;
+
   /* We use read authz callback to implement dump filtering. If there is no
    * read access for some node, it will be excluded from dump as well as
    * references to it (e.g. copy source). */
   if (filter_func)
     {
-      authz_func = dump_filter_authz_func;
+      params.authz_func = dump_filter_authz_func;
       authz_baton.filter_func = filter_func;
       authz_baton.filter_baton = filter_baton;
     }
   else
     {
-      authz_func = NULL;
+      params.authz_func = NULL;
     }
 
   /* Write out the UUID. */
@@ -2073,77 +2391,37 @@ svn_repos_dump_fs4(svn_repos_t *repos,
     notify = svn_repos_notify_create(svn_repos_notify_dump_rev_end,
                                      pool);
 
-  /* Main loop:  we're going to dump revision REV.  */
-  for (rev = start_rev; rev <= end_rev; rev++)
+  if (jobs > 1 && start_rev < end_rev)
     {
-      svn_fs_root_t *to_root;
-      svn_boolean_t use_deltas_for_rev;
-
-      svn_pool_clear(iterpool);
-
-      /* Check for cancellation. */
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Write the revision record. */
-      SVN_ERR(write_revision_record(stream, repos, rev, include_revprops,
-                                    authz_func, &authz_baton, iterpool));
-
-      /* When dumping revision 0, we just write out the revision record.
-         The parser might want to use its properties.
-         If we don't want revision changes at all, skip in any case. */
-      if (rev == 0 || !include_changes)
-        goto loop_end;
-
-      /* Fetch the editor which dumps nodes to a file.  Regardless of
-         what we've been told, don't use deltas for the first rev of a
-         non-incremental dump. */
-      use_deltas_for_rev = use_deltas && (incremental || rev != start_rev);
-      SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, rev,
-                              "", stream, &found_old_reference,
-                              &found_old_mergeinfo, NULL,
-                              notify_func, notify_baton,
-                              start_rev, use_deltas_for_rev, FALSE, FALSE,
-                              iterpool));
-
-      /* Drive the editor in one way or another. */
-      SVN_ERR(svn_fs_revision_root(&to_root, fs, rev, iterpool));
-
-      /* If this is the first revision of a non-incremental dump,
-         we're in for a full tree dump.  Otherwise, we want to simply
-         replay the revision.  */
-      if ((rev == start_rev) && (! incremental))
-        {
-          /* Compare against revision 0, so everything appears to be added. */
-          svn_fs_root_t *from_root;
-          SVN_ERR(svn_fs_revision_root(&from_root, fs, 0, iterpool));
-          SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
-                                       to_root, "",
-                                       dump_editor, dump_edit_baton,
-                                       authz_func, &authz_baton,
-                                       FALSE, /* don't send text-deltas */
-                                       svn_depth_infinity,
-                                       FALSE, /* don't send entry props */
-                                       FALSE, /* don't ignore ancestry */
-                                       iterpool));
-        }
-      else
+      /* Dump revisions in parallel but write them in order. */
+      SVN_ERR(dump_revisions_concurrently(repos, &params, stream, jobs,
+                                          &found_old_reference,
+                                          &found_old_mergeinfo,
+                                          notify_func, notify_baton, notify,
+                                          cancel_func, cancel_baton,
+                                          iterpool));
+    }
+  else
+    {
+      /* Main loop:  we're going to dump revision REV.  */
+      for (rev = start_rev; rev <= end_rev; rev++)
         {
-          /* The normal case: compare consecutive revs. */
-          SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
-                                    dump_editor, dump_edit_baton,
-                                    authz_func, &authz_baton, iterpool));
-
-          /* While our editor close_edit implementation is a no-op, we still
-             do this for completeness. */
-          SVN_ERR(dump_editor->close_edit(dump_edit_baton, iterpool));
-        }
+          svn_pool_clear(iterpool);
 
-    loop_end:
-      if (notify_func)
-        {
-          notify->revision = rev;
-          notify_func(notify_baton, notify, iterpool);
+          /* Check for cancellation. */
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          SVN_ERR(dump_one_revision(repos, rev, &params, stream,
+                                    &found_old_reference,
+                                    &found_old_mergeinfo,
+                                    notify_func, notify_baton, iterpool));
+
+          if (notify_func)
+            {
+              notify->revision = rev;
+              notify_func(notify_baton, notify, iterpool);
+            }
         }
     }
 
@@ -2419,12 +2697,180 @@ report_error(svn_revnum_t revision,
     }
 }
 
+/* Baton type used for verifying revisions concurrently. */
+typedef struct verify_revs_baton_t
+{
+  /* Filesystem path and configuration used to open the FS instances of
+     the worker threads. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* Revisions to verify. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+
+  /* Parameters as passed to svn_repos_verify_fs4(). */
+  svn_boolean_t check_normalization;
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_verify_callback_t verify_callback;
+  void *verify_baton;
+
+  /* Re-used notification object for svn_repos_notify_verify_rev_end. */
+  svn_repos_notify_t *notify;
+} verify_revs_baton_t;
+
+/* Result of verifying a single revision in a worker thread. */
+typedef struct verify_rev_result_t
+{
+  /* Notifications (svn_repos_notify_t *) to send for the revision. */
+  apr_array_header_t *notifications;
+
+  /* Verification failure.  NULL, if the revision is o.k. */
+  svn_error_t *err;
+} verify_rev_result_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Open a private instance of the filesystem given by the
+ * verify_revs_baton_t BATON. */
+static svn_error_t *
+open_fs_instance(void **thread_context,
+                 void *baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t *vb = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_open2(&fs, vb->fs_path, vb->fs_config, result_pool,
+                       scratch_pool));
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Verify the revision given by TASK_INDEX relative to the start revision
+ * in the verify_revs_baton_t PROCESS_BATON using the svn_fs_t given by
+ * THREAD_CONTEXT.  Only cancellation is considered fatal. */
+static svn_error_t *
+verify_rev_task(void **result,
+                void *process_baton,
+                void *thread_context,
+                apr_int64_t task_index,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t *vb = process_baton;
+  verify_rev_result_t *rev_result = apr_pcalloc(result_pool,
+                                                sizeof(*rev_result));
+  svn_error_t *err;
+
+  rev_result->notifications = apr_array_make(result_pool, 0,
+                                             sizeof(svn_repos_notify_t *));
+
+  err = verify_one_revision(thread_context,
+                            vb->start_rev + (svn_revnum_t)task_index,
+                            vb->notify_func ? buffer_notification : NULL,
+                            rev_result->notifications, vb->start_rev,
+                            vb->check_normalization,
+                            cancel_func, cancel_baton, scratch_pool);
+
+  if (err && err->apr_err == SVN_ERR_CANCELLED)
+    return svn_error_trace(err);
+
+  rev_result->err = err;
+  *result = rev_result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Report the verify_rev_result_t RESULT for the revision given by
+ * TASK_INDEX relative to the start revision in the verify_revs_baton_t
+ * OUTPUT_BATON just as svn_repos_verify_fs4() would for a single job. */
+static svn_error_t *
+report_rev_result(void *result,
+                  void *output_baton,
+                  apr_int64_t task_index,
+                  apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t *vb = output_baton;
+  verify_rev_result_t *rev_result = result;
+  svn_revnum_t rev = vb->start_rev + (svn_revnum_t)task_index;
+  int i;
+
+  if (vb->notify_func)
+    for (i = 0; i < rev_result->notifications->nelts; ++i)
+      vb->notify_func(vb->notify_baton,
+                      APR_ARRAY_IDX(rev_result->notifications, i,
+                                    svn_repos_notify_t *),
+                      scratch_pool);
+
+  if (rev_result->err)
+    {
+      SVN_ERR(report_error(rev, rev_result->err, vb->verify_callback,
+                           vb->verify_baton, scratch_pool));
+    }
+  else if (vb->notify_func)
+    {
+      /* Tell the caller that we're done with this revision. */
+      vb->notify->revision = rev;
+      vb->notify_func(vb->notify_baton, vb->notify, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify revisions START_REV to END_REV of FS using up to JOBS threads.
+ * The other parameters are the same as for svn_repos_verify_fs4().
+ * NOTIFY is the notification object to use for
+ * svn_repos_notify_verify_rev_end. */
+static svn_error_t *
+verify_revisions_concurrently(svn_fs_t *fs,
+                              svn_revnum_t start_rev,
+                              svn_revnum_t end_rev,
+                              svn_boolean_t check_normalization,
+                              int jobs,
+                              svn_repos_notify_func_t notify_func,
+                              void *notify_baton,
+                              svn_repos_notify_t *notify,
+                              svn_repos_verify_callback_t verify_callback,
+                              void *verify_baton,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t vb;
+
+  vb.fs_path = svn_fs_path(fs, scratch_pool);
+  vb.fs_config = svn_fs_config(fs, scratch_pool);
+  vb.start_rev = start_rev;
+  vb.end_rev = end_rev;
+  vb.check_normalization = check_normalization;
+  vb.notify_func = notify_func;
+  vb.notify_baton = notify_baton;
+  vb.verify_callback = verify_callback;
+  vb.verify_baton = verify_baton;
+  vb.notify = notify;
+
+  return svn_error_trace(svn_task__run(jobs, end_rev - start_rev + 1,
+                                       open_fs_instance, &vb,
+                                       verify_rev_task, &vb,
+                                       report_rev_result, &vb,
+                                       cancel_func, cancel_baton,
+                                       scratch_pool));
+}
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int jobs,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_repos_verify_callback_t verify_callback,
@@ -2434,10 +2880,11 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                      apr_pool_t *pool)
 {
   svn_fs_t *fs = svn_repos_fs(repos);
+  apr_hash_t *fs_config;
   svn_revnum_t youngest;
   svn_revnum_t rev;
   apr_pool_t *iterpool = svn_pool_create(pool);
-  svn_repos_notify_t *notify;
+  svn_repos_notify_t *notify = NULL;
   svn_fs_progress_notify_func_t verify_notify = NULL;
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
   svn_error_t *err;
@@ -2482,7 +2929,17 @@ svn_repos_verify_fs3(svn_repos_t *repos,
     }
 
   /* Verify global metadata and backend-specific data first. */
-  err = svn_fs_verify(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
+  fs_config = svn_fs_config(fs, pool);
+  if (jobs > 1)
+    {
+      if (!fs_config)
+        fs_config = apr_hash_make(pool);
+
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_PARALLEL_JOBS,
+                    apr_itoa(pool, jobs));
+    }
+
+  err = svn_fs_verify(svn_fs_path(fs, pool), fs_config,
                       start_rev, end_rev,
                       verify_notify, verify_notify_baton,
                       cancel_func, cancel_baton, pool);
@@ -2497,7 +2954,14 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
-  if (!metadata_only)
+  if (!metadata_only && jobs > 1)
+    SVN_ERR(verify_revisions_concurrently(fs, start_rev, end_rev,
+                                          check_normalization, jobs,
+                                          notify_func, notify_baton, notify,
+                                          verify_callback, verify_baton,
+                                          cancel_func, cancel_baton,
+                                          iterpool));
+  else if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
         svn_pool_clear(iterpool);
@@ -883,9 +883,9 @@ apply_textdelta(void *file_baton, const char *base_checksum,
   delta_filestream = svn_stream_from_aprfile2(eb->delta_file, TRUE, pool);
 
   /* Prepare to write the delta to the delta_filestream */
-  svn_txdelta_to_svndiff3(handler, handler_baton,
+  svn_txdelta_to_svndiff4(handler, handler_baton,
                           delta_filestream, 0,
-                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1, pool);
 
   /* Record that there's text to be dumped, and its base checksum. */
   fb->dump_text = TRUE;
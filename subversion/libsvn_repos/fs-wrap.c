@@ -1045,10 +1045,12 @@ svn_repos_fs_pack2(svn_repos_t *repos,
   pnb.notify_func = notify_func;
   pnb.notify_baton = notify_baton;
 
-  return svn_fs_pack(repos->db_path,
-                     notify_func ? pack_notify_func : NULL,
-                     notify_func ? &pnb : NULL,
-                     cancel_func, cancel_baton, pool);
+  /* Pass REPOS' FS config on to allow for e.g. concurrent packing. */
+  return svn_fs_pack2(repos->db_path,
+                      repos->fs ? svn_fs_config(repos->fs, pool) : NULL,
+                      notify_func ? pack_notify_func : NULL,
+                      notify_func ? &pnb : NULL,
+                      cancel_func, cancel_baton, pool);
 }
 
 svn_error_t *
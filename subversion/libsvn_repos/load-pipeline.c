@@ -0,0 +1,1298 @@
+/* load-pipeline.c --- parsing a dumpstream ahead of its consumer.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Loading a dumpstream is a strictly sequential process:  Every
+ * revision must be committed before the next one can be started.  Much
+ * of the work, however, does not depend on the repository at all:
+ * reading and parsing the stream as well as decompressing and decoding
+ * svndiff data.
+ *
+ * This module does all of that ahead of time.  A parser thread records
+ * the parser callbacks in batches, worker threads decode the texts
+ * within those batches and the calling thread finally replays them
+ * against the actual vtable, i.e. commits the revisions.  The amount of
+ * memory held by queued batches is limited; large texts go to temporary
+ * files instead.
+ */
+
+#include <apr_thread_proc.h>
+
+#if APR_HAS_THREADS
+#include <apr_thread_cond.h>
+#endif
+
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_repos.h"
+#include "svn_string.h"
+#include "svn_delta.h"
+#include "svn_sorts.h"
+#include "repos.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+
+
+#if APR_HAS_THREADS
+
+/* Default value for the MEMORY_LIMIT parameter. */
+#define DEFAULT_MEMORY_LIMIT (64 * 1024 * 1024)
+
+/* Lower bound for the size of a batch, i.e. also for texts that we keep
+ * in memory and pre-process. */
+#define MIN_BATCH_SIZE (256 * 1024)
+
+/* Maximum number of records in a single batch.  This keeps the latency
+ * low for streams with many small revisions. */
+#define MAX_BATCH_RECORDS 1024
+
+/* Kinds of parser callbacks that we record. */
+typedef enum record_kind_t
+{
+  op_magic_header,
+  op_uuid,
+  op_new_revision,
+  op_new_node,
+  op_revision_property,
+  op_node_property,
+  op_delete_node_property,
+  op_remove_node_props,
+  op_text,
+  op_close_node,
+  op_close_revision
+} record_kind_t;
+
+/* A single recorded parser callback. */
+typedef struct record_t
+{
+  record_kind_t kind;
+
+  /* Dumpfile format version for op_magic_header. */
+  int version;
+
+  /* UUID or property name. */
+  const char *name;
+
+  /* Property value for op_*_property. */
+  const svn_string_t *value;
+
+  /* Record headers for op_new_revision and op_new_node. */
+  apr_hash_t *headers;
+
+  /* For op_text: Whether the text belongs to a node rather than to
+   * a revision record. */
+  svn_boolean_t for_node;
+
+  /* For op_text: Whether DATA / SPILL are svndiff data. */
+  svn_boolean_t is_delta;
+
+  /* For op_text: The text body.  Small bodies live in DATA,
+   * larger ones are stored in SPILL and not pre-processed. */
+  svn_stringbuf_t *data;
+  svn_spillbuf_t *spill;
+
+  /* For op_text: Windows decoded from DATA, if IS_DELTA is set. */
+  apr_array_header_t *windows;
+
+  /* For op_text: Error found while pre-processing DATA.  It will
+   * only be reported if the consumer wants to receive the text. */
+  svn_error_t *err;
+} record_t;
+
+/* A sequence of records plus the pre-processing state. */
+typedef struct batch_t
+{
+  /* Root pool holding all of this batch. */
+  apr_pool_t *pool;
+
+  /* The record_t * in stream order. */
+  apr_array_header_t *records;
+
+  /* Approximate memory consumption in bytes. */
+  apr_size_t size;
+
+  /* Set once a thread has started pre-processing this batch. */
+  svn_boolean_t claimed;
+
+  /* Set once pre-processing has finished. */
+  svn_boolean_t done;
+
+  /* Next batch in the queue. */
+  struct batch_t *next;
+} batch_t;
+
+/* Batons handed out to the dumpstream parser by the recording vtable. */
+typedef struct record_target_t
+{
+  struct pipeline_t *pipeline;
+  svn_boolean_t is_node;
+} record_target_t;
+
+/* Shared state of the parser, the workers and the committer. */
+typedef struct pipeline_t
+{
+  /* Parameters as passed to svn_repos__parse_dumpstream_pipelined(). */
+  svn_stream_t *stream;
+  const svn_repos_parse_fns3_t *parse_fns;
+  void *parse_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Maximum amount of memory in queued batches. */
+  apr_size_t memory_limit;
+
+  /* A batch gets queued once it reaches this size.  Texts exceeding it
+   * will be buffered in temporary files. */
+  apr_size_t batch_limit;
+
+  /* Parser thread only: batch being filled, the currently open text
+   * record and whether the latest record announced a text delta. */
+  batch_t *current;
+  record_t *text;
+  svn_boolean_t text_delta;
+  record_target_t rev_target;
+  record_target_t node_target;
+
+  /* Committer only: the batons and pools used with PARSE_FNS. */
+  void *rev_baton;
+  void *node_baton;
+  apr_pool_t *pool;
+  apr_pool_t *revpool;
+  apr_pool_t *nodepool;
+  apr_pool_t *iterpool;
+
+  /* Queue of batches to be replayed, oldest first. */
+  batch_t *first;
+  batch_t *last;
+
+  /* Sum of the sizes of all queued batches. */
+  apr_size_t queued_bytes;
+
+  /* Set when the parser thread has queued its last batch, together
+   * with the parser error, if any. */
+  svn_boolean_t parser_done;
+  svn_error_t *parser_err;
+
+  /* Set when the whole operation shall be aborted.  Only modified while
+   * holding MUTEX but may be read at any time. */
+  volatile svn_atomic_t aborted;
+
+  /* Protects the queue and the state flags above. */
+  svn_mutex__t *mutex;
+
+  /* Signaled whenever any of the above changes. */
+  apr_thread_cond_t *cond;
+} pipeline_t;
+
+/* Wait for the next signal on P's condition variable.  The caller must
+ * hold P's mutex. */
+static svn_error_t *
+wait_for_signal(pipeline_t *p)
+{
+  apr_status_t status = apr_thread_cond_wait(p->cond,
+                                             svn_mutex__get(p->mutex));
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't wait for condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Signal all threads waiting on P's condition variable. */
+static svn_error_t *
+signal_all(pipeline_t *p)
+{
+  apr_status_t status = apr_thread_cond_broadcast(p->cond);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't signal condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** The parser thread ***/
+
+/* Append BATCH to P's queue and block while P exceeds its memory limit.
+ * The caller must hold P's mutex. */
+static svn_error_t *
+enqueue_batch(pipeline_t *p,
+              batch_t *batch,
+              svn_boolean_t wait)
+{
+  if (p->last)
+    p->last->next = batch;
+  else
+    p->first = batch;
+
+  p->last = batch;
+  p->queued_bytes += batch->size;
+  SVN_ERR(signal_all(p));
+
+  while (wait && !p->aborted && p->queued_bytes >= p->memory_limit)
+    SVN_ERR(wait_for_signal(p));
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue P's current batch, if any, and wait for memory to become
+ * available if WAIT is set. */
+static svn_error_t *
+queue_current_batch(pipeline_t *p,
+                    svn_boolean_t wait)
+{
+  batch_t *batch = p->current;
+  if (batch == NULL)
+    return SVN_NO_ERROR;
+
+  p->current = NULL;
+  SVN_MUTEX__WITH_LOCK(p->mutex, enqueue_batch(p, batch, wait));
+
+  if (svn_atomic_read(&p->aborted))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a new record of the given KIND in P's current batch. */
+static record_t *
+add_record(pipeline_t *p,
+           record_kind_t kind)
+{
+  record_t *record;
+
+  if (p->current == NULL)
+    {
+      apr_pool_t *pool = svn_pool_create(NULL);
+
+      p->current = apr_pcalloc(pool, sizeof(*p->current));
+      p->current->pool = pool;
+      p->current->records = apr_array_make(pool, 16, sizeof(record_t *));
+    }
+
+  record = apr_pcalloc(p->current->pool, sizeof(*record));
+  record->kind = kind;
+  APR_ARRAY_PUSH(p->current->records, record_t *) = record;
+
+  return record;
+}
+
+/* Account for SIZE bytes added to the latest record in P's current
+ * batch and queue the latter if it is full. */
+static svn_error_t *
+finish_record(pipeline_t *p,
+              apr_size_t size)
+{
+  p->current->size += size + sizeof(record_t);
+
+  if (   p->current->size >= p->batch_limit
+      || p->current->records->nelts >= MAX_BATCH_RECORDS)
+    SVN_ERR(queue_current_batch(p, TRUE));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a copy of HEADERS allocated in RESULT_POOL.  Add the size of
+ * the data to *SIZE. */
+static apr_hash_t *
+copy_headers(apr_hash_t *headers,
+             apr_size_t *size,
+             apr_pool_t *result_pool)
+{
+  apr_hash_t *copy = apr_hash_make(result_pool);
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(result_pool, headers); hi; hi = apr_hash_next(hi))
+    {
+      const char *key = apr_hash_this_key(hi);
+      const char *value = apr_hash_this_val(hi);
+
+      svn_hash_sets(copy, apr_pstrdup(result_pool, key),
+                    apr_pstrdup(result_pool, value));
+      *size += strlen(key) + strlen(value) + 2;
+    }
+
+  return copy;
+}
+
+/* Remember the text-related information from HEADERS in P. */
+static void
+note_text_headers(pipeline_t *p,
+                  apr_hash_t *headers)
+{
+  const char *value = svn_hash_gets(headers, SVN_REPOS_DUMPFILE_TEXT_DELTA);
+  p->text_delta = (value && strcmp(value, "true") == 0);
+}
+
+/* Set *P to the pipeline that BATON, as handed out by the recording
+ * vtable, belongs to.  The serial parser may pass in a NULL revision
+ * baton for records that precede all revision records. */
+static svn_error_t *
+get_pipeline(pipeline_t **p,
+             void *baton)
+{
+  if (baton == NULL)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Dumpstream data found outside of a "
+                              "revision record"));
+
+  *p = ((record_target_t *)baton)->pipeline;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.magic_header_record. */
+static svn_error_t *
+record_magic_header_record(int version,
+                           void *parse_baton,
+                           apr_pool_t *pool)
+{
+  pipeline_t *p = parse_baton;
+  record_t *record = add_record(p, op_magic_header);
+
+  record->version = version;
+
+  return svn_error_trace(finish_record(p, 0));
+}
+
+/* Implements svn_repos_parse_fns3_t.uuid_record. */
+static svn_error_t *
+record_uuid_record(const char *uuid,
+                   void *parse_baton,
+                   apr_pool_t *pool)
+{
+  pipeline_t *p = parse_baton;
+  record_t *record = add_record(p, op_uuid);
+
+  record->name = apr_pstrdup(p->current->pool, uuid);
+
+  return svn_error_trace(finish_record(p, strlen(uuid)));
+}
+
+/* Implements svn_repos_parse_fns3_t.new_revision_record. */
+static svn_error_t *
+record_new_revision_record(void **revision_baton,
+                           apr_hash_t *headers,
+                           void *parse_baton,
+                           apr_pool_t *pool)
+{
+  pipeline_t *p = parse_baton;
+  record_t *record = add_record(p, op_new_revision);
+  apr_size_t size = 0;
+
+  record->headers = copy_headers(headers, &size, p->current->pool);
+  note_text_headers(p, headers);
+  *revision_baton = &p->rev_target;
+
+  return svn_error_trace(finish_record(p, size));
+}
+
+/* Implements svn_repos_parse_fns3_t.new_node_record. */
+static svn_error_t *
+record_new_node_record(void **node_baton,
+                       apr_hash_t *headers,
+                       void *revision_baton,
+                       apr_pool_t *pool)
+{
+  pipeline_t *p;
+  record_t *record;
+  apr_size_t size = 0;
+
+  SVN_ERR(get_pipeline(&p, revision_baton));
+  record = add_record(p, op_new_node);
+
+  record->headers = copy_headers(headers, &size, p->current->pool);
+  note_text_headers(p, headers);
+  *node_baton = &p->node_target;
+
+  return svn_error_trace(finish_record(p, size));
+}
+
+/* Record a property change of the given KIND in the pipeline owning
+ * BATON.  VALUE may be NULL. */
+static svn_error_t *
+record_property(void *baton,
+                record_kind_t kind,
+                const char *name,
+                const svn_string_t *value)
+{
+  pipeline_t *p;
+  record_t *record;
+  apr_size_t size = 0;
+
+  SVN_ERR(get_pipeline(&p, baton));
+  record = add_record(p, kind);
+
+  if (name)
+    {
+      record->name = apr_pstrdup(p->current->pool, name);
+      size += strlen(name);
+    }
+
+  if (value)
+    {
+      record->value = svn_string_dup(value, p->current->pool);
+      size += value->len;
+    }
+
+  return svn_error_trace(finish_record(p, size));
+}
+
+/* Implements svn_repos_parse_fns3_t.set_revision_property. */
+static svn_error_t *
+record_set_revision_property(void *revision_baton,
+                             const char *name,
+                             const svn_string_t *value)
+{
+  return svn_error_trace(record_property(revision_baton,
+                                         op_revision_property,
+                                         name, value));
+}
+
+/* Implements svn_repos_parse_fns3_t.set_node_property. */
+static svn_error_t *
+record_set_node_property(void *node_baton,
+                         const char *name,
+                         const svn_string_t *value)
+{
+  return svn_error_trace(record_property(node_baton, op_node_property,
+                                         name, value));
+}
+
+/* Implements svn_repos_parse_fns3_t.delete_node_property. */
+static svn_error_t *
+record_delete_node_property(void *node_baton,
+                            const char *name)
+{
+  return svn_error_trace(record_property(node_baton,
+                                         op_delete_node_property,
+                                         name, NULL));
+}
+
+/* Implements svn_repos_parse_fns3_t.remove_node_props. */
+static svn_error_t *
+record_remove_node_props(void *node_baton)
+{
+  return svn_error_trace(record_property(node_baton,
+                                         op_remove_node_props,
+                                         NULL, NULL));
+}
+
+/* Implements svn_write_fn_t for the text stream of the recorder.
+ * BATON is the pipeline_t. */
+static svn_error_t *
+text_write(void *baton,
+           const char *data,
+           apr_size_t *len)
+{
+  pipeline_t *p = baton;
+  record_t *record = p->text;
+
+  /* Switch to a spill buffer once the text gets too large. */
+  if (!record->spill && record->data->len + *len > p->batch_limit)
+    {
+      record->spill = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE,
+                                           p->batch_limit,
+                                           p->current->pool);
+      SVN_ERR(svn_spillbuf__write(record->spill, record->data->data,
+                                  record->data->len, p->current->pool));
+      record->data = NULL;
+    }
+
+  if (record->spill)
+    SVN_ERR(svn_spillbuf__write(record->spill, data, *len,
+                                p->current->pool));
+  else
+    svn_stringbuf_appendbytes(record->data, data, *len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for the text stream of the recorder.
+ * BATON is the pipeline_t. */
+static svn_error_t *
+text_close(void *baton)
+{
+  pipeline_t *p = baton;
+  record_t *record = p->text;
+  apr_size_t size = record->spill
+                  ? (apr_size_t)svn_spillbuf__get_memory_size(record->spill)
+                  : record->data->blocksize;
+
+  p->text = NULL;
+
+  return svn_error_trace(finish_record(p, size));
+}
+
+/* Implements svn_repos_parse_fns3_t.set_fulltext.  Note that the parser
+ * sends text deltas here as well. */
+static svn_error_t *
+record_set_fulltext(svn_stream_t **stream,
+                    void *baton)
+{
+  pipeline_t *p;
+  record_t *record;
+
+  SVN_ERR(get_pipeline(&p, baton));
+  record = add_record(p, op_text);
+
+  record->for_node = ((record_target_t *)baton)->is_node;
+  record->is_delta = p->text_delta;
+  record->data = svn_stringbuf_create_empty(p->current->pool);
+
+  p->text = record;
+  *stream = svn_stream_create(p, p->current->pool);
+  svn_stream_set_write(*stream, text_write);
+  svn_stream_set_close(*stream, text_close);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.close_node. */
+static svn_error_t *
+record_close_node(void *node_baton)
+{
+  pipeline_t *p = ((record_target_t *)node_baton)->pipeline;
+  add_record(p, op_close_node);
+
+  return svn_error_trace(finish_record(p, 0));
+}
+
+/* Implements svn_repos_parse_fns3_t.close_revision. */
+static svn_error_t *
+record_close_revision(void *revision_baton)
+{
+  pipeline_t *p = ((record_target_t *)revision_baton)->pipeline;
+  add_record(p, op_close_revision);
+
+  return svn_error_trace(finish_record(p, 0));
+}
+
+/* The recording vtable.  Text deltas are parsed as plain text and
+ * decoded by the workers. */
+static const svn_repos_parse_fns3_t recorder_vtable =
+{
+  record_magic_header_record,
+  record_uuid_record,
+  record_new_revision_record,
+  record_new_node_record,
+  record_set_revision_property,
+  record_set_node_property,
+  record_delete_node_property,
+  record_remove_node_props,
+  record_set_fulltext,
+  NULL,
+  record_close_node,
+  record_close_revision
+};
+
+/* Implements svn_cancel_func_t for the parser thread.  BATON is the
+ * pipeline_t. */
+static svn_error_t *
+parser_cancel_func(void *baton)
+{
+  pipeline_t *p = baton;
+
+  if (svn_atomic_read(&p->aborted))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue P's current batch, if any, and mark the parser as finished with
+ * ERR in one go, such that the committer knows which batch is the last.
+ * The caller must hold P's mutex. */
+static svn_error_t *
+parser_finished(pipeline_t *p,
+                svn_error_t *err)
+{
+  batch_t *batch = p->current;
+
+  p->current = NULL;
+  p->parser_done = TRUE;
+  p->parser_err = err;
+
+  if (batch)
+    SVN_ERR(enqueue_batch(p, batch, FALSE));
+
+  return svn_error_trace(signal_all(p));
+}
+
+/* Mark the parser in P as finished with ERR, acquiring P's mutex. */
+static svn_error_t *
+finish_parser(pipeline_t *p,
+              svn_error_t *err)
+{
+  SVN_MUTEX__WITH_LOCK(p->mutex, parser_finished(p, err));
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function parsing the stream of the pipeline_t given by DATA. */
+static void * APR_THREAD_FUNC
+parser_thread(apr_thread_t *tid,
+              void *data)
+{
+  pipeline_t *p = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_error_t *err;
+
+  err = svn_repos_parse_dumpstream3(p->stream, &recorder_vtable, p, TRUE,
+                                    parser_cancel_func, p, pool);
+
+  /* A text that the parser could not read completely must not reach
+   * the consumer.  It is always the latest record. */
+  if (p->text)
+    {
+      apr_array_pop(p->current->records);
+      p->text = NULL;
+    }
+
+  /* Everything parsed before an error must still be replayed such that
+   * errors get reported at the same point as in a serial load. */
+  /* Synchronization failures can't be reported and will prevent any
+     further progress anyway. */
+  svn_error_clear(finish_parser(p, err));
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+
+/*** Pre-processing ***/
+
+/* Baton for collect_window(). */
+typedef struct collect_baton_t
+{
+  record_t *record;
+  apr_size_t size;
+  apr_pool_t *pool;
+} collect_baton_t;
+
+/* Implements svn_txdelta_window_handler_t, appending copies of all
+ * windows to the record in the collect_baton_t BATON. */
+static svn_error_t *
+collect_window(svn_txdelta_window_t *window,
+               void *baton)
+{
+  collect_baton_t *cb = baton;
+
+  if (window)
+    {
+      APR_ARRAY_PUSH(cb->record->windows, svn_txdelta_window_t *)
+        = svn_txdelta_window_dup(window, cb->pool);
+      cb->size += sizeof(*window)
+                + window->num_ops * sizeof(*window->ops)
+                + (window->new_data ? window->new_data->len : 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Decode the svndiff data in RECORD and store the windows in RECORD.
+ * Allocate them in RESULT_POOL and add their size to *SIZE.  Use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+decode_delta(record_t *record,
+             apr_size_t *size,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  collect_baton_t cb;
+  svn_stream_t *stream;
+  apr_size_t len = record->data->len;
+
+  cb.record = record;
+  cb.size = 0;
+  cb.pool = result_pool;
+  record->windows = apr_array_make(result_pool, 4,
+                                   sizeof(svn_txdelta_window_t *));
+
+  stream = svn_txdelta_parse_svndiff(collect_window, &cb, TRUE,
+                                     scratch_pool);
+  SVN_ERR(svn_stream_write(stream, record->data->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  *size += cb.size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Decode the text deltas in BATCH, unless they were too large to be kept
+ * in memory.  Fulltexts are passed on as they are; the consumer checks
+ * them against their MD5 checksums while storing them anyway.  Add the
+ * memory used by decoded deltas to *SIZE.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static void
+preprocess_batch(batch_t *batch,
+                 apr_size_t *size,
+                 apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < batch->records->nelts; ++i)
+    {
+      record_t *record = APR_ARRAY_IDX(batch->records, i, record_t *);
+      if (record->kind != op_text || !record->is_delta || record->spill)
+        continue;
+
+      svn_pool_clear(iterpool);
+      record->err = decode_delta(record, size, batch->pool, iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+}
+
+/* Set *BATCH to the oldest batch in P not claimed by any thread, yet,
+ * and claim it.  Set *BATCH to NULL if there will be none.  The caller
+ * must hold P's mutex. */
+static svn_error_t *
+claim_batch(batch_t **batch,
+            pipeline_t *p)
+{
+  while (TRUE)
+    {
+      batch_t *candidate;
+
+      *batch = NULL;
+      if (p->aborted)
+        return SVN_NO_ERROR;
+
+      for (candidate = p->first; candidate; candidate = candidate->next)
+        if (!candidate->claimed)
+          {
+            candidate->claimed = TRUE;
+            *batch = candidate;
+            return SVN_NO_ERROR;
+          }
+
+      if (p->parser_done)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(wait_for_signal(p));
+    }
+}
+
+/* Mark BATCH in P as pre-processed, with SIZE bytes of additional memory
+ * used.  The caller must hold P's mutex. */
+static svn_error_t *
+complete_batch(pipeline_t *p,
+               batch_t *batch,
+               apr_size_t size)
+{
+  batch->size += size;
+  p->queued_bytes += size;
+  batch->done = TRUE;
+
+  return svn_error_trace(signal_all(p));
+}
+
+/* Pre-process batches from P until there are none left.  Use POOL for
+ * temporary allocations. */
+static svn_error_t *
+process_batches(pipeline_t *p,
+                apr_pool_t *pool)
+{
+  while (TRUE)
+    {
+      batch_t *batch;
+      apr_size_t size = 0;
+
+      SVN_MUTEX__WITH_LOCK(p->mutex, claim_batch(&batch, p));
+      if (batch == NULL)
+        break;
+
+      preprocess_batch(batch, &size, pool);
+      SVN_MUTEX__WITH_LOCK(p->mutex, complete_batch(p, batch, size));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function pre-processing batches of the pipeline_t given by
+ * DATA. */
+static void * APR_THREAD_FUNC
+worker_thread(apr_thread_t *tid,
+              void *data)
+{
+  pipeline_t *p = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  /* Synchronization failures can't be reported and will prevent any
+     further progress anyway. */
+  svn_error_clear(process_batches(p, pool));
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+
+/*** Replaying the batches ***/
+
+/* Write the body of the text RECORD to STREAM and close the latter.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_text(svn_stream_t *stream,
+           record_t *record,
+           apr_pool_t *scratch_pool)
+{
+  if (record->spill)
+    {
+      while (TRUE)
+        {
+          const char *data;
+          apr_size_t len;
+
+          SVN_ERR(svn_spillbuf__read(&data, &len, record->spill,
+                                     scratch_pool));
+          if (data == NULL)
+            break;
+
+          SVN_ERR(svn_stream_write(stream, data, &len));
+        }
+    }
+  else
+    {
+      apr_size_t len = record->data->len;
+      SVN_ERR(svn_stream_write(stream, record->data->data, &len));
+    }
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Hand the text RECORD to P's vtable. */
+static svn_error_t *
+replay_text(pipeline_t *p,
+            record_t *record)
+{
+  void *baton = record->for_node ? p->node_baton : p->rev_baton;
+  apr_pool_t *pool = record->for_node ? p->nodepool : p->revpool;
+  svn_error_t *err = record->err;
+
+  /* Errors found while pre-processing are only relevant if the text
+   * is actually being used. */
+  record->err = SVN_NO_ERROR;
+
+  if (record->is_delta)
+    {
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+
+      SVN_ERR(svn_error_compose_create(
+                p->parse_fns->apply_textdelta(&handler, &handler_baton,
+                                              baton),
+                err));
+      if (handler == NULL)
+        {
+          svn_error_clear(err);
+        }
+      else if (err)
+        {
+          return svn_error_trace(err);
+        }
+      else if (record->windows)
+        {
+          int i;
+          for (i = 0; i < record->windows->nelts; ++i)
+            SVN_ERR(handler(APR_ARRAY_IDX(record->windows, i,
+                                          svn_txdelta_window_t *),
+                            handler_baton));
+
+          SVN_ERR(handler(NULL, handler_baton));
+        }
+      else
+        {
+          svn_stream_t *stream = svn_txdelta_parse_svndiff(handler,
+                                                           handler_baton,
+                                                           TRUE, pool);
+          SVN_ERR(write_text(stream, record, p->iterpool));
+        }
+    }
+  else
+    {
+      svn_stream_t *stream;
+
+      SVN_ERR(svn_error_compose_create(
+                p->parse_fns->set_fulltext(&stream, baton),
+                err));
+      if (stream == NULL)
+        svn_error_clear(err);
+      else if (err)
+        return svn_error_trace(err);
+      else
+        SVN_ERR(write_text(stream, record, p->iterpool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Invoke the callback in P's vtable that corresponds to RECORD.  The
+ * pools are used the same way svn_repos_parse_dumpstream3() does. */
+static svn_error_t *
+replay_record(pipeline_t *p,
+              record_t *record)
+{
+  const svn_repos_parse_fns3_t *fns = p->parse_fns;
+
+  svn_pool_clear(p->iterpool);
+
+  switch (record->kind)
+    {
+      case op_magic_header:
+        SVN_ERR(fns->magic_header_record(record->version, p->parse_baton,
+                                         p->pool));
+        break;
+
+      case op_uuid:
+        SVN_ERR(fns->uuid_record(record->name, p->parse_baton, p->pool));
+        break;
+
+      case op_new_revision:
+        SVN_ERR(fns->new_revision_record(&p->rev_baton, record->headers,
+                                         p->parse_baton, p->revpool));
+        break;
+
+      case op_new_node:
+        SVN_ERR(fns->new_node_record(&p->node_baton, record->headers,
+                                     p->rev_baton, p->nodepool));
+        break;
+
+      case op_revision_property:
+        SVN_ERR(fns->set_revision_property(p->rev_baton,
+                                  apr_pstrdup(p->revpool, record->name),
+                                  svn_string_dup(record->value, p->revpool)));
+        break;
+
+      case op_node_property:
+        SVN_ERR(fns->set_node_property(p->node_baton,
+                                  apr_pstrdup(p->nodepool, record->name),
+                                  svn_string_dup(record->value, p->nodepool)));
+        break;
+
+      case op_delete_node_property:
+        SVN_ERR(fns->delete_node_property(p->node_baton,
+                                  apr_pstrdup(p->nodepool, record->name)));
+        break;
+
+      case op_remove_node_props:
+        SVN_ERR(fns->remove_node_props(p->node_baton));
+        break;
+
+      case op_text:
+        SVN_ERR(replay_text(p, record));
+        break;
+
+      case op_close_node:
+        SVN_ERR(fns->close_node(p->node_baton));
+        svn_pool_clear(p->nodepool);
+        p->node_baton = NULL;
+        break;
+
+      case op_close_revision:
+        /* The serial parser only closes revisions it has opened. */
+        if (p->rev_baton)
+          SVN_ERR(fns->close_revision(p->rev_baton));
+        svn_pool_clear(p->revpool);
+        p->rev_baton = NULL;
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *BATCH to the oldest batch in P once it has been pre-processed and
+ * remove it from the queue.  If no other thread has started to
+ * pre-process it, claim it and set *PREPROCESS.  Set *LAST if it is the
+ * final batch of a finished parser.  Set *BATCH to NULL if there are no
+ * more batches.  The caller must hold P's mutex. */
+static svn_error_t *
+dequeue_batch(batch_t **batch,
+              svn_boolean_t *preprocess,
+              svn_boolean_t *last,
+              pipeline_t *p)
+{
+  while (   !(p->first && (p->first->done || !p->first->claimed))
+         && !(p->first == NULL && p->parser_done))
+    SVN_ERR(wait_for_signal(p));
+
+  *batch = p->first;
+  *preprocess = FALSE;
+  if (*batch == NULL)
+    return SVN_NO_ERROR;
+
+  if (!(*batch)->claimed)
+    {
+      (*batch)->claimed = TRUE;
+      *preprocess = TRUE;
+    }
+
+  p->first = (*batch)->next;
+  if (p->first == NULL)
+    p->last = NULL;
+
+  *last = p->first == NULL && p->parser_done;
+
+  return SVN_NO_ERROR;
+}
+
+/* Release the memory of the dequeued BATCH in P.  The caller must hold
+ * P's mutex. */
+static svn_error_t *
+release_batch(pipeline_t *p,
+              batch_t *batch)
+{
+  p->queued_bytes -= batch->size;
+
+  return svn_error_trace(signal_all(p));
+}
+
+/* Release the memory of the dequeued BATCH in P, acquiring P's mutex. */
+static svn_error_t *
+finish_batch(pipeline_t *p,
+             batch_t *batch)
+{
+  SVN_MUTEX__WITH_LOCK(p->mutex, release_batch(p, batch));
+
+  return SVN_NO_ERROR;
+}
+
+/* Destroy BATCH including any pending errors. */
+static void
+destroy_batch(batch_t *batch)
+{
+  int i;
+
+  for (i = 0; i < batch->records->nelts; ++i)
+    svn_error_clear(APR_ARRAY_IDX(batch->records, i, record_t *)->err);
+
+  svn_pool_destroy(batch->pool);
+}
+
+/* Replay all batches of P in order until the parser finished or an
+ * error occurred. */
+static svn_error_t *
+replay_batches(pipeline_t *p)
+{
+  svn_error_t *err;
+
+  while (TRUE)
+    {
+      batch_t *batch;
+      svn_boolean_t preprocess;
+      svn_boolean_t last;
+      apr_size_t unused_size = 0;
+      int i;
+
+      SVN_MUTEX__WITH_LOCK(p->mutex, dequeue_batch(&batch, &preprocess,
+                                                   &last, p));
+      if (batch == NULL)
+        break;
+
+      err = SVN_NO_ERROR;
+
+      /* No worker had time for this batch.  Don't wait for them. */
+      if (preprocess)
+        preprocess_batch(batch, &unused_size, p->iterpool);
+
+      for (i = 0; i < batch->records->nelts && !err; ++i)
+        {
+          if (p->cancel_func)
+            err = p->cancel_func(p->cancel_baton);
+
+          if (!err)
+            err = replay_record(p, APR_ARRAY_IDX(batch->records, i,
+                                                 record_t *));
+        }
+
+      /* Always release the memory such that the parser can't get stuck
+       * waiting for it. */
+      err = svn_error_compose_create(err, finish_batch(p, batch));
+      destroy_batch(batch);
+
+      /* Replaying the records that precede a parser error may fail
+       * because they are incomplete, e.g. a node without its text.
+       * The parser's error is the one that matters, then. */
+      if (err && last && p->parser_err)
+        {
+          err = svn_error_compose_create(p->parser_err, err);
+          p->parser_err = SVN_NO_ERROR;
+        }
+
+      SVN_ERR(err);
+    }
+
+  /* Report parser errors after everything that came before them. */
+  err = p->parser_err;
+  p->parser_err = SVN_NO_ERROR;
+
+  return svn_error_trace(err);
+}
+
+/* Tell all threads in P to stop.  The caller must hold P's mutex. */
+static svn_error_t *
+abort_pipeline(pipeline_t *p)
+{
+  svn_atomic_set(&p->aborted, TRUE);
+
+  return svn_error_trace(signal_all(p));
+}
+
+/* Abort all threads in P, acquiring its mutex. */
+static svn_error_t *
+stop_pipeline(pipeline_t *p)
+{
+  SVN_MUTEX__WITH_LOCK(p->mutex, abort_pipeline(p));
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the pipeline P with one parser and WORKER_COUNT worker threads.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_pipeline(pipeline_t *p,
+             int worker_count,
+             apr_pool_t *scratch_pool)
+{
+  apr_thread_t *parser;
+  apr_thread_t **workers;
+  apr_pool_t *thread_pool;
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+  int started = 0;
+  int i;
+
+  SVN_ERR(svn_mutex__init(&p->mutex, TRUE, scratch_pool));
+  status = apr_thread_cond_create(&p->cond, scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  /* The threads allocate from the pool they are created in while we
+   * keep using SCRATCH_POOL.  Give them a root pool of their own that
+   * lives until they have all been joined. */
+  thread_pool = svn_pool_create(NULL);
+  status = apr_thread_create(&parser, NULL, parser_thread, p, thread_pool);
+  if (status)
+    {
+      svn_pool_destroy(thread_pool);
+      return svn_error_wrap_apr(status, _("Can't create thread"));
+    }
+
+  /* If we fail to create some of the workers, the others and the
+   * calling thread will have to do all the pre-processing. */
+  workers = apr_pcalloc(scratch_pool, worker_count * sizeof(*workers));
+  for (i = 0; i < worker_count; ++i)
+    {
+      status = apr_thread_create(&workers[i], NULL, worker_thread, p,
+                                 thread_pool);
+      if (status)
+        break;
+
+      ++started;
+    }
+
+  err = replay_batches(p);
+
+  /* Stop all threads and wait for them to terminate. */
+  err = svn_error_compose_create(err, stop_pipeline(p));
+
+  for (i = -1; i < started; ++i)
+    {
+      apr_status_t retval;
+      status = apr_thread_join(&retval, i < 0 ? parser : workers[i]);
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+    }
+
+  svn_pool_destroy(thread_pool);
+
+  /* Discard everything that did not get replayed. */
+  while (p->first)
+    {
+      batch_t *batch = p->first;
+      p->first = batch->next;
+      destroy_batch(batch);
+    }
+
+  svn_error_clear(p->parser_err);
+
+  return svn_error_trace(err);
+}
+
+#endif
+
+svn_error_t *
+svn_repos__parse_dumpstream_pipelined(svn_stream_t *stream,
+                                      const svn_repos_parse_fns3_t *parse_fns,
+                                      void *parse_baton,
+                                      int jobs,
+                                      apr_size_t memory_limit,
+                                      svn_cancel_func_t cancel_func,
+                                      void *cancel_baton,
+                                      apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  if (jobs > 1)
+    {
+      pipeline_t *p = apr_pcalloc(pool, sizeof(*p));
+      svn_error_t *err;
+
+      p->stream = stream;
+      /* Make sure we can blindly invoke callbacks. */
+      p->parse_fns = svn_repos__complete_parse_fns(parse_fns, pool);
+      p->parse_baton = parse_baton;
+      p->cancel_func = cancel_func;
+      p->cancel_baton = cancel_baton;
+      p->memory_limit = memory_limit ? memory_limit : DEFAULT_MEMORY_LIMIT;
+      p->batch_limit = MAX(p->memory_limit / (4 * jobs), MIN_BATCH_SIZE);
+      p->rev_target.pipeline = p;
+      p->node_target.pipeline = p;
+      p->node_target.is_node = TRUE;
+
+      p->pool = pool;
+      p->revpool = svn_pool_create(pool);
+      p->nodepool = svn_pool_create(pool);
+      p->iterpool = svn_pool_create(pool);
+
+      err = run_pipeline(p, jobs - 1, pool);
+
+      svn_pool_destroy(p->iterpool);
+      svn_pool_destroy(p->nodepool);
+      svn_pool_destroy(p->revpool);
+
+      return svn_error_trace(err);
+    }
+#endif
+
+  return svn_error_trace(svn_repos_parse_dumpstream3(stream, parse_fns,
+                                                     parse_baton, FALSE,
+                                                     cancel_func,
+                                                     cancel_baton, pool));
+}
@@ -490,11 +490,9 @@ dummy_handler_close_revision(void *revision_baton)
 #define SET_VTABLE_ENTRY(dest, source, name) \
   dest->name = provided->name ? provided->name : dummy_handler_##name
 
-/* Return a copy of PROVIDED with all NULL callbacks replaced by a dummy
- * handler.  Allocate the result in RESULT_POOL. */
-static const svn_repos_parse_fns3_t *
-complete_vtable(const svn_repos_parse_fns3_t *provided,
-                apr_pool_t *result_pool)
+const svn_repos_parse_fns3_t *
+svn_repos__complete_parse_fns(const svn_repos_parse_fns3_t *provided,
+                              apr_pool_t *result_pool)
 {
   svn_repos_parse_fns3_t *completed = apr_pcalloc(result_pool,
                                                   sizeof(*completed));
@@ -539,7 +537,7 @@ svn_repos_parse_dumpstream3(svn_stream_t *stream,
   int version;
 
   /* Make sure we can blindly invoke callbacks. */
-  parse_fns = complete_vtable(parse_fns, pool);
+  parse_fns = svn_repos__complete_parse_fns(parse_fns, pool);
 
   /* Start parsing process. */
   SVN_ERR(svn_stream_readline(stream, &linebuf, "\n", &eof, linepool));
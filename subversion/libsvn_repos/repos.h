@@ -387,6 +387,37 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+
+/*** Dumpstream Loading ***/
+
+/* Return a copy of PROVIDED with all NULL callbacks replaced by a dummy
+   handler.  Allocate the result in RESULT_POOL. */
+const svn_repos_parse_fns3_t *
+svn_repos__complete_parse_fns(const svn_repos_parse_fns3_t *provided,
+                              apr_pool_t *result_pool);
+
+/* Like svn_repos_parse_dumpstream3() with DELTAS_ARE_TEXT set to FALSE,
+   but if JOBS is larger than 1, read and parse STREAM in a separate
+   thread and decode text deltas in up to JOBS - 1 worker threads.  All
+   PARSE_FNS callbacks will still be invoked from the calling thread and
+   in stream order.
+
+   Limit the data read ahead of the PARSE_FNS callbacks to roughly
+   MEMORY_LIMIT bytes of memory, using temporary files for larger texts.
+   0 selects a default limit.
+
+   CANCEL_FUNC will only be called from the calling thread.  Use POOL
+   for allocations. */
+svn_error_t *
+svn_repos__parse_dumpstream_pipelined(svn_stream_t *stream,
+                                      const svn_repos_parse_fns3_t *parse_fns,
+                                      void *parse_baton,
+                                      int jobs,
+                                      apr_size_t memory_limit,
+                                      svn_cancel_func_t cancel_func,
+                                      void *cancel_baton,
+                                      apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,1312 @@
+/*
+ * cache-disk.c: persistent, memory-mapped second-level cache
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_md5.h>
+#include <apr_mmap.h>
+
+#ifdef HAVE_POSIX_FALLOCATE
+#include <fcntl.h>
+#endif
+
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+#include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+
+#include "cache.h"
+
+/* A note on the file format and on consistency:
+ *
+ * The cache file consists of three parts: a fixed-size header, an index
+ * of GROUP_COUNT bucket groups and a data area that is used as a ring
+ * buffer.  Records get appended to the ring buffer at the header's
+ * WRITE_POS and older records get overwritten as the write position
+ * wraps around.  WRITE_POS keeps increasing, so a bucket refers to a
+ * valid record only if its POSITION is no more than DATA_SIZE bytes
+ * behind WRITE_POS.
+ *
+ * Each bucket group holds up to BUCKETS_PER_GROUP entries.  When a group
+ * is full, the entry that refers to the oldest record gets replaced.
+ *
+ * The file may be used by several processes at the same time and it may
+ * have been left behind by a process that crashed in the middle of an
+ * update.  We serialize access within a process.  Writers additionally
+ * take an exclusive lock on the file, so records of concurrent writers
+ * in other processes never overlap.  Readers don't lock across processes.
+ * Instead, they copy the record and then verify its size and the MD5
+ * digest over its key and data before using any of it.  A record that
+ * does not pass these checks is treated as a cache miss.
+ *
+ * Other processes may have the file mapped at any time.  Changing its
+ * size would make them crash with SIGBUS, and re-initializing it would
+ * invalidate what they are reading.  So a file is created, completely
+ * allocated and initialized under a temporary name before it gets moved
+ * into place.  Afterwards, it is never resized or re-initialized; a file
+ * that doesn't match the configured size or layout is not used at all.
+ *
+ * Since the file lives in the OS page cache, writes are cheap memory
+ * copies and it is left to the OS to flush them to disk.  Taking the file
+ * lock is not cheap, though.  So new records are collected in a small
+ * per-process buffer first and get written in batches under a single
+ * lock.  Lookups check that buffer before the file.  Whatever is still
+ * buffered when the process ends gets written when the cache's pool is
+ * cleaned up; if the process crashes, it is simply lost.
+ */
+
+/* Identifies the file format.  Exactly 8 bytes, NULs included.
+ */
+#define DISK_CACHE_MAGIC "SVN-L2C\1"
+
+/* Bump this whenever the file layout changes.
+ */
+#define DISK_CACHE_FORMAT 2
+
+/* Number of index entries per bucket group.
+ */
+#define BUCKETS_PER_GROUP 4
+
+/* Records start at multiples of this value.  Must be a power of 2.
+ */
+#define RECORD_ALIGNMENT 8
+
+/* The index gets one bucket per this many bytes in the data area.
+ */
+#define AVERAGE_RECORD_SIZE 0x1000
+
+/* Don't create cache files smaller than this.
+ */
+#define MIN_DISK_CACHE_SIZE APR_UINT64_C(0x100000)
+
+/* Space reserved for the file header.
+ */
+#define HEADER_SIZE 64
+
+/* Size of the per-process buffer for records not written to the file yet.
+ */
+#define WRITE_BUFFER_SIZE 0x10000
+
+/* Maximum number of records in the per-process write buffer.
+ */
+#define WRITE_BUFFER_COUNT 64
+
+/* Align integer VALUE to the next RECORD_ALIGNMENT boundary.
+ */
+#define ALIGN_RECORD(value) \
+  (((value) + RECORD_ALIGNMENT-1) & ~(apr_uint64_t)(RECORD_ALIGNMENT-1))
+
+/* The file header as stored at the start of the cache file.
+ */
+typedef struct disk_header_t
+{
+  /* Must be DISK_CACHE_MAGIC. */
+  char magic[8];
+
+  /* Must be DISK_CACHE_FORMAT. */
+  apr_uint32_t format;
+
+  /* Number of bucket groups in the index. */
+  apr_uint32_t group_count;
+
+  /* Size of the data area in bytes. */
+  apr_uint64_t data_size;
+
+  /* Logical position at which to append the next record.  The physical
+   * offset within the data area is WRITE_POS modulo DATA_SIZE. */
+  apr_uint64_t write_pos;
+} disk_header_t;
+
+/* An index entry.
+ */
+typedef struct disk_bucket_t
+{
+  /* Hash value of the full key.  0 for unused buckets. */
+  apr_uint64_t key_hash;
+
+  /* Logical position of the record (see disk_header_t.WRITE_POS). */
+  apr_uint64_t position;
+
+  /* Size of the record in bytes, header, key and data included. */
+  apr_uint32_t size;
+
+  /* Padding, always 0. */
+  apr_uint32_t unused;
+
+  /* MD5 digest over the record's key and data. */
+  unsigned char digest[APR_MD5_DIGESTSIZE];
+} disk_bucket_t;
+
+/* Header of each record in the data area.  It is followed by the key,
+ * padded to RECORD_ALIGNMENT, and the data.
+ */
+typedef struct disk_record_t
+{
+  /* Same as disk_bucket_t.KEY_HASH. */
+  apr_uint64_t key_hash;
+
+  /* Length of the key in bytes (without padding). */
+  apr_uint32_t key_len;
+
+  /* Length of the data in bytes. */
+  apr_uint32_t data_len;
+} disk_record_t;
+
+/* A record in the per-process write buffer.
+ */
+typedef struct pending_record_t
+{
+  /* Hash value of the key.  0 if the record has been dropped. */
+  apr_uint64_t key_hash;
+
+  /* Position of the key within the write buffer.  It is immediately
+   * followed by the data. */
+  apr_size_t offset;
+
+  /* Length of the key and the data in bytes. */
+  apr_size_t key_len;
+  apr_size_t data_len;
+} pending_record_t;
+
+/* A cache file mapped into memory.
+ */
+struct svn_cache__disk_t
+{
+  /* Path of the cache file. */
+  const char *path;
+
+  /* The open cache file.  Writers lock it. */
+  apr_file_t *file;
+
+  /* The mapped file contents: header, index and data area. */
+  disk_header_t *header;
+  disk_bucket_t *buckets;
+  char *data;
+
+  /* Copies of the respective header fields as of the time we mapped the
+   * file.  Other processes cannot change them without changing the file
+   * size as well, but we never trust the file contents anyway. */
+  apr_uint32_t group_count;
+  apr_uint64_t data_size;
+
+  /* Total size of the file in bytes. */
+  apr_uint64_t size;
+
+  /* Records not written to the file yet.  BUFFER holds WRITE_BUFFER_SIZE
+   * bytes of which BUFFER_USED are in use by the first PENDING_COUNT
+   * entries of PENDING. */
+  char *buffer;
+  apr_size_t buffer_used;
+  pending_record_t pending[WRITE_BUFFER_COUNT];
+  int pending_count;
+
+  /* Serializes access within this process. */
+  svn_mutex__t *mutex;
+};
+
+/* Process-global registry of all cache files opened so far, mapping
+ * their paths to svn_cache__disk_t *.  All access is serialized by
+ * REGISTRY_MUTEX.  Allocated in REGISTRY_POOL.
+ */
+static apr_hash_t *registry = NULL;
+static svn_mutex__t *registry_mutex = NULL;
+static apr_pool_t *registry_pool = NULL;
+
+/* Implements svn_atomic__err_init_func_t.  Set up the registry.
+ */
+static svn_error_t *
+init_registry(void *baton,
+              apr_pool_t *scratch_pool)
+{
+  registry_pool = svn_pool_create(NULL);
+  registry = svn_hash__make(registry_pool);
+  SVN_ERR(svn_mutex__init(&registry_mutex, TRUE, registry_pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_MMAP
+/* Allocate all SIZE bytes of the empty FILE at PATH on disk, such that
+ * writes to its mapping cannot fail for lack of disk space.  The file
+ * contents will be all zeros.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+allocate_file(apr_file_t *file,
+              const char *path,
+              apr_uint64_t size,
+              apr_pool_t *scratch_pool)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+  apr_os_file_t fd;
+  int rv;
+
+  SVN_ERR(svn_error_wrap_apr(apr_os_file_get(&fd, file), NULL));
+  rv = posix_fallocate(fd, 0, (off_t)size);
+  if (rv)
+    return svn_error_wrap_apr(APR_FROM_OS_ERROR(rv),
+                              _("Can't allocate cache file '%s'"),
+                              svn_dirent_local_style(path, scratch_pool));
+#else
+  /* Write zeros rather than truncating the file to SIZE, which could
+   * leave us with a sparse file. */
+  apr_size_t chunk_size = 0x10000;
+  char *zeros = apr_pcalloc(scratch_pool, chunk_size);
+  apr_uint64_t written;
+
+  for (written = 0; written < size; written += chunk_size)
+    SVN_ERR(svn_io_file_write_full(file, zeros,
+                                   (apr_size_t)MIN(chunk_size,
+                                                   size - written),
+                                   NULL, scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Create a new cache file at PATH for the layout given in DISK with a
+ * total size of SIZE bytes.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * If another process creates the same file concurrently, the last one
+ * to finish wins and the others use an orphaned copy until they reopen
+ * the file.
+ */
+static svn_error_t *
+create_cache_file(const char *path,
+                  const svn_cache__disk_t *disk,
+                  apr_uint64_t size,
+                  apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  const char *tmp_path;
+  disk_header_t header = { { 0 } };
+  apr_off_t offset = 0;
+
+  SVN_ERR(svn_io_open_unique_file3(&file, &tmp_path,
+                                   svn_dirent_dirname(path, scratch_pool),
+                                   svn_io_file_del_none,
+                                   scratch_pool, scratch_pool));
+
+  /* The index has to be all zeros, which allocate_file() takes care of. */
+  SVN_ERR(allocate_file(file, tmp_path, size, scratch_pool));
+
+  memcpy(header.magic, DISK_CACHE_MAGIC, sizeof(header.magic));
+  header.format = DISK_CACHE_FORMAT;
+  header.group_count = disk->group_count;
+  header.data_size = disk->data_size;
+  header.write_pos = 0;
+
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, &header, sizeof(header), NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  return svn_error_trace(svn_io_file_rename2(tmp_path, path, FALSE,
+                                             scratch_pool));
+}
+#endif
+
+#if APR_HAS_MMAP
+/* Open and map the cache file for DISK, whose PATH and layout have
+ * already been set, with a total size of SIZE bytes and INDEX_SIZE bytes
+ * for the index.  Create the file if it doesn't exist yet.  If it exists
+ * but doesn't match the expected size or layout, don't touch it and
+ * return an error.  Allocate the file and the mapping in POOL.
+ */
+static svn_error_t *
+map_cache_file(svn_cache__disk_t *disk,
+               apr_uint64_t size,
+               apr_uint64_t index_size,
+               apr_pool_t *pool)
+{
+  const char *path = disk->path;
+  apr_mmap_t *mmap;
+  apr_status_t status;
+  svn_error_t *err;
+  svn_filesize_t file_size;
+  char *base;
+
+  err = svn_io_file_open(&disk->file, path,
+                         APR_READ | APR_WRITE | APR_BINARY,
+                         APR_OS_DEFAULT, pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      SVN_ERR(create_cache_file(path, disk, size, pool));
+      err = svn_io_file_open(&disk->file, path,
+                             APR_READ | APR_WRITE | APR_BINARY,
+                             APR_OS_DEFAULT, pool);
+    }
+  SVN_ERR(err);
+
+  /* Never resize a file that other processes may have mapped. */
+  SVN_ERR(svn_io_file_size_get(&file_size, disk->file, pool));
+  if ((apr_uint64_t)file_size != size)
+    return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                             _("Cache file '%s' has %s bytes instead of "
+                               "%s; remove it to have it recreated"),
+                             svn_dirent_local_style(path, pool),
+                             apr_psprintf(pool, "%" SVN_FILESIZE_T_FMT,
+                                          file_size),
+                             apr_psprintf(pool, "%" APR_UINT64_T_FMT,
+                                          size));
+
+  status = apr_mmap_create(&mmap, disk->file, 0, (apr_size_t)size,
+                           APR_MMAP_READ | APR_MMAP_WRITE, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't map cache file '%s'"),
+                              svn_dirent_local_style(path, pool));
+
+  base = mmap->mm;
+  disk->header = (disk_header_t *)base;
+  disk->buckets = (disk_bucket_t *)(base + HEADER_SIZE);
+  disk->data = base + HEADER_SIZE + index_size;
+
+  /* Never re-initialize a file that other processes may be using. */
+  if (   memcmp(disk->header->magic, DISK_CACHE_MAGIC,
+                sizeof(disk->header->magic))
+      || disk->header->format != DISK_CACHE_FORMAT
+      || disk->header->group_count != disk->group_count
+      || disk->header->data_size != disk->data_size)
+    return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                             _("Cache file '%s' has an unsupported "
+                               "format; remove it to have it recreated"),
+                             svn_dirent_local_style(path, pool));
+
+  return SVN_NO_ERROR;
+}
+#endif
+
+/* Return the file size that we actually use when asked for SIZE bytes.
+ */
+static apr_uint64_t
+effective_size(apr_uint64_t size)
+{
+  /* Make sure that the whole file can be mapped at once. */
+  if (size < MIN_DISK_CACHE_SIZE)
+    size = MIN_DISK_CACHE_SIZE;
+  if (size > APR_SIZE_MAX / 2)
+    size = APR_SIZE_MAX / 2;
+
+  return size;
+}
+
+/* Forward declaration. */
+static apr_status_t
+flush_on_cleanup(void *data);
+
+/* Map the cache file at PATH with a total size of SIZE bytes and return
+ * it in *DISK_P.  See map_cache_file() for details.  Allocate the result
+ * in RESULT_POOL.
+ */
+static svn_error_t *
+disk_cache_create(svn_cache__disk_t **disk_p,
+                  const char *path,
+                  apr_uint64_t size,
+                  apr_pool_t *result_pool)
+{
+#if APR_HAS_MMAP
+  apr_pool_t *pool = svn_pool_create(result_pool);
+  svn_cache__disk_t *disk = apr_pcalloc(pool, sizeof(*disk));
+  svn_error_t *err;
+  apr_uint64_t group_count;
+  apr_uint64_t index_size;
+
+  size = effective_size(size);
+
+  /* Derive the layout from the total file size. */
+  group_count = MAX(1, size / AVERAGE_RECORD_SIZE / BUCKETS_PER_GROUP);
+  group_count = MIN(group_count, APR_UINT32_MAX);
+  index_size = group_count * BUCKETS_PER_GROUP * sizeof(disk_bucket_t);
+
+  disk->path = apr_pstrdup(pool, path);
+  disk->size = size;
+  disk->group_count = (apr_uint32_t)group_count;
+  disk->data_size = (size - HEADER_SIZE - index_size)
+                  & ~(apr_uint64_t)(RECORD_ALIGNMENT-1);
+
+  /* Don't leak file handles and mappings if we can't use the file. */
+  err = map_cache_file(disk, size, index_size, pool);
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  SVN_ERR(svn_mutex__init(&disk->mutex, TRUE, pool));
+  disk->buffer = apr_palloc(pool, WRITE_BUFFER_SIZE);
+
+  /* Registered last, so this runs before the file gets closed. */
+  apr_pool_cleanup_register(pool, disk, flush_on_cleanup,
+                            apr_pool_cleanup_null);
+
+  *disk_p = disk;
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Disk caches require memory-mapped files"));
+#endif
+}
+
+/* Set *DISK_P to the registered cache file at PATH.  Map and register
+ * the file with SIZE bytes if it has not been opened before.  If it has
+ * but with a different size, return an error.  Use SCRATCH_POOL for
+ * temporary allocations.  The caller must hold the REGISTRY_MUTEX.
+ */
+static svn_error_t *
+get_registered(svn_cache__disk_t **disk_p,
+               const char *path,
+               apr_uint64_t size,
+               apr_pool_t *scratch_pool)
+{
+  svn_cache__disk_t *disk = svn_hash_gets(registry, path);
+  if (disk == NULL)
+    {
+      SVN_ERR(disk_cache_create(&disk, path, size, registry_pool));
+      svn_hash_sets(registry, disk->path, disk);
+    }
+  else if (disk->size != effective_size(size))
+    {
+      return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                               _("Cache file '%s' is already in use with "
+                                 "%s bytes instead of %s"),
+                               svn_dirent_local_style(path, scratch_pool),
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_UINT64_T_FMT,
+                                            disk->size),
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_UINT64_T_FMT,
+                                            effective_size(size)));
+    }
+
+  *disk_p = disk;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__disk_open(svn_cache__disk_t **disk_p,
+                     const char *path,
+                     apr_uint64_t size,
+                     apr_pool_t *scratch_pool)
+{
+  static svn_atomic_t initialized = 0;
+
+  SVN_ERR(svn_atomic__init_once(&initialized, init_registry, NULL,
+                                scratch_pool));
+  SVN_MUTEX__WITH_LOCK(registry_mutex, get_registered(disk_p, path, size,
+                                                      scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a non-zero hash value for the LEN bytes in KEY.
+ */
+static apr_uint64_t
+hash_key(const char *key,
+         apr_size_t len)
+{
+  apr_uint64_t result = ((apr_uint64_t)svn__fnv1a_32(key, len) << 32)
+                      | svn__fnv1a_32x4(key, len);
+
+  return result ? result : 1;
+}
+
+/* Return the bucket group for KEY_HASH in DISK.
+ */
+static disk_bucket_t *
+get_group(svn_cache__disk_t *disk,
+          apr_uint64_t key_hash)
+{
+  return disk->buckets
+       + (key_hash % disk->group_count) * BUCKETS_PER_GROUP;
+}
+
+/* Return the MD5 digest over the KEY_LEN bytes of KEY and the SIZE bytes
+ * of DATA in DIGEST.
+ */
+static void
+record_digest(unsigned char digest[APR_MD5_DIGESTSIZE],
+              const char *key,
+              apr_size_t key_len,
+              const void *data,
+              apr_size_t size)
+{
+  apr_md5_ctx_t context;
+
+  apr_md5_init(&context);
+  apr_md5_update(&context, key, key_len);
+  apr_md5_update(&context, data, size);
+  apr_md5_final(digest, &context);
+}
+
+/* Copy the record referenced by the index entry for KEY_HASH in DISK to
+ * *RECORD and its digest to DIGEST.  Set *RECORD to NULL if there is no
+ * valid record.  Allocate the result in RESULT_POOL.  The caller must
+ * hold DISK's mutex.
+ */
+static svn_error_t *
+copy_record(disk_record_t **record,
+            unsigned char digest[APR_MD5_DIGESTSIZE],
+            svn_cache__disk_t *disk,
+            apr_uint64_t key_hash,
+            apr_pool_t *result_pool)
+{
+  disk_bucket_t *group = get_group(disk, key_hash);
+  apr_uint64_t write_pos = disk->header->write_pos;
+  int i;
+
+  *record = NULL;
+  for (i = 0; i < BUCKETS_PER_GROUP; ++i)
+    if (group[i].key_hash == key_hash)
+      {
+        disk_bucket_t bucket = group[i];
+        apr_uint64_t offset = bucket.position % disk->data_size;
+
+        /* Has the record been overwritten since or is the index entry
+         * corrupt? */
+        if (   bucket.position + bucket.size > write_pos
+            || write_pos - bucket.position > disk->data_size
+            || bucket.size < sizeof(disk_record_t)
+            || offset + bucket.size > disk->data_size)
+          return SVN_NO_ERROR;
+
+        *record = apr_palloc(result_pool, bucket.size);
+        memcpy(*record, disk->data + offset, bucket.size);
+        memcpy(digest, bucket.digest, APR_MD5_DIGESTSIZE);
+
+        /* Sanity-check the record header. */
+        if (   (*record)->key_hash != key_hash
+            || sizeof(disk_record_t) + ALIGN_RECORD((*record)->key_len)
+                 + (*record)->data_len != bucket.size)
+          *record = NULL;
+
+        return SVN_NO_ERROR;
+      }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the entry in DISK's write buffer for the KEY_LEN bytes of KEY
+ * with hash value KEY_HASH or NULL if there is none.  The caller must
+ * hold DISK's mutex.
+ */
+static pending_record_t *
+find_pending(svn_cache__disk_t *disk,
+             apr_uint64_t key_hash,
+             const char *key,
+             apr_size_t key_len)
+{
+  int i;
+
+  for (i = 0; i < disk->pending_count; ++i)
+    {
+      pending_record_t *pending = &disk->pending[i];
+      if (   pending->key_hash == key_hash
+          && pending->key_len == key_len
+          && !memcmp(disk->buffer + pending->offset, key, key_len))
+        return pending;
+    }
+
+  return NULL;
+}
+
+/* Copy the data of the entry in DISK's write buffer for the KEY_LEN bytes
+ * of KEY with hash value KEY_HASH to *DATA and *SIZE and set *FOUND.
+ * Allocate the result in RESULT_POOL.  The caller must hold DISK's mutex.
+ */
+static svn_error_t *
+copy_pending(void **data,
+             apr_size_t *size,
+             svn_boolean_t *found,
+             svn_cache__disk_t *disk,
+             apr_uint64_t key_hash,
+             const char *key,
+             apr_size_t key_len,
+             apr_pool_t *result_pool)
+{
+  pending_record_t *pending = find_pending(disk, key_hash, key, key_len);
+
+  *found = pending != NULL;
+  if (pending)
+    {
+      *data = apr_pmemdup(result_pool,
+                          disk->buffer + pending->offset + key_len,
+                          pending->data_len);
+      *size = pending->data_len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Look for the KEY_LEN bytes of KEY in DISK.  If a valid entry is found,
+ * set *FOUND and return its contents in *DATA and *SIZE.  Allocate the
+ * result in RESULT_POOL.
+ */
+static svn_error_t *
+disk_get(void **data,
+         apr_size_t *size,
+         svn_boolean_t *found,
+         svn_cache__disk_t *disk,
+         const char *key,
+         apr_size_t key_len,
+         apr_pool_t *result_pool)
+{
+  apr_uint64_t key_hash = hash_key(key, key_len);
+  disk_record_t *record;
+  unsigned char expected[APR_MD5_DIGESTSIZE];
+  unsigned char actual[APR_MD5_DIGESTSIZE];
+  char *record_key;
+  char *record_data;
+
+  /* Recent records may not have been written to the file yet. */
+  SVN_MUTEX__WITH_LOCK(disk->mutex,
+                       copy_pending(data, size, found, disk, key_hash, key,
+                                    key_len, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(disk->mutex,
+                       copy_record(&record, expected, disk, key_hash,
+                                   result_pool));
+  if (record == NULL || record->key_len != key_len)
+    return SVN_NO_ERROR;
+
+  /* Verify that this is indeed the record that we are looking for and
+   * that nobody modified it while we copied it. */
+  record_key = (char *)(record + 1);
+  record_data = record_key + ALIGN_RECORD(key_len);
+  if (memcmp(record_key, key, key_len))
+    return SVN_NO_ERROR;
+
+  record_digest(actual, record_key, key_len, record_data, record->data_len);
+  if (memcmp(actual, expected, APR_MD5_DIGESTSIZE))
+    return SVN_NO_ERROR;
+
+  *data = record_data;
+  *size = record->data_len;
+  *found = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Take an exclusive lock on DISK's file, serializing writers across
+ * processes.  Locks on files are per process, so the caller must hold
+ * DISK's mutex as well.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+lock_file(svn_cache__disk_t *disk,
+          apr_pool_t *scratch_pool)
+{
+  apr_status_t status = apr_file_lock(disk->file, APR_FLOCK_EXCLUSIVE);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't lock cache file '%s'"),
+                              svn_dirent_local_style(disk->path,
+                                                     scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Release the lock taken by lock_file() on DISK and return ERR.
+ */
+static svn_error_t *
+unlock_file(svn_cache__disk_t *disk,
+            svn_error_t *err)
+{
+  apr_status_t status = apr_file_unlock(disk->file);
+  if (status && !err)
+    err = svn_error_wrap_apr(status, _("Can't unlock cache file"));
+
+  return err;
+}
+
+/* Append a record for KEY of KEY_LEN bytes with SIZE bytes of DATA to
+ * DISK and make the index point to it.  The caller must hold DISK's
+ * mutex and the lock on its file.
+ */
+static svn_error_t *
+write_record(svn_cache__disk_t *disk,
+             const char *key,
+             apr_size_t key_len,
+             const void *data,
+             apr_size_t size)
+{
+  apr_uint64_t key_hash = hash_key(key, key_len);
+  apr_uint64_t record_size = sizeof(disk_record_t) + ALIGN_RECORD(key_len)
+                           + size;
+  apr_uint64_t write_pos = disk->header->write_pos;
+  apr_uint64_t offset;
+  disk_bucket_t *group = get_group(disk, key_hash);
+  disk_bucket_t *target = &group[0];
+  disk_record_t *record;
+  int i;
+
+  /* Don't let a single record take a large chunk of the ring buffer. */
+  if (record_size > disk->data_size / 8)
+    return SVN_NO_ERROR;
+
+  /* Records are never split.  Wrap around if necessary. */
+  write_pos = ALIGN_RECORD(write_pos);
+  offset = write_pos % disk->data_size;
+  if (offset + record_size > disk->data_size)
+    {
+      write_pos += disk->data_size - offset;
+      offset = 0;
+    }
+
+  /* Invalidate the index entries of the records that we are about to
+   * overwrite by moving the write position past them first.  Readers
+   * will then consider them too old.  The file lock makes sure that no
+   * other process is updating the write position at the same time. */
+  disk->header->write_pos = write_pos + ALIGN_RECORD(record_size);
+
+  record = (disk_record_t *)(disk->data + offset);
+  record->key_hash = key_hash;
+  record->key_len = (apr_uint32_t)key_len;
+  record->data_len = (apr_uint32_t)size;
+  memcpy(record + 1, key, key_len);
+  memcpy((char *)(record + 1) + ALIGN_RECORD(key_len), data, size);
+
+  /* Re-use the entry for the same key, an unused one or the one that
+   * refers to the oldest data. */
+  for (i = 0; i < BUCKETS_PER_GROUP; ++i)
+    {
+      if (group[i].key_hash == key_hash || group[i].key_hash == 0)
+        {
+          target = &group[i];
+          break;
+        }
+
+      if (group[i].position < target->position)
+        target = &group[i];
+    }
+
+  target->key_hash = 0;
+  target->position = write_pos;
+  target->size = (apr_uint32_t)record_size;
+  record_digest(target->digest, key, key_len, data, size);
+  target->key_hash = key_hash;
+
+  return SVN_NO_ERROR;
+}
+
+/* Invalidate the entry for KEY of KEY_LEN bytes in DISK, if there is
+ * one.  The caller must hold DISK's mutex and the lock on its file.
+ */
+static svn_error_t *
+remove_record(svn_cache__disk_t *disk,
+              const char *key,
+              apr_size_t key_len)
+{
+  apr_uint64_t key_hash = hash_key(key, key_len);
+  disk_bucket_t *group = get_group(disk, key_hash);
+  int i;
+
+  for (i = 0; i < BUCKETS_PER_GROUP; ++i)
+    if (group[i].key_hash == key_hash)
+      group[i].key_hash = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all records in DISK's write buffer to the file and empty the
+ * buffer.  The caller must hold DISK's mutex and the lock on its file.
+ */
+static svn_error_t *
+write_pending(svn_cache__disk_t *disk)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  for (i = 0; i < disk->pending_count && !err; ++i)
+    {
+      pending_record_t *pending = &disk->pending[i];
+      const char *key = disk->buffer + pending->offset;
+
+      if (pending->key_hash)
+        err = write_record(disk, key, pending->key_len,
+                           key + pending->key_len, pending->data_len);
+    }
+
+  /* Never write the same records twice. */
+  disk->pending_count = 0;
+  disk->buffer_used = 0;
+
+  return svn_error_trace(err);
+}
+
+/* Like write_pending() but take the lock on DISK's file for it.  Use
+ * SCRATCH_POOL for temporary allocations.  The caller must hold DISK's
+ * mutex.
+ */
+static svn_error_t *
+flush_pending(svn_cache__disk_t *disk,
+              apr_pool_t *scratch_pool)
+{
+  if (disk->pending_count == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(lock_file(disk, scratch_pool));
+  return svn_error_trace(unlock_file(disk, write_pending(disk)));
+}
+
+/* Implements apr_pool_cleanup_t for svn_cache__disk_t DATA.  Write what
+ * is left in its write buffer.  Other threads cannot use the cache
+ * anymore at this point, so we don't need to take its mutex.
+ */
+static apr_status_t
+flush_on_cleanup(void *data)
+{
+  svn_cache__disk_t *disk = data;
+
+  if (   disk->pending_count
+      && apr_file_lock(disk->file, APR_FLOCK_EXCLUSIVE) == APR_SUCCESS)
+    svn_error_clear(unlock_file(disk, write_pending(disk)));
+
+  return APR_SUCCESS;
+}
+
+/* Add a record for KEY of KEY_LEN bytes with SIZE bytes of DATA to DISK.
+ * It will get written to the file when the write buffer is full.  Use
+ * SCRATCH_POOL for temporary allocations.  The caller must hold DISK's
+ * mutex.
+ */
+static svn_error_t *
+queue_record(svn_cache__disk_t *disk,
+             const char *key,
+             apr_size_t key_len,
+             const void *data,
+             apr_size_t size,
+             apr_pool_t *scratch_pool)
+{
+  apr_uint64_t key_hash = hash_key(key, key_len);
+  pending_record_t *pending = find_pending(disk, key_hash, key, key_len);
+
+  /* write_record() would not store it anyway. */
+  if (  sizeof(disk_record_t) + ALIGN_RECORD(key_len) + (apr_uint64_t)size
+      > disk->data_size / 8)
+    return SVN_NO_ERROR;
+
+  /* Newer data replaces older data. */
+  if (pending)
+    pending->key_hash = 0;
+
+  if (   disk->pending_count == WRITE_BUFFER_COUNT
+      || key_len + size > WRITE_BUFFER_SIZE - disk->buffer_used)
+    SVN_ERR(flush_pending(disk, scratch_pool));
+
+  /* Large records bypass the buffer. */
+  if (key_len + size > WRITE_BUFFER_SIZE)
+    {
+      SVN_ERR(lock_file(disk, scratch_pool));
+      return svn_error_trace(unlock_file(disk, write_record(disk, key,
+                                                            key_len, data,
+                                                            size)));
+    }
+
+  pending = &disk->pending[disk->pending_count++];
+  pending->key_hash = key_hash;
+  pending->offset = disk->buffer_used;
+  pending->key_len = key_len;
+  pending->data_len = size;
+  memcpy(disk->buffer + disk->buffer_used, key, key_len);
+  memcpy(disk->buffer + disk->buffer_used + key_len, data, size);
+  disk->buffer_used += key_len + size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Like remove_record() but take the lock on DISK's file for it and drop
+ * the record from the write buffer as well.  Use SCRATCH_POOL for
+ * temporary allocations.  The caller must hold DISK's mutex.
+ */
+static svn_error_t *
+locked_remove_record(svn_cache__disk_t *disk,
+                     const char *key,
+                     apr_size_t key_len,
+                     apr_pool_t *scratch_pool)
+{
+  pending_record_t *pending = find_pending(disk, hash_key(key, key_len),
+                                           key, key_len);
+  if (pending)
+    pending->key_hash = 0;
+
+  SVN_ERR(lock_file(disk, scratch_pool));
+  return svn_error_trace(unlock_file(disk, remove_record(disk, key,
+                                                         key_len)));
+}
+
+
+/* The svn_cache__t implementation that puts a svn_cache__disk_t behind
+ * some other cache. */
+typedef struct disk_tier_t
+{
+  /* The first-level cache.  Never NULL. */
+  svn_cache__t *l1;
+
+  /* The second-level cache file.  Never NULL. */
+  svn_cache__disk_t *disk;
+
+  /* Prefix to make our keys unique within DISK. */
+  svn_string_t *prefix;
+
+  /* The size of the key: either a fixed number of bytes or
+   * APR_HASH_KEY_STRING. */
+  apr_ssize_t klen;
+
+  /* Used to marshal values in and out of DISK. */
+  svn_cache__serialize_func_t serialize_func;
+  svn_cache__deserialize_func_t deserialize_func;
+} disk_tier_t;
+
+/* Return the full key for KEY in CACHE, i.e. KEY with CACHE's prefix,
+ * in *FULL_KEY and its length in *FULL_LEN.  Allocate it in POOL.
+ */
+static void
+combine_key(const char **full_key,
+            apr_size_t *full_len,
+            disk_tier_t *cache,
+            const void *key,
+            apr_pool_t *pool)
+{
+  apr_size_t key_len = cache->klen == APR_HASH_KEY_STRING
+                     ? strlen(key)
+                     : (apr_size_t)cache->klen;
+  char *result = apr_palloc(pool, cache->prefix->len + key_len);
+
+  memcpy(result, cache->prefix->data, cache->prefix->len);
+  memcpy(result + cache->prefix->len, key, key_len);
+
+  *full_key = result;
+  *full_len = cache->prefix->len + key_len;
+}
+
+/* Look up KEY in CACHE's second-level cache only.  If found, set *FOUND
+ * and return the serialized data in *DATA and *SIZE.  Allocate it in
+ * RESULT_POOL.
+ */
+static svn_error_t *
+disk_tier_get_serialized(void **data,
+                         apr_size_t *size,
+                         svn_boolean_t *found,
+                         disk_tier_t *cache,
+                         const void *key,
+                         apr_pool_t *result_pool)
+{
+  const char *full_key;
+  apr_size_t full_len;
+
+  combine_key(&full_key, &full_len, cache, key, result_pool);
+  return svn_error_trace(disk_get(data, size, found, cache->disk,
+                                  full_key, full_len, result_pool));
+}
+
+/* Deserialize SIZE bytes of DATA taken from CACHE into *VALUE, allocated
+ * in RESULT_POOL.  This may modify DATA.
+ */
+static svn_error_t *
+disk_tier_deserialize(void **value,
+                      disk_tier_t *cache,
+                      void *data,
+                      apr_size_t size,
+                      apr_pool_t *result_pool)
+{
+  if (cache->deserialize_func)
+    return svn_error_trace(cache->deserialize_func(value, data, size,
+                                                   result_pool));
+
+  /* Default: the data is a svn_stringbuf_t incl. terminating NUL. */
+  {
+    svn_stringbuf_t *value_str = apr_palloc(result_pool,
+                                            sizeof(*value_str));
+    value_str->pool = result_pool;
+    value_str->data = data;
+    value_str->blocksize = size;
+    value_str->len = size - 1;
+    *value = value_str;
+  }
+
+  return SVN_NO_ERROR;
+}
+
+/* Store KEY and the serialized form of VALUE in CACHE's second-level
+ * cache.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+disk_tier_set_serialized(disk_tier_t *cache,
+                         const void *key,
+                         void *value,
+                         apr_pool_t *scratch_pool)
+{
+  const char *full_key;
+  apr_size_t full_len;
+  void *data;
+  apr_size_t size;
+
+  if (cache->serialize_func)
+    {
+      SVN_ERR(cache->serialize_func(&data, &size, value, scratch_pool));
+    }
+  else
+    {
+      svn_stringbuf_t *value_str = value;
+      data = value_str->data;
+      size = value_str->len + 1;
+    }
+
+  combine_key(&full_key, &full_len, cache, key, scratch_pool);
+  SVN_MUTEX__WITH_LOCK(cache->disk->mutex,
+                       queue_record(cache->disk, full_key, full_len,
+                                    data, size, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__vtable_t.get.
+ */
+static svn_error_t *
+disk_tier_get(void **value_p,
+              svn_boolean_t *found,
+              void *cache_void,
+              const void *key,
+              apr_pool_t *result_pool)
+{
+  disk_tier_t *cache = cache_void;
+  void *data;
+  apr_size_t size;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->l1, key, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(disk_tier_get_serialized(&data, &size, found, cache, key,
+                                   result_pool));
+  if (*found)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(result_pool);
+
+      /* Promote the item to the first-level cache. */
+      SVN_ERR(disk_tier_deserialize(value_p, cache, data, size,
+                                    result_pool));
+      SVN_ERR(svn_cache__set(cache->l1, key, *value_p, scratch_pool));
+
+      svn_pool_destroy(scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__vtable_t.has_key.
+ */
+static svn_error_t *
+disk_tier_has_key(svn_boolean_t *found,
+                  void *cache_void,
+                  const void *key,
+                  apr_pool_t *scratch_pool)
+{
+  disk_tier_t *cache = cache_void;
+  void *data;
+  apr_size_t size;
+
+  SVN_ERR(svn_cache__has_key(found, cache->l1, key, scratch_pool));
+  if (!*found)
+    SVN_ERR(disk_tier_get_serialized(&data, &size, found, cache, key,
+                                     scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__vtable_t.set.
+ */
+static svn_error_t *
+disk_tier_set(void *cache_void,
+              const void *key,
+              void *value,
+              apr_pool_t *scratch_pool)
+{
+  disk_tier_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set(cache->l1, key, value, scratch_pool));
+
+  /* Write through to the disk.  The membuffer cache does not tell us
+   * what it evicts, so this is our only chance to get the data. */
+  if (value)
+    {
+      apr_pool_t *subpool = svn_pool_create(scratch_pool);
+      SVN_ERR(disk_tier_set_serialized(cache, key, value, subpool));
+      svn_pool_destroy(subpool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__vtable_t.iter.
+ */
+static svn_error_t *
+disk_tier_iter(svn_boolean_t *completed,
+               void *cache_void,
+               svn_iter_apr_hash_cb_t user_cb,
+               void *user_baton,
+               apr_pool_t *scratch_pool)
+{
+  disk_tier_t *cache = cache_void;
+  return svn_error_trace(svn_cache__iter(completed, cache->l1, user_cb,
+                                         user_baton, scratch_pool));
+}
+
+/* Implements svn_cache__vtable_t.is_cachable.
+ */
+static svn_boolean_t
+disk_tier_is_cachable(void *cache_void,
+                      apr_size_t size)
+{
+  disk_tier_t *cache = cache_void;
+  return svn_cache__is_cachable(cache->l1, size);
+}
+
+/* Implements svn_cache__vtable_t.get_partial.
+ */
+static svn_error_t *
+disk_tier_get_partial(void **value_p,
+                      svn_boolean_t *found,
+                      void *cache_void,
+                      const void *key,
+                      svn_cache__partial_getter_func_t func,
+                      void *baton,
+                      apr_pool_t *result_pool)
+{
+  disk_tier_t *cache = cache_void;
+  void *data;
+  apr_size_t size;
+
+  SVN_ERR(svn_cache__get_partial(value_p, found, cache->l1, key, func,
+                                 baton, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(disk_tier_get_serialized(&data, &size, found, cache, key,
+                                   result_pool));
+  if (*found)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(result_pool);
+      void *item;
+
+      /* Promote a private copy of the item to the first-level cache.
+       * Deserialization modifies the data, which FUNC shall not see. */
+      SVN_ERR(disk_tier_deserialize(&item, cache,
+                                    apr_pmemdup(scratch_pool, data, size),
+                                    size, scratch_pool));
+      SVN_ERR(svn_cache__set(cache->l1, key, item, scratch_pool));
+      svn_pool_destroy(scratch_pool);
+
+      SVN_ERR(func(value_p, data, size, baton, result_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__vtable_t.set_partial.
+ */
+static svn_error_t *
+disk_tier_set_partial(void *cache_void,
+                      const void *key,
+                      svn_cache__partial_setter_func_t func,
+                      void *baton,
+                      apr_pool_t *scratch_pool)
+{
+  disk_tier_t *cache = cache_void;
+  const char *full_key;
+  apr_size_t full_len;
+
+  SVN_ERR(svn_cache__set_partial(cache->l1, key, func, baton,
+                                 scratch_pool));
+
+  /* The copy on disk is outdated now. */
+  combine_key(&full_key, &full_len, cache, key, scratch_pool);
+  SVN_MUTEX__WITH_LOCK(cache->disk->mutex,
+                       locked_remove_record(cache->disk, full_key, full_len,
+                                            scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__vtable_t.get_info.
+ */
+static svn_error_t *
+disk_tier_get_info(void *cache_void,
+                   svn_cache__info_t *info,
+                   svn_boolean_t reset,
+                   apr_pool_t *result_pool)
+{
+  disk_tier_t *cache = cache_void;
+  return svn_error_trace(svn_cache__get_info(cache->l1, info, reset,
+                                             result_pool));
+}
+
+static svn_cache__vtable_t disk_tier_vtable = {
+  disk_tier_get,
+  disk_tier_has_key,
+  disk_tier_set,
+  disk_tier_iter,
+  disk_tier_is_cachable,
+  disk_tier_get_partial,
+  disk_tier_set_partial,
+  disk_tier_get_info
+};
+
+svn_error_t *
+svn_cache__create_disk_tier(svn_cache__t **cache_p,
+                            svn_cache__t *l1,
+                            svn_cache__disk_t *disk,
+                            svn_cache__serialize_func_t serialize_func,
+                            svn_cache__deserialize_func_t deserialize_func,
+                            apr_ssize_t klen,
+                            const char *prefix,
+                            apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  disk_tier_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->l1 = l1;
+  cache->disk = disk;
+  cache->klen = klen;
+  cache->serialize_func = serialize_func;
+  cache->deserialize_func = deserialize_func;
+
+  /* Include the terminating NUL to separate prefix and key. */
+  cache->prefix = svn_string_ncreate(prefix, strlen(prefix) + 1,
+                                     result_pool);
+
+  wrapper->vtable = &disk_tier_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
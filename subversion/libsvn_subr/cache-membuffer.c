@@ -24,6 +24,12 @@
 #include <assert.h>
 #include <apr_md5.h>
 #include <apr_thread_rwlock.h>
+#include <apr_proc_mutex.h>
+#include <apr_shm.h>
+
+#if APR_HAVE_UNISTD_H
+#include <unistd.h>       /* for getpid() */
+#endif
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
@@ -129,6 +135,15 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Lookups are by far the most frequent operation, though.  Where supported
+ * (see USE_OPTIMISTIC_READS), readers don't take the segment lock at all.
+ * Instead, every writer bumps the segment's WRITE_SEQUENCE number before
+ * and after modifying it, i.e. the number is odd while a modification is
+ * in progress.  A reader remembers the sequence number, copies the data
+ * it is interested in and then checks that the number did not change.  If
+ * it did, the copy may be inconsistent and the reader falls back to the
+ * lock-based code path.  Hit counters are updated atomically in any case.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +161,65 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Lock-free, optimistic reads (see above) require a read memory barrier,
+ * which we only know how to do portably with GCC-compatible compilers.
+ * Since they replace the r/w lock for the reader, don't use them with
+ * simple mutexes, either.  SVN_DEBUG_CACHE_MEMBUFFER wants to verify
+ * entries under the lock, so disable optimistic reads in that case, too.
+ */
+#if (   APR_HAS_THREADS && !USE_SIMPLE_MUTEX && defined(__GNUC__) \
+     && !defined(SVN_DEBUG_CACHE_MEMBUFFER))
+#  define USE_OPTIMISTIC_READS 1
+#  define READ_BARRIER() __sync_synchronize()
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Caches shared between processes live in anonymous shared memory that
+ * is inherited by forked child processes.  They need a process-shared lock
+ * that works when its memory gets mapped into several processes.  Only
+ * enable sharing where APR provides such a lock mechanism.
+ */
+#if APR_HAS_SHARED_MEMORY && APR_HAS_FORK
+#  if APR_HAS_PROC_PTHREAD_SERIALIZE
+#    define SHARED_CACHE_LOCK_MECH APR_LOCK_PROC_PTHREAD
+#  elif APR_HAS_SYSVSEM_SERIALIZE
+#    define SHARED_CACHE_LOCK_MECH APR_LOCK_SYSVSEM
+#  endif
+#endif
+
+#ifdef SHARED_CACHE_LOCK_MECH
+/* Baton for proc_lock_cleanup().
+ */
+typedef struct proc_lock_owner_t
+{
+  /* The process-shared lock of a cache segment. */
+  apr_proc_mutex_t *lock;
+
+  /* The process that created LOCK. */
+  pid_t pid;
+} proc_lock_owner_t;
+
+/* Pool cleanup function that destroys the lock in the proc_lock_owner_t
+ * BATON, but only in the process that created it.
+ *
+ * Forked children inherit the cache pool together with its cleanups and
+ * run them when they exit.  Destroying the lock there would remove the
+ * SysV semaphore or drop the last reference to the pthread mutex for the
+ * parent and all other children still using the cache.
+ */
+static apr_status_t
+proc_lock_cleanup(void *baton)
+{
+  proc_lock_owner_t *owner = baton;
+
+  if (owner->pid != getpid())
+    return APR_SUCCESS;
+
+  return apr_proc_mutex_cleanup(owner->lock);
+}
+#endif
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -197,6 +271,13 @@
  */
 #define MAX_ITEM_SIZE ((apr_uint32_t)(0 - ITEM_ALIGNMENT))
 
+/* Partial getters may only be called for consistent data.  Lock-free
+ * lookups must therefore copy the item to a stack buffer first, which
+ * is only feasible for smallish items.  Larger ones will be read under
+ * the segment lock.  Must be a multiple of 8.
+ */
+#define OPTIMISTIC_PARTIAL_READ_SIZE 0x1000
+
 /* We use this structure to identify cache entries. There cannot be two
  * entries with the same entry key. However unlikely, though, two different
  * full keys (see full_key_t) may have the same entry key.  That is a
@@ -701,6 +782,13 @@ struct svn_membuffer_t
      and that all segments must / will report the same values here. */
   apr_uint32_t segment_count;
 
+  /* Incremented by writers right after acquiring and right before
+   * releasing the write lock.  Thus, it is odd while the segment is
+   * being modified.  Optimistic readers use it to detect concurrent
+   * modifications.  Only used if USE_OPTIMISTIC_READS is set.
+   */
+  svn_atomic_t write_sequence;
+
   /* Collection of prefixes shared among all instances accessing the
    * same membuffer cache backend.  If a prefix is contained in this
    * pool then all cache instances using an equal prefix must actually
@@ -805,13 +893,25 @@ struct svn_membuffer_t
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   /* Same for read-write lock. */
   apr_thread_rwlock_t *lock;
+#endif
+
+  /* A lock for inter-process synchronization if this segment lives in
+   * shared memory, NULL otherwise.  If set, it takes precedence over
+   * LOCK and serializes readers as well as writers.
+   */
+  apr_proc_mutex_t *proc_lock;
+
+  /* Set while some process holds PROC_LOCK.  If we find it set after
+   * acquiring the lock, the previous holder died in the middle of an
+   * operation and may have left the segment inconsistent.
+   */
+  svn_boolean_t proc_lock_held;
 
   /* If set, write access will wait until they get exclusive access.
    * Otherwise, they will become no-ops if the segment is currently
-   * read-locked.  Only used when LOCK is an r/w lock.
+   * locked.  Only used when LOCK is an r/w lock or with PROC_LOCK.
    */
   svn_boolean_t allow_blocking_writes;
-#endif
 
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
@@ -823,11 +923,109 @@ struct svn_membuffer_t
  */
 #define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
 
+/* Tell optimistic readers of CACHE that we are about to modify it.
+ * The caller must hold the write lock.
+ */
+static APR_INLINE void
+begin_write(svn_membuffer_t *cache)
+{
+#if USE_OPTIMISTIC_READS
+  svn_atomic_inc(&cache->write_sequence);
+#endif
+}
+
+/* Tell optimistic readers of CACHE that we are done modifying it.
+ * The caller must still hold the write lock.
+ */
+static APR_INLINE void
+end_write(svn_membuffer_t *cache)
+{
+#if USE_OPTIMISTIC_READS
+  svn_atomic_inc(&cache->write_sequence);
+#endif
+}
+
+/* Remove all entries from the cache segment SEGMENT.  The caller must
+ * hold the write lock.
+ */
+static void
+reset_segment(svn_membuffer_t *segment)
+{
+  /* Length of the group_initialized array in bytes.
+     See also svn_cache__membuffer_cache_create(). */
+  apr_size_t group_init_size
+    = 1 + (segment->group_count + segment->spare_group_count)
+            / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Mark all groups as "not initialized", which implies "empty". */
+  segment->first_spare_group = NO_INDEX;
+  segment->max_spare_used = 0;
+
+  memset(segment->group_initialized, 0, group_init_size);
+
+  /* Unlink L1 contents. */
+  segment->l1.first = NO_INDEX;
+  segment->l1.last = NO_INDEX;
+  segment->l1.next = NO_INDEX;
+  segment->l1.current_data = segment->l1.start_offset;
+
+  /* Unlink L2 contents. */
+  segment->l2.first = NO_INDEX;
+  segment->l2.last = NO_INDEX;
+  segment->l2.next = NO_INDEX;
+  segment->l2.current_data = segment->l2.start_offset;
+
+  /* Reset content counters. */
+  segment->data_used = 0;
+  segment->used_entries = 0;
+}
+
+/* Acquire the inter-process lock of the shared CACHE.  If SUCCESS is not
+ * NULL, don't wait for the lock but set *SUCCESS to FALSE if it is busy.
+ */
+static svn_error_t *
+proc_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
+{
+  apr_status_t status;
+  if (success)
+    {
+      status = apr_proc_mutex_trylock(cache->proc_lock);
+      if (SVN_LOCK_IS_BUSY(status))
+        {
+          *success = FALSE;
+          status = APR_SUCCESS;
+        }
+    }
+  else
+    {
+      status = apr_proc_mutex_lock(cache->proc_lock);
+    }
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't lock shared cache mutex"));
+
+  /* APR recovers the lock of a process that died while holding it, but
+     we can't tell which parts of the segment it had already modified.
+     Start over with an empty segment. */
+  if (!success || *success)
+    {
+      if (cache->proc_lock_held)
+        reset_segment(cache);
+
+      cache->proc_lock_held = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->proc_lock)
+    return svn_error_trace(proc_lock_cache(cache, NULL));
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +1049,17 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+  if (cache->proc_lock)
+    {
+      SVN_ERR(proc_lock_cache(cache, cache->allow_blocking_writes
+                                     ? NULL
+                                     : success));
+      if (*success)
+        begin_write(cache);
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -876,6 +1085,9 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
                                   _("Can't write-lock cache mutex"));
     }
 
+  if (*success)
+    begin_write(cache);
+
   return SVN_NO_ERROR;
 #else
   return SVN_NO_ERROR;
@@ -888,14 +1100,24 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->proc_lock)
+    {
+      SVN_ERR(proc_lock_cache(cache, NULL));
+      begin_write(cache);
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
-  if (status)
-    return svn_error_wrap_apr(status,
-                              _("Can't write-lock cache mutex"));
+  {
+    apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't write-lock cache mutex"));
+  }
 
+  begin_write(cache);
   return SVN_NO_ERROR;
 #else
   return SVN_NO_ERROR;
@@ -908,6 +1130,22 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+  if (cache->proc_lock)
+    {
+      apr_status_t status;
+
+      cache->proc_lock_held = FALSE;
+      status = apr_proc_mutex_unlock(cache->proc_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't unlock shared cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1165,16 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Release the write lock on CACHE acquired through write_lock_cache or
+ * force_write_lock_cache.  Return ERR upon success.
+ */
+static svn_error_t *
+write_unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
+{
+  end_write(cache);
+  return unlock_cache(cache, err);
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -959,7 +1207,7 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  SVN_ERR(write_unlock_cache(cache, (expr)));                   \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1550,6 +1798,104 @@ find_entry(svn_membuffer_t *cache,
   return entry;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Begin an optimistic, lock-free read from CACHE and return the current
+ * write sequence number in *SEQUENCE.  Return FALSE, if a writer is
+ * currently modifying CACHE.  In that case, the caller should fall back
+ * to the lock-based code path.
+ */
+static APR_INLINE svn_boolean_t
+optimistic_read_begin(svn_membuffer_t *cache,
+                      apr_uint32_t *sequence)
+{
+  *sequence = svn_atomic_read(&cache->write_sequence);
+  READ_BARRIER();
+
+  return (*sequence & 1) == 0;
+}
+
+/* Return TRUE, if CACHE has not been modified since optimistic_read_begin
+ * returned SEQUENCE, i.e. if all data read in the meantime is consistent.
+ */
+static APR_INLINE svn_boolean_t
+optimistic_read_end(svn_membuffer_t *cache,
+                    apr_uint32_t sequence)
+{
+  READ_BARRIER();
+  return svn_atomic_read(&cache->write_sequence) == sequence;
+}
+
+/* Lock-free variant of find_entry with FIND_EMPTY being FALSE.  If an
+ * entry matching TO_FIND could be found in group GROUP_INDEX of CACHE,
+ * copy it to *SNAPSHOT and return a pointer to the original entry.
+ * Return NULL otherwise.
+ *
+ * Writers may modify CACHE at any time.  Therefore, all indexes and
+ * offsets read from the directory get checked before being used and the
+ * caller must only use the contents of *SNAPSHOT.  The result is only
+ * valid if optimistic_read_end succeeds afterwards.
+ */
+static entry_t *
+find_entry_optimistic(svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find,
+                      entry_t *snapshot)
+{
+  apr_uint64_t data_size = cache->l2.start_offset + cache->l2.size;
+  apr_uint32_t group_limit = cache->group_count + cache->spare_group_count;
+  apr_uint32_t chain_length = 1;
+  entry_group_t *group = &cache->directory[group_index];
+
+  /* If the entry group has not been initialized, yet, there is no data.
+   */
+  if (! is_group_initialized(cache, group_index))
+    return NULL;
+
+  while (1)
+    {
+      apr_uint32_t used = group->header.used;
+      apr_uint32_t next;
+      apr_size_t i;
+
+      for (i = 0; i < used && i < GROUP_SIZE; ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            /* The entry may change while we copy it.  Verify the copy. */
+            *snapshot = group->entries[i];
+            if (!entry_keys_match(&snapshot->key, &to_find->entry_key))
+              return NULL;
+
+            /* Never access memory outside the data buffer. */
+            if (   snapshot->size > cache->max_entry_size
+                || snapshot->offset > data_size
+                || ALIGN_VALUE(snapshot->size) > data_size - snapshot->offset
+                || snapshot->key.key_len > snapshot->size)
+              return NULL;
+
+            /* Compare the full key, if necessary. */
+            if (   snapshot->key.key_len
+                && memcmp(to_find->full_key.data,
+                          cache->data + snapshot->offset,
+                          snapshot->key.key_len))
+              return NULL;
+
+            return &group->entries[i];
+          }
+
+      /* end of chain? */
+      next = group->header.next;
+      if (   next == NO_INDEX
+          || next >= group_limit
+          || ++chain_length > MAX_GROUP_CHAIN_LENGTH)
+        return NULL;
+
+      group = &cache->directory[next];
+    }
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Move a surviving ENTRY from just behind the insertion window to
  * its beginning and move the insertion window up accordingly.
  */
@@ -1832,6 +2178,23 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
+/* Return SIZE bytes of uninitialized cache memory.  If *SHM_NEXT is NULL,
+ * allocate them in POOL.  Otherwise, take them from the shared memory
+ * block that *SHM_NEXT points into and advance the pointer accordingly.
+ */
+static void *
+alloc_cache_memory(char **shm_next,
+                   apr_size_t size,
+                   apr_pool_t *pool)
+{
+  void *result = *shm_next;
+  if (result == NULL)
+    return apr_palloc(pool, size);
+
+  *shm_next += ALIGN_VALUE(size);
+  return result;
+}
+
 svn_error_t *
 svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   apr_size_t total_size,
@@ -1839,10 +2202,12 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   apr_size_t segment_count,
                                   svn_boolean_t thread_safe,
                                   svn_boolean_t allow_blocking_writes,
+                                  svn_boolean_t shared,
                                   apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  char *shm_next = NULL;
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
@@ -1852,11 +2217,29 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
 
+#ifndef SHARED_CACHE_LOCK_MECH
+  if (shared)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Caches shared between processes are not "
+                              "supported on this platform"));
+#endif
+
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   *
+   * The prefix indexes are process-local and would not match between
+   * processes sharing the cache.  Shared caches therefore use an empty
+   * prefix pool, i.e. always store the full keys.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  if (shared)
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, 0, thread_safe, pool));
+    }
+  else
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100,
+                                 thread_safe, pool));
+      total_size -= total_size / 100;
+    }
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
@@ -1910,9 +2293,6 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1963,11 +2343,39 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Shared caches get all their memory from a single anonymous shared
+   * memory block that processes forked later on will inherit. */
+  if (shared)
+    {
+      apr_shm_t *shm;
+      apr_status_t status;
+      apr_uint64_t shm_size
+        = ALIGN_VALUE(segment_count * sizeof(*c))
+        + segment_count * (  ALIGN_VALUE(group_count * sizeof(entry_group_t))
+                           + ALIGN_VALUE(group_init_size)
+                           + ALIGN_VALUE(data_size));
+
+      if (shm_size > APR_SIZE_MAX)
+        return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+      status = apr_shm_create(&shm, (apr_size_t)shm_size, NULL, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared cache memory"));
+
+      shm_next = apr_shm_baseaddr_get(shm);
+    }
+
+  /* allocate cache as an array of segments / cache objects */
+  c = alloc_cache_memory(&shm_next, segment_count * sizeof(*c), pool);
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
        */
       c[seg].segment_count = (apr_uint32_t)segment_count;
+      c[seg].write_sequence = 0;
       c[seg].prefix_pool = prefix_pool;
 
       c[seg].group_count = main_group_count;
@@ -1978,12 +2386,15 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      c[seg].directory
+        = alloc_cache_memory(&shm_next,
+                             group_count * sizeof(entry_group_t), pool);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized
+        = alloc_cache_memory(&shm_next, group_init_size, pool);
+      memset(c[seg].group_initialized, 0, group_init_size);
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +2415,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = alloc_cache_memory(&shm_next,
+                                       (apr_size_t)ALIGN_VALUE(data_size),
+                                       pool);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2028,11 +2441,11 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
        * the cache's creator doesn't feel the cache needs to be
        * thread-safe.
        */
-      SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe, pool));
+      SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe && !shared, pool));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
       /* Same for read-write lock. */
       c[seg].lock = NULL;
-      if (thread_safe)
+      if (thread_safe && !shared)
         {
           apr_status_t status =
               apr_thread_rwlock_create(&(c[seg].lock), pool);
@@ -2040,10 +2453,39 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
             return svn_error_wrap_apr(status, _("Can't create cache mutex"));
         }
 
+#endif
+
+      /* Shared segments are always protected by a process-shared lock,
+       * which also serializes the threads within each process.
+       */
+      c[seg].proc_lock = NULL;
+      c[seg].proc_lock_held = FALSE;
+#ifdef SHARED_CACHE_LOCK_MECH
+      if (shared)
+        {
+          proc_lock_owner_t *owner;
+          apr_status_t status =
+              apr_proc_mutex_create(&(c[seg].proc_lock), NULL,
+                                    SHARED_CACHE_LOCK_MECH, pool);
+          if (status)
+            return svn_error_wrap_apr(status,
+                                      _("Can't create shared cache mutex"));
+
+          /* Replace APR's cleanup with one that only the creating
+           * process will execute. */
+          owner = apr_palloc(pool, sizeof(*owner));
+          owner->lock = c[seg].proc_lock;
+          owner->pid = getpid();
+          apr_pool_cleanup_kill(pool, c[seg].proc_lock,
+                                apr_proc_mutex_cleanup);
+          apr_pool_cleanup_register(pool, owner, proc_lock_cleanup,
+                                    apr_pool_cleanup_null);
+        }
+#endif
+
       /* Select the behavior of write operations.
        */
       c[seg].allow_blocking_writes = allow_blocking_writes;
-#endif
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
     }
@@ -2060,12 +2502,6 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
   apr_size_t seg;
   apr_size_t segment_count = cache->segment_count;
 
-  /* Length of the group_initialized array in bytes.
-     See also svn_cache__membuffer_cache_create(). */
-  apr_size_t group_init_size
-    = 1 + (cache->group_count + cache->spare_group_count)
-            / (8 * GROUP_INIT_GRANULARITY);
-
   /* Clear segment by segment.  This implies that other thread may read
      and write to other segments after we cleared them and before the
      last segment is done.
@@ -2079,30 +2515,10 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
 
-      /* Mark all groups as "not initialized", which implies "empty". */
-      cache[seg].first_spare_group = NO_INDEX;
-      cache[seg].max_spare_used = 0;
-
-      memset(cache[seg].group_initialized, 0, group_init_size);
-
-      /* Unlink L1 contents. */
-      cache[seg].l1.first = NO_INDEX;
-      cache[seg].l1.last = NO_INDEX;
-      cache[seg].l1.next = NO_INDEX;
-      cache[seg].l1.current_data = cache[seg].l1.start_offset;
-
-      /* Unlink L2 contents. */
-      cache[seg].l2.first = NO_INDEX;
-      cache[seg].l2.last = NO_INDEX;
-      cache[seg].l2.next = NO_INDEX;
-      cache[seg].l2.current_data = cache[seg].l2.start_offset;
-
-      /* Reset content counters. */
-      cache[seg].data_used = 0;
-      cache[seg].used_entries = 0;
+      reset_segment(&cache[seg]);
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(write_unlock_cache(&cache[seg], SVN_NO_ERROR));
     }
 
   /* done here */
@@ -2433,6 +2849,57 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Lock-free variant of membuffer_cache_get_internal.  Return FALSE, if a
+ * concurrent modification of CACHE prevented us from getting a consistent
+ * result.  In that case, the contents of *BUFFER and *ITEM_SIZE are
+ * undefined and the caller must use the locking code path instead.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+  apr_uint32_t sequence;
+  entry_t snapshot;
+  entry_t *entry;
+
+  if (!optimistic_read_begin(cache, &sequence))
+    return FALSE;
+
+  entry = find_entry_optimistic(cache, group_index, to_find, &snapshot);
+  if (entry == NULL)
+    {
+      *buffer = NULL;
+      *item_size = 0;
+    }
+  else
+    {
+      apr_size_t size = ALIGN_VALUE(snapshot.size) - snapshot.key.key_len;
+      *buffer = apr_palloc(result_pool, size);
+      memcpy(*buffer, cache->data + snapshot.offset + snapshot.key.key_len,
+             size);
+      *item_size = snapshot.size - snapshot.key.key_len;
+    }
+
+  if (!optimistic_read_end(cache, sequence))
+    return FALSE;
+
+  /* update hit statistics
+   */
+  cache->total_reads++;
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  return TRUE;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * to re-construct the proper object from the serialized data.
@@ -2453,6 +2920,11 @@ membuffer_cache_get(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
+
+#if USE_OPTIMISTIC_READS
+  if (!membuffer_cache_get_optimistic(cache, group_index, key,
+                                      &buffer, &size, result_pool))
+#endif
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_internal(cache,
                                               group_index,
@@ -2502,6 +2974,41 @@ membuffer_cache_has_key_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Lock-free variant of membuffer_cache_has_key_internal.  Return FALSE,
+ * if a concurrent modification of CACHE prevented us from getting a
+ * consistent result.  In that case, the caller must use the locking code
+ * path instead.
+ */
+static svn_boolean_t
+membuffer_cache_has_key_optimistic(svn_membuffer_t *cache,
+                                   apr_uint32_t group_index,
+                                   const full_key_t *to_find,
+                                   svn_boolean_t *found)
+{
+  apr_uint32_t sequence;
+  entry_t snapshot;
+  entry_t *entry;
+
+  if (!optimistic_read_begin(cache, &sequence))
+    return FALSE;
+
+  entry = find_entry_optimistic(cache, group_index, to_find, &snapshot);
+  if (!optimistic_read_end(cache, sequence))
+    return FALSE;
+
+  /* See membuffer_cache_has_key_internal for why we count this as a hit.
+   */
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  *found = entry != NULL;
+  return TRUE;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Look for an entry identified by KEY.  If no item has been stored
  * for KEY, *FOUND will be set to FALSE and TRUE otherwise.
  */
@@ -2517,6 +3024,9 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
   cache->total_reads++;
 
+#if USE_OPTIMISTIC_READS
+  if (!membuffer_cache_has_key_optimistic(cache, group_index, key, found))
+#endif
   WITH_READ_LOCK(cache,
                  membuffer_cache_has_key_internal(cache,
                                                   group_index,
@@ -2583,6 +3093,58 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
     }
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Lock-free variant of membuffer_cache_get_partial_internal.  Because
+ * the partial getter must not see data that is being modified, we only
+ * handle items no larger than OPTIMISTIC_PARTIAL_READ_SIZE and copy them
+ * to BUFFER, which must provide that much space.  The size of the item
+ * will be returned in *ITEM_SIZE.  *FOUND indicates whether the item has
+ * been found at all.
+ *
+ * Return FALSE, if the item was too large or a concurrent modification
+ * of CACHE prevented us from getting a consistent result.  In that case,
+ * the caller must use the locking code path instead.
+ */
+static svn_boolean_t
+membuffer_cache_get_partial_optimistic(svn_membuffer_t *cache,
+                                       apr_uint32_t group_index,
+                                       const full_key_t *to_find,
+                                       void *buffer,
+                                       apr_size_t *item_size,
+                                       svn_boolean_t *found)
+{
+  apr_uint32_t sequence;
+  entry_t snapshot;
+  entry_t *entry;
+
+  if (!optimistic_read_begin(cache, &sequence))
+    return FALSE;
+
+  entry = find_entry_optimistic(cache, group_index, to_find, &snapshot);
+  if (entry)
+    {
+      *item_size = snapshot.size - snapshot.key.key_len;
+      if (*item_size > OPTIMISTIC_PARTIAL_READ_SIZE)
+        return FALSE;
+
+      memcpy(buffer, cache->data + snapshot.offset + snapshot.key.key_len,
+             *item_size);
+    }
+
+  if (!optimistic_read_end(cache, sequence))
+    return FALSE;
+
+  cache->total_reads++;
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  *found = entry != NULL;
+  return TRUE;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Look for the cache entry identified by KEY. FOUND indicates
  * whether that entry exists. If not found, *ITEM will be NULL. Otherwise,
  * the DESERIALIZER is called with that entry and the BATON provided
@@ -2601,6 +3163,26 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
 {
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
 
+#if USE_OPTIMISTIC_READS
+  {
+    /* Properly aligned buffer for the item copy. */
+    apr_uint64_t buffer[OPTIMISTIC_PARTIAL_READ_SIZE / sizeof(apr_uint64_t)];
+    apr_size_t size;
+
+    if (membuffer_cache_get_partial_optimistic(cache, group_index, key,
+                                               buffer, &size, found))
+      {
+        if (!*found)
+          {
+            *item = NULL;
+            return SVN_NO_ERROR;
+          }
+
+        return deserializer(item, buffer, size, baton, result_pool);
+      }
+  }
+#endif
+
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_partial_internal
                      (cache, group_index, key, item, found,
@@ -64,6 +64,10 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* If set, place the process-global membuffer cache in shared memory.
+ */
+static svn_boolean_t cache_shared = FALSE;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -127,8 +131,28 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
           0,
           ! svn_cache_config_get()->single_threaded,
           FALSE,
+          cache_shared,
           pool);
 
+      /* Not all platforms support sharing the cache between processes.
+       * A process-local cache is still better than no cache at all.
+       */
+      if (err && cache_shared
+          && err->apr_err != APR_ENOMEM)
+        {
+          svn_error_clear(err);
+          svn_pool_clear(pool);
+          err = svn_cache__membuffer_cache_create(
+              &cache,
+              (apr_size_t)cache_size,
+              (apr_size_t)(cache_size / 5),
+              0,
+              ! svn_cache_config_get()->single_threaded,
+              FALSE,
+              FALSE,
+              pool);
+        }
+
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
        */
@@ -173,6 +197,12 @@ svn_cache__get_global_membuffer_cache(void)
   return cache;
 }
 
+void
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared)
+{
+  cache_shared = shared;
+}
+
 void
 svn_cache_config_set(const svn_cache_config_t *settings)
 {
@@ -51,6 +51,15 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
 #include "svn_hash.h"
 #include "svn_types.h"
 #include "svn_dirent_uri.h"
@@ -875,6 +884,113 @@ copy_contents(apr_file_t *from_file,
 }
 
 
+#if defined(FICLONE) || defined(SYS_copy_file_range)
+/* Try to let the kernel copy all of FROM_FILE into the empty TO_FILE,
+ * ideally by sharing the underlying storage blocks.  Set *COPIED to TRUE
+ * if that succeeded.  If the file systems involved support neither,
+ * set *COPIED to FALSE and leave both files untouched.
+ */
+static apr_status_t
+copy_contents_in_kernel(svn_boolean_t *copied,
+                        apr_file_t *from_file,
+                        apr_file_t *to_file)
+{
+  apr_os_file_t from_fd, to_fd;
+  apr_off_t offset = 0;
+  apr_status_t status;
+
+  *copied = FALSE;
+
+  status = apr_os_file_get(&from_fd, from_file);
+  if (status)
+    return status;
+
+  status = apr_os_file_get(&to_fd, to_file);
+  if (status)
+    return status;
+
+#ifdef FICLONE
+  /* Reflink, e.g. on Btrfs and XFS.  O(1) regardless of the file size. */
+  if (ioctl(to_fd, FICLONE, from_fd) == 0)
+    *copied = TRUE;
+#endif
+
+#ifdef SYS_copy_file_range
+  if (!*copied)
+    {
+      /* Use explicit offsets such that the file pointers do not change
+       * in case we have to fall back to the user-space copy. */
+      apr_int64_t from_offset = 0;
+      apr_int64_t to_offset = 0;
+      long bytes_copied;
+
+      do
+        {
+          bytes_copied = syscall(SYS_copy_file_range,
+                                 from_fd, &from_offset, to_fd, &to_offset,
+                                 (size_t)0x40000000, 0u);
+          if (bytes_copied < 0 && errno != EINTR)
+            {
+              /* Not supported by the kernel or the file systems? */
+              if (to_offset == 0
+                  && (   errno == ENOSYS || errno == EXDEV
+                      || errno == EINVAL || errno == EOPNOTSUPP))
+                return APR_SUCCESS;
+
+              return apr_get_os_error();
+            }
+        }
+      while (bytes_copied != 0);
+
+      *copied = TRUE;
+    }
+#endif
+
+  /* Be consistent with the user-space copy and leave TO_FILE's pointer
+   * at the end of the data. */
+  return *copied ? apr_file_seek(to_file, APR_END, &offset) : APR_SUCCESS;
+}
+#endif
+
+svn_error_t *
+svn_io__file_copy_contents(apr_file_t *dst,
+                           apr_file_t *src,
+                           apr_pool_t *scratch_pool)
+{
+  apr_status_t apr_err;
+  svn_boolean_t copied = FALSE;
+
+#if defined(FICLONE) || defined(SYS_copy_file_range)
+  apr_err = copy_contents_in_kernel(&copied, src, dst);
+#else
+  apr_err = APR_SUCCESS;
+#endif
+
+  if (!apr_err && !copied)
+    {
+      apr_off_t offset = 0;
+      apr_err = apr_file_seek(src, APR_SET, &offset);
+      if (!apr_err)
+        apr_err = copy_contents(src, dst, scratch_pool);
+    }
+
+  if (apr_err)
+    {
+      const char *src_name, *dst_name;
+      SVN_ERR(svn_io_file_name_get(&src_name, src, scratch_pool));
+      SVN_ERR(svn_io_file_name_get(&dst_name, dst, scratch_pool));
+
+      return svn_error_wrap_apr(apr_err, _("Can't copy '%s' to '%s'"),
+                                svn_dirent_local_style(src_name,
+                                                       scratch_pool),
+                                svn_dirent_local_style(dst_name,
+                                                       scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_io_copy_file(const char *src,
                  const char *dst,
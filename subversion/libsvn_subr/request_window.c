@@ -0,0 +1,63 @@
+/*
+ * request_window.c :  tune the number of concurrent requests from latency
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include "svn_sorts.h"
+#include "private/svn_subr_private.h"
+
+/* By Little's law, the average time a request spends in flight is the
+ * number of requests in flight divided by the completion rate.  When
+ * that time stays close to the lowest one observed, requests are mostly
+ * waiting on the network rather than on the server or on the available
+ * bandwidth, so we can afford to keep more of them in flight.  When it
+ * grows well beyond that, requests start queueing and we back off.  This
+ * is the same reasoning TCP Vegas applies to its congestion window.
+ */
+unsigned int
+svn_request_window__adjust(unsigned int window,
+                           unsigned int in_flight,
+                           apr_interval_time_t rtt,
+                           apr_interval_time_t min_rtt,
+                           unsigned int min_window,
+                           unsigned int max_window)
+{
+  unsigned int queued;
+
+  if (rtt <= 0)
+    return window;
+
+  /* The caller's limits may collide, e.g. with few connections. */
+  min_window = MIN(min_window, max_window);
+
+  /* How many of the requests in the window are queued somewhere instead
+     of travelling over the network? */
+  queued = (unsigned int)(window * (rtt - min_rtt) / rtt);
+
+  if (queued < window / 4 && in_flight * 2 > window)
+    return MIN(window * 2, max_window);
+
+  if (queued > window / 2)
+    return MAX(window - window / 4, min_window);
+
+  return window;
+}
@@ -0,0 +1,473 @@
+/* task.c : parallel processing of sequential tasks
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_proc.h>
+
+#if APR_HAS_THREADS
+#include <apr_thread_cond.h>
+#endif
+
+#include "svn_pools.h"
+#include "svn_error.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_task.h"
+
+#include "svn_private_config.h"
+
+
+
+/* Process all tasks in the current thread, using SCRATCH_POOL for
+ * temporary allocations.  All other parameters are the same as for
+ * svn_task__run. */
+static svn_error_t *
+run_serially(apr_int64_t task_count,
+             svn_task__thread_context_constructor_t context_constructor,
+             void *context_baton,
+             svn_task__process_func_t process_func,
+             void *process_baton,
+             svn_task__output_func_t output_func,
+             void *output_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  void *thread_context = NULL;
+  apr_int64_t i;
+
+  if (context_constructor)
+    SVN_ERR(context_constructor(&thread_context, context_baton,
+                                scratch_pool, iterpool));
+
+  for (i = 0; i < task_count; ++i)
+    {
+      void *result;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(process_func(&result, process_baton, thread_context, i,
+                           cancel_func, cancel_baton, iterpool, iterpool));
+      if (output_func)
+        SVN_ERR(output_func(result, output_baton, i, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Maximum number of tasks per worker thread that may be processed ahead
+ * of the oldest task not yet handed to the output function. */
+#define TASKS_PER_THREAD 4
+
+/* Processing state of a single task. */
+typedef struct task_slot_t
+{
+  /* Root pool for the task result.  Cleared after the result has been
+   * handed to the output function. */
+  apr_pool_t *pool;
+
+  /* Task result as returned by the process function. */
+  void *result;
+
+  /* Error returned by the process function. */
+  svn_error_t *err;
+
+  /* Set by the worker thread once RESULT and ERR are valid. */
+  svn_boolean_t done;
+} task_slot_t;
+
+/* Shared state of all worker threads and the output thread. */
+typedef struct task_runner_t
+{
+  /* Parameters as passed to svn_task__run(). */
+  apr_int64_t task_count;
+  svn_task__thread_context_constructor_t context_constructor;
+  void *context_baton;
+  svn_task__process_func_t process_func;
+  void *process_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Ring buffer of SLOT_COUNT task slots.  Task I uses slot
+   * I % SLOT_COUNT. */
+  task_slot_t *slots;
+  int slot_count;
+
+  /* Number of the next task to be claimed by a worker thread. */
+  apr_int64_t next_task;
+
+  /* Number of the oldest task whose result has not been handed to the
+   * output function, yet. */
+  apr_int64_t first_pending;
+
+  /* Set when the whole operation shall be aborted.  Only modified while
+   * holding MUTEX but may be read at any time. */
+  volatile svn_atomic_t aborted;
+
+  /* Protects all of the above, except the parameters. */
+  svn_mutex__t *mutex;
+
+  /* Signaled whenever a task has been completed or a slot got released. */
+  apr_thread_cond_t *cond;
+} task_runner_t;
+
+/* Wait for the next signal on RUNNER's condition variable.  The caller
+ * must hold RUNNER's mutex. */
+static svn_error_t *
+wait_for_signal(task_runner_t *runner)
+{
+  apr_status_t status = apr_thread_cond_wait(runner->cond,
+                                             svn_mutex__get(runner->mutex));
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't wait for condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Signal all threads waiting on RUNNER's condition variable. */
+static svn_error_t *
+signal_all(task_runner_t *runner)
+{
+  apr_status_t status = apr_thread_cond_broadcast(runner->cond);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't signal condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cancel_func_t for the worker threads.  BATON is the
+ * task_runner_t. */
+static svn_error_t *
+worker_cancel_func(void *baton)
+{
+  task_runner_t *runner = baton;
+
+  if (svn_atomic_read(&runner->aborted))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  if (runner->cancel_func)
+    SVN_ERR(runner->cancel_func(runner->cancel_baton));
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait until RUNNER has a free slot and claim the next task for
+ * processing.  Set *TASK_INDEX to its number or to -1 if there are no
+ * more tasks to process.  The caller must hold RUNNER's mutex. */
+static svn_error_t *
+claim_task(apr_int64_t *task_index,
+           task_runner_t *runner)
+{
+  while (   !runner->aborted
+         && runner->next_task < runner->task_count
+         && runner->next_task - runner->first_pending >= runner->slot_count)
+    SVN_ERR(wait_for_signal(runner));
+
+  if (runner->aborted || runner->next_task >= runner->task_count)
+    *task_index = -1;
+  else
+    *task_index = runner->next_task++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark the task in SLOT of RUNNER as completed with RESULT and ERR.
+ * The caller must hold RUNNER's mutex. */
+static svn_error_t *
+complete_task(task_runner_t *runner,
+              task_slot_t *slot,
+              void *result,
+              svn_error_t *err)
+{
+  slot->result = result;
+  slot->err = err;
+  slot->done = TRUE;
+
+  return svn_error_trace(signal_all(runner));
+}
+
+/* Process tasks from RUNNER until there are none left.  Use POOL for
+ * the thread context and for temporary allocations. */
+static svn_error_t *
+process_tasks(task_runner_t *runner,
+              apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_boolean_t has_context = FALSE;
+  void *thread_context = NULL;
+
+  while (TRUE)
+    {
+      apr_int64_t task_index;
+      task_slot_t *slot;
+      void *result = NULL;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      svn_pool_clear(iterpool);
+
+      SVN_MUTEX__WITH_LOCK(runner->mutex, claim_task(&task_index, runner));
+      if (task_index < 0)
+        break;
+
+      /* Construct the context lazily such that errors will be reported
+       * in task order. */
+      slot = &runner->slots[task_index % runner->slot_count];
+      if (!has_context && runner->context_constructor)
+        err = runner->context_constructor(&thread_context,
+                                          runner->context_baton,
+                                          pool, iterpool);
+      has_context = !err;
+
+      if (!err)
+        err = runner->process_func(&result, runner->process_baton,
+                                   thread_context, task_index,
+                                   worker_cancel_func, runner,
+                                   slot->pool, iterpool);
+
+      SVN_MUTEX__WITH_LOCK(runner->mutex,
+                           complete_task(runner, slot, result, err));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function processing tasks from the task_runner_t given by DATA.
+ */
+static void * APR_THREAD_FUNC
+worker_thread(apr_thread_t *tid,
+              void *data)
+{
+  task_runner_t *runner = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  /* Synchronization failures can't be reported and will prevent any
+     further progress anyway. */
+  svn_error_clear(process_tasks(runner, pool));
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Wait for the oldest pending task of RUNNER to complete and return the
+ * respective slot in *SLOT_P.  The caller must hold RUNNER's mutex. */
+static svn_error_t *
+wait_for_oldest_task(task_slot_t **slot_p,
+                     task_runner_t *runner)
+{
+  task_slot_t *slot
+    = &runner->slots[runner->first_pending % runner->slot_count];
+
+  while (!slot->done)
+    SVN_ERR(wait_for_signal(runner));
+
+  *slot_p = slot;
+
+  return SVN_NO_ERROR;
+}
+
+/* Release the SLOT of the oldest pending task in RUNNER such that it
+ * can be reused by the worker threads.  The caller must hold RUNNER's
+ * mutex. */
+static svn_error_t *
+release_oldest_task(task_runner_t *runner,
+                    task_slot_t *slot)
+{
+  svn_pool_clear(slot->pool);
+  slot->result = NULL;
+  slot->done = FALSE;
+  runner->first_pending++;
+
+  return svn_error_trace(signal_all(runner));
+}
+
+/* Tell all worker threads in RUNNER to stop after their current task.
+ * The caller must hold RUNNER's mutex. */
+static svn_error_t *
+abort_tasks(task_runner_t *runner)
+{
+  svn_atomic_set(&runner->aborted, TRUE);
+
+  return svn_error_trace(signal_all(runner));
+}
+
+/* Abort all tasks in RUNNER, acquiring its mutex. */
+static svn_error_t *
+stop_workers(task_runner_t *runner)
+{
+  SVN_MUTEX__WITH_LOCK(runner->mutex, abort_tasks(runner));
+
+  return SVN_NO_ERROR;
+}
+
+/* Hand the task results in RUNNER to OUTPUT_FUNC with OUTPUT_BATON, in
+ * task order, until all tasks have been completed or an error occurred.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+output_results(task_runner_t *runner,
+               svn_task__output_func_t output_func,
+               void *output_baton,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (runner->first_pending < runner->task_count)
+    {
+      task_slot_t *slot;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      SVN_MUTEX__WITH_LOCK(runner->mutex,
+                           wait_for_oldest_task(&slot, runner));
+
+      err = slot->err;
+      slot->err = SVN_NO_ERROR;
+      if (!err && output_func)
+        err = output_func(slot->result, output_baton, runner->first_pending,
+                          iterpool);
+
+      SVN_MUTEX__WITH_LOCK(runner->mutex, release_oldest_task(runner, slot));
+      SVN_ERR(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+svn_error_t *
+svn_task__run(int thread_count,
+              apr_int64_t task_count,
+              svn_task__thread_context_constructor_t context_constructor,
+              void *context_baton,
+              svn_task__process_func_t process_func,
+              void *process_baton,
+              svn_task__output_func_t output_func,
+              void *output_baton,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  task_runner_t *runner;
+  apr_thread_t **threads;
+  apr_pool_t *thread_pool;
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+  int started = 0;
+  int i;
+
+  if (thread_count > task_count)
+    thread_count = (int)task_count;
+
+  if (thread_count > 1)
+    {
+      runner = apr_pcalloc(scratch_pool, sizeof(*runner));
+      runner->task_count = task_count;
+      runner->context_constructor = context_constructor;
+      runner->context_baton = context_baton;
+      runner->process_func = process_func;
+      runner->process_baton = process_baton;
+      runner->cancel_func = cancel_func;
+      runner->cancel_baton = cancel_baton;
+
+      runner->slot_count = thread_count * TASKS_PER_THREAD;
+      runner->slots = apr_pcalloc(scratch_pool,
+                                  runner->slot_count * sizeof(*runner->slots));
+      for (i = 0; i < runner->slot_count; ++i)
+        runner->slots[i].pool = svn_pool_create(NULL);
+
+      SVN_ERR(svn_mutex__init(&runner->mutex, TRUE, scratch_pool));
+      status = apr_thread_cond_create(&runner->cond, scratch_pool);
+      if (status)
+        err = svn_error_wrap_apr(status,
+                                 _("Can't create condition variable"));
+
+      /* Start the workers.  If we fail to create some of them, the
+       * ones we got will have to do all the work.  APR allocates from
+       * the pool passed to apr_thread_create() while the new thread is
+       * running, so it must not be SCRATCH_POOL, which we keep using
+       * here.  A root pool has its own allocator. */
+      thread_pool = svn_pool_create(NULL);
+      threads = apr_pcalloc(scratch_pool, thread_count * sizeof(*threads));
+      for (i = 0; i < thread_count && !err; ++i)
+        {
+          status = apr_thread_create(&threads[i], NULL, worker_thread,
+                                     runner, thread_pool);
+          if (status)
+            {
+              if (started == 0)
+                err = svn_error_wrap_apr(status, _("Can't create thread"));
+              break;
+            }
+
+          ++started;
+        }
+
+      if (!err)
+        err = output_results(runner, output_func, output_baton,
+                             scratch_pool);
+
+      /* Stop all workers and wait for them to terminate. */
+      if (started)
+        err = svn_error_compose_create(err, stop_workers(runner));
+
+      for (i = 0; i < started; ++i)
+        {
+          apr_status_t retval;
+          status = apr_thread_join(&retval, threads[i]);
+          if (status)
+            err = svn_error_compose_create(err,
+                    svn_error_wrap_apr(status, _("Can't join thread")));
+        }
+
+      svn_pool_destroy(thread_pool);
+
+      /* Discard the results of all tasks that did not get output. */
+      for (i = 0; i < runner->slot_count; ++i)
+        {
+          svn_error_clear(runner->slots[i].err);
+          svn_pool_destroy(runner->slots[i].pool);
+        }
+
+      return svn_error_trace(err);
+    }
+#endif
+
+  return svn_error_trace(run_serially(task_count,
+                                      context_constructor, context_baton,
+                                      process_func, process_baton,
+                                      output_func, output_baton,
+                                      cancel_func, cancel_baton,
+                                      scratch_pool));
+}
@@ -428,6 +428,19 @@ int dav_svn__get_compression_level(request_rec *r);
 /* Return the hook script environment parsed from the configuration. */
 const char *dav_svn__get_hooks_env(request_rec *r);
 
+/* Return the directory of the report cache, or NULL if it is disabled. */
+const char *dav_svn__get_report_cache_path(request_rec *r);
+
+/* Return the maximum total size of the report cache in bytes. */
+apr_uint64_t dav_svn__get_report_cache_size(request_rec *r);
+
+/* Return the counter of KB that this process added to the report cache
+   since it last trimmed it, or NULL if the report cache is disabled. */
+volatile apr_uint32_t *dav_svn__get_report_cache_added(request_rec *r);
+
+/* Return whether reports may be cached while path-based authz is active. */
+svn_boolean_t dav_svn__get_report_cache_authz_flag(request_rec *r);
+
 /** For HTTP protocol v2, these are the new URIs and URI stubs
     returned to the client in our OPTIONS response.  They all depend
     on the 'special uri', which is configurable in httpd.conf.  **/
@@ -702,6 +715,7 @@ static const dav_report_elem dav_svn__reports_list[] = {
   { SVN_XML_NAMESPACE, SVN_DAV__MERGEINFO_REPORT },
   { SVN_XML_NAMESPACE, SVN_DAV__INHERITED_PROPS_REPORT },
   { SVN_XML_NAMESPACE, "list-report" },
+  { SVN_XML_NAMESPACE, "get-files-report" },
   { NULL, NULL },
 };
 
@@ -759,6 +773,11 @@ dav_svn__list_report(const dav_resource *resource,
                      const apr_xml_doc *doc,
                      dav_svn__output *output);
 
+dav_error *
+dav_svn__get_files_report(const dav_resource *resource,
+                          const apr_xml_doc *doc,
+                          dav_svn__output *output);
+
 /*** posts/ ***/
 
 /* The various POST handlers, defined in posts/, and used by repos.c.  */
@@ -1129,6 +1148,62 @@ dav_svn__fuzzy_escape_author(const char *author,
                              apr_pool_t *result_pool,
                              apr_pool_t *scratch_pool);
 
+/*** reportcache.c ***/
+
+/* The name of the output filter that records report bodies. */
+#define DAV_SVN__REPORT_CACHE_FILTER "SVN-REPORT-CACHE"
+
+/* A report response body in the on-disk report cache (SVNReportCachePath),
+   addressed by a digest of everything that determines its contents. */
+typedef struct dav_svn__report_cache_t dav_svn__report_cache_t;
+
+/* Return the report cache entry for the REPORT request DOC against
+   RESOURCE, which is about to produce a response for revision REVNUM.
+   Return NULL if report caching is disabled for the request or the
+   entry could not be determined.  Allocate the result in POOL.
+
+   The key includes the request body, REVNUM, the repository and the
+   settings that affect the rendering, and -- unless path-based authz is
+   disabled -- the authenticated user.  While path-based authz is active,
+   caching is disabled unless SVNReportCacheAuthz is On, because the key
+   cannot reflect changes to the authz rules.  Callers must not use the
+   cache for requests whose responses depend on other mutable state,
+   e.g. locks. */
+dav_svn__report_cache_t *
+dav_svn__report_cache_open(const dav_resource *resource,
+                           const apr_xml_doc *doc,
+                           svn_revnum_t revnum,
+                           apr_pool_t *pool);
+
+/* If CACHE holds a complete response body, pass it to OUTPUT and set
+   *SENT to TRUE.  Otherwise, set *SENT to FALSE and send nothing.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+dav_svn__report_cache_send(svn_boolean_t *sent,
+                           dav_svn__report_cache_t *cache,
+                           dav_svn__output *output,
+                           apr_pool_t *scratch_pool);
+
+/* Start recording the response body of the current request into a
+   spool file for CACHE.  Failures are logged and disable recording. */
+void
+dav_svn__report_cache_record(dav_svn__report_cache_t *cache);
+
+/* Stop recording for CACHE.  If SUCCESS is TRUE and the whole body has
+   been recorded, add it to the cache and evict the least recently used
+   entries beyond the configured cache size; otherwise discard it.
+   Use SCRATCH_POOL for temporary allocations. */
+void
+dav_svn__report_cache_finish(dav_svn__report_cache_t *cache,
+                             svn_boolean_t success,
+                             apr_pool_t *scratch_pool);
+
+/* The output filter DAV_SVN__REPORT_CACHE_FILTER, which copies the data
+   in BB to the spool file of the dav_svn__report_cache_t in F->ctx. */
+apr_status_t
+dav_svn__report_cache_filter(ap_filter_t *f,
+                             apr_bucket_brigade *bb);
+
 /*** mirror.c ***/
 
 /* Perform the fixup hook for the R request.  */
@@ -42,6 +42,7 @@
 #include "svn_dso.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 
@@ -62,7 +63,7 @@ typedef struct server_conf_t {
   const char *special_uri;
   svn_boolean_t use_utf8;
 
-  /* The compression level we will pass to svn_txdelta_to_svndiff3()
+  /* The compression level we will pass to svn_txdelta_to_svndiff4()
    * for wire-compression. Negative value used to specify default
      compression level. */
   int compression_level;
@@ -108,6 +109,10 @@ typedef struct dir_conf_t {
   enum conf_flag nodeprop_cache;     /* whether to enable nodeprop caching */
   enum conf_flag block_read;         /* whether to enable block read mode */
   const char *hooks_env;             /* path to hook script env config file */
+  const char *report_cache_path;     /* where to keep rendered reports */
+  apr_uint64_t report_cache_size;    /* report cache size limit in bytes */
+  volatile apr_uint32_t *report_cache_added; /* KB added since last trim */
+  enum conf_flag report_cache_authz; /* whether to cache with path authz */
 } dir_conf_t;
 
 
@@ -120,6 +125,9 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Whether the in-memory cache shall be shared between worker processes. */
+static svn_boolean_t shared_memory_cache = FALSE;
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -150,6 +158,11 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
 
+  /* Create the shared cache in the parent process such that all worker
+   * processes forked from it will inherit it. */
+  if (shared_memory_cache)
+    svn_cache__get_global_membuffer_cache();
+
   return OK;
 }
 
@@ -285,6 +298,14 @@ merge_dir_config(apr_pool_t *p, void *base, void *overrides)
   newconf->block_read = INHERIT_VALUE(parent, child, block_read);
   newconf->root_dir = INHERIT_VALUE(parent, child, root_dir);
   newconf->hooks_env = INHERIT_VALUE(parent, child, hooks_env);
+  newconf->report_cache_path = INHERIT_VALUE(parent, child,
+                                             report_cache_path);
+  newconf->report_cache_size = INHERIT_VALUE(parent, child,
+                                             report_cache_size);
+  newconf->report_cache_added = INHERIT_VALUE(parent, child,
+                                              report_cache_added);
+  newconf->report_cache_authz = INHERIT_VALUE(parent, child,
+                                              report_cache_authz);
 
   if (parent->fs_path)
     ap_log_error(APLOG_MARK, APLOG_WARNING, 0, NULL,
@@ -624,6 +645,15 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNSharedMemoryCache_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  shared_memory_cache = arg;
+  svn_cache__set_global_membuffer_shared(arg);
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -674,6 +704,50 @@ SVNHooksEnv_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNReportCachePath_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  dir_conf_t *conf = config;
+
+  conf->report_cache_path = svn_dirent_internal_style(arg1, cmd->pool);
+
+  /* Shared by all requests that this process serves for the location. */
+  conf->report_cache_added = apr_pcalloc(cmd->pool,
+                                         sizeof(*conf->report_cache_added));
+
+  return NULL;
+}
+
+static const char *
+SVNReportCacheAuthz_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  dir_conf_t *conf = config;
+
+  if (arg)
+    conf->report_cache_authz = CONF_FLAG_ON;
+  else
+    conf->report_cache_authz = CONF_FLAG_OFF;
+
+  return NULL;
+}
+
+static const char *
+SVNReportCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  dir_conf_t *conf = config;
+  apr_uint64_t value = 0;
+  svn_error_t *err = svn_cstring_atoui64(&value, arg1);
+  if (err || value == 0)
+    {
+      svn_error_clear(err);
+      return "Invalid positive decimal number for the SVN report cache size.";
+    }
+
+  conf->report_cache_size = value * 0x100000;
+
+  return NULL;
+}
+
 static svn_boolean_t
 get_conf_flag(enum conf_flag flag, svn_boolean_t default_value)
 {
@@ -1054,6 +1128,48 @@ dav_svn__get_hooks_env(request_rec *r)
   return conf->hooks_env;
 }
 
+
+const char *
+dav_svn__get_report_cache_path(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+  return conf->report_cache_path;
+}
+
+
+apr_uint64_t
+dav_svn__get_report_cache_size(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+
+  /* 1 GB unless configured otherwise. */
+  return conf->report_cache_size ? conf->report_cache_size : 0x40000000;
+}
+
+
+volatile apr_uint32_t *
+dav_svn__get_report_cache_added(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+  return conf->report_cache_added;
+}
+
+
+svn_boolean_t
+dav_svn__get_report_cache_authz_flag(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+  return get_conf_flag(conf->report_cache_authz, FALSE);
+}
+
 static void
 merge_xml_filter_insert(request_rec *r)
 {
@@ -1389,6 +1505,12 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_FLAG("SVNSharedMemoryCache", SVNSharedMemoryCache_cmd, NULL,
+               RSRC_CONF,
+               "shares Subversion's in-memory object cache between all "
+               "worker processes instead of giving each one its own copy; "
+               "useful with the prefork MPM (default is Off)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
@@ -1408,6 +1530,32 @@ static const command_rec cmds[] =
                 "of hook scripts. If not absolute, the path is relative to "
                 "the repository's conf directory (by default the hooks-env "
                 "file in the repository is used)."),
+
+  /* per directory/location */
+  AP_INIT_TAKE1("SVNReportCachePath", SVNReportCachePath_cmd, NULL,
+                ACCESS_CONF|RSRC_CONF,
+                "specifies a directory in which rendered update reports are "
+                "kept, such that identical update requests can be answered "
+                "from disk (default is no caching). Cached reports are not "
+                "invalidated when revision properties such as svn:author "
+                "or svn:date change; clear the directory after changing "
+                "them. Reports are only cached if SVNPathAuthz is Off or "
+                "SVNReportCacheAuthz is On."),
+
+  /* per directory/location */
+  AP_INIT_TAKE1("SVNReportCacheSize", SVNReportCacheSize_cmd, NULL,
+                ACCESS_CONF|RSRC_CONF,
+                "specifies the maximum total size of the files in "
+                "SVNReportCachePath in MB (default is 1024)."),
+
+  /* per directory/location */
+  AP_INIT_FLAG("SVNReportCacheAuthz", SVNReportCacheAuthz_cmd, NULL,
+               ACCESS_CONF|RSRC_CONF,
+               "enables the report cache while path-based authorization "
+               "is active (default is Off). Cached reports are then kept "
+               "per user, but are not invalidated when the authz rules "
+               "change: until the SVNReportCachePath directory is cleared, "
+               "users keep receiving content they may no longer read."),
   { NULL }
 };
 
@@ -1439,6 +1587,11 @@ register_hooks(apr_pool_t *pconf)
   ap_hook_insert_filter(merge_xml_filter_insert, NULL, NULL,
                         APR_HOOK_MIDDLE);
 
+  /* output filter to record REPORT bodies for the report cache. */
+  ap_register_output_filter(DAV_SVN__REPORT_CACHE_FILTER,
+                            dav_svn__report_cache_filter, NULL,
+                            AP_FTYPE_RESOURCE);
+
   /* general request handler for methods which mod_dav DECLINEs. */
   ap_hook_handler(dav_svn__handler, NULL, NULL, APR_HOOK_LAST);
 
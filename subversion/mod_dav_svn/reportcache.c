@@ -0,0 +1,483 @@
+/*
+ * reportcache.c: on-disk cache of rendered REPORT response bodies
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Build farms tend to run the very same update from the very same
+   working copy state over and over again.  Each of these requests makes
+   the server walk the same trees and compute the same deltas, only to
+   produce a byte-identical response.
+
+   The report cache keeps such response bodies as plain files in the
+   SVNReportCachePath directory.  Each file is named after the SHA-1 of
+   everything that determines its contents (see make_key()), so a
+   cache hit is simply an existing file, which we hand to Apache as a
+   file bucket and thus allow it to be sent with sendfile().
+
+   A miss records the response body on its way to the client through the
+   DAV_SVN__REPORT_CACHE_FILTER output filter into a temporary file in
+   the same directory.  When the report completed successfully, that file
+   is atomically renamed to its final name.  Concurrent processes may
+   race to add the same entry; they produce the same contents, so the
+   last rename simply wins.
+
+   Path-based authz makes responses depend on the reader.  The key then
+   contains the user name, but not the state of the authz rules, so
+   this is only done if SVNReportCacheAuthz allows it.  Neither does the
+   key reflect revision property changes; the admin has to clear the
+   cache after changing svn:author or svn:date.
+
+   Hits update the modification time of the entry.  Scanning the cache
+   directory is expensive with many entries, so each process only does
+   so after it added another 1/16th of SVNReportCacheSize to the cache.
+   It then removes the least recently used entries until the total size
+   is within the limit again.  Spool files (SPOOL_SUFFIX) of recordings
+   in progress are left alone unless they have been abandoned. */
+
+#include <apr_atomic.h>
+#include <apr_strings.h>
+#include <apr_xml.h>
+
+#include <httpd.h>
+#include <http_log.h>
+#include <util_filter.h>
+#include <mod_dav.h>
+
+#include "svn_checksum.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_sorts_private.h"
+
+#include "dav_svn.h"
+
+
+/* Suffix of the temporary files that responses get recorded into. */
+#define SPOOL_SUFFIX ".tmp"
+
+/* Spool files not modified for this long belong to crashed processes. */
+#define SPOOL_ABANDONED apr_time_from_sec(3600)
+
+
+struct dav_svn__report_cache_t
+{
+  /* The request whose response we send or record. */
+  request_rec *r;
+
+  /* The cache directory and its size limit. */
+  const char *dir;
+  apr_uint64_t max_size;
+
+  /* KB added to the cache by this process since it last trimmed it. */
+  volatile apr_uint32_t *added;
+
+  /* The path of the cache entry. */
+  const char *path;
+
+  /* While recording: the spool file, its path and the number of bytes
+     written to it so far.  SPOOL is NULL if we don't (or no longer)
+     record. */
+  apr_file_t *spool;
+  const char *spool_path;
+  apr_off_t spooled;
+
+  /* The recording filter, while it is installed. */
+  ap_filter_t *filter;
+};
+
+
+/* Log ERR as a warning about the report cache of R, and clear it. */
+static void
+log_warning(request_rec *r,
+            svn_error_t *err)
+{
+  dav_svn__log_err(r, dav_svn__convert_err(err, HTTP_INTERNAL_SERVER_ERROR,
+                                           "Report cache failure",
+                                           r->pool),
+                   APLOG_WARNING);
+}
+
+/* Set *KEY to the digest that identifies the response to the REPORT
+   DOC against RESOURCE for revision REVNUM.  Allocate *KEY in POOL. */
+static svn_error_t *
+make_key(svn_checksum_t **key,
+         const dav_resource *resource,
+         const apr_xml_doc *doc,
+         svn_revnum_t revnum,
+         apr_pool_t *pool)
+{
+  request_rec *r = resource->info->r;
+  const dav_svn_repos *repos = resource->info->repos;
+  svn_checksum_ctx_t *ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+  const char *uuid;
+  const char *user_class;
+  const char *settings;
+  const char *body;
+  apr_size_t size;
+
+  SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, pool));
+
+  /* With path-based authz, the response depends on who is asking.
+     Without it, everybody gets to see the same. */
+  if (! dav_svn__get_pathauthz_flag(r))
+    user_class = "*";
+  else if (repos->username)
+    user_class = apr_pstrcat(pool, "user:", repos->username, SVN_VA_NULL);
+  else
+    user_class = "anonymous";
+
+  /* The repository, the target revision, the reader and everything in
+     the configuration and request headers that affects the rendering. */
+  settings = apr_psprintf(pool, "%s\n%s\n%s\n%s\n%ld\n%d %d %d %d %d\n%s\n",
+                          repos->fs_path, uuid, repos->root_path,
+                          repos->special_uri, revnum,
+                          resource->info->svndiff_version,
+                          dav_svn__get_compression_level(r),
+                          (int)repos->bulk_updates, repos->v2_protocol,
+                          (int)resource->info->restype, user_class);
+  SVN_ERR(svn_checksum_update(ctx, settings, strlen(settings)));
+
+  /* The request itself. */
+  apr_xml_to_text(pool, doc->root, APR_XML_X2T_FULL, doc->namespaces, NULL,
+                  &body, &size);
+  SVN_ERR(svn_checksum_update(ctx, body, size));
+
+  return svn_error_trace(svn_checksum_final(key, ctx, pool));
+}
+
+dav_svn__report_cache_t *
+dav_svn__report_cache_open(const dav_resource *resource,
+                           const apr_xml_doc *doc,
+                           svn_revnum_t revnum,
+                           apr_pool_t *pool)
+{
+  request_rec *r = resource->info->r;
+  const char *dir = dav_svn__get_report_cache_path(r);
+  dav_svn__report_cache_t *cache;
+  svn_checksum_t *key;
+  svn_error_t *err;
+
+  if (! dir)
+    return NULL;
+
+  /* The key can't reflect changes to the authz rules.  So unless the
+     admin explicitly accepted that users may keep receiving reports
+     with content they are no longer allowed to read, don't cache at all
+     while path-based authz is active. */
+  if (dav_svn__get_pathauthz_flag(r)
+      && ! dav_svn__get_report_cache_authz_flag(r))
+    return NULL;
+
+  err = make_key(&key, resource, doc, revnum, pool);
+  if (err)
+    {
+      log_warning(r, err);
+      return NULL;
+    }
+
+  cache = apr_pcalloc(pool, sizeof(*cache));
+  cache->r = r;
+  cache->dir = dir;
+  cache->max_size = dav_svn__get_report_cache_size(r);
+  cache->added = dav_svn__get_report_cache_added(r);
+  cache->path = svn_dirent_join(dir, svn_checksum_to_cstring(key, pool),
+                                pool);
+
+  return cache;
+}
+
+svn_error_t *
+dav_svn__report_cache_send(svn_boolean_t *sent,
+                           dav_svn__report_cache_t *cache,
+                           dav_svn__output *output,
+                           apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_finfo_t finfo;
+  apr_bucket_brigade *bb;
+  svn_error_t *err;
+
+  *sent = FALSE;
+
+  /* The file must live as long as the brigade we pass it with. */
+  err = svn_io_file_open(&file, cache->path,
+                         APR_READ | APR_BINARY | APR_SENDFILE_ENABLED,
+                         APR_OS_DEFAULT, cache->r->pool);
+  if (err)
+    {
+      if (APR_STATUS_IS_ENOENT(err->apr_err))
+        svn_error_clear(err);
+      else
+        log_warning(cache->r, err);
+
+      return SVN_NO_ERROR;
+    }
+
+  err = svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file, scratch_pool);
+  if (err)
+    {
+      log_warning(cache->r, err);
+      return SVN_NO_ERROR;
+    }
+
+  /* Mark the entry as recently used.  This is merely a hint for the
+     eviction, so ignore failures. */
+  (void)apr_file_mtime_set(cache->path, apr_time_now(), scratch_pool);
+
+  bb = apr_brigade_create(cache->r->pool,
+                          dav_svn__output_get_bucket_alloc(output));
+  apr_brigade_insert_file(bb, file, 0, finfo.size, cache->r->pool);
+
+  /* Once we started sending, we can't fall back to rendering anymore. */
+  *sent = TRUE;
+
+  return svn_error_trace(dav_svn__output_pass_brigade(output, bb));
+}
+
+void
+dav_svn__report_cache_record(dav_svn__report_cache_t *cache)
+{
+  svn_error_t *err;
+
+  err = svn_io_open_uniquely_named(&cache->spool, &cache->spool_path,
+                                   cache->dir, "spool", SPOOL_SUFFIX,
+                                   svn_io_file_del_none,
+                                   cache->r->pool, cache->r->pool);
+  if (err)
+    {
+      cache->spool = NULL;
+      log_warning(cache->r, err);
+      return;
+    }
+
+  cache->spooled = 0;
+  cache->filter = ap_add_output_filter(DAV_SVN__REPORT_CACHE_FILTER, cache,
+                                       cache->r, cache->r->connection);
+}
+
+/* Close and remove the spool file of CACHE, if any. */
+static void
+discard_spool(dav_svn__report_cache_t *cache,
+              apr_pool_t *scratch_pool)
+{
+  if (! cache->spool)
+    return;
+
+  svn_error_clear(svn_io_file_close(cache->spool, scratch_pool));
+  svn_error_clear(svn_io_remove_file2(cache->spool_path, TRUE,
+                                      scratch_pool));
+  cache->spool = NULL;
+}
+
+/* Sort callback for svn_sort__hash(), ordering svn_io_dirent2_t values
+   from the least to the most recently modified. */
+static int
+compare_mtime(const svn_sort__item_t *a,
+              const svn_sort__item_t *b)
+{
+  const svn_io_dirent2_t *dirent_a = a->value;
+  const svn_io_dirent2_t *dirent_b = b->value;
+
+  if (dirent_a->mtime == dirent_b->mtime)
+    return 0;
+
+  return dirent_a->mtime < dirent_b->mtime ? -1 : 1;
+}
+
+/* Return TRUE if NAME is the name of a spool file. */
+static svn_boolean_t
+is_spool_file(const char *name)
+{
+  apr_size_t len = strlen(name);
+
+  return len >= sizeof(SPOOL_SUFFIX) - 1
+      && strcmp(name + len - (sizeof(SPOOL_SUFFIX) - 1), SPOOL_SUFFIX) == 0;
+}
+
+/* Remove the least recently used entries from the directory of CACHE
+   until their total size does not exceed the configured limit.  Also
+   remove abandoned spool files; leave all others alone, since other
+   processes are still recording into them.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+trim_cache(dav_svn__report_cache_t *cache,
+           apr_pool_t *scratch_pool)
+{
+  apr_hash_t *dirents;
+  apr_array_header_t *sorted;
+  apr_uint64_t total = 0;
+  apr_time_t abandoned = apr_time_now() - SPOOL_ABANDONED;
+  apr_pool_t *iterpool;
+  int i;
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, cache->dir, FALSE,
+                              scratch_pool, scratch_pool));
+  sorted = svn_sort__hash(dirents, compare_mtime, scratch_pool);
+
+  for (i = 0; i < sorted->nelts; i++)
+    {
+      const svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i,
+                                                    svn_sort__item_t);
+      const svn_io_dirent2_t *dirent = item->value;
+
+      if (dirent->kind == svn_node_file && ! is_spool_file(item->key))
+        total += dirent->filesize;
+    }
+
+  /* Other processes may be trimming at the same time, so files may
+     already be gone. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < sorted->nelts; i++)
+    {
+      const svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i,
+                                                    svn_sort__item_t);
+      const svn_io_dirent2_t *dirent = item->value;
+      svn_boolean_t spool_file = is_spool_file(item->key);
+
+      if (dirent->kind != svn_node_file)
+        continue;
+      if (spool_file ? dirent->mtime >= abandoned : total <= cache->max_size)
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_remove_file2(svn_dirent_join(cache->dir, item->key,
+                                                  iterpool),
+                                  TRUE, iterpool));
+      if (! spool_file)
+        total -= dirent->filesize;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Trim CACHE if this process added enough data to it since it last did
+   so, ADDED being the size of the entry that it just added.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+maybe_trim_cache(dav_svn__report_cache_t *cache,
+                 apr_off_t added,
+                 apr_pool_t *scratch_pool)
+{
+  apr_uint32_t added_kb = (apr_uint32_t)((added + 1023) / 1024);
+  apr_uint64_t threshold_kb = cache->max_size / 16 / 1024;
+
+  if (apr_atomic_add32(cache->added, added_kb) + added_kb < threshold_kb)
+    return SVN_NO_ERROR;
+
+  /* Concurrent requests will count towards the next trim. */
+  apr_atomic_set32(cache->added, 0);
+
+  return svn_error_trace(trim_cache(cache, scratch_pool));
+}
+
+void
+dav_svn__report_cache_finish(dav_svn__report_cache_t *cache,
+                             svn_boolean_t success,
+                             apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (cache->filter)
+    {
+      ap_remove_output_filter(cache->filter);
+      cache->filter = NULL;
+    }
+
+  if (! cache->spool)
+    return;
+
+  if (! success)
+    {
+      discard_spool(cache, scratch_pool);
+      return;
+    }
+
+  err = svn_io_file_close(cache->spool, scratch_pool);
+  cache->spool = NULL;
+  if (! err)
+    err = svn_io_file_rename2(cache->spool_path, cache->path, FALSE,
+                              scratch_pool);
+  if (err)
+    {
+      svn_error_clear(svn_io_remove_file2(cache->spool_path, TRUE,
+                                          scratch_pool));
+      log_warning(cache->r, err);
+      return;
+    }
+
+  err = maybe_trim_cache(cache, cache->spooled, scratch_pool);
+  if (err)
+    log_warning(cache->r, err);
+}
+
+apr_status_t
+dav_svn__report_cache_filter(ap_filter_t *f,
+                             apr_bucket_brigade *bb)
+{
+  dav_svn__report_cache_t *cache = f->ctx;
+  apr_bucket *bkt;
+
+  /* A single body may fill at most half of the cache. */
+  apr_off_t max_body = (apr_off_t)(cache->max_size / 2);
+
+  for (bkt = APR_BRIGADE_FIRST(bb);
+       cache->spool && bkt != APR_BRIGADE_SENTINEL(bb);
+       bkt = APR_BUCKET_NEXT(bkt))
+    {
+      const char *data;
+      apr_size_t len;
+      apr_status_t status;
+
+      if (APR_BUCKET_IS_METADATA(bkt))
+        continue;
+
+      status = apr_bucket_read(bkt, &data, &len, APR_BLOCK_READ);
+      if (status == APR_SUCCESS && cache->spooled + len > max_body)
+        status = APR_ENOSPC;
+      if (status == APR_SUCCESS)
+        status = apr_file_write_full(cache->spool, data, len, NULL);
+
+      if (status != APR_SUCCESS)
+        {
+          if (! APR_STATUS_IS_ENOSPC(status))
+            ap_log_rerror(APLOG_MARK, APLOG_WARNING, status, f->r,
+                          "Could not record the report response in '%s'",
+                          cache->spool_path);
+          discard_spool(cache, f->r->pool);
+        }
+      else
+        cache->spooled += len;
+    }
+
+  /* Don't bother with the remaining data if we gave up recording. */
+  if (! cache->spool)
+    {
+      cache->filter = NULL;
+      ap_remove_output_filter(f);
+    }
+
+  return ap_pass_brigade(f->next, bb);
+}
@@ -209,9 +209,9 @@ file_rev_handler(void *baton,
 
       base64_stream = dav_svn__make_base64_output_stream(frb->bb, frb->output,
                                                          pool);
-      svn_txdelta_to_svndiff3(&frb->window_handler, &frb->window_baton,
+      svn_txdelta_to_svndiff4(&frb->window_handler, &frb->window_baton,
                               base64_stream, frb->svndiff_version,
-                              frb->compression_level, pool);
+                              frb->compression_level, 1, pool);
       *window_handler = delta_window_handler;
       *window_baton = frb;
       /* Start the txdelta element which will be terminated by the window
@@ -0,0 +1,366 @@
+/*
+ * get-files.c: mod_dav_svn REPORT handler for fetching the contents of
+ *              many files at once
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+#include <apr_xml.h>
+
+#include <mod_dav.h>
+
+#include "svn_fs.h"
+#include "svn_xml.h"
+#include "svn_dav.h"
+#include "svn_delta.h"
+#include "svn_pools.h"
+
+#include "../dav_svn.h"
+
+/* The get-files REPORT is the bulk variant of a series of GET requests
+   with an optional X-SVN-VR-Base header, as issued by the update editor
+   of non-"send-all" clients.
+
+   Request:
+
+     <S:get-files-report xmlns:S="svn:">
+       <S:file>
+         <S:href>VERSION-URL</S:href>
+         <S:delta-base>VERSION-URL</S:delta-base>
+       </S:file>
+       ...
+     </S:get-files-report>
+
+   Response, in request order:
+
+     <S:get-files-report xmlns:S="svn:" xmlns:D="DAV:">
+       <S:file href="VERSION-URL"><S:txdelta>BASE64-SVNDIFF</S:txdelta></S:file>
+       ...
+     </S:get-files-report>
+
+   The delta-base element is optional.  If it is missing or doesn't
+   refer to a readable file, the delta is sent against the empty file.
+
+   Requests for more than MAX_FILES files are rejected. */
+
+/* Maximum number of files per request.  Clients send a few dozen; this
+   merely keeps a single request from occupying a worker for too long. */
+#define MAX_FILES 1000
+
+/* Maximum number of revision roots kept open while serving a request. */
+#define MAX_CACHED_ROOTS 16
+
+/* Baton for the get-files REPORT. */
+typedef struct get_files_baton_t
+{
+  const dav_resource *resource;
+
+  /* this buffers the output for a bit and is automatically flushed,
+     at appropriate times, by the Apache filter system. */
+  apr_bucket_brigade *bb;
+
+  /* where to deliver the output */
+  dav_svn__output *output;
+
+  /* Revision roots opened so far, mapping svn_revnum_t to
+     svn_fs_root_t *.  Most requested files share a few revisions.
+     The hash and the roots live in ROOTS_POOL, which gets cleared once
+     it holds MAX_CACHED_ROOTS roots. */
+  apr_hash_t *roots;
+  apr_pool_t *roots_pool;
+} get_files_baton_t;
+
+
+/* Set *ROOT and *PATH to the revision root and path of the version
+   resource URI.  If URI doesn't refer to a file the user may read, set
+   *ROOT to NULL and *NOT_FOUND_MSG to an explanation.  Allocate *PATH
+   in POOL; revision roots are cached in GFB. */
+static svn_error_t *
+resolve_file(svn_fs_root_t **root,
+             const char **path,
+             const char **not_found_msg,
+             get_files_baton_t *gfb,
+             const char *uri,
+             apr_pool_t *pool)
+{
+  const dav_resource *resource = gfb->resource;
+  dav_svn__uri_info info;
+  svn_node_kind_t kind;
+  svn_error_t *err;
+
+  *root = NULL;
+
+  err = dav_svn__simple_parse_uri(&info, resource, uri, pool);
+  if (err || !SVN_IS_VALID_REVNUM(info.rev))
+    {
+      svn_error_clear(err);
+      *not_found_msg = "is not a version resource";
+      return SVN_NO_ERROR;
+    }
+
+  if (! dav_svn__allow_read(resource->info->r, resource->info->repos,
+                            info.repos_path, info.rev, pool))
+    {
+      *not_found_msg = "is not readable";
+      return SVN_NO_ERROR;
+    }
+
+  *root = apr_hash_get(gfb->roots, &info.rev, sizeof(info.rev));
+  if (! *root)
+    {
+      svn_revnum_t *rev = apr_pmemdup(gfb->roots_pool, &info.rev,
+                                      sizeof(info.rev));
+
+      SVN_ERR(svn_fs_revision_root(root, resource->info->repos->fs,
+                                   info.rev, gfb->roots_pool));
+      apr_hash_set(gfb->roots, rev, sizeof(*rev), *root);
+    }
+
+  SVN_ERR(svn_fs_check_path(&kind, *root, info.repos_path, pool));
+  if (kind != svn_node_file)
+    {
+      *root = NULL;
+      *not_found_msg = "does not refer to a file";
+      return SVN_NO_ERROR;
+    }
+
+  *path = info.repos_path;
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the <S:file> element for the file at the version resource HREF,
+   as a delta against DELTA_BASE (which may be NULL), using the baton
+   GFB.  Use SCRATCH_POOL for temporary allocations. */
+static dav_error *
+send_file(get_files_baton_t *gfb,
+          const char *href,
+          const char *delta_base,
+          apr_pool_t *scratch_pool)
+{
+  const dav_resource *resource = gfb->resource;
+  svn_fs_root_t *root;
+  svn_fs_root_t *base_root = NULL;
+  const char *path;
+  const char *base_path = NULL;
+  const char *not_found_msg;
+  svn_txdelta_stream_t *txd_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *base64_stream;
+  svn_error_t *serr;
+
+  serr = resolve_file(&root, &path, &not_found_msg, gfb, href,
+                      scratch_pool);
+  if (serr)
+    return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                "Could not open the requested file",
+                                resource->pool);
+  if (! root)
+    return dav_svn__new_error(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                              apr_psprintf(resource->pool,
+                                           "The requested resource '%s' %s",
+                                           href, not_found_msg));
+
+  /* A delta base that we can't use is not an error; we simply send the
+     full contents instead. */
+  if (delta_base)
+    {
+      serr = resolve_file(&base_root, &base_path, &not_found_msg, gfb,
+                          delta_base, scratch_pool);
+      if (serr)
+        return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                    "Could not open the delta base",
+                                    resource->pool);
+    }
+
+  serr = svn_fs_get_file_delta_stream(&txd_stream, base_root, base_path,
+                                      root, path, scratch_pool);
+  if (serr)
+    return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                "Could not prepare to read a delta",
+                                resource->pool);
+
+  serr = dav_svn__brigade_printf(gfb->bb, gfb->output,
+                                 "<S:file href=\"%s\"><S:txdelta>",
+                                 apr_xml_quote_string(scratch_pool, href, 1));
+  if (serr)
+    return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                "Error writing REPORT response.",
+                                resource->pool);
+
+  base64_stream = dav_svn__make_base64_output_stream(gfb->bb, gfb->output,
+                                                     scratch_pool);
+  svn_txdelta_to_svndiff4(&handler, &handler_baton, base64_stream,
+                          resource->info->svndiff_version,
+                          dav_svn__get_compression_level(resource->info->r),
+                          1, scratch_pool);
+
+  /* The svndiff handler closes BASE64_STREAM, and with that flushes the
+     base64 encoder, when it receives the final NULL window. */
+  serr = svn_txdelta_send_txstream(txd_stream, handler, handler_baton,
+                                   scratch_pool);
+  if (serr)
+    return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                "Could not deliver the txdelta stream",
+                                resource->pool);
+
+  serr = dav_svn__brigade_puts(gfb->bb, gfb->output,
+                               "</S:txdelta></S:file>" DEBUG_CR);
+  if (serr)
+    return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                "Error writing REPORT response.",
+                                resource->pool);
+
+  return NULL;
+}
+
+dav_error *
+dav_svn__get_files_report(const dav_resource *resource,
+                          const apr_xml_doc *doc,
+                          dav_svn__output *output)
+{
+  svn_error_t *serr;
+  dav_error *derr = NULL;
+  apr_xml_elem *child;
+  get_files_baton_t gfb = { 0 };
+  apr_pool_t *iterpool;
+  int file_count = 0;
+  int ns;
+
+  /* Sanity check. */
+  ns = dav_svn__find_ns(doc->namespaces, SVN_XML_NAMESPACE);
+  if (ns == -1)
+    {
+      return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                    "The request does not contain the 'svn:' "
+                                    "namespace, so it is not going to have "
+                                    "certain required elements");
+    }
+
+  /* SVNAllowBulkUpdates Off: we don't advertise this report either. */
+  if (resource->info->repos->bulk_updates == CONF_BULKUPD_OFF)
+    {
+      return dav_svn__new_error_svn(resource->pool, HTTP_FORBIDDEN,
+                                    SVN_ERR_UNSUPPORTED_FEATURE, 0,
+                                    "Bulk transfers of file contents are "
+                                    "disabled for this repository");
+    }
+
+  /* Refuse oversized requests before we start the response. */
+  for (child = doc->root->first_child; child != NULL; child = child->next)
+    if (child->ns == ns && strcmp(child->name, "file") == 0)
+      file_count++;
+
+  if (file_count > MAX_FILES)
+    {
+      return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                    apr_psprintf(resource->pool,
+                                                 "Too many files requested; "
+                                                 "the limit is %d",
+                                                 MAX_FILES));
+    }
+
+  gfb.resource = resource;
+  gfb.output = output;
+  gfb.roots_pool = svn_pool_create(resource->pool);
+  gfb.roots = apr_hash_make(gfb.roots_pool);
+  gfb.bb = apr_brigade_create(resource->pool,
+                              dav_svn__output_get_bucket_alloc(output));
+
+  serr = dav_svn__brigade_puts(gfb.bb, gfb.output,
+                               DAV_XML_HEADER DEBUG_CR
+                               "<S:get-files-report xmlns:S=\""
+                               SVN_XML_NAMESPACE "\" "
+                               "xmlns:D=\"DAV:\">" DEBUG_CR);
+  if (serr)
+    {
+      derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                  "Error beginning REPORT response.",
+                                  resource->pool);
+      goto cleanup;
+    }
+
+  /* Send the files in the order they were requested, so the client can
+     process them as they arrive. */
+  iterpool = svn_pool_create(resource->pool);
+  for (child = doc->root->first_child; child != NULL; child = child->next)
+    {
+      const char *href = NULL;
+      const char *delta_base = NULL;
+      apr_xml_elem *elem;
+
+      /* if this element isn't one of ours, then skip it */
+      if (child->ns != ns || strcmp(child->name, "file") != 0)
+        continue;
+
+      svn_pool_clear(iterpool);
+
+      /* Roots opened for earlier files are only needed again if files
+         of the same revisions follow, which they usually do. */
+      if (apr_hash_count(gfb.roots) >= MAX_CACHED_ROOTS)
+        {
+          svn_pool_clear(gfb.roots_pool);
+          gfb.roots = apr_hash_make(gfb.roots_pool);
+        }
+
+      for (elem = child->first_child; elem != NULL; elem = elem->next)
+        {
+          if (elem->ns != ns)
+            continue;
+          else if (strcmp(elem->name, "href") == 0)
+            href = dav_xml_get_cdata(elem, iterpool, 1);
+          else if (strcmp(elem->name, "delta-base") == 0)
+            delta_base = dav_xml_get_cdata(elem, iterpool, 1);
+        }
+
+      if (! href)
+        {
+          derr = dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST,
+                                        0, 0,
+                                        "A requested file has no 'href' "
+                                        "element");
+          break;
+        }
+
+      derr = send_file(&gfb, href, delta_base, iterpool);
+      if (derr)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  if (derr)
+    goto cleanup;
+
+  if ((serr = dav_svn__brigade_puts(gfb.bb, gfb.output,
+                                    "</S:get-files-report>" DEBUG_CR)))
+    {
+      derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                  "Error ending REPORT response.",
+                                  resource->pool);
+      goto cleanup;
+    }
+
+ cleanup:
+  return dav_svn__final_flush_or_error(resource->info->r, gfb.bb, output,
+                                       derr, resource->pool);
+}
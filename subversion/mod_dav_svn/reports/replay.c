@@ -322,13 +322,14 @@ apply_textdelta(void *file_baton,
   else
     SVN_ERR(dav_svn__brigade_puts(eb->bb, eb->output, ">"));
 
-  svn_txdelta_to_svndiff3(handler,
+  svn_txdelta_to_svndiff4(handler,
                           handler_baton,
                           dav_svn__make_base64_output_stream(eb->bb,
                                                              eb->output,
                                                              pool),
                           eb->svndiff_version,
                           eb->compression_level,
+                          1,
                           pool);
 
   eb->sending_textdelta = TRUE;
@@ -828,9 +828,9 @@ upd_apply_textdelta(void *file_baton,
                                                      wb->uc->output,
                                                      file->pool);
 
-  svn_txdelta_to_svndiff3(&(wb->handler), &(wb->handler_baton),
+  svn_txdelta_to_svndiff4(&(wb->handler), &(wb->handler_baton),
                           base64_stream, file->uc->svndiff_version,
-                          file->uc->compression_level, file->pool);
+                          file->uc->compression_level, 1, file->pool);
 
   *handler = window_handler;
   *handler_baton = wb;
@@ -979,6 +979,8 @@ dav_svn__update_report(const dav_resource *resource,
   svn_boolean_t resource_walk = FALSE;
   svn_boolean_t ignore_ancestry = FALSE;
   svn_boolean_t send_copyfrom_args = FALSE;
+  svn_boolean_t saw_lock_token = FALSE;
+  dav_svn__report_cache_t *report_cache = NULL;
   dav_svn__authz_read_baton arb;
   apr_pool_t *subpool = svn_pool_create(resource->pool);
 
@@ -1327,7 +1329,10 @@ dav_svn__update_report(const dav_resource *resource,
                 else if (strcmp(this_attr->name, "start-empty") == 0)
                   start_empty = entry_is_empty = TRUE;
                 else if (strcmp(this_attr->name, "lock-token") == 0)
-                  locktoken = this_attr->value;
+                  {
+                    locktoken = this_attr->value;
+                    saw_lock_token = TRUE;
+                  }
 
                 this_attr = this_attr->next;
               }
@@ -1444,6 +1449,39 @@ dav_svn__update_report(const dav_resource *resource,
     dav_svn__operational_log(resource->info, action);
   }
 
+  /* If an identical report has been answered before, send the recorded
+     response instead of generating it again.  Lock tokens are checked
+     against the current locks, which may change without a new revision,
+     so we never cache reports that contain any. */
+  if (! saw_lock_token)
+    report_cache = dav_svn__report_cache_open(resource, doc, revnum,
+                                              resource->pool);
+  if (report_cache)
+    {
+      svn_boolean_t sent;
+
+      serr = dav_svn__report_cache_send(&sent, report_cache, output,
+                                        resource->pool);
+      if (sent)
+        {
+          svn_error_clear(svn_repos_abort_report(rbaton, resource->pool));
+          rbaton = NULL;
+        }
+
+      if (serr)
+        {
+          derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                      "Could not send the cached "
+                                      "update report",
+                                      resource->pool);
+          goto cleanup;
+        }
+      else if (sent)
+        goto cleanup;
+
+      dav_svn__report_cache_record(report_cache);
+    }
+
   /* this will complete the report, and then drive our editor to generate
      the response to the client. */
   serr = svn_repos_finish_report(rbaton, resource->pool);
@@ -1568,6 +1606,12 @@ dav_svn__update_report(const dav_resource *resource,
   /* Destroy our subpool. */
   svn_pool_destroy(subpool);
 
-  return dav_svn__final_flush_or_error(resource->info->r, uc.bb, output,
+  derr = dav_svn__final_flush_or_error(resource->info->r, uc.bb, output,
                                        derr, resource->pool);
+
+  /* Only keep complete, error-free responses in the report cache. */
+  if (report_cache)
+    dav_svn__report_cache_finish(report_cache, derr == NULL, resource->pool);
+
+  return derr;
 }
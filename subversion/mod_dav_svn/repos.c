@@ -3836,10 +3836,10 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
           svn_stream_set_close(o_stream, close_filter);
 
           /* get a handler/baton for writing into the output stream */
-          svn_txdelta_to_svndiff3(&handler, &h_baton,
+          svn_txdelta_to_svndiff4(&handler, &h_baton,
                                   o_stream, resource->info->svndiff_version,
                                   dav_svn__get_compression_level(resource->info->r),
-                                  resource->pool);
+                                  1, resource->pool);
 
           /* got everything set up. read in delta windows and shove them into
              the handler, which pushes data into the output stream, which goes
@@ -370,6 +370,11 @@ get_option(const dav_resource *resource,
                      apr_pstrdup(r->pool, capabilities[i].capability_name));
     }
 
+  /* The get-files REPORT sends file contents inline, just like a bulk
+     update, so don't offer it where those have been switched off. */
+  if (dav_svn__get_bulk_updates_flag(r) != CONF_BULKUPD_OFF)
+    apr_table_addn(r->headers_out, "DAV", SVN_DAV_NS_DAV_SVN_GET_FILES);
+
   return NULL;
 }
 
@@ -1180,6 +1185,10 @@ deliver_report(request_rec *r,
         {
           return dav_svn__list_report(resource, doc, output);
         }
+      else if (strcmp(doc->root->name, "get-files-report") == 0)
+        {
+          return dav_svn__get_files_report(resource, doc, output);
+        }
       /* NOTE: if you add a report, don't forget to add it to the
        *       dav_svn__reports_list[] array.
        */
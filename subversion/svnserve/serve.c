@@ -55,6 +55,7 @@
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
 #include "private/svn_fspath.h"
+#include "private/svn_subr_private.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>   /* For getpid() */
@@ -1736,6 +1737,95 @@ parse_dirent_fields(apr_uint32_t *dirent_fields_p,
   return SVN_NO_ERROR;
 }
 
+/* Response caching.
+ *
+ * The responses to get-dir, stat and check-path for a given path in a
+ * given revision are immutable as long as the revprops don't change.
+ * IDEs and build tools tend to send the same requests over and over, so
+ * we keep the marshalled responses in B->RESPONSE_CACHE and simply copy
+ * them to the connection on subsequent requests.  Responses that depend
+ * on the user's authz rules are not cached.
+ */
+
+/* Return the key for the cached response to command CMD on FULL_PATH in
+ * REV within B's repository.  FLAGS encodes all further command
+ * parameters that affect the response.  Allocate the result in POOL.
+ */
+static const char *
+response_cache_key(server_baton_t *b,
+                   const char *cmd,
+                   svn_revnum_t rev,
+                   apr_uint64_t flags,
+                   const char *full_path,
+                   apr_pool_t *pool)
+{
+  const char *repos_root = b->repository->repos_root;
+
+  /* The same path may be served by a different repository later, e.g.
+   * after it has been deleted and recreated.  Include the UUID to tell
+   * them apart.  Prefix the repository path with its length to make the
+   * key unique. */
+  return apr_psprintf(pool, "%s %ld %" APR_UINT64_T_FMT
+                      " %s %" APR_SIZE_T_FMT ":%s%s",
+                      cmd, rev, flags, b->repository->uuid,
+                      strlen(repos_root), repos_root, full_path);
+}
+
+/* If B's response cache contains a response for KEY, write it to CONN and
+ * set *FOUND to TRUE.  Set it to FALSE otherwise.  Use POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+write_cached_response(svn_boolean_t *found,
+                      svn_ra_svn_conn_t *conn,
+                      server_baton_t *b,
+                      const char *key,
+                      apr_pool_t *pool)
+{
+  svn_stringbuf_t *response;
+
+  SVN_ERR(svn_cache__get((void **)&response, found, b->response_cache, key,
+                         pool));
+  if (*found)
+    SVN_ERR(svn_ra_svn__write_raw(conn, pool, response->data,
+                                  response->len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a connection object that collects everything written to it in
+ * *RESPONSE.  Allocate both in POOL.
+ */
+static svn_ra_svn_conn_t *
+create_response_buffer(svn_stringbuf_t **response,
+                       apr_pool_t *pool)
+{
+  *response = svn_stringbuf_create_empty(pool);
+  return svn_ra_svn_create_conn5(NULL, svn_stream_empty(pool),
+                                 svn_stream_from_stringbuf(*response, pool),
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE, 0, 0, 0, 0,
+                                 pool);
+}
+
+/* Flush OUT, which has been created by create_response_buffer() together
+ * with RESPONSE, store the RESPONSE in B's response cache under KEY and
+ * write it to CONN.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+write_buffered_response(svn_ra_svn_conn_t *conn,
+                        server_baton_t *b,
+                        const char *key,
+                        svn_ra_svn_conn_t *out,
+                        svn_stringbuf_t *response,
+                        apr_pool_t *pool)
+{
+  SVN_ERR(svn_ra_svn__flush(out, pool));
+  SVN_ERR(svn_cache__set(b->response_cache, key, response, pool));
+
+  return svn_error_trace(svn_ra_svn__write_raw(conn, pool, response->data,
+                                               response->len));
+}
+
 static svn_error_t *
 get_dir(svn_ra_svn_conn_t *conn,
         apr_pool_t *pool,
@@ -1756,6 +1846,9 @@ get_dir(svn_ra_svn_conn_t *conn,
   svn_ra_svn__list_t *dirent_fields_list = NULL;
   int i;
   authz_baton_t ab;
+  const char *cache_key = NULL;
+  svn_ra_svn_conn_t *out = conn;
+  svn_stringbuf_t *response = NULL;
 
   ab.server = b;
   ab.conn = conn;
@@ -1784,6 +1877,28 @@ get_dir(svn_ra_svn_conn_t *conn,
                                        want_contents, want_props,
                                        dirent_fields, pool)));
 
+  /* The list of entries is filtered by authz and inherited props depend
+     on access to the parent paths.  So, we can only share the response
+     with other users if nothing gets filtered. */
+  if (b->response_cache
+      && !wants_inherited_props
+      && lookup_access(pool, b, svn_authz_read | svn_authz_recursive,
+                       full_path, FALSE))
+    {
+      svn_boolean_t found;
+
+      cache_key = response_cache_key(b, "get-dir", rev,
+                                     (apr_uint64_t)dirent_fields * 4
+                                       + (want_props ? 2 : 0)
+                                       + (want_contents ? 1 : 0),
+                                     full_path, pool);
+      SVN_ERR(write_cached_response(&found, conn, b, cache_key, pool));
+      if (found)
+        return SVN_NO_ERROR;
+
+      out = create_response_buffer(&response, pool);
+    }
+
   /* Fetch the root of the appropriate revision. */
   SVN_CMD_ERR(svn_fs_revision_root(&root, b->repository->fs, rev, pool));
 
@@ -1802,9 +1917,9 @@ get_dir(svn_ra_svn_conn_t *conn,
       SVN_CMD_ERR(svn_fs_dir_entries(&entries, root, full_path, pool));
 
   /* Begin response ... */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w(r(!", "success", rev));
-  SVN_ERR(svn_ra_svn__write_proplist(conn, pool, props));
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!)(!"));
+  SVN_ERR(svn_ra_svn__write_tuple(out, pool, "w(r(!", "success", rev));
+  SVN_ERR(svn_ra_svn__write_proplist(out, pool, props));
+  SVN_ERR(svn_ra_svn__write_tuple(out, pool, "!)(!"));
 
   /* Fetch the directory entries if requested and send them immediately. */
   if (want_contents)
@@ -1876,7 +1991,7 @@ get_dir(svn_ra_svn_conn_t *conn,
             cdate = missing_date;
 
           /* Send the entry. */
-          SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "cwnbr(?c)(?c)", name,
+          SVN_ERR(svn_ra_svn__write_tuple(out, pool, "cwnbr(?c)(?c)", name,
                                           svn_node_kind_to_word(entry_kind),
                                           (apr_uint64_t) entry_size,
                                           has_props, created_rev,
@@ -1889,24 +2004,28 @@ get_dir(svn_ra_svn_conn_t *conn,
     {
       apr_pool_t *iterpool = svn_pool_create(pool);
 
-      SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!)(?!"));
+      SVN_ERR(svn_ra_svn__write_tuple(out, pool, "!)(?!"));
       for (i = 0; i < inherited_props->nelts; i++)
         {
           svn_prop_inherited_item_t *iprop =
             APR_ARRAY_IDX(inherited_props, i, svn_prop_inherited_item_t *);
 
           svn_pool_clear(iterpool);
-          SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "!(c(!",
+          SVN_ERR(svn_ra_svn__write_tuple(out, iterpool, "!(c(!",
                                           iprop->path_or_url));
-          SVN_ERR(svn_ra_svn__write_proplist(conn, iterpool, iprop->prop_hash));
-          SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "!))!",
+          SVN_ERR(svn_ra_svn__write_proplist(out, iterpool, iprop->prop_hash));
+          SVN_ERR(svn_ra_svn__write_tuple(out, iterpool, "!))!",
                                           iprop->path_or_url));
         }
       svn_pool_destroy(iterpool);
     }
 
   /* Finish response. */
-  return svn_ra_svn__write_tuple(conn, pool, "!))");
+  SVN_ERR(svn_ra_svn__write_tuple(out, pool, "!))"));
+  if (cache_key)
+    SVN_ERR(write_buffered_response(conn, b, cache_key, out, response, pool));
+
+  return SVN_NO_ERROR;
 }
 
 static svn_error_t *
@@ -1921,15 +2040,17 @@ update(svn_ra_svn_conn_t *conn,
   svn_boolean_t recurse;
   svn_tristate_t send_copyfrom_args; /* Optional; default FALSE */
   svn_tristate_t ignore_ancestry; /* Optional; default FALSE */
+  svn_tristate_t send_text_deltas; /* Optional; default TRUE */
   /* Default to unknown.  Old clients won't send depth, but we'll
      handle that by converting recurse if necessary. */
   svn_depth_t depth = svn_depth_unknown;
   svn_boolean_t is_checkout;
 
   /* Parse the arguments. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3", &rev, &target,
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3?3", &rev, &target,
                                   &recurse, &depth_word,
-                                  &send_copyfrom_args, &ignore_ancestry));
+                                  &send_copyfrom_args, &ignore_ancestry,
+                                  &send_text_deltas));
   target = svn_relpath_canonicalize(target, pool);
 
   if (depth_word)
@@ -1945,7 +2066,8 @@ update(svn_ra_svn_conn_t *conn,
     SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->repository->fs, pool));
 
   SVN_ERR(accept_report(&is_checkout, NULL,
-                        conn, pool, b, rev, target, NULL, TRUE,
+                        conn, pool, b, rev, target, NULL,
+                        (send_text_deltas != svn_tristate_false),
                         depth,
                         (send_copyfrom_args == svn_tristate_true),
                         (ignore_ancestry == svn_tristate_true)));
@@ -2496,6 +2618,9 @@ check_path(svn_ra_svn_conn_t *conn,
   const char *path, *full_path;
   svn_fs_root_t *root;
   svn_node_kind_t kind;
+  const char *cache_key = NULL;
+  svn_ra_svn_conn_t *out = conn;
+  svn_stringbuf_t *response = NULL;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "c(?r)", &path, &rev));
   full_path = svn_fspath__join(b->repository->fs_path->data,
@@ -2511,10 +2636,26 @@ check_path(svn_ra_svn_conn_t *conn,
   SVN_ERR(log_command(b, conn, pool, "check-path %s@%d",
                       svn_path_uri_encode(full_path, pool), rev));
 
+  if (b->response_cache)
+    {
+      svn_boolean_t found;
+
+      cache_key = response_cache_key(b, "check-path", rev, 0, full_path,
+                                     pool);
+      SVN_ERR(write_cached_response(&found, conn, b, cache_key, pool));
+      if (found)
+        return SVN_NO_ERROR;
+
+      out = create_response_buffer(&response, pool);
+    }
+
   SVN_CMD_ERR(svn_fs_revision_root(&root, b->repository->fs, rev, pool));
   SVN_CMD_ERR(svn_fs_check_path(&kind, root, full_path, pool));
-  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, "w",
+  SVN_ERR(svn_ra_svn__write_cmd_response(out, pool, "w",
                                          svn_node_kind_to_word(kind)));
+  if (cache_key)
+    SVN_ERR(write_buffered_response(conn, b, cache_key, out, response, pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -2529,6 +2670,9 @@ stat_cmd(svn_ra_svn_conn_t *conn,
   const char *path, *full_path, *cdate;
   svn_fs_root_t *root;
   svn_dirent_t *dirent;
+  const char *cache_key = NULL;
+  svn_ra_svn_conn_t *out = conn;
+  svn_stringbuf_t *response = NULL;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "c(?r)", &path, &rev));
   full_path = svn_fspath__join(b->repository->fs_path->data,
@@ -2544,6 +2688,18 @@ stat_cmd(svn_ra_svn_conn_t *conn,
   SVN_ERR(log_command(b, conn, pool, "stat %s@%d",
                       svn_path_uri_encode(full_path, pool), rev));
 
+  if (b->response_cache)
+    {
+      svn_boolean_t found;
+
+      cache_key = response_cache_key(b, "stat", rev, 0, full_path, pool);
+      SVN_ERR(write_cached_response(&found, conn, b, cache_key, pool));
+      if (found)
+        return SVN_NO_ERROR;
+
+      out = create_response_buffer(&response, pool);
+    }
+
   SVN_CMD_ERR(svn_fs_revision_root(&root, b->repository->fs, rev, pool));
   SVN_CMD_ERR(svn_repos_stat(&dirent, root, full_path, pool));
 
@@ -2552,18 +2708,23 @@ stat_cmd(svn_ra_svn_conn_t *conn,
 
   if (dirent == NULL)
     {
-      SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, "()"));
-      return SVN_NO_ERROR;
+      SVN_ERR(svn_ra_svn__write_cmd_response(out, pool, "()"));
+    }
+  else
+    {
+      cdate = (dirent->time == (time_t) -1) ? NULL
+        : svn_time_to_cstring(dirent->time, pool);
+
+      SVN_ERR(svn_ra_svn__write_cmd_response(out, pool, "((wnbr(?c)(?c)))",
+                                             svn_node_kind_to_word(dirent->kind),
+                                             (apr_uint64_t) dirent->size,
+                                             dirent->has_props,
+                                             dirent->created_rev,
+                                             cdate, dirent->last_author));
     }
 
-  cdate = (dirent->time == (time_t) -1) ? NULL
-    : svn_time_to_cstring(dirent->time, pool);
-
-  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, "((wnbr(?c)(?c)))",
-                                         svn_node_kind_to_word(dirent->kind),
-                                         (apr_uint64_t) dirent->size,
-                                         dirent->has_props, dirent->created_rev,
-                                         cdate, dirent->last_author));
+  if (cache_key)
+    SVN_ERR(write_buffered_response(conn, b, cache_key, out, response, pool));
 
   return SVN_NO_ERROR;
 }
@@ -2821,9 +2982,10 @@ static svn_error_t *file_rev_handler(void *baton, const char *path,
       svn_stream_set_write(stream, svndiff_handler);
       svn_stream_set_close(stream, svndiff_close_handler);
 
-      svn_txdelta_to_svndiff3(d_handler, d_baton, stream,
+      svn_txdelta_to_svndiff4(d_handler, d_baton, stream,
                               svn_ra_svn__svndiff_version(frb->conn),
-                              svn_ra_svn_compression_level(frb->conn), pool);
+                              svn_ra_svn_compression_level(frb->conn), 1,
+                              pool);
     }
   else
     SVN_ERR(svn_ra_svn__write_cstring(frb->conn, pool, ""));
@@ -4119,6 +4281,7 @@ construct_server_baton(server_baton_t **baton,
   b->repository->use_sasl = FALSE;
 
   b->read_only = params->read_only;
+  b->response_cache = params->response_cache;
   b->pool = conn_pool;
   b->vhost = params->vhost;
 
@@ -4129,7 +4292,7 @@ construct_server_baton(server_baton_t **baton,
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwww?w?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
@@ -4143,11 +4306,17 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           svn_zstd__is_available()
+                                             ? SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED
+                                             : NULL,
+                                           params->concurrent_connections
+                                             ? SVN_RA_SVN_CAP_SKELETON_UPDATE
+                                             : NULL
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwww?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -4159,7 +4328,10 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           params->concurrent_connections
+                                             ? SVN_RA_SVN_CAP_SKELETON_UPDATE
+                                             : NULL
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
@@ -4311,6 +4483,59 @@ construct_server_baton(server_baton_t **baton,
   return SVN_NO_ERROR;
 }
 
+/* Return a hash mapping command names to the svn_ra_svn__cmd_entry_t
+   of all main commands, allocated in RESULT_POOL. */
+static apr_hash_t *
+make_command_hash(apr_pool_t *result_pool)
+{
+  const svn_ra_svn__cmd_entry_t *command;
+  apr_hash_t *cmd_hash = apr_hash_make(result_pool);
+
+  for (command = main_commands; command->cmdname; command++)
+    svn_hash_sets(cmd_hash, command->cmdname, command);
+
+  return cmd_hash;
+}
+
+/* Create the ra_svn connection object for CONNECTION, perform the
+   initial handshake and open the repository.  Use POOL for the server
+   baton. */
+static svn_error_t *
+init_connection(connection_t *connection,
+                apr_pool_t *pool)
+{
+  apr_status_t ar;
+
+  /* Enable TCP keep-alives on the socket so we time out when
+   * the connection breaks due to network-layer problems.
+   * If the peer has dropped the connection due to a network partition
+   * or a crash, or if the peer no longer considers the connection
+   * valid because we are behind a NAT and our public IP has changed,
+   * it will respond to the keep-alive probe with a RST instead of an
+   * acknowledgment segment, which will cause svn to abort the session
+   * even while it is currently blocked waiting for data from the peer. */
+  ar = apr_socket_opt_set(connection->usock, APR_SO_KEEPALIVE, 1);
+  if (ar)
+    {
+      /* It's not a fatal error if we cannot enable keep-alives. */
+    }
+
+  /* create the connection, configure ports etc. */
+  connection->conn
+    = svn_ra_svn_create_conn5(connection->usock, NULL, NULL,
+                              connection->params->compression_level,
+                              connection->params->zero_copy_limit,
+                              connection->params->error_check_interval,
+                              connection->params->max_request_size,
+                              connection->params->max_response_size,
+                              connection->pool);
+
+  /* Construct server baton and open the repository for the first time. */
+  return svn_error_trace(construct_server_baton(&connection->baton,
+                                                connection->conn,
+                                                connection->params, pool));
+}
+
 svn_error_t *
 serve_interruptable(svn_boolean_t *terminate_p,
                     connection_t *connection,
@@ -4319,47 +4544,14 @@ serve_interruptable(svn_boolean_t *terminate_p,
 {
   svn_boolean_t terminate = FALSE;
   svn_error_t *err = NULL;
-  const svn_ra_svn__cmd_entry_t *command;
   apr_pool_t *iterpool = svn_pool_create(pool);
 
   /* Prepare command parser. */
-  apr_hash_t *cmd_hash = apr_hash_make(pool);
-  for (command = main_commands; command->cmdname; command++)
-    svn_hash_sets(cmd_hash, command->cmdname, command);
+  apr_hash_t *cmd_hash = make_command_hash(pool);
 
   /* Auto-initialize connection */
   if (! connection->conn)
-    {
-      apr_status_t ar;
-
-      /* Enable TCP keep-alives on the socket so we time out when
-       * the connection breaks due to network-layer problems.
-       * If the peer has dropped the connection due to a network partition
-       * or a crash, or if the peer no longer considers the connection
-       * valid because we are behind a NAT and our public IP has changed,
-       * it will respond to the keep-alive probe with a RST instead of an
-       * acknowledgment segment, which will cause svn to abort the session
-       * even while it is currently blocked waiting for data from the peer. */
-      ar = apr_socket_opt_set(connection->usock, APR_SO_KEEPALIVE, 1);
-      if (ar)
-        {
-          /* It's not a fatal error if we cannot enable keep-alives. */
-        }
-
-      /* create the connection, configure ports etc. */
-      connection->conn
-        = svn_ra_svn_create_conn5(connection->usock, NULL, NULL,
-                                  connection->params->compression_level,
-                                  connection->params->zero_copy_limit,
-                                  connection->params->error_check_interval,
-                                  connection->params->max_request_size,
-                                  connection->params->max_response_size,
-                                  connection->pool);
-
-      /* Construct server baton and open the repository for the first time. */
-      err = construct_server_baton(&connection->baton, connection->conn,
-                                   connection->params, pool);
-    }
+    err = init_connection(connection, pool);
 
   /* If we can't access the repo for some reason, end this connection. */
   if (err)
@@ -4408,6 +4600,54 @@ serve_interruptable(svn_boolean_t *terminate_p,
   return svn_error_trace(err);
 }
 
+svn_error_t *
+serve_pending(svn_boolean_t *terminate_p,
+              connection_t *connection,
+              apr_pool_t *pool)
+{
+  svn_boolean_t terminate = FALSE;
+  svn_boolean_t has_command = TRUE;
+  svn_error_t *err = NULL;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_hash_t *cmd_hash = make_command_hash(pool);
+
+  /* Auto-initialize connection */
+  if (! connection->conn)
+    err = init_connection(connection, pool);
+
+  /* If we can't access the repo for some reason, end this connection. */
+  if (err)
+    terminate = TRUE;
+
+  /* Process all commands that the client already sent.  Once a command
+   * has been started, we will wait for the rest of it to come in. */
+  while (!terminate && !err)
+    {
+      svn_pool_clear(iterpool);
+
+      err = svn_ra_svn__has_command(&has_command, &terminate,
+                                    connection->conn, iterpool);
+      if (err || terminate || !has_command)
+        break;
+
+      err = svn_ra_svn__handle_command(&terminate, cmd_hash,
+                                       connection->baton,
+                                       connection->conn,
+                                       FALSE, iterpool);
+    }
+
+  /* The client will wait for our responses before sending anything
+   * else, so make sure they actually got sent. */
+  if (!terminate && !err)
+    err = svn_ra_svn__flush(connection->conn, iterpool);
+
+  svn_pool_destroy(iterpool);
+  if (terminate_p)
+    *terminate_p = terminate;
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *serve(svn_ra_svn_conn_t *conn,
                    serve_params_t *params,
                    apr_pool_t *pool)
@@ -27,6 +27,7 @@
 #define SERVER_H
 
 #include <apr_network_io.h>
+#include <apr_poll.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +38,7 @@ extern "C" {
 #include "svn_ra_svn.h"
 
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_mutex.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
@@ -90,6 +92,8 @@ typedef struct server_baton_t {
                               May be NULL even if log_file is not. */
   svn_boolean_t read_only; /* Disallow write access (global flag) */
   svn_boolean_t vhost;     /* Use virtual-host-based path to repo. */
+  svn_cache__t *response_cache; /* Marshalled command responses; may be
+                                   NULL.  See serve_params_t. */
   apr_pool_t *pool;
 } server_baton_t;
 
@@ -159,6 +163,17 @@ typedef struct serve_params_t {
 
   /* Use virtual-host-based path to repo. */
   svn_boolean_t vhost;
+
+  /* If not NULL, cache for the marshalled responses to get-dir, stat and
+     check-path commands, keyed by repository, revision, path and command
+     parameters.  Shared by all repositories and connections. */
+  svn_cache__t *response_cache;
+
+  /* True if further connections from the same client will be served
+     while one of its connections is busy, i.e. if every connection gets
+     its own process.  Only then can the client be told to fetch file
+     contents over additional connections. */
+  svn_boolean_t concurrent_connections;
 } serve_params_t;
 
 /* This structure contains all data that describes a client / server
@@ -192,6 +207,10 @@ typedef struct connection_t
      released.  */
   svn_atomic_t ref_count;
 
+  /* descriptor used to wait for new commands while the connection is
+     idle, i.e. not being served by any thread */
+  apr_pollfd_t pollfd;
+
 } connection_t;
 
 /* Return a client_info_t structure allocated in POOL and initialize it
@@ -221,6 +240,19 @@ serve_interruptable(svn_boolean_t *terminate_p,
                     svn_boolean_t (* is_busy)(connection_t *),
                     apr_pool_t *pool);
 
+/* Serve all commands that are readily available on CONNECTION without
+   waiting for the client to send new ones.  Flush all responses before
+   returning.  Set *TERMINATE_P to TRUE if the connection got terminated.
+
+   As with serve_interruptable, CONNECTION->CONN may be NULL for the
+   first call, in which case it will be created and the handshake with
+   the client will be performed.
+ */
+svn_error_t *
+serve_pending(svn_boolean_t *terminate_p,
+              connection_t *connection,
+              apr_pool_t *pool);
+
 /* Initialize the Cyrus SASL library. POOL is used for allocations. */
 svn_error_t *cyrus_init(apr_pool_t *pool);
 
@@ -145,6 +145,11 @@ enum run_mode {
  */
 #define THREADPOOL_THREAD_IDLE_LIMIT 1000000
 
+/* Number of connection events that we handle per call to apr_pollset_poll
+ * in threaded mode.  This does not limit the number of idle connections.
+ */
+#define POLLSET_BATCH_SIZE 64
+
 /* Number of client to server connections that may concurrently in the
  * TCP 3-way handshake state, i.e. are in the process of being created.
  *
@@ -222,6 +227,9 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_MMAP_PACKED     277
+#define SVNSERVE_OPT_CACHE_RESPONSES 278
+#define SVNSERVE_OPT_SHARED_CACHE    279
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -297,6 +305,14 @@ static const apr_getopt_option_t svnserve__options[] =
         "0 switches to dynamically sized caches.\n"
         "                             "
         "[used for FSFS and FSX repositories only]")},
+    {"memory-cache-shared", SVNSERVE_OPT_SHARED_CACHE, 1,
+     N_("share the in-memory cache between all processes\n"
+        "                             "
+        "forked to serve connections.\n"
+        "                             "
+        "Default is no.\n"
+        "                             "
+        "[used with fork mode only]")},
     {"cache-txdeltas", SVNSERVE_OPT_CACHE_TXDELTAS, 1,
      N_("enable or disable caching of deltas between older\n"
         "                             "
@@ -325,6 +341,16 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+    {"cache-responses", SVNSERVE_OPT_CACHE_RESPONSES, 1,
+     N_("enable or disable caching of get-dir, stat and\n"
+        "                             "
+        "check-path responses.  Changes to svn:author and\n"
+        "                             "
+        "svn:date revprops may not be visible to clients\n"
+        "                             "
+        "until the server gets restarted.\n"
+        "                             "
+        "Default is no.")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -341,6 +367,14 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is no.\n"
         "                             "
         "[used for FSFS repositories in 1.9 format only]")},
+    {"mmap-packed", SVNSERVE_OPT_MMAP_PACKED, 1,
+     N_("Read packed shards through memory mappings\n"
+        "                             "
+        "instead of buffered file I/O.\n"
+        "                             "
+        "Default is no.\n"
+        "                             "
+        "[used for FSFS repositories only]")},
 #ifdef CONNECTION_HAVE_THREAD_OPTION
     /* ### Making the assumption here that WIN32 never has fork and so
      * ### this option never exists when --service exists. */
@@ -614,6 +648,11 @@ static svn_root_pools__t *connection_pools;
 /* The global thread pool serving all connections. */
 static apr_thread_pool_t *threads;
 
+/* Idle connections waiting for the next client command, plus the
+   listening socket.  NULL, if the platform does not support thread-safe
+   pollsets.  In that case, idle connections will block a thread. */
+static apr_pollset_t *idle_connections;
+
 /* Very simple load determination callback for serve_interruptable:
    With less than half the threads in THREADS in use, we can afford to
    wait in the socket read() function.  Otherwise, poll them round-robin. */
@@ -656,6 +695,152 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
   return NULL;
 }
 
+/* Add CONNECTION to IDLE_CONNECTIONS such that the main thread will
+   schedule it for processing as soon as the client sends new data.
+   If that fails, fall back to serving it in a thread of its own. */
+static void
+park_connection(connection_t *connection)
+{
+  apr_pollfd_t *pollfd = &connection->pollfd;
+  apr_status_t status;
+
+  if (pollfd->p == NULL)
+    {
+      pollfd->p = connection->pool;
+      pollfd->desc_type = APR_POLL_SOCKET;
+      pollfd->reqevents = APR_POLLIN;
+      pollfd->desc.s = connection->usock;
+      pollfd->client_data = connection;
+    }
+
+  /* Once added, the main thread may take over the connection at any
+     moment, i.e. we must not access it afterwards. */
+  status = apr_pollset_add(idle_connections, pollfd);
+  if (status)
+    apr_thread_pool_push(threads, serve_thread, connection, 0, NULL);
+}
+
+/* Serve all commands that the client of the connection given by DATA
+   has sent so far.  Then, either close the connection or park it in
+   IDLE_CONNECTIONS. */
+static void * APR_THREAD_FUNC serve_pending_thread(apr_thread_t *tid,
+                                                   void *data)
+{
+  svn_boolean_t done;
+  connection_t *connection = data;
+  svn_error_t *err;
+
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+
+  /* process the actual request and log errors */
+  err = serve_pending(&done, connection, pool);
+  if (err)
+    {
+      logger__log_error(connection->params->logger, err, NULL,
+                        get_client_info(connection->conn, connection->params,
+                                        pool));
+      svn_error_clear(err);
+      done = TRUE;
+    }
+  svn_root_pools__release_pool(pool, connection_pools);
+
+  /* Close or park the connection. */
+  if (done)
+    close_connection(connection);
+  else
+    park_connection(connection);
+
+  return NULL;
+}
+
+/* Accept new connections on SOCK using PARAMS and wait for new commands
+ * on idle connections.  Hand both over to the worker THREADS.  Use POOL
+ * for allocations.
+ *
+ * Connections only occupy a worker thread while there are commands to
+ * process, i.e. the number of mostly idle clients is not limited by the
+ * number of threads.
+ */
+static svn_error_t *
+serve_parked_connections(apr_socket_t *sock,
+                         serve_params_t *params,
+                         apr_pool_t *pool)
+{
+  apr_pollfd_t listener = { 0 };
+  apr_status_t status;
+
+  listener.p = pool;
+  listener.desc_type = APR_POLL_SOCKET;
+  listener.reqevents = APR_POLLIN;
+  listener.desc.s = sock;
+  listener.client_data = NULL;
+
+  status = apr_pollset_add(idle_connections, &listener);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't poll the listening socket"));
+
+  /* A pending connection may get aborted before we accept it.  Don't let
+     that block the loop below. */
+  status = apr_socket_opt_set(sock, APR_SO_NONBLOCK, 1);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't poll the listening socket"));
+
+  while (1)
+    {
+      const apr_pollfd_t *signalled;
+      apr_int32_t count, i;
+
+      status = apr_pollset_poll(idle_connections, -1, &count, &signalled);
+      if (APR_STATUS_IS_EINTR(status))
+        continue;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't poll client connections"));
+
+      for (i = 0; i < count; ++i)
+        {
+          connection_t *connection = signalled[i].client_data;
+
+          if (connection)
+            {
+              /* Events will be reported until the data got read.  So,
+                 stop watching the connection while it gets served. */
+              status = apr_pollset_remove(idle_connections,
+                                          &connection->pollfd);
+              if (status)
+                return svn_error_wrap_apr(status,
+                                          _("Can't poll client connections"));
+            }
+          else
+            {
+              svn_error_t *err = accept_connection(&connection, sock, params,
+                                                   connection_mode_thread,
+                                                   pool);
+              if (err && APR_STATUS_IS_EAGAIN(err->apr_err))
+                {
+                  svn_error_clear(err);
+                  close_connection(connection);
+                  continue;
+                }
+              SVN_ERR(err);
+
+              /* Some platforms let the new socket inherit O_NONBLOCK. */
+              status = apr_socket_opt_set(connection->usock,
+                                          APR_SO_NONBLOCK, 0);
+              if (status)
+                return svn_error_wrap_apr(status,
+                                          _("Can't accept client connection"));
+            }
+
+          status = apr_thread_pool_push(threads, serve_pending_thread,
+                                        connection, 0, NULL);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't push task"));
+        }
+    }
+
+  /* NOTREACHED */
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -724,7 +909,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_nodeprops = TRUE;
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
+  svn_boolean_t cache_responses = FALSE;
+  svn_boolean_t shared_cache = FALSE;
   svn_boolean_t use_block_read = FALSE;
+  svn_boolean_t use_mmap = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
   int family = APR_INET;
@@ -774,6 +962,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.error_check_interval = 4096;
   params.max_request_size = MAX_REQUEST_SIZE * 0x100000;
   params.max_response_size = 0;
+  params.concurrent_connections = TRUE;
+  params.response_cache = NULL;
 
   while (1)
     {
@@ -925,10 +1115,22 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_CACHE_RESPONSES:
+          cache_responses = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
+        case SVNSERVE_OPT_SHARED_CACHE:
+          shared_cache = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_MMAP_PACKED:
+          use_mmap = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
         case SVNSERVE_OPT_CLIENT_SPEED:
           {
             apr_size_t bandwidth = (apr_size_t)apr_strtoi64(arg, NULL, 0);
@@ -1038,6 +1240,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 
   /* construct object pools */
   is_multi_threaded = handling_mode == connection_mode_thread;
+
+  /* Extra connections of a client waiting for a worker thread while its
+   * other connections hog the bounded thread pool would deadlock.  Only
+   * promise what a process per connection can actually deliver. */
+  params.concurrent_connections
+    = (run_mode == run_mode_inetd || run_mode == run_mode_tunnel
+       || (run_mode != run_mode_listen_once
+           && handling_mode == connection_mode_fork));
   params.fs_config = apr_hash_make(pool);
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                 cache_txdeltas ? "1" :"0");
@@ -1049,6 +1259,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                 cache_revprops ? "2" :"0");
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ,
                 use_block_read ? "1" :"0");
+  svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_MMAP_PACKED,
+                use_mmap ? "1" :"0");
 
   SVN_ERR(svn_repos__config_pool_create(&params.config_pool,
                                         is_multi_threaded,
@@ -1297,6 +1509,27 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_set(&settings);
   }
 
+  /* Forked children inherit the shared cache only if it has been created
+   * before the first fork.  Threads and single-process modes always share
+   * the cache anyway. */
+  if (shared_cache && handling_mode == connection_mode_fork)
+    {
+      svn_cache__set_global_membuffer_shared(TRUE);
+      svn_cache__get_global_membuffer_cache();
+    }
+
+  /* The response cache lives in the global membuffer and is therefore
+   * only available if that has been configured. */
+  if (cache_responses && svn_cache__get_global_membuffer_cache())
+    SVN_ERR(svn_cache__create_membuffer_cache(
+                &params.response_cache,
+                svn_cache__get_global_membuffer_cache(),
+                NULL, NULL, APR_HASH_KEY_STRING,
+                "svnserve:response",
+                SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                handling_mode == connection_mode_thread,
+                FALSE, pool, pool));
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
@@ -1323,11 +1556,21 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 
       /* don't queue requests unless we reached the worker thread limit */
       apr_thread_pool_threshold_set(threads, 0);
+
+      /* Wait for commands on idle connections without blocking a thread.
+         The worker threads will add connections while we are polling. */
+      status = apr_pollset_create(&idle_connections, POLLSET_BATCH_SIZE,
+                                  pool, APR_POLLSET_THREADSAFE);
+      if (status)
+        idle_connections = NULL;
     }
   else
     {
       threads = NULL;
     }
+
+  if (idle_connections && run_mode != run_mode_listen_once)
+    return serve_parked_connections(sock, &params, pool);
 #endif
 
   while (1)
@@ -26,6 +26,9 @@
 
 # General modules
 import os
+import socket
+import subprocess
+import time
 
 # Our testing module
 import svntest
@@ -1664,6 +1667,231 @@ def remove_access_after_commit(sbox):
                                         [], True)
 
 
+#----------------------------------------------------------------------
+# svnserve --cache-responses
+#
+# svnserveautocheck runs a forking svnserve without response caching, so
+# these tests start their own threaded svnserve for SBOX's repository.
+# All connections then share a single response cache.
+
+def start_caching_svnserve(sbox):
+  """Start a threaded svnserve with response caching serving the
+  repository of SBOX.  Return the process and the repository URL."""
+
+  svnserve = os.path.join(os.path.dirname(os.path.dirname(
+                            svntest.main.svn_binary)),
+                          'svnserve', 'svnserve' + svntest.main._exe)
+  if not os.path.isfile(svnserve):
+    raise svntest.Skip("svnserve not found at '%s'" % svnserve)
+
+  # Let the OS pick a free port.
+  s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+  s.bind(('127.0.0.1', 0))
+  port = s.getsockname()[1]
+  s.close()
+
+  proc = subprocess.Popen([svnserve, '-d', '--foreground', '-T',
+                           '--listen-host', '127.0.0.1',
+                           '--listen-port', str(port),
+                           '--cache-responses', 'on',
+                           '-r', sbox.repo_dir])
+
+  # Wait for it to accept connections.
+  for i in range(100):
+    try:
+      socket.create_connection(('127.0.0.1', port)).close()
+      break
+    except socket.error:
+      time.sleep(0.1)
+  else:
+    proc.kill()
+    raise svntest.Failure("svnserve did not start")
+
+  return proc, 'svn://127.0.0.1:%d' % port
+
+def stop_svnserve(proc):
+  "Terminate the svnserve process PROC."
+
+  proc.terminate()
+  proc.wait()
+
+def read_ra_svn_item(f):
+  """Read the next item of the ra_svn protocol from the binary stream F
+  and return it.  Lists become lists, strings become bytes and numbers as
+  well as words become str.  Return None for the end of a list."""
+
+  c = f.read(1)
+  while c.isspace():
+    c = f.read(1)
+  if c == b'(':
+    items = []
+    item = read_ra_svn_item(f)
+    while item is not None:
+      items.append(item)
+      item = read_ra_svn_item(f)
+    return items
+  if c == b')':
+    return None
+
+  token = c
+  c = f.read(1)
+  while c and not c.isspace() and c != b':':
+    token += c
+    c = f.read(1)
+  if not c:
+    raise svntest.Failure("Connection closed by svnserve")
+  if c == b':':
+    return f.read(int(token))
+  return token.decode()
+
+def ra_svn_get_dir(url, path, want_iprops):
+  """Anonymously send a get-dir request for the props and inherited
+  props of PATH in the HEAD revision of the repository at the svn:// URL
+  and return the parsed response."""
+
+  host, port = url[len('svn://'):].split(':')
+  sock = socket.create_connection((host, int(port)))
+  f = sock.makefile('rb')
+  url = url.encode()
+  path = path.encode()
+
+  read_ra_svn_item(f)  # greeting
+  sock.sendall(b'( 2 ( edit-pipeline svndiff1 absent-entries depth '
+               b'mergeinfo log-revprops ) %d:%s ) ' % (len(url), url))
+  read_ra_svn_item(f)  # auth request
+  sock.sendall(b'( ANONYMOUS ( 0: ) ) ')
+  read_ra_svn_item(f)  # auth response
+  read_ra_svn_item(f)  # repos info
+
+  # get-dir ( path ( ) want-props want-contents ( ) want-iprops )
+  sock.sendall(b'( get-dir ( %d:%s ( ) true false ( ) %s ) ) '
+               % (len(path), path, b'true' if want_iprops else b'false'))
+  response = read_ra_svn_item(f)
+
+  f.close()
+  sock.close()
+
+  if response[0] != 'success':
+    raise svntest.Failure("get-dir failed: %s" % repr(response))
+  return response
+
+@SkipUnless(svntest.main.is_ra_type_svn)
+def response_cache_revisions(sbox):
+  "svnserve --cache-responses across revisions"
+
+  sbox.build(create_wc = False)
+
+  proc, url = start_caching_svnserve(sbox)
+  try:
+    # r2 deletes A/B, r3 adds an empty A/B.
+    svntest.main.run_svn(None, 'rm', '-m', '', url + '/A/B')
+    svntest.main.run_svn(None, 'mkdir', '-m', '', url + '/A/B')
+
+    # Ask everything twice to get cache hits.
+    for i in range(2):
+      for rev, expected in [(1, ['B/\n', 'C/\n', 'D/\n', 'mu\n']),
+                            (2, ['C/\n', 'D/\n', 'mu\n']),
+                            (3, ['B/\n', 'C/\n', 'D/\n', 'mu\n'])]:
+        svntest.actions.run_and_verify_svn(expected, [],
+                                           'ls', '-r', str(rev), url + '/A')
+
+      svntest.actions.run_and_verify_svn(['E/\n', 'F/\n', 'lambda\n'], [],
+                                         'ls', '-r1', url + '/A/B')
+      svntest.actions.run_and_verify_svn(None, svntest.verify.AnyOutput,
+                                         'ls', '-r2', url + '/A/B')
+      svntest.actions.run_and_verify_svn([], [],
+                                         'ls', '-r3', url + '/A/B')
+      svntest.actions.run_and_verify_svn([], [], 'ls', url + '/A/B')
+      svntest.actions.run_and_verify_svn(['A/\n', 'iota\n'], [],
+                                         'ls', '-r1', url)
+
+    # A new repository at the same path must not get the cached responses
+    # for the old one.
+    svntest.main.safe_rmtree(sbox.repo_dir)
+    svntest.main.create_repos(sbox.repo_dir)
+    svntest.main.run_svn(None, 'mkdir', '-m', '', url + '/X')
+    svntest.actions.run_and_verify_svn(['X/\n'], [], 'ls', '-r1', url)
+  finally:
+    stop_svnserve(proc)
+
+@SkipUnless(svntest.main.is_ra_type_svn)
+def response_cache_authz(sbox):
+  "svnserve --cache-responses with path-based authz"
+
+  sbox.build(create_wc = False)
+
+  write_restrictive_svnserve_conf(sbox.repo_dir)
+  write_authz_file(sbox, { "/" : "* = r",
+                           "/A/B" : "* =\n" + svntest.main.wc_author + " = r"})
+
+  expected_err = ".*svn: E170001: Authorization failed.*"
+  restricted = ['--username', svntest.main.wc_author2]
+
+  proc, url = start_caching_svnserve(sbox)
+  try:
+    # Alternate between a user with recursive read access to /A and one
+    # with read access to /A but not to /A/B.  Either one's responses must
+    # not be served to the other.
+    for i in range(2):
+      svntest.actions.run_and_verify_svn(['B/\n', 'C/\n', 'D/\n', 'mu\n'],
+                                         [], 'ls', url + '/A')
+      svntest.actions.run_and_verify_svn(['C/\n', 'D/\n', 'mu\n'], [],
+                                         'ls', url + '/A', *restricted)
+      svntest.actions.run_and_verify_svn(['lambda\n'], [],
+                                         'ls', url + '/A/B/lambda')
+      svntest.actions.run_and_verify_svn(None, expected_err,
+                                         'ls', url + '/A/B/lambda',
+                                         *restricted)
+      svntest.actions.run_and_verify_svn(None, [],
+                                         'info', url + '/A/B')
+      svntest.actions.run_and_verify_svn(None, expected_err,
+                                         'info', url + '/A/B', *restricted)
+  finally:
+    stop_svnserve(proc)
+
+@SkipUnless(svntest.main.is_ra_type_svn)
+def response_cache_iprops(sbox):
+  "svnserve --cache-responses and inherited props"
+
+  sbox.build()
+
+  sbox.simple_propset('AProp', 'A-Prop-Val', 'A')
+  sbox.simple_propset('BProp', 'B-Prop-Val', 'A/B')
+  sbox.simple_commit()
+
+  write_restrictive_svnserve_conf(sbox.repo_dir, "read")
+  write_authz_file(sbox, { "/" : "* = r" })
+
+  def has_value(item, value):
+    if isinstance(item, list):
+      return any(has_value(i, value) for i in item)
+    return item == value
+
+  proc, url = start_caching_svnserve(sbox)
+  try:
+    # Without inherited props, the response may get cached.  That must
+    # not stop us from getting them later.
+    response = ra_svn_get_dir(url, 'A/B', False)
+    if not has_value(response, b'B-Prop-Val'):
+      raise svntest.Failure("Missing props: %s" % repr(response))
+    response = ra_svn_get_dir(url, 'A/B', True)
+    if not has_value(response, b'A-Prop-Val'):
+      raise svntest.Failure("Missing inherited props: %s" % repr(response))
+
+    # Inherited props depend on read access to the parents.
+    write_authz_file(sbox, { "/" : "* = r",
+                             "/A" : "* =",
+                             "/A/B" : "* = r" })
+    response = ra_svn_get_dir(url, 'A/B', True)
+    if has_value(response, b'A-Prop-Val'):
+      raise svntest.Failure("Unreadable inherited props: %s"
+                            % repr(response))
+    if not has_value(response, b'B-Prop-Val'):
+      raise svntest.Failure("Missing props: %s" % repr(response))
+  finally:
+    stop_svnserve(proc)
+
+
 ########################################################################
 # Run the tests
 
@@ -1700,6 +1928,9 @@ test_list = [ None,
               authz_file_external_to_authz,
               authz_log_censor_revprops,
               remove_access_after_commit,
+              response_cache_revisions,
+              response_cache_authz,
+              response_cache_iprops,
              ]
 serial_only = True
 
@@ -25,7 +25,7 @@
 ######################################################################
 
 # General modules
-import shutil, stat, re, os, logging
+import shutil, stat, re, os, logging, socket
 
 logger = logging.getLogger()
 
@@ -3234,6 +3234,76 @@ def filtered_ls_top_level_path(sbox):
       [], [], 'ls', f_path, '--search=*/*', *extra_opts)
 
 
+#----------------------------------------------------------------------
+
+def _svn_read_until(sock, data, pattern):
+  "Receive data from SOCK until DATA matches PATTERN.  Return the match."
+
+  while True:
+    match = re.search(pattern, data, re.DOTALL)
+    if match:
+      return match, data[match.end():]
+
+    received = sock.recv(4096)
+    if not received:
+      raise svntest.Failure("Connection closed by the server")
+    data += received
+
+def _svn_open_session(url):
+  "Open an anonymous ra_svn session to URL and return the socket."
+
+  loc = svntest.main.urlparse(url)
+  sock = socket.create_connection((loc.hostname, loc.port or 3690))
+  url = url.encode()
+
+  # Greeting, client response and anonymous authentication.
+  match, data = _svn_read_until(sock, b'',
+                                br'\( success \( \d+ \d+ .*?\) \) \) ')
+  sock.sendall(b'( 2 ( edit-pipeline svndiff1 ) '
+               + str(len(url)).encode() + b':' + url + b' ) ')
+  match, data = _svn_read_until(sock, data, br'\( success \( \( .*?\) \) ')
+  sock.sendall(b'( ANONYMOUS ( 0: ) ) ')
+  match, data = _svn_read_until(sock, data,
+                                br'\( success \( \) \) \( success \( '
+                                br'.*?\( [^)]*\) \) \) ')
+  if data:
+    raise svntest.Failure("Unexpected data from the server")
+
+  return sock
+
+@SkipUnless(svntest.main.is_ra_type_svn)
+def many_idle_sessions(sbox):
+  "many mostly idle svn:// sessions"
+
+  sbox.build(create_wc=False, read_only=True)
+
+  # With a threaded svnserve, more than its default thread limit.
+  sessions = [_svn_open_session(sbox.repo_url) for i in range(300)]
+
+  try:
+    # The server must still be responsive to other clients.
+    svntest.actions.run_and_verify_svn(['A/\n', 'iota\n'], [],
+                                       'ls', sbox.repo_url)
+
+    # Wake up all the idle sessions at once.
+    for sock in sessions:
+      sock.sendall(b'( get-latest-rev ( ) ) ')
+
+    for sock in sessions:
+      match, data = _svn_read_until(sock, b'', br'\( success \( (\d+) \) \) ')
+      if int(match.group(1)) != 1:
+        raise svntest.Failure("Unexpected youngest revision %s"
+                              % match.group(1))
+
+    # And they still work after having been idle again.
+    for sock in sessions[::10]:
+      sock.sendall(b'( get-latest-rev ( ) ) ')
+      _svn_read_until(sock, b'', br'\( success \( 1 \) \) ')
+
+  finally:
+    for sock in sessions:
+      sock.close()
+
 ########################################################################
 # Run the tests
 
@@ -3308,6 +3378,7 @@ test_list = [ None,
               null_update_last_changed_revision,
               null_prop_update_last_changed_revision,
               filtered_ls_top_level_path,
+              many_idle_sessions,
              ]
 
 if __name__ == '__main__':
@@ -583,6 +583,33 @@ cat >> "$HTTPD_CFG" <<__EOF__
   Require           valid-user
   ${SVN_PATH_AUTHZ_LINE}
 </Location>
+<Location /report-cache-test-work/repositories>
+__EOF__
+location_common
+cat >> "$HTTPD_CFG" <<__EOF__
+  SVNParentPath     "$ABS_BUILDDIR/subversion/tests/cmdline/svn-test-work/repositories"
+  Require           valid-user
+  SVNPathAuthz      Off
+  SVNReportCachePath "$ABS_BUILDDIR/subversion/tests/cmdline/svn-test-work/report-cache"
+</Location>
+<Location /report-cache-authz-test-work/repositories>
+__EOF__
+location_common
+cat >> "$HTTPD_CFG" <<__EOF__
+  SVNParentPath     "$ABS_BUILDDIR/subversion/tests/cmdline/svn-test-work/repositories"
+  Require           valid-user
+  SVNPathAuthz      On
+  SVNReportCacheAuthz Off
+  SVNReportCachePath "$ABS_BUILDDIR/subversion/tests/cmdline/svn-test-work/report-cache-authz"
+</Location>
+<Location /no-bulk-test-work/repositories>
+__EOF__
+location_common
+cat >> "$HTTPD_CFG" <<__EOF__
+  SVNParentPath     "$ABS_BUILDDIR/subversion/tests/cmdline/svn-test-work/repositories"
+  Require           valid-user
+  SVNAllowBulkUpdates Off
+</Location>
 <Location /authz-test-work/anon>
   DAV               svn
   SVNParentPath     "$ABS_BUILDDIR/subversion/tests/cmdline/svn-test-work/local_tmp"
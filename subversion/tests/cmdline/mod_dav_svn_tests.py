@@ -25,7 +25,7 @@
 ######################################################################
 
 # General modules
-import os, logging, base64, functools
+import os, logging, base64, functools, time
 
 try:
   # Python <3.0
@@ -38,6 +38,7 @@ logger = logging.getLogger()
 
 # Our testing module
 import svntest
+from svntest.main import write_authz_file
 
 # (abbreviation)
 Skip = svntest.testcase.Skip_deco
@@ -46,6 +47,7 @@ XFail = svntest.testcase.XFail_deco
 Issues = svntest.testcase.Issues_deco
 Issue = svntest.testcase.Issue_deco
 Wimp = svntest.testcase.Wimp_deco
+Item = svntest.wc.StateItem
 
 ######################################################################
 # Helper routines
@@ -640,6 +642,257 @@ def propfind_propname(sbox):
   actual_response = r.read()
   verify_xml_response(expected_response, actual_response)
 
+
+@SkipUnless(svntest.main.is_ra_type_dav_serf)
+def checkout_skelta_many_files(sbox):
+  "checkout many small files in skelta mode"
+
+  sbox.build()
+
+  # Enough files to fill several get-files REPORTs.
+  sbox.simple_mkdir('many')
+  expected_disk = svntest.main.greek_state.copy()
+  expected_disk.add({'many' : Item()})
+  for i in range(200):
+    name = 'many/file-%d' % i
+    svntest.main.file_write(sbox.ospath(name), 'This is file %d.\n' % i)
+    sbox.simple_add(name)
+    expected_disk.add({name : Item(contents='This is file %d.\n' % i)})
+  sbox.simple_commit()
+
+  # Unreadable paths must not end up in the get-files REPORTs.
+  write_authz_file(sbox, { '/' : '* = r',
+                           '/A/D/G' : '* =',
+                           '/many/file-42' : '* =' })
+  expected_disk.remove('A/D/G', 'A/D/G/pi', 'A/D/G/rho', 'A/D/G/tau',
+                       'many/file-42')
+
+  expected_output = expected_disk.copy()
+  expected_output.wc_dir = sbox.add_wc_path('skelta')
+  expected_output.tweak(status='A ', contents=None)
+
+  svntest.actions.run_and_verify_checkout(sbox.repo_url,
+                                          expected_output.wc_dir,
+                                          expected_output,
+                                          expected_disk,
+                                          [],
+                                          '--config-option',
+                                          'servers:global:'
+                                          'http-bulk-updates=no')
+
+
+@SkipUnless(svntest.main.is_ra_type_dav)
+def get_files_report(sbox):
+  "verify get-files REPORT responses"
+
+  sbox.build(create_wc=False)
+  repo_uripath = '/' + svntest.wc.svn_uri_quote(
+    sbox.repo_dir.replace(os.path.sep, '/'))
+  write_authz_file(sbox, { '/' : '* = r',
+                           '/A/mu' : '* =' })
+
+  headers = {
+    'Authorization': 'Basic ' + base64.b64encode(b'jconstant:rayjandom').decode(),
+  }
+
+  def get_files(paths):
+    h = svntest.main.create_http_connection(sbox.repo_url)
+    req_body = (
+      '<?xml version="1.0" encoding="utf-8"?>\n'
+      '<S:get-files-report xmlns:S="svn:">\n'
+      + ''.join('<S:file><S:href>%s/!svn/rvr/1/%s</S:href></S:file>\n'
+                % (repo_uripath, path) for path in paths)
+      + '</S:get-files-report>\n'
+      )
+    h.request('REPORT', sbox.repo_url + '/!svn/me', req_body, headers)
+    r = h.getresponse()
+    return r.status, r.read().decode()
+
+  def file_elem(path):
+    return '<S:file href="%s/!svn/rvr/1/%s">' % (repo_uripath, path)
+
+  # Readable files are delivered in request order.
+  status, body = get_files(['iota', 'A/B/lambda'])
+  if status != httplib.OK:
+    raise svntest.Failure('Unexpected status: %d' % status)
+  if not 0 <= body.find(file_elem('iota')) < body.find(file_elem('A/B/lambda')):
+    raise svntest.Failure('Files missing from response: %s' % body)
+
+  # Nothing is sent for an unreadable file or anything requested after it.
+  status, body = get_files(['iota', 'A/mu', 'A/B/lambda'])
+  if file_elem('A/mu') in body or file_elem('A/B/lambda') in body:
+    raise svntest.Failure('Unreadable file delivered: %s' % body)
+
+  # Oversized requests are refused up front.
+  status, body = get_files(['iota'] * 1001)
+  if status != httplib.BAD_REQUEST:
+    raise svntest.Failure('Unexpected status: %d' % status)
+
+@SkipUnless(svntest.main.is_ra_type_dav)
+def get_files_report_bulk_off(sbox):
+  "no get-files REPORT without bulk updates"
+
+  sbox.build(create_wc=False)
+  url = sbox.repo_url.replace('/svn-test-work/repositories/',
+                              '/no-bulk-test-work/repositories/')
+  if url == sbox.repo_url:
+    raise svntest.Skip('SVNAllowBulkUpdates Off location not configured')
+  repo_uripath = '/' + svntest.wc.svn_uri_quote(
+    sbox.repo_dir.replace(os.path.sep, '/'))
+
+  headers = {
+    'Authorization': 'Basic ' + base64.b64encode(b'jconstant:rayjandom').decode(),
+  }
+
+  # The capability is not advertised ...
+  h = svntest.main.create_http_connection(url)
+  req_body = (
+    '<?xml version="1.0" encoding="utf-8"?>\n'
+    '<D:options xmlns:D="DAV:"><D:activity-collection-set/></D:options>\n'
+    )
+  h.request('OPTIONS', url, req_body, headers)
+  r = h.getresponse()
+  r.read()
+  if r.status != httplib.OK:
+    raise svntest.Failure('Unexpected status: %d' % r.status)
+  if 'http://subversion.tigris.org/xmlns/dav/svn/get-files' in \
+      (r.getheader('DAV') or ''):
+    raise svntest.Failure('get-files advertised: %s' % r.getheader('DAV'))
+
+  # ... and the REPORT is refused.
+  h = svntest.main.create_http_connection(url)
+  req_body = (
+    '<?xml version="1.0" encoding="utf-8"?>\n'
+    '<S:get-files-report xmlns:S="svn:">\n'
+    '<S:file><S:href>%s/!svn/rvr/1/iota</S:href></S:file>\n'
+    '</S:get-files-report>\n'
+    ) % repo_uripath
+  h.request('REPORT', url + '/!svn/me', req_body, headers)
+  r = h.getresponse()
+  body = r.read().decode()
+  if r.status != httplib.FORBIDDEN:
+    raise svntest.Failure('Unexpected status: %d %s' % (r.status, body))
+
+def report_cache_url(sbox, location):
+  """Return the URL of the repository of SBOX below the davautocheck
+  LOCATION that keeps its report cache in the directory named after it
+  within the test work area.  Create that directory, empty, and return
+  its path as well."""
+
+  url = sbox.repo_url.replace('/svn-test-work/repositories/',
+                              '/%s-test-work/repositories/' % location)
+  if url == sbox.repo_url:
+    raise svntest.Skip('Report cache location not configured')
+
+  cache_dir = os.path.join(svntest.main.work_dir, location)
+  svntest.main.safe_rmtree(cache_dir)
+  os.makedirs(cache_dir)
+
+  return url, cache_dir
+
+def update_report(url, entries):
+  """Send an update REPORT to revision 1 of the repository at URL with the
+  S:entry elements ENTRIES.  Return the status and the response body."""
+
+  headers = {
+    'Authorization': 'Basic ' + base64.b64encode(b'jconstant:rayjandom').decode(),
+  }
+  req_body = (
+    '<?xml version="1.0" encoding="utf-8"?>\n'
+    '<S:update-report xmlns:S="svn:" send-all="true">\n'
+    '<S:src-path>%s</S:src-path>\n'
+    '<S:target-revision>1</S:target-revision>\n'
+    '<S:depth>unknown</S:depth>\n'
+    '%s'
+    '</S:update-report>\n'
+    ) % (url, entries)
+
+  h = svntest.main.create_http_connection(url)
+  h.request('REPORT', url + '/!svn/vcc/default', req_body, headers)
+  r = h.getresponse()
+  if r.status == httplib.NOT_FOUND:
+    raise svntest.Skip('Report cache location not configured')
+
+  return r.status, r.read()
+
+def wait_for_cache_entry(cache_dir):
+  """Return the names in CACHE_DIR once there is anything but spool
+  files in it.  The server may still be storing the entry after the
+  client got the last byte of the response."""
+
+  for i in range(50):
+    entries = os.listdir(cache_dir)
+    if entries and not any(e.endswith('.tmp') for e in entries):
+      return entries
+    time.sleep(0.1)
+
+  raise svntest.Failure('Nothing got cached: %s' % os.listdir(cache_dir))
+
+@SkipUnless(svntest.main.is_ra_type_dav)
+def report_cache(sbox):
+  "update REPORTs served from SVNReportCachePath"
+
+  sbox.build(create_wc=False)
+  url, cache_dir = report_cache_url(sbox, 'report-cache')
+  checkout = '<S:entry rev="1" depth="infinity" start-empty="true"></S:entry>\n'
+
+  # The first report gets recorded ...
+  status, body = update_report(url, checkout)
+  if status != httplib.OK:
+    raise svntest.Failure('Unexpected status: %d' % status)
+  entries = wait_for_cache_entry(cache_dir)
+  if len(entries) != 1:
+    raise svntest.Failure('Unexpected cache contents: %s' % entries)
+  with open(os.path.join(cache_dir, entries[0]), 'rb') as f:
+    if f.read() != body:
+      raise svntest.Failure('Cache entry differs from the response')
+
+  # ... and an identical one gets exactly the same response from it.
+  status, cached_body = update_report(url, checkout)
+  if status != httplib.OK or cached_body != body:
+    raise svntest.Failure('Cached response differs from the original')
+  if os.listdir(cache_dir) != entries:
+    raise svntest.Failure('Unexpected cache contents: %s'
+                          % os.listdir(cache_dir))
+
+  # Responses to reports with lock tokens depend on the current locks.
+  svntest.main.safe_rmtree(cache_dir)
+  os.makedirs(cache_dir)
+  status, body = update_report(url,
+                               '<S:entry rev="1" depth="infinity"></S:entry>\n'
+                               '<S:entry rev="1" lock-token="opaquelocktoken:'
+                               'a1b2c3d4-0000-0000-0000-000000000000">'
+                               'iota</S:entry>\n')
+  if status != httplib.OK:
+    raise svntest.Failure('Unexpected status: %d' % status)
+  if os.listdir(cache_dir):
+    raise svntest.Failure('Report with lock token got cached: %s'
+                          % os.listdir(cache_dir))
+
+  # A failing report must neither leave an entry nor a spool file behind.
+  update_report(url,
+                '<S:entry rev="1" depth="infinity"></S:entry>\n'
+                '<S:entry rev="99">iota</S:entry>\n')
+  if os.listdir(cache_dir):
+    raise svntest.Failure('Failed report left cache contents: %s'
+                          % os.listdir(cache_dir))
+
+@SkipUnless(svntest.main.is_ra_type_dav)
+def report_cache_path_authz(sbox):
+  "no report caching with SVNReportCacheAuthz Off"
+
+  sbox.build(create_wc=False)
+  url, cache_dir = report_cache_url(sbox, 'report-cache-authz')
+  checkout = '<S:entry rev="1" depth="infinity" start-empty="true"></S:entry>\n'
+
+  # SVNPathAuthz is on, so nothing may be cached.
+  for i in range(2):
+    status, body = update_report(url, checkout)
+    if status != httplib.OK:
+      raise svntest.Failure('Unexpected status: %d' % status)
+    if os.listdir(cache_dir):
+      raise svntest.Failure('Report got cached: %s' % os.listdir(cache_dir))
+
 ########################################################################
 # Run the tests
 
@@ -652,6 +905,11 @@ test_list = [ None,
               propfind_404,
               propfind_allprop,
               propfind_propname,
+              checkout_skelta_many_files,
+              get_files_report,
+              get_files_report_bulk_off,
+              report_cache,
+              report_cache_path_authz,
              ]
 serial_only = True
 
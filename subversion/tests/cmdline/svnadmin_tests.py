@@ -3913,6 +3913,195 @@ def recover_prunes_rep_cache_when_disabled(sbox):
 
   check_recover_prunes_rep_cache(sbox, enable_rep_sharing=False)
 
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+def verify_jobs(sbox):
+  "svnadmin verify --jobs"
+
+  sbox.build()
+  patch_format(sbox.repo_dir, shard_size=2)
+
+  # Spread some changes across several shards.
+  for i in range(6):
+    sbox.simple_append('iota', "Line %d.\n" % i)
+    sbox.simple_propset('prop', str(i), 'A/mu')
+    sbox.simple_commit(message='r%d' % (i + 2))
+
+  if svntest.main.fs_has_pack():
+    svntest.actions.run_and_verify_svnadmin(None, [], "pack", sbox.repo_dir)
+
+  # Verification results must be reported in the same order, no matter
+  # how many threads we use.
+  exit_code, expected_output, errput = \
+    svntest.main.run_svnadmin("verify", sbox.repo_dir)
+  if errput:
+    raise svntest.Failure("Unexpected error while running 'svnadmin verify'")
+
+  svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                          "verify", "--jobs", "4",
+                                          sbox.repo_dir)
+
+  # Invalid job counts are being rejected.
+  svntest.actions.run_and_verify_svnadmin(None, ".*Invalid number of jobs",
+                                          "verify", "--jobs", "0",
+                                          sbox.repo_dir)
+
+@SkipUnless(svntest.main.fs_has_pack)
+def pack_jobs(sbox):
+  "svnadmin pack --jobs"
+
+  sbox.build(create_wc=False)
+  patch_format(sbox.repo_dir, shard_size=2)
+
+  # Spread some changes across several shards.
+  for i in range(7):
+    svntest.actions.run_and_verify_svnmucc(None, [],
+                                           '-U', sbox.repo_url,
+                                           '-m', 'r%d' % (i + 2),
+                                           'propset', 'prop', str(i), 'iota')
+
+  # Progress must be reported in shard order, no matter how many threads
+  # we use.
+  expected_output = ["Packing revisions in shard %d...done.\n" % i
+                     for i in range(4)]
+  if svntest.main.is_fs_type_fsfs and svntest.main.options.fsfs_packing:
+    # With --fsfs-packing, everything is already packed.
+    expected_output = None
+  svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                          "pack", "--jobs", "4",
+                                          sbox.repo_dir)
+
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "verify", sbox.repo_dir)
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+def hotcopy_jobs(sbox):
+  "svnadmin hotcopy --jobs"
+
+  sbox.build(create_wc=False)
+  patch_format(sbox.repo_dir, shard_size=2)
+
+  def add_revisions(count):
+    for i in range(count):
+      svntest.actions.run_and_verify_svnmucc(None, [],
+                                             '-U', sbox.repo_url,
+                                             '-m', 'log msg',
+                                             'propset', 'prop', str(i),
+                                             'iota')
+
+  # Have a mix of packed and non-packed shards.
+  add_revisions(6)
+  if svntest.main.fs_has_pack():
+    svntest.actions.run_and_verify_svnadmin(None, [],
+                                            "pack", sbox.repo_dir)
+  add_revisions(3)
+
+  backup_dir, backup_url = sbox.add_repo_path('backup')
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "hotcopy", "--jobs", "4",
+                                          sbox.repo_dir, backup_dir)
+  check_hotcopy_fsfs(sbox.repo_dir, backup_dir)
+
+  # Incrementally copy new revisions and new packs.
+  add_revisions(4)
+  if svntest.main.fs_has_pack():
+    svntest.actions.run_and_verify_svnadmin(None, [],
+                                            "pack", sbox.repo_dir)
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "hotcopy", "--incremental",
+                                          "--jobs", "4",
+                                          sbox.repo_dir, backup_dir)
+  check_hotcopy_fsfs(sbox.repo_dir, backup_dir)
+
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "verify", backup_dir)
+
+def load_jobs(sbox):
+  "svnadmin load --jobs"
+
+  sbox.build(empty=True)
+
+  # This dumpfile contains text deltas.  Load it serially for reference.
+  dumpfile_location = os.path.join(os.path.dirname(sys.argv[0]),
+                                   'svnadmin_tests_data',
+                                   'load_txdelta.dump.gz')
+  dumpfile = gzip.open(dumpfile_location, "rb").readlines()
+  load_dumpstream(sbox, dumpfile)
+  expected_dump = svntest.actions.run_and_verify_dump(sbox.repo_dir)
+
+  # Use a small buffer such that the parser has to wait for the commits.
+  sbox2 = sbox.clone_dependent()
+  sbox2.build(empty=True)
+  load_dumpstream(sbox2, dumpfile, '--jobs', '4', '--buffer-size', '1')
+  actual_dump = svntest.actions.run_and_verify_dump(sbox2.repo_dir)
+  svntest.verify.compare_dump_files(None, None, expected_dump, actual_dump)
+
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "verify", sbox2.repo_dir)
+
+  # A truncated stream must fail the same way as in a serial load, i.e.
+  # after loading the complete revisions and with the parser's error.
+  # Try it with cuts at different points of the last revision.
+  for cut in [100, len(dumpfile[-1]) + len(dumpfile[-2])]:
+    truncated = b''.join(dumpfile)[:-cut]
+    results = []
+    for args in [[], ['--jobs', '4']]:
+      sbox3 = sbox.clone_dependent()
+      sbox3.build(empty=True)
+      exit_code, output, errput = svntest.main.run_command_stdin(
+        svntest.main.svnadmin_binary, svntest.verify.AnyOutput, 0, True,
+        [truncated], 'load', '--quiet', sbox3.repo_dir, *args)
+      if exit_code == 0 or not errput:
+        raise svntest.Failure("Loading a truncated stream did not fail")
+      exit_code, youngest, _ = svntest.main.run_svnlook("youngest",
+                                                        sbox3.repo_dir)
+      results.append((errput, youngest))
+
+    svntest.verify.compare_and_display_lines(
+      "Error of the pipelined load", "STDERR:", results[0][0],
+      results[1][0])
+    svntest.verify.compare_and_display_lines(
+      "Youngest revision after the pipelined load", "STDOUT:",
+      results[0][1], results[1][1])
+
+def dump_jobs(sbox):
+  "svnadmin dump --jobs"
+
+  sbox.build()
+
+  # Create some history with copies, mergeinfo and property changes.
+  sbox.simple_copy('A/B', 'A/B2')
+  sbox.simple_commit(message='r2')
+  sbox.simple_append('iota', 'more text\n')
+  sbox.simple_propset('svn:mergeinfo', '/A/B:2', 'A/B2')
+  sbox.simple_commit(message='r3')
+  sbox.simple_rm('A/D/G')
+  sbox.simple_propset('prop', 'val', 'A/mu')
+  sbox.simple_commit(message='r4')
+  sbox.simple_copy('A/D', 'A/D2')
+  sbox.simple_append('A/D2/gamma', 'changed\n')
+  sbox.simple_commit(message='r5')
+
+  # The dump data and the progress output must not depend on the number
+  # of jobs.
+  for args in [[], ['--deltas'], ['-r', '2:5', '--incremental'],
+               ['-r', '3:4', '--deltas'], ['-r', '0:1']]:
+    exit_code, expected_dump, expected_err = \
+      svntest.main.run_svnadmin('dump', sbox.repo_dir, *args)
+    exit_code, actual_dump, actual_err = \
+      svntest.main.run_svnadmin('dump', sbox.repo_dir, '--jobs', '4', *args)
+
+    if exit_code:
+      raise svntest.Failure("Parallel dump failed")
+    svntest.verify.compare_dump_files(None, None, expected_dump, actual_dump)
+    svntest.verify.verify_outputs(None, None, actual_err, None, expected_err)
+
+  # Dumped copy sources outside the range must still be reported.
+  exit_code, output, errput = \
+    svntest.main.run_svnadmin('dump', sbox.repo_dir, '--jobs', '4',
+                              '-r', '5', '--incremental')
+  if not [line for line in errput if 'Referencing data in revision 4' in line]:
+    raise svntest.Failure("Missing warning about old copy source")
+
 ########################################################################
 # Run the tests
 
@@ -3990,6 +4179,11 @@ test_list = [ None,
               dump_no_canonicalize_svndate,
               recover_prunes_rep_cache_when_enabled,
               recover_prunes_rep_cache_when_disabled,
+              verify_jobs,
+              pack_jobs,
+              hotcopy_jobs,
+              load_jobs,
+              dump_jobs,
              ]
 
 if __name__ == '__main__':
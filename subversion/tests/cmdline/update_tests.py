@@ -6856,6 +6856,165 @@ def update_add_missing_local_add(sbox):
   
   sbox.simple_update()
 
+@SkipUnless(svntest.main.is_ra_type_svn)
+def update_parallel_fetch(sbox):
+  "update fetching contents over extra connections"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  # Keep a copy of the r1 working copy to update later.
+  other_wc = sbox.add_wc_path('other')
+  svntest.actions.duplicate_dir(wc_dir, other_wc)
+
+  # Change every file, add some and commit.
+  expected_output = svntest.wc.State(other_wc, {})
+  expected_disk = svntest.main.greek_state.copy()
+  for path, item in svntest.main.greek_state.desc.items():
+    if item.contents is not None:
+      svntest.main.file_append(sbox.ospath(path), "more text\n")
+      expected_output.add({ path : Item(status='U ') })
+      expected_disk.tweak(path, contents=item.contents + "more text\n")
+  for i in range(20):
+    path = 'A/new%d' % i
+    sbox.simple_add_text('new file %d\n' % i, path)
+    expected_output.add({ path : Item(status='A ') })
+    expected_disk.add({ path : Item(contents='new file %d\n' % i) })
+  sbox.simple_commit()
+
+  expected_status = svntest.actions.get_virginal_state(other_wc, 2)
+  for i in range(20):
+    expected_status.add({ 'A/new%d' % i : Item(status='  ', wc_rev=2) })
+
+  svntest.actions.run_and_verify_update(other_wc, expected_output,
+                                        expected_disk, expected_status,
+                                        [], False,
+                                        '--config-option',
+                                        'servers:global:svn-max-connections=3',
+                                        other_wc)
+
+@SkipUnless(svntest.main.is_ra_type_svn)
+def update_parallel_fetch_authz(sbox):
+  "update fetching contents with restricted access"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  # Keep a copy of the r1 working copy to update later.
+  other_wc = sbox.add_wc_path('other')
+  svntest.actions.duplicate_dir(wc_dir, other_wc)
+
+  # Change every file, add some readable and some hidden ones and commit.
+  expected_output = svntest.wc.State(other_wc, {})
+  expected_disk = svntest.main.greek_state.copy()
+  for path, item in svntest.main.greek_state.desc.items():
+    if item.contents is not None:
+      svntest.main.file_append(sbox.ospath(path), "more text\n")
+      expected_output.add({ path : Item(status='U ') })
+      expected_disk.tweak(path, contents=item.contents + "more text\n")
+  for i in range(20):
+    path = 'A/new%d' % i
+    sbox.simple_add_text('new file %d\n' % i, path)
+    expected_output.add({ path : Item(status='A ') })
+    expected_disk.add({ path : Item(contents='new file %d\n' % i) })
+    sbox.simple_add_text('secret %d\n' % i, 'A/secret%d' % i)
+  sbox.simple_commit()
+
+  expected_status = svntest.actions.get_virginal_state(other_wc, 2)
+  for i in range(20):
+    expected_status.add({ 'A/new%d' % i : Item(status='  ', wc_rev=2) })
+
+  # Only authenticated users get in and the secrets are hidden from
+  # everyone.  Interleaving readable and unreadable paths makes sure that
+  # the get-file requests over the extra connections are not answered
+  # with authentication requests.
+  svntest.main.write_restrictive_svnserve_conf(sbox.repo_dir, "none")
+  rules = { '/' : '* = rw' }
+  for i in range(20):
+    rules['/A/secret%d' % i] = '* ='
+  svntest.main.write_authz_file(sbox, rules)
+
+  svntest.actions.run_and_verify_update(other_wc, expected_output,
+                                        expected_disk, expected_status,
+                                        [], False,
+                                        '--config-option',
+                                        'servers:global:svn-max-connections=3',
+                                        other_wc)
+
+@SkipUnless(svntest.main.is_ra_type_dav_serf)
+def update_http2_options(sbox):
+  "parse the http-http2 and http-max-streams options"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  # Valid values, both globally and for a server group.  Too few streams
+  # get raised to the number of connections.
+  svntest.actions.run_and_verify_svn(None, [],
+                                     'info', sbox.repo_url,
+                                     '--config-option',
+                                     'servers:global:http-http2=yes',
+                                     '--config-option',
+                                     'servers:global:http-max-streams=1')
+  svntest.actions.run_and_verify_svn(None, [],
+                                     'info', sbox.repo_url,
+                                     '--config-option',
+                                     'servers:groups:test=*',
+                                     '--config-option',
+                                     'servers:test:http-http2=no',
+                                     '--config-option',
+                                     'servers:test:http-max-streams=64')
+
+  # Invalid values are rejected when opening the session.
+  svntest.actions.run_and_verify_svn(None,
+                                     ".*invalid boolean value 'maybe'"
+                                     " for '\\[global\\] http-http2'.*",
+                                     'info', sbox.repo_url,
+                                     '--config-option',
+                                     'servers:global:http-http2=maybe')
+  svntest.actions.run_and_verify_svn(None,
+                                     ".*invalid boolean value 'maybe'"
+                                     " for '\\[test\\] http-http2'.*",
+                                     'info', sbox.repo_url,
+                                     '--config-option',
+                                     'servers:groups:test=*',
+                                     '--config-option',
+                                     'servers:test:http-http2=maybe')
+  svntest.actions.run_and_verify_svn(None,
+                                     ".*Could not convert 'many' into a"
+                                     " number.*",
+                                     'info', sbox.repo_url,
+                                     '--config-option',
+                                     'servers:global:http-max-streams=many')
+  svntest.actions.run_and_verify_svn(None,
+                                     ".*Could not convert 'many' into a"
+                                     " number.*",
+                                     'info', sbox.repo_url,
+                                     '--config-option',
+                                     'servers:groups:test=*',
+                                     '--config-option',
+                                     'servers:test:http-max-streams=many')
+
+  # A complete update with the options set still works.
+  sbox.simple_append('iota', 'more text\n')
+  sbox.simple_commit()
+  sbox.simple_update(revision=1)
+  expected_output = svntest.wc.State(wc_dir, {
+    'iota' : Item(status='U '),
+    })
+  expected_disk = svntest.main.greek_state.copy()
+  expected_disk.tweak('iota',
+                      contents="This is the file 'iota'.\nmore text\n")
+  expected_status = svntest.actions.get_virginal_state(wc_dir, 2)
+  svntest.actions.run_and_verify_update(wc_dir, expected_output,
+                                        expected_disk, expected_status,
+                                        [], False,
+                                        '--config-option',
+                                        'servers:global:http-http2=yes',
+                                        '--config-option',
+                                        'servers:global:http-max-streams=3',
+                                        wc_dir)
+
 #######################################################################
 # Run the tests
 
@@ -6947,6 +7106,9 @@ test_list = [ None,
               missing_tmp_update,
               update_delete_switched,
               update_add_missing_local_add,
+              update_parallel_fetch,
+              update_parallel_fetch_authz,
+              update_http2_options,
              ]
 
 if __name__ == '__main__':
@@ -36,6 +36,8 @@
 #include "svn_delta.h"
 #include "svn_pools.h"
 #include "svn_error.h"
+#include "svn_sorts.h"
+#include "private/svn_subr_private.h"
 
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
@@ -45,10 +47,19 @@
 #define DEFAULT_MAXLEN (100 * 1024)
 #define DEFAULT_DUMP_FILES 0
 #define DEFAULT_PRINT_WINDOWS 0
+#define DEFAULT_BENCHMARK_VOLUME 64
 #define SEEDS 50
 #define MAXSEQ 100
 
 
+/* Return the highest svndiff version that this build can read and write.
+   svndiff2 is always available; svndiff3 requires zstd. */
+static int
+max_svndiff_version(void)
+{
+  return svn_zstd__is_available() ? 3 : 2;
+}
+
 /* Initialize parameters for the random tests. */
 extern int test_argc;
 extern const char **test_argv;
@@ -75,7 +86,7 @@ static void init_params(apr_uint32_t *seed,
 
   apr_getopt_init(&opt, pool, test_argc, test_argv);
   while (APR_SUCCESS
-         == (status = apr_getopt(opt, "s:l:n:r:FW", &optch, &opt_arg)))
+         == (status = apr_getopt(opt, "s:l:n:r:b:FW", &optch, &opt_arg)))
     {
       switch (optch)
         {
@@ -329,9 +340,11 @@ do_random_test(apr_pool_t *pool,
                                          delta_pool);
 
       /* Make stage 2: encode the text delta in svndiff format using
-                       varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
-                              i % 10, delta_pool);
+                       varying svndiff versions, compression levels
+                       and encoder threads. */
+      svn_txdelta_to_svndiff4(&handler, &handler_baton, stream,
+                              i % (max_svndiff_version() + 1),
+                              i % 10, 1 + i % 4, delta_pool);
 
       /* Make stage 1: create the text delta.  */
       svn_txdelta2(&txdelta_stream,
@@ -425,9 +438,11 @@ do_random_combine_test(apr_pool_t *pool,
                                          delta_pool);
 
       /* Make stage 2: encode the text delta in svndiff format using
-                       varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
-                              i % 10, delta_pool);
+                       varying svndiff versions, compression levels
+                       and encoder threads. */
+      svn_txdelta_to_svndiff4(&handler, &handler_baton, stream,
+                              i % (max_svndiff_version() + 1),
+                              i % 10, 1 + i % 4, delta_pool);
 
       /* Make stage 1: create the text deltas.  */
 
@@ -569,8 +584,9 @@ do_random_txdelta_to_svndiff_stream_test(apr_pool_t *pool,
                    svn_stream_from_aprfile2(source, TRUE, iterpool),
                    svn_stream_from_aprfile2(target, TRUE, iterpool),
                    FALSE, iterpool);
-      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 3, i % 10,
-                                                   iterpool);
+      delta_stream = svn_txdelta_to_svndiff_stream(
+                       txstream, i % (max_svndiff_version() + 1), i % 10,
+                       iterpool);
 
       /* Apply it to a copy of the source file to see if we get the
          same target back. */
@@ -605,6 +621,305 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Return the amount of data in MB to process per delta benchmark run,
+   as given by the -b option, or 0 if that option has not been given. */
+static apr_size_t
+benchmark_volume(apr_pool_t *pool)
+{
+  apr_getopt_t *opt;
+  char optch;
+  const char *opt_arg;
+  apr_size_t volume = 0;
+
+  apr_getopt_init(&opt, pool, test_argc, test_argv);
+  while (APR_SUCCESS == apr_getopt(opt, "s:l:n:r:b:FW", &optch, &opt_arg))
+    if (optch == 'b')
+      volume = (apr_size_t) atol(opt_arg);
+
+  return volume;
+}
+
+/* Return a copy of SOURCE of SIZE bytes with small random modifications
+   every few KB, as is typical for a new version of a binary file.  Return
+   the length of the result in *TARGET_SIZE.  Use SEED for randomization
+   and allocate the result in POOL. */
+static const char *
+modify_data(apr_size_t *target_size,
+            const char *source,
+            apr_size_t size,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(size + size / 16,
+                                                        pool);
+  apr_size_t pos = 0;
+
+  while (pos < size)
+    {
+      apr_size_t copy = svn_test_rand(seed) % 4096;
+      apr_size_t len = svn_test_rand(seed) % 32 + 1;
+      apr_size_t i;
+
+      if (copy > size - pos)
+        copy = size - pos;
+
+      svn_stringbuf_appendbytes(target, source + pos, copy);
+      pos += copy;
+
+      switch (svn_test_rand(seed) % 3)
+        {
+          case 0: /* Replace LEN bytes. */
+            pos += len;
+            /* Fall through. */
+
+          case 1: /* Insert LEN bytes. */
+            for (i = 0; i < len; ++i)
+              svn_stringbuf_appendbyte(target, (char)svn_test_rand(seed));
+            break;
+
+          default: /* Delete LEN bytes. */
+            pos += len;
+            break;
+        }
+    }
+
+  *target_size = target->len;
+  return target->data;
+}
+
+/* Run the delta algorithm on SOURCE of SOURCE_SIZE bytes and TARGET of
+   TARGET_SIZE bytes until VOLUME MB of target data have been processed.
+   If OPTS request verbose output, print the throughput under the title
+   DESCRIPTION.  Use POOL for temporary allocations. */
+static svn_error_t *
+run_delta_benchmark(const char *source,
+                    apr_size_t source_size,
+                    const char *target,
+                    apr_size_t target_size,
+                    apr_size_t volume,
+                    const char *description,
+                    const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint64_t processed = 0;
+  apr_time_t start = apr_time_now();
+  apr_time_t duration;
+
+  while (processed < (apr_uint64_t)volume * 1024 * 1024)
+    {
+      svn_string_t source_str;
+      svn_string_t target_str;
+
+      svn_pool_clear(iterpool);
+
+      source_str.data = source;
+      source_str.len = source_size;
+      target_str.data = target;
+      target_str.len = target_size;
+
+      SVN_ERR(svn_txdelta_run(svn_stream_from_string(&source_str, iterpool),
+                              svn_stream_from_string(&target_str, iterpool),
+                              svn_delta_noop_window_handler, NULL,
+                              svn_checksum_md5, NULL, NULL, NULL,
+                              iterpool, iterpool));
+      processed += target_size;
+    }
+
+  duration = apr_time_now() - start;
+  if (opts->verbose && duration > 0)
+    printf("%s: %.1f MB/s\n", description,
+           (double)processed * APR_USEC_PER_SEC / duration / (1024 * 1024));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *SVNDIFF to the delta from SOURCE to TARGET, encoded in svndiff
+   format VERSION.  Allocate the result in POOL. */
+static svn_error_t *
+encode_delta(svn_stringbuf_t **svndiff,
+             const svn_string_t *source,
+             const svn_string_t *target,
+             int version,
+             apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  svn_txdelta_to_svndiff4(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*svndiff, pool),
+                          version, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1,
+                          pool);
+
+  return svn_error_trace(svn_txdelta_run(svn_stream_from_string(source, pool),
+                                         svn_stream_from_string(target, pool),
+                                         handler, handler_baton,
+                                         svn_checksum_md5, NULL, NULL, NULL,
+                                         pool, pool));
+}
+
+/* Set *RESULT to SOURCE with the svndiff data in SVNDIFF applied to it.
+   Allocate the result in POOL. */
+static svn_error_t *
+decode_delta(svn_stringbuf_t **result,
+             const svn_string_t *source,
+             const svn_stringbuf_t *svndiff,
+             apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len = svndiff->len;
+
+  *result = svn_stringbuf_create_empty(pool);
+  svn_txdelta_apply(svn_stream_from_string(source, pool),
+                    svn_stream_from_stringbuf(*result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+
+  SVN_ERR(svn_stream_write(stream, svndiff->data, &len));
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Encode the delta from SOURCE of SOURCE_SIZE bytes to TARGET of
+   TARGET_SIZE bytes in every svndiff version supported by this build,
+   check that it decodes to TARGET again and then repeatedly encode and
+   decode it until VOLUME MB of target data have been processed.
+   If OPTS request verbose output, print the throughput under the title
+   DESCRIPTION.  Use POOL for temporary allocations. */
+static svn_error_t *
+run_svndiff_benchmark(const char *source,
+                      apr_size_t source_size,
+                      const char *target,
+                      apr_size_t target_size,
+                      apr_size_t volume,
+                      const char *description,
+                      const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_string_t source_str;
+  svn_string_t target_str;
+  int version;
+
+  source_str.data = source;
+  source_str.len = source_size;
+  target_str.data = target;
+  target_str.len = target_size;
+
+  for (version = 0; version <= max_svndiff_version(); ++version)
+    {
+      svn_stringbuf_t *svndiff;
+      svn_stringbuf_t *result;
+      apr_uint64_t processed;
+      apr_time_t start;
+      apr_time_t encode_duration;
+      apr_time_t decode_duration;
+
+      /* Round-trip once so that we only time working codecs. */
+      SVN_ERR(encode_delta(&svndiff, &source_str, &target_str, version,
+                           pool));
+      SVN_ERR(decode_delta(&result, &source_str, svndiff, pool));
+      SVN_TEST_ASSERT(result->len == target_size);
+      SVN_TEST_ASSERT(memcmp(result->data, target, target_size) == 0);
+
+      start = apr_time_now();
+      for (processed = 0;
+           processed < (apr_uint64_t)volume * 1024 * 1024;
+           processed += target_size)
+        {
+          svn_stringbuf_t *encoded;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(encode_delta(&encoded, &source_str, &target_str, version,
+                               iterpool));
+        }
+      encode_duration = apr_time_now() - start;
+
+      start = apr_time_now();
+      for (processed = 0;
+           processed < (apr_uint64_t)volume * 1024 * 1024;
+           processed += target_size)
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(decode_delta(&result, &source_str, svndiff, iterpool));
+        }
+      decode_duration = apr_time_now() - start;
+
+      if (opts->verbose && encode_duration > 0 && decode_duration > 0)
+        {
+          printf("%s, svndiff%d encoding: %.1f MB/s\n", description, version,
+                 (double)processed * APR_USEC_PER_SEC / encode_duration
+                 / (1024 * 1024));
+          printf("%s, svndiff%d decoding: %.1f MB/s\n", description, version,
+                 (double)processed * APR_USEC_PER_SEC / decode_duration
+                 / (1024 * 1024));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Measure the throughput of the delta algorithm and of the svndiff
+   encoder and decoder for typical and worst-case inputs.  Use --verbose
+   to see the results and -b to set the amount of data in MB to process
+   per input.  Without either option, the benchmark is skipped to keep
+   the regular test runs short. */
+static svn_error_t *
+delta_benchmark(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  enum { DATA_SIZE = 40 * SVN_DELTA_WINDOW_SIZE };
+  apr_size_t volume = benchmark_volume(pool);
+  apr_uint32_t seed = 0x12345678;
+  char *source = apr_palloc(pool, DATA_SIZE);
+  char *unrelated = apr_palloc(pool, DATA_SIZE);
+  const char *modified;
+  apr_size_t modified_size;
+  apr_size_t i;
+
+  if (volume == 0)
+    {
+      if (! opts->verbose)
+        return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                                "use -b or --verbose to run the benchmark");
+
+      volume = DEFAULT_BENCHMARK_VOLUME;
+    }
+
+  for (i = 0; i < DATA_SIZE; ++i)
+    {
+      source[i] = (char)svn_test_rand(&seed);
+      unrelated[i] = (char)svn_test_rand(&seed);
+    }
+
+  modified = modify_data(&modified_size, source, DATA_SIZE, &seed, pool);
+
+  /* Mostly matching data, i.e. the match extension dominates. */
+  SVN_ERR(run_delta_benchmark(source, DATA_SIZE, modified, modified_size,
+                              volume, "modified data", opts, pool));
+
+  /* Nothing matches, i.e. the rolling checksum search dominates. */
+  SVN_ERR(run_delta_benchmark(source, DATA_SIZE, unrelated, DATA_SIZE,
+                              volume, "unrelated data", opts, pool));
+
+  /* The svndiff codecs on top of the delta, for each format version.
+     Compression is much slower than delta calculation, so process less
+     data here to keep the test run short. */
+  volume = MAX(volume / 8, 1);
+  SVN_ERR(run_svndiff_benchmark(source, DATA_SIZE, modified, modified_size,
+                                volume, "modified data", opts, pool));
+  SVN_ERR(run_svndiff_benchmark(source, DATA_SIZE, unrelated, DATA_SIZE,
+                                volume, "unrelated data", opts, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +940,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_OPTS_PASS(delta_benchmark,
+                       "delta throughput benchmark"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
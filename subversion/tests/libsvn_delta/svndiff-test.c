@@ -91,8 +91,8 @@ main(int argc, char **argv)
   encoder = svn_base64_encode2(stdout_stream, TRUE, pool);
 #endif
   /* use maximum compression level */
-  svn_txdelta_to_svndiff3(&svndiff_handler, &svndiff_baton,
-                          encoder, version, 9, pool);
+  svn_txdelta_to_svndiff4(&svndiff_handler, &svndiff_baton,
+                          encoder, version, 9, 1, pool);
   err = svn_txdelta_send_txstream(txdelta_stream,
                                   svndiff_handler,
                                   svndiff_baton,
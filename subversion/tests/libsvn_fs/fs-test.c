@@ -7369,6 +7369,167 @@ closest_copy_test_svn_4677(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-group-commit"
+#define THREAD_COUNT 4
+#define COMMITS_PER_THREAD 8
+
+#if APR_HAS_THREADS
+
+/* Parameters and result of a single group_commit_thread.
+ */
+typedef struct group_commit_baton_t
+{
+  /* Configuration to open the repository with. */
+  apr_hash_t *fs_config;
+
+  /* The file to modify with each commit. */
+  const char *path;
+
+  /* Error returned by this thread. */
+  svn_error_t *err;
+} group_commit_baton_t;
+
+/* Open a private FS instance as described by BATON and commit
+ * COMMITS_PER_THREAD modifications to BATON->PATH, one at a time.
+ * Use POOL for allocations.
+ */
+static svn_error_t *
+commit_concurrently(group_commit_baton_t *baton,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, baton->fs_config, pool, pool));
+  for (i = 1; i <= COMMITS_PER_THREAD; ++i)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      svn_revnum_t youngest, new_rev;
+      const char *conflict;
+
+      svn_pool_clear(iterpool);
+
+      /* Our txns will usually be out of date by the time they get
+       * committed and need to be merged by the group leader. */
+      SVN_ERR(svn_fs_youngest_rev(&youngest, fs, iterpool));
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, baton->path,
+                                          apr_psprintf(iterpool, "%d\n", i),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(&conflict, &new_rev, txn, iterpool));
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(new_rev));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static void *
+APR_THREAD_FUNC group_commit_thread(apr_thread_t *tid, void *data)
+{
+  group_commit_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  baton->err = commit_concurrently(baton, pool);
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+#endif
+
+static svn_error_t *
+group_commit_concurrently(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_thread_t *threads[THREAD_COUNT];
+  group_commit_baton_t batons[THREAD_COUNT];
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_status_t status;
+  int i;
+
+  /* BDB doesn't support group commit. */
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_BDB) == 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Create one file per thread, so that all commits merge cleanly. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_GROUP_COMMIT, "1");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      batons[i].fs_config = fs_config;
+      batons[i].path = apr_psprintf(pool, "file-%d", i);
+      batons[i].err = SVN_NO_ERROR;
+      SVN_ERR(svn_fs_make_file(root, batons[i].path, pool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      status = apr_thread_create(&threads[i], NULL, group_commit_thread,
+                                 &batons[i], pool);
+      if (status)
+        return svn_error_wrap_apr(status, NULL);
+    }
+
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      apr_status_t retval;
+      status = apr_thread_join(&retval, threads[i]);
+      if (status)
+        return svn_error_wrap_apr(status, NULL);
+
+      err = svn_error_compose_create(err, batons[i].err);
+    }
+
+  SVN_ERR(err);
+
+  /* Every commit got its own revision and none of the changes got lost. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_TEST_ASSERT(rev == 1 + THREAD_COUNT * COMMITS_PER_THREAD);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      svn_stream_t *rstream;
+      svn_stringbuf_t *rstring;
+
+      SVN_ERR(svn_fs_file_contents(&rstream, root, batons[i].path, pool));
+      SVN_ERR(svn_test__stream_to_string(&rstring, rstream, pool));
+      SVN_TEST_STRING_ASSERT(rstring->data,
+                             apr_psprintf(pool, "%d\n", COMMITS_PER_THREAD));
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, rev, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, "no thread support");
+#endif
+}
+
+#undef REPO_NAME
+#undef THREAD_COUNT
+#undef COMMITS_PER_THREAD
+
 /* ------------------------------------------------------------------------ */
 
 /* The test table.  */
@@ -7513,6 +7674,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test rep-sharing on content rather than SHA1"),
     SVN_TEST_OPTS_PASS(closest_copy_test_svn_4677,
                        "test issue SVN-4677 regression"),
+    SVN_TEST_OPTS_PASS(group_commit_concurrently,
+                       "group commit from concurrent threads"),
     SVN_TEST_NULL
   };
 
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <apr_pools.h>
+#include <apr_thread_proc.h>
 
 #include "../svn_test.h"
 #include "../../libsvn_fs/fs-loader.h"
@@ -30,12 +31,15 @@
 #include "../../libsvn_fs_fs/fs_fs.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
+#include "../../libsvn_fs_fs/rev_file.h"
 #include "../../libsvn_fs_fs/util.h"
 
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 #include "svn_fs.h"
+#include "private/svn_mutex.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -190,7 +194,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, NULL, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -225,7 +229,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -662,7 +666,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -1001,7 +1005,7 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
   /* Pack repo to verify that old and new shard get packed according to
      their respective addressing mode */
 
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   /* verify that our changes got in */
 
@@ -1887,6 +1891,645 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-long_multi_chunk_delta_chain"
+#define MAX_REV 13
+
+/* Return the contents of "big" in revision REV, allocated in POOL.
+ * The text spans several txdelta windows and every revision touches
+ * each of them. */
+static svn_stringbuf_t *
+get_big_file_contents(svn_revnum_t rev,
+                      apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  svn_revnum_t r;
+  int i;
+
+  for (i = 0; contents->len <= 3 * 102400; ++i)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "line %d\n", i));
+
+  for (r = 1; r <= rev; ++r)
+    for (i = 0; i < 4; ++i)
+      contents->data[(r * 997 + i * 81920) % contents->len] = (char)('a' + r);
+
+  return contents;
+}
+
+static svn_error_t *
+long_multi_chunk_delta_chain(const svn_test_opts_t *opts,
+                             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Create a linear delta chain of multi-window file contents.
+   * The default limit for linear deltification is 16. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  for (rev = 0; rev < MAX_REV; ++rev)
+    {
+      svn_revnum_t new_rev;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 0)
+        SVN_ERR(svn_fs_make_file(root, "big", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "big",
+                          get_big_file_contents(rev + 1, iterpool)->data,
+                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, iterpool));
+    }
+
+  /* Read the contents through a new FS instance with disjoint caches.
+   * Reading the youngest revision first populates the checkpoints that
+   * all older revisions will then start from. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  for (rev = MAX_REV; rev > 0; --rev)
+    {
+      svn_stream_t *stream;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_fs_file_contents(&stream, root, "big", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&contents, stream, iterpool));
+
+      if (! svn_stringbuf_compare(contents,
+                                  get_big_file_contents(rev, iterpool)))
+        return svn_error_createf(SVN_ERR_FS_GENERAL, NULL,
+                                 "Bad data in revision %ld.", rev);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-batched_commit_fsync"
+#define SHARD_SIZE 4
+#define MAX_REV 13
+
+static svn_error_t *
+batched_commit_fsync(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_interval_time_t total = 0, worst = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Small shards make us create new shard directories during commit.
+   * Flushing to disk is enabled by default. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  for (rev = 0; rev < MAX_REV; ++rev)
+    {
+      svn_revnum_t new_rev;
+      apr_time_t start;
+      apr_interval_time_t latency;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 0)
+        SVN_ERR(svn_fs_make_file(root, "iota", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "iota",
+                                          get_rev_contents(rev + 1, iterpool),
+                                          iterpool));
+
+      /* Measure the commit itself, which includes all fsyncs. */
+      start = apr_time_now();
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, iterpool));
+      latency = apr_time_now() - start;
+
+      SVN_TEST_ASSERT(new_rev == rev + 1);
+      total += latency;
+      worst = MAX(worst, latency);
+    }
+
+  if (opts->verbose)
+    printf("%d commits: %" APR_TIME_T_FMT " usec average, "
+           "%" APR_TIME_T_FMT " usec max\n",
+           MAX_REV, total / MAX_REV, worst);
+
+  /* The temporary 'next' file has been moved into place as 'current'. */
+  SVN_ERR(svn_io_check_path(svn_dirent_join(REPO_NAME, PATH_NEXT, pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  /* All revisions must be complete and visible to a new FS instance. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_TEST_ASSERT(rev == MAX_REV);
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_string_t *value;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_prop2(&value, fs, rev, SVN_PROP_REVISION_DATE,
+                                    TRUE, iterpool, iterpool));
+      SVN_TEST_ASSERT(value != NULL);
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL,
+                        NULL, NULL, pool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+/* Baton type for verify_notify(). */
+typedef struct verify_notify_baton_t
+{
+  /* Revision of the last notification. */
+  svn_revnum_t last_revision;
+
+  /* Number of notifications received so far or -1 if they came out of
+     order. */
+  int count;
+} verify_notify_baton_t;
+
+/* Implements svn_fs_progress_notify_func_t.  Check that the notifications
+   get sent in revision order. */
+static void
+verify_notify(svn_revnum_t revision,
+              void *baton,
+              apr_pool_t *pool)
+{
+  verify_notify_baton_t *vnb = baton;
+
+  if (revision <= vnb->last_revision)
+    vnb->count = -1;
+  else if (vnb->count >= 0)
+    vnb->count++;
+
+  vnb->last_revision = revision;
+}
+
+#define REPO_NAME "test-repo-verify-concurrently"
+#define SHARD_SIZE 4
+#define MAX_REV 21
+static svn_error_t *
+verify_concurrently(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  verify_notify_baton_t vnb;
+
+  /* Packed shards 0 to 4 plus the unpacked r20 and r21. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_PARALLEL_JOBS, "4");
+
+  vnb.last_revision = SVN_INVALID_REVNUM;
+  vnb.count = 0;
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, MAX_REV,
+                        verify_notify, &vnb, NULL, NULL, pool));
+  SVN_TEST_ASSERT(vnb.count >= 0);
+
+  /* A range that does not start at a shard boundary. */
+  vnb.last_revision = SVN_INVALID_REVNUM;
+  vnb.count = 0;
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 6, MAX_REV - 1,
+                        verify_notify, &vnb, NULL, NULL, pool));
+  SVN_TEST_ASSERT(vnb.count >= 0);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-pack-concurrently"
+#define SHARD_SIZE 4
+#define MAX_REV 21
+static svn_error_t *
+pack_concurrently(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  struct pack_notify_baton pnb;
+  svn_fs_t *fs;
+  svn_stream_t *rstream;
+  svn_stringbuf_t *rstring;
+  svn_revnum_t i;
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_PARALLEL_JOBS, "4");
+
+  /* Notifications must still be sent in shard order. */
+  pnb.expected_shard = 0;
+  pnb.expected_action = svn_fs_pack_notify_start;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, fs_config, pack_notify, &pnb, NULL, NULL,
+                       pool));
+  SVN_TEST_ASSERT(pnb.expected_shard == (MAX_REV + 1) / SHARD_SIZE);
+  SVN_TEST_ASSERT(pnb.expected_action == svn_fs_pack_notify_start);
+
+  /* The result must be equivalent to a sequential pack. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (i = 2; i < (MAX_REV + 1); i++)
+    {
+      svn_fs_root_t *rev_root;
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, pool));
+      SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", pool));
+      SVN_ERR(svn_test__stream_to_string(&rstring, rstream, pool));
+      SVN_TEST_STRING_ASSERT(rstring->data, get_rev_contents(i, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-read-mapped-packed-fs"
+#define SHARD_SIZE 4
+#define MAX_REV 21
+static svn_error_t *
+read_mapped_packed_fs(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_stream_t *rstream;
+  svn_stringbuf_t *rstring;
+  svn_revnum_t i;
+  int block_read;
+
+  /* Packed shards 0 to 4 plus the unpacked r20 and r21. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_MMAP_PACKED, "1");
+
+  /* Only pack files get mapped. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+#if APR_HAS_MMAP
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+  SVN_TEST_ASSERT(rev_file->is_packed && rev_file->mmap != NULL);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+#endif
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, MAX_REV, pool,
+                                           pool));
+  SVN_TEST_ASSERT(!rev_file->is_packed && rev_file->mmap == NULL);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Read all contents through the mappings with and without block-read.
+   * Use separate cache namespaces to actually hit the files. */
+  for (block_read = 0; block_read < 2; ++block_read)
+    {
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ,
+                    block_read ? "1" : "0");
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                    svn_uuid_generate(pool));
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+      for (i = 2; i < (MAX_REV + 1); i++)
+        {
+          svn_fs_root_t *rev_root;
+
+          SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, pool));
+          SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", pool));
+          SVN_ERR(svn_test__stream_to_string(&rstring, rstream, pool));
+          SVN_TEST_STRING_ASSERT(rstring->data, get_rev_contents(i, pool));
+        }
+    }
+
+  /* Verification reads indexes and all items through the mappings. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, MAX_REV, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-read-ahead-packed-fs"
+#define SHARD_SIZE 8
+#define MAX_REV 17
+/* Read-ahead only hands hints to the OS and has no visible effect of its
+ * own.  This is therefore a regression test for reading packed data with
+ * read-ahead enabled, not proof that anything actually got prefetched. */
+static svn_error_t *
+read_ahead_packed_fs(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_file_t *file;
+  const char *io_config = "[io]\nblock-size = 1\nread-ahead = 2\n";
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_stream_t *rstream;
+  svn_stringbuf_t *rstring;
+  char before[64], after[64];
+  svn_revnum_t i;
+  int use_mmap;
+
+  /* Use tiny blocks, so that each pack file spans a few of them. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_io_file_open(&file,
+                           svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, io_config, strlen(io_config), NULL,
+                                 pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Prefetching is a mere hint and must not move the read position. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, 100));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, before, sizeof(before)));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, 100));
+  svn_fs_fs__rev_file_prefetch(rev_file, 0, 0x10000);
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, after, sizeof(after)));
+  SVN_TEST_ASSERT(memcmp(before, after, sizeof(before)) == 0);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Scan all revisions backwards and forwards, through buffered files
+   * as well as through mappings, and make sure that the contents are
+   * still correct.  Use separate cache namespaces to actually hit the
+   * files. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ, "1");
+  for (use_mmap = 0; use_mmap < 2; ++use_mmap)
+    {
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_MMAP_PACKED,
+                    use_mmap ? "1" : "0");
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                    svn_uuid_generate(pool));
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+      for (i = MAX_REV; i > 1; i--)
+        {
+          svn_fs_root_t *rev_root;
+
+          SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, pool));
+          SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", pool));
+          SVN_ERR(svn_test__stream_to_string(&rstring, rstream, pool));
+          SVN_TEST_STRING_ASSERT(rstring->data, get_rev_contents(i, pool));
+        }
+
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                    svn_uuid_generate(pool));
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+      for (i = 2; i < (MAX_REV + 1); i++)
+        {
+          svn_fs_root_t *rev_root;
+
+          SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, pool));
+          SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", pool));
+          SVN_ERR(svn_test__stream_to_string(&rstring, rstream, pool));
+          SVN_TEST_STRING_ASSERT(rstring->data, get_rev_contents(i, pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-group-commit-fsfs"
+#define THREAD_COUNT 4
+
+#if APR_HAS_THREADS
+
+/* A single commit performed by group_commit_thread. */
+typedef struct group_commit_baton_t
+{
+  /* Root pool of this commit, used exclusively by its thread. */
+  apr_pool_t *pool;
+
+  /* The txn to commit and the revision it became. */
+  svn_fs_txn_t *txn;
+  svn_revnum_t new_rev;
+
+  /* Error returned by this thread. */
+  svn_error_t *err;
+} group_commit_baton_t;
+
+/* Open a private FS instance in BATON->POOL and begin BATON->TXN, adding
+ * a file named after INDEX.  FS_CONFIG is the configuration to open the
+ * repository with. */
+static svn_error_t *
+prepare_group_commit(group_commit_baton_t *baton,
+                     int index,
+                     apr_hash_t *fs_config)
+{
+  svn_fs_t *fs;
+  svn_fs_root_t *root;
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, baton->pool, baton->pool));
+  SVN_ERR(svn_fs_begin_txn(&baton->txn, fs, 0, baton->pool));
+  SVN_ERR(svn_fs_txn_root(&root, baton->txn, baton->pool));
+  SVN_ERR(svn_fs_make_file(root, apr_psprintf(baton->pool, "file-%d", index),
+                           baton->pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Commit the txn given in the group_commit_baton_t DATA. */
+static void *
+APR_THREAD_FUNC group_commit_thread(apr_thread_t *tid, void *data)
+{
+  group_commit_baton_t *baton = data;
+
+  baton->err = svn_fs_commit_txn(NULL, &baton->new_rev, baton->txn,
+                                 baton->pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Baton for start_group_commit. */
+typedef struct group_freeze_baton_t
+{
+  group_commit_baton_t *batons;
+  apr_thread_t **threads;
+  int started;
+  apr_pool_t *thread_pool;
+  fs_fs_shared_data_t *ffsd;
+} group_freeze_baton_t;
+
+/* Set *LENGTH to the number of commits queued in FFSD.  The caller must
+ * hold FFSD's GROUP_COMMIT_LOCK. */
+static svn_error_t *
+get_commit_queue_length(int *length,
+                        fs_fs_shared_data_t *ffsd)
+{
+  *length = ffsd->commit_queue_length;
+
+  return SVN_NO_ERROR;
+}
+
+/* Start one group_commit_thread per commit given in the
+ * group_freeze_baton_t BATON and wait until all of them are queued.
+ * Since we hold the write lock, none of them can be processed before
+ * we return.  This implements svn_fs_freeze_func_t. */
+static svn_error_t *
+start_group_commit(void *baton,
+                   apr_pool_t *pool)
+{
+  group_freeze_baton_t *b = baton;
+  int queued = 0;
+  int i;
+
+  for (; b->started < THREAD_COUNT; ++b->started)
+    {
+      apr_status_t status
+        = apr_thread_create(&b->threads[b->started], NULL,
+                            group_commit_thread, &b->batons[b->started],
+                            b->thread_pool);
+      if (status)
+        return svn_error_wrap_apr(status, NULL);
+    }
+
+  for (i = 0; queued < THREAD_COUNT; ++i)
+    {
+      if (i == 10000)
+        return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                                "Commits did not get queued");
+
+      apr_sleep(1000);
+      SVN_MUTEX__WITH_LOCK(b->ffsd->group_commit_lock,
+                           get_commit_queue_length(&queued, b->ffsd));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+static svn_error_t *
+group_commit_fsfs(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_thread_t *threads[THREAD_COUNT];
+  group_commit_baton_t batons[THREAD_COUNT];
+  group_freeze_baton_t fb;
+  svn_revnum_t rev;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_GROUP_COMMIT, "true");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "group commit needs a newer format");
+
+  /* Each commit gets its own FS instance, adding a different file. */
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      batons[i].pool = svn_pool_create(NULL);
+      batons[i].new_rev = SVN_INVALID_REVNUM;
+      batons[i].err = SVN_NO_ERROR;
+      if (!err)
+        err = prepare_group_commit(&batons[i], i, fs_config);
+    }
+
+  /* Let all commits queue up while the repository is frozen. */
+  fb.batons = batons;
+  fb.threads = threads;
+  fb.started = 0;
+  fb.thread_pool = svn_pool_create(NULL);
+  fb.ffsd = ffd->shared;
+  if (!err)
+    err = svn_fs_freeze(fs, start_group_commit, &fb, pool);
+
+  for (i = 0; i < fb.started; ++i)
+    {
+      apr_status_t retval;
+      apr_status_t status = apr_thread_join(&retval, threads[i]);
+      if (status)
+        err = svn_error_compose_create(err,
+                                       svn_error_wrap_apr(status, NULL));
+
+      err = svn_error_compose_create(err, batons[i].err);
+    }
+
+  svn_pool_destroy(fb.thread_pool);
+  for (i = 0; i < THREAD_COUNT; ++i)
+    svn_pool_destroy(batons[i].pool);
+
+  SVN_ERR(err);
+
+  /* The first commit to get the write lock took all others with it. */
+  SVN_TEST_ASSERT(ffd->shared->commit_groups == 1);
+  SVN_TEST_ASSERT(ffd->shared->commit_queue_length == 0);
+
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_TEST_ASSERT(rev == THREAD_COUNT);
+  for (i = 0; i < THREAD_COUNT; ++i)
+    SVN_TEST_ASSERT(batons[i].new_rev > 0 && batons[i].new_rev <= rev);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, rev, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, "no thread support");
+#endif
+}
+
+#undef REPO_NAME
+#undef THREAD_COUNT
 
 
 /* The test table.  */
@@ -1942,6 +2585,20 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(long_multi_chunk_delta_chain,
+                       "read multi-window reps via delta checkpoints"),
+    SVN_TEST_OPTS_PASS(batched_commit_fsync,
+                       "commit FSFS revisions with batched fsyncs"),
+    SVN_TEST_OPTS_PASS(verify_concurrently,
+                       "verify FSFS using multiple threads"),
+    SVN_TEST_OPTS_PASS(pack_concurrently,
+                       "pack FSFS using multiple threads"),
+    SVN_TEST_OPTS_PASS(read_mapped_packed_fs,
+                       "read packed FSFS through memory mappings"),
+    SVN_TEST_OPTS_PASS(read_ahead_packed_fs,
+                       "read packed FSFS with read-ahead enabled"),
+    SVN_TEST_OPTS_PASS(group_commit_fsfs,
+                       "group commits queued on the write lock"),
     SVN_TEST_NULL
   };
 
@@ -37,6 +37,7 @@
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
 
+#include "private/svn_ra_svn_private.h"
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
 #include "../../libsvn_ra_local/ra_local.h"
@@ -1784,6 +1785,148 @@ commit_locked_file(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Write many small items and a large string through an ra_svn connection,
+   read them back and verify that the connection used large I/O chunks. */
+static svn_error_t *
+ra_svn_bulk_io(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *wire = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *large = svn_stringbuf_create_empty(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn__io_stats_t initial, stats;
+  svn_ra_svn__item_t *item;
+  int i;
+
+  for (i = 0; i < 256 * 1024; ++i)
+    svn_stringbuf_appendbyte(large, (char)('a' + i % 26));
+
+  /* Write. */
+  conn = svn_ra_svn_create_conn5(NULL, svn_stream_empty(pool),
+                                 svn_stream_from_stringbuf(wire, pool),
+                                 0, 0, 0, 0, 0, pool);
+  svn_ra_svn__get_io_stats(&initial, conn);
+
+  for (i = 0; i < 100000; ++i)
+    SVN_ERR(svn_ra_svn__write_number(conn, pool, i));
+  SVN_ERR(svn_ra_svn__write_string(conn, pool,
+                                   svn_string_ncreate(large->data,
+                                                      large->len, pool)));
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+
+  svn_ra_svn__get_io_stats(&stats, conn);
+  SVN_TEST_ASSERT(stats.bytes_written == wire->len);
+  SVN_TEST_ASSERT(stats.write_buf_size > initial.write_buf_size);
+  SVN_TEST_ASSERT(stats.write_calls
+                  < wire->len / initial.write_buf_size / 2);
+
+  /* Read back. */
+  conn = svn_ra_svn_create_conn5(NULL, svn_stream_from_stringbuf(wire, pool),
+                                 svn_stream_empty(pool),
+                                 0, 0, 0, 0, 0, pool);
+  for (i = 0; i < 100000; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_NUMBER);
+      SVN_TEST_ASSERT(item->u.number == (apr_uint64_t)i);
+    }
+
+  SVN_ERR(svn_ra_svn__read_item(conn, pool, &item));
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+  SVN_TEST_ASSERT(item->u.string.len == large->len);
+  SVN_TEST_ASSERT(memcmp(item->u.string.data, large->data, large->len) == 0);
+
+  svn_ra_svn__get_io_stats(&stats, conn);
+  SVN_TEST_ASSERT(stats.bytes_read == wire->len);
+  SVN_TEST_ASSERT(stats.read_buf_size > initial.read_buf_size);
+  SVN_TEST_ASSERT(stats.read_calls < wire->len / initial.read_buf_size / 2);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_svn__command_handler.  Send a long response. */
+static svn_error_t *
+bulk_response(svn_ra_svn_conn_t *conn,
+              apr_pool_t *pool,
+              svn_ra_svn__list_t *params,
+              void *baton)
+{
+  int i;
+
+  for (i = 0; i < 100000; ++i)
+    SVN_ERR(svn_ra_svn__write_number(conn, pool, i));
+
+  return SVN_NO_ERROR;
+}
+
+/* Handle a command that makes both I/O buffers of an ra_svn connection
+   grow and verify that they shrink back afterwards. */
+static svn_error_t *
+ra_svn_buffers_shrink(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  const svn_ra_svn__cmd_entry_t bulk_cmd = { "bulk", bulk_response };
+  svn_stringbuf_t *request = svn_stringbuf_create("( bulk ( ", pool);
+  svn_stringbuf_t *response = svn_stringbuf_create_empty(pool);
+  apr_hash_t *cmd_hash = apr_hash_make(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn__io_stats_t initial, stats;
+  svn_ra_svn__item_t *item;
+  svn_boolean_t terminate;
+  int i;
+
+  /* Many parameters, followed by the next command. */
+  for (i = 0; i < 100000; ++i)
+    svn_stringbuf_appendcstr(request, apr_psprintf(iterpool, "%d ", i));
+  svn_stringbuf_appendcstr(request, ") ) ( next ( ) ) ");
+
+  svn_hash_sets(cmd_hash, bulk_cmd.cmdname, &bulk_cmd);
+  conn = svn_ra_svn_create_conn5(NULL,
+                                 svn_stream_from_stringbuf(request, pool),
+                                 svn_stream_from_stringbuf(response, pool),
+                                 0, 0, 0, 0, 0, pool);
+  svn_ra_svn__get_io_stats(&initial, conn);
+
+  SVN_ERR(svn_ra_svn__handle_command(&terminate, cmd_hash, NULL, conn,
+                                     TRUE, pool));
+  SVN_TEST_ASSERT(!terminate);
+
+  svn_ra_svn__get_io_stats(&stats, conn);
+  SVN_TEST_ASSERT(stats.read_buf_size == initial.read_buf_size);
+  SVN_TEST_ASSERT(stats.write_buf_size == initial.write_buf_size);
+  SVN_TEST_ASSERT(stats.read_calls < request->len / initial.read_buf_size / 2);
+
+  /* Unread input and pending output survived the shrinking. */
+  SVN_ERR(svn_ra_svn__read_item(conn, pool, &item));
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_LIST);
+  SVN_TEST_ASSERT(item->u.list.nelts == 2);
+  item = &SVN_RA_SVN__LIST_ITEM(&item->u.list, 0);
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_WORD);
+  SVN_TEST_STRING_ASSERT(item->u.word.data, "next");
+
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+  conn = svn_ra_svn_create_conn5(NULL,
+                                 svn_stream_from_stringbuf(response, pool),
+                                 svn_stream_empty(pool),
+                                 0, 0, 0, 0, 0, pool);
+  for (i = 0; i < 100000; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_NUMBER);
+      SVN_TEST_ASSERT(item->u.number == (apr_uint64_t)i);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -1820,6 +1963,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "check how last change applies to empty commit"),
     SVN_TEST_OPTS_PASS(commit_locked_file,
                        "check commit editor for a locked file"),
+    SVN_TEST_OPTS_PASS(ra_svn_bulk_io,
+                       "ra_svn buffer sizes for bulk data"),
+    SVN_TEST_OPTS_PASS(ra_svn_buffers_shrink,
+                       "shrink ra_svn I/O buffers after a command"),
     SVN_TEST_NULL
   };
 
@@ -22,12 +22,15 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
 
 #include "svn_pools.h"
+#include "svn_dirent_uri.h"
 
 #include "private/svn_cache.h"
 #include "svn_private_config.h"
@@ -210,7 +213,7 @@ test_membuffer_cache_basic(apr_pool_t *pool)
   svn_membuffer_t *membuffer;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
@@ -268,7 +271,7 @@ test_membuffer_serializer_error_handling(apr_pool_t *pool)
   void *val;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
@@ -300,7 +303,7 @@ test_membuffer_serializer_error_handling(apr_pool_t *pool)
 
   /* Create a new cache. */
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE, pool));
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
                                             membuffer,
                                             serialize_revnum,
@@ -387,7 +390,7 @@ test_membuffer_cache_clearing(apr_pool_t *pool)
 
   /* Create a simple cache for strings, keyed by strings. */
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE, pool));
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
                                             membuffer,
                                             serialize_revnum,
@@ -505,7 +508,7 @@ test_membuffer_unaligned_string_keys(apr_pool_t *pool)
   const char *unaligned_prefix = apr_pstrdup(pool, "_cache:") + 1;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(
@@ -555,7 +558,7 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   const char *unaligned_prefix = apr_pstrdup(pool, "_cache:") + 1;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(
@@ -590,6 +593,423 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_cache__partial_getter_func_t */
+static svn_error_t *
+get_revnum_partial(void **out,
+                   const void *data,
+                   apr_size_t data_len,
+                   void *baton,
+                   apr_pool_t *result_pool)
+{
+  return deserialize_revnum(out, (void *)data, data_len, result_pool);
+}
+
+#if APR_HAS_THREADS
+
+/* Number of different keys used by the concurrent membuffer access test.
+ */
+#define CONCURRENT_KEY_COUNT 256
+
+/* Parameters and result of a single concurrent_access_thread.
+ */
+typedef struct concurrent_access_baton_t
+{
+  /* Cache shared by all threads. */
+  svn_membuffer_t *membuffer;
+
+  /* Number of lookups to do. */
+  int iterations;
+
+  /* Write to the cache every WRITE_INTERVAL lookups.  0 for no writes. */
+  int write_interval;
+
+  /* Error returned by this thread. */
+  svn_error_t *err;
+} concurrent_access_baton_t;
+
+/* Do BATON->ITERATIONS lookups in BATON->MEMBUFFER, alternating between
+ * full and partial gets, and check the values found.  Also write to the
+ * cache as requested by BATON.  Use POOL for allocations.
+ */
+static svn_error_t *
+access_concurrently(concurrent_access_baton_t *baton,
+                    apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Cache front-ends are not thread-safe.  Use a private one. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            baton->membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "concurrent:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  for (i = 0; i < baton->iterations; ++i)
+    {
+      svn_revnum_t key = i % CONCURRENT_KEY_COUNT;
+      svn_revnum_t *value;
+      svn_boolean_t found;
+
+      svn_pool_clear(iterpool);
+
+      if (baton->write_interval && i % baton->write_interval == 0)
+        SVN_ERR(svn_cache__set(cache, &key, &key, iterpool));
+
+      if (i % 2)
+        SVN_ERR(svn_cache__get_partial((void **)&value, &found, cache, &key,
+                                       get_revnum_partial, NULL, iterpool));
+      else
+        SVN_ERR(svn_cache__get((void **)&value, &found, cache, &key,
+                               iterpool));
+
+      /* Entries may get evicted but we must never see wrong contents. */
+      if (found && *value != key)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "expected %ld but found %ld", key, *value);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static void *
+APR_THREAD_FUNC concurrent_access_thread(apr_thread_t *tid, void *data)
+{
+  concurrent_access_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  /* give all threads a good chance to get started by the scheduler */
+  apr_thread_yield();
+
+  baton->err = access_concurrently(baton, pool);
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+#define APR_ERR(expr)                           \
+  do {                                          \
+    apr_status_t status = (expr);               \
+    if (status)                                 \
+      return svn_error_wrap_apr(status, NULL);  \
+  } while (0)
+
+/* Run THREAD_COUNT threads doing ITERATIONS lookups each on MEMBUFFER,
+ * writing every WRITE_INTERVAL lookups.  Report the throughput under
+ * the title DESCRIPTION, if OPTS request verbose output.  Use POOL for
+ * allocations.
+ */
+static svn_error_t *
+run_concurrent_access(svn_membuffer_t *membuffer,
+                      int thread_count,
+                      int iterations,
+                      int write_interval,
+                      const char *description,
+                      const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  apr_thread_t **threads = apr_pcalloc(pool, thread_count * sizeof(*threads));
+  concurrent_access_baton_t *batons
+    = apr_pcalloc(pool, thread_count * sizeof(*batons));
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_time_t start = apr_time_now();
+  apr_time_t duration;
+  int i;
+
+  for (i = 0; i < thread_count; ++i)
+    {
+      batons[i].membuffer = membuffer;
+      batons[i].iterations = iterations;
+      batons[i].write_interval = write_interval;
+      APR_ERR(apr_thread_create(&threads[i], NULL, concurrent_access_thread,
+                                &batons[i], pool));
+    }
+
+  /* wait for the threads to finish */
+  for (i = 0; i < thread_count; ++i)
+    {
+      apr_status_t retval;
+      APR_ERR(apr_thread_join(&retval, threads[i]));
+      APR_ERR(retval);
+
+      err = svn_error_compose_create(err, batons[i].err);
+    }
+
+  SVN_ERR(err);
+
+  duration = apr_time_now() - start;
+  if (opts->verbose && duration > 0)
+    printf("%s, %d threads: %.0f lookups/s\n", description, thread_count,
+           (double)thread_count * iterations * APR_USEC_PER_SEC / duration);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_concurrent_access(const svn_test_opts_t *opts,
+                                 apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  /* Many threads hammering the same cache segment.  Pure lookups should
+   * scale with the number of cores while modifications must never lead
+   * to inconsistent results.  Use --verbose to see the throughput.
+   */
+  enum { THREAD_COUNT = 8, ITERATIONS = 100000 };
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_revnum_t key;
+  int thread_count;
+
+  /* Single segment, i.e. maximum contention. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024,
+                                            128*1024, 1, TRUE, TRUE, FALSE, pool));
+
+  /* Pre-populate the cache. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "concurrent:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+  for (key = 0; key < CONCURRENT_KEY_COUNT; ++key)
+    SVN_ERR(svn_cache__set(cache, &key, &key, pool));
+
+  for (thread_count = 1; thread_count <= THREAD_COUNT; thread_count *= 2)
+    {
+      SVN_ERR(run_concurrent_access(membuffer, thread_count, ITERATIONS, 0,
+                                    "read-only", opts, pool));
+      SVN_ERR(run_concurrent_access(membuffer, thread_count, ITERATIONS, 64,
+                                    "read-mostly", opts, pool));
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_error_t *err;
+  apr_proc_t proc;
+  apr_status_t status;
+  svn_revnum_t key;
+  svn_revnum_t *value;
+  svn_boolean_t found;
+
+  err = svn_cache__membuffer_cache_create(&membuffer, 1024*1024, 64*1024, 0,
+                                          TRUE, TRUE, TRUE, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    {
+      svn_error_clear(err);
+      return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                              "shared membuffer caches not supported");
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "shared:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  /* Let a child process populate the cache. */
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      for (key = 0; key < 100; ++key)
+        {
+          svn_revnum_t data = key * 3;
+          err = svn_cache__set(cache, &key, &data, pool);
+          if (err)
+            exit(1);
+        }
+
+      /* Exit like svnserve and httpd children do, running all pool
+       * cleanups.  This must not tear down the locks of the shared
+       * cache for the parent. */
+      apr_terminate();
+      exit(0);
+    }
+  else if (status == APR_INPARENT)
+    {
+      int exitcode;
+      apr_exit_why_e exitwhy;
+
+      status = apr_proc_wait(&proc, &exitcode, &exitwhy, APR_WAIT);
+      if (status != APR_CHILD_DONE)
+        return svn_error_wrap_apr(status, "apr_proc_wait");
+      SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exitwhy) && exitcode == 0);
+    }
+  else
+    {
+      return svn_error_wrap_apr(status, "apr_proc_fork");
+    }
+
+  /* The parent must see everything the child wrote. */
+  for (key = 0; key < 100; ++key)
+    {
+      SVN_ERR(svn_cache__get((void **)&value, &found, cache, &key, pool));
+      SVN_TEST_ASSERT(found);
+      SVN_TEST_ASSERT(*value == key * 3);
+    }
+
+  /* Writes take the process-shared lock, which must have survived the
+   * exit of the child. */
+  for (key = 100; key < 200; ++key)
+    {
+      svn_revnum_t data = key * 3;
+      SVN_ERR(svn_cache__set(cache, &key, &data, pool));
+    }
+
+  for (key = 0; key < 200; ++key)
+    {
+      SVN_ERR(svn_cache__get((void **)&value, &found, cache, &key, pool));
+      SVN_TEST_ASSERT(found);
+      SVN_TEST_ASSERT(*value == key * 3);
+    }
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "fork() not supported");
+#endif
+}
+
+static svn_error_t *
+test_disk_cache_tier(apr_pool_t *pool)
+{
+  const char *sandbox_dir;
+  svn_cache__disk_t *disk;
+  svn_membuffer_t *membuffer;
+  svn_cache__t *l1;
+  svn_cache__t *cache;
+  svn_revnum_t key;
+  svn_revnum_t *value;
+  svn_boolean_t found;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox_dir, "cache-test-disk", pool));
+  SVN_ERR(svn_cache__disk_open(&disk,
+                               svn_dirent_join(sandbox_dir, "l2-cache",
+                                               pool),
+                               0x100000, pool));
+
+  /* Populate the disk cache through some L1 cache. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 64*1024, 4*1024, 0,
+                                            TRUE, TRUE, FALSE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&l1,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "disk:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__create_disk_tier(&cache, l1, disk,
+                                      serialize_revnum, deserialize_revnum,
+                                      sizeof(svn_revnum_t), "disk:", pool));
+  for (key = 0; key < 1000; ++key)
+    {
+      svn_revnum_t data = key * 7;
+      SVN_ERR(svn_cache__set(cache, &key, &data, pool));
+    }
+
+  /* A fresh L1 cache, as after a restart, must get everything from disk
+   * and keep a copy of it. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 64*1024, 4*1024, 0,
+                                            TRUE, TRUE, FALSE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&l1,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "disk:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__create_disk_tier(&cache, l1, disk,
+                                      serialize_revnum, deserialize_revnum,
+                                      sizeof(svn_revnum_t), "disk:", pool));
+
+  key = 42;
+  SVN_ERR(svn_cache__has_key(&found, l1, &key, pool));
+  SVN_TEST_ASSERT(!found);
+
+  for (key = 0; key < 1000; ++key)
+    {
+      SVN_ERR(svn_cache__get((void **)&value, &found, cache, &key, pool));
+      SVN_TEST_ASSERT(found);
+      SVN_TEST_ASSERT(*value == key * 7);
+    }
+
+  key = 42;
+  SVN_ERR(svn_cache__has_key(&found, l1, &key, pool));
+  SVN_TEST_ASSERT(found);
+
+  /* Entries of other caches in the same file must not match. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+  SVN_ERR(svn_cache__create_disk_tier(&cache, l1, disk,
+                                      serialize_revnum, deserialize_revnum,
+                                      sizeof(svn_revnum_t), "other:", pool));
+  key = 1;
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, &key, pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_disk_cache_size_mismatch(apr_pool_t *pool)
+{
+  const char *sandbox_dir;
+  const char *path;
+  svn_cache__disk_t *disk;
+  apr_finfo_t finfo;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox_dir, "cache-test-disk-size",
+                                    pool));
+  path = svn_dirent_join(sandbox_dir, "l2-cache", pool);
+  SVN_ERR(svn_cache__disk_open(&disk, path, 0x100000, pool));
+
+  /* Another process configured with a different size must neither resize
+   * nor reinitialize the file that is already mapped here. */
+  SVN_TEST_ASSERT_ERROR(svn_cache__disk_open(&disk, path, 0x200000, pool),
+                        SVN_ERR_MALFORMED_FILE);
+  SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size == 0x100000);
+
+  /* Matching configurations still share it. */
+  SVN_ERR(svn_cache__disk_open(&disk, path, 0x100000, pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* The test table.  */
 
@@ -616,6 +1036,15 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_OPTS_SKIP(test_membuffer_concurrent_access,
+                       ! APR_HAS_THREADS,
+                       "test concurrent membuffer cache access"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "test membuffer cache shared between processes"),
+    SVN_TEST_PASS2(test_disk_cache_tier,
+                   "test persistent second-level cache"),
+    SVN_TEST_PASS2(test_disk_cache_size_mismatch,
+                   "test disk cache refuses to resize a shared file"),
     SVN_TEST_NULL
   };
 
@@ -1147,6 +1147,60 @@ test_apr_trunc_workaround(apr_pool_t *pool)
   return SVN_NO_ERROR;  
 }
 
+static svn_error_t *
+test_file_copy_contents(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *src_path;
+  const char *dst_path;
+  apr_file_t *src;
+  apr_file_t *dst;
+  svn_stringbuf_t *expected;
+  svn_stringbuf_t *actual;
+  apr_off_t offset;
+  int i;
+
+  /* create a temp folder & schedule it for automatic cleanup */
+  SVN_ERR(svn_dirent_get_absolute(&tmp_dir, "test_file_copy_contents",
+                                  pool));
+  SVN_ERR(svn_io_remove_dir2(tmp_dir, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(tmp_dir, pool));
+  svn_test_add_dir_cleanup(tmp_dir);
+
+  /* Some content that spans multiple copy buffers. */
+  expected = svn_stringbuf_create_empty(pool);
+  for (i = 0; i < 20000; i++)
+    svn_stringbuf_appendcstr(expected, apr_psprintf(pool, "%d\n", i));
+
+  src_path = svn_dirent_join(tmp_dir, "src", pool);
+  dst_path = svn_dirent_join(tmp_dir, "dst", pool);
+  SVN_ERR(svn_io_file_create_bytes(src_path, expected->data, expected->len,
+                                   pool));
+  SVN_ERR(svn_io_file_create_empty(dst_path, pool));
+
+  /* The current SRC position must not matter. */
+  SVN_ERR(svn_io_file_open(&src, src_path, APR_READ, APR_OS_DEFAULT, pool));
+  offset = 1000;
+  SVN_ERR(svn_io_file_seek(src, APR_SET, &offset, pool));
+
+  SVN_ERR(svn_io_file_open(&dst, dst_path, APR_READ | APR_WRITE,
+                           APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io__file_copy_contents(dst, src, pool));
+
+  /* We should now be positioned at the end of the copied data. */
+  offset = 0;
+  SVN_ERR(svn_io_file_seek(dst, APR_CUR, &offset, pool));
+  SVN_TEST_ASSERT(offset == (apr_off_t)expected->len);
+
+  SVN_ERR(svn_io_file_close(src, pool));
+  SVN_ERR(svn_io_file_close(dst, pool));
+
+  SVN_ERR(svn_stringbuf_from_file2(&actual, dst_path, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 3;
@@ -1184,6 +1238,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_io_open_uniquely_named()"),
     SVN_TEST_PASS2(test_apr_trunc_workaround,
                    "test workaround for APR in svn_io_file_trunc"),
+    SVN_TEST_PASS2(test_file_copy_contents,
+                   "test svn_io__file_copy_contents"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,185 @@
+/*
+ * request-window-test.c:  a collection of svn_request_window__* tests
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ====================================================================
+   To add tests, look toward the bottom of this file.
+
+*/
+
+#include "../svn_test.h"
+
+#include "svn_error.h"
+#include "private/svn_subr_private.h"
+
+/* Window limits as used by ra_serf's update report. */
+#define MIN_WINDOW 40
+#define MAX_WINDOW 160
+
+static svn_error_t *
+test_no_sample(apr_pool_t *pool)
+{
+  /* Without a usable round trip time, nothing changes. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(40, 40, 0, 0,
+                                             MIN_WINDOW, MAX_WINDOW) == 40);
+  SVN_TEST_ASSERT(svn_request_window__adjust(80, 80, -1, 0,
+                                             MIN_WINDOW, MAX_WINDOW) == 80);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_grow(apr_pool_t *pool)
+{
+  /* Requests take no longer than the bare latency: double the window. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(40, 40, 1000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 80);
+
+  /* Less than a quarter of the window queued still counts as idle. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(40, 40, 1200, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 80);
+
+  /* Never beyond the maximum. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(120, 120, 1000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW)
+                  == MAX_WINDOW);
+  SVN_TEST_ASSERT(svn_request_window__adjust(MAX_WINDOW, MAX_WINDOW,
+                                             1000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW)
+                  == MAX_WINDOW);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_grow_unused(apr_pool_t *pool)
+{
+  /* Fast round trips don't justify a larger window if we don't even
+   * use half of the current one. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(80, 40, 1000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 80);
+  SVN_TEST_ASSERT(svn_request_window__adjust(80, 10, 1000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 80);
+  SVN_TEST_ASSERT(svn_request_window__adjust(80, 41, 1000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 160);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_keep(apr_pool_t *pool)
+{
+  /* A third of the window queued: neither grow nor shrink. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(120, 120, 1500, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 120);
+
+  /* Exactly half of the window queued. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(120, 120, 2000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 120);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_shrink(apr_pool_t *pool)
+{
+  /* Three quarters of the window queued: back off by a quarter. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(160, 160, 4000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 120);
+
+  /* The window usage doesn't matter when shrinking. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(160, 20, 4000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW) == 120);
+
+  /* Never below the minimum. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(48, 48, 4000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW)
+                  == MIN_WINDOW);
+  SVN_TEST_ASSERT(svn_request_window__adjust(MIN_WINDOW, MIN_WINDOW,
+                                             4000, 1000,
+                                             MIN_WINDOW, MAX_WINDOW)
+                  == MIN_WINDOW);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_converge(apr_pool_t *pool)
+{
+  unsigned int window = MIN_WINDOW;
+  int i;
+
+  /* On an idle high-latency link, we quickly reach the maximum ... */
+  for (i = 0; i < 3; ++i)
+    window = svn_request_window__adjust(window, window, 1000, 1000,
+                                        MIN_WINDOW, MAX_WINDOW);
+  SVN_TEST_ASSERT(window == MAX_WINDOW);
+
+  /* ... and return to the minimum once the server gets overloaded. */
+  for (i = 0; i < 10; ++i)
+    window = svn_request_window__adjust(window, window, 10000, 1000,
+                                        MIN_WINDOW, MAX_WINDOW);
+  SVN_TEST_ASSERT(window == MIN_WINDOW);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_min_exceeds_max(apr_pool_t *pool)
+{
+  /* With only a few connections, the maximum may be lower than the
+   * minimum.  Never exceed the maximum, then. */
+  SVN_TEST_ASSERT(svn_request_window__adjust(20, 20, 4000, 1000,
+                                             MIN_WINDOW, 16) == 16);
+  SVN_TEST_ASSERT(svn_request_window__adjust(16, 16, 4000, 1000,
+                                             MIN_WINDOW, 16) == 16);
+  SVN_TEST_ASSERT(svn_request_window__adjust(8, 8, 1000, 1000,
+                                             MIN_WINDOW, 16) == 16);
+
+  return SVN_NO_ERROR;
+}
+
+/* An array of all test functions */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_no_sample,
+                   "keep the window without a round trip time"),
+    SVN_TEST_PASS2(test_grow,
+                   "grow the window while latency dominates"),
+    SVN_TEST_PASS2(test_grow_unused,
+                   "don't grow a window that isn't being used"),
+    SVN_TEST_PASS2(test_keep,
+                   "keep the window with moderate queueing"),
+    SVN_TEST_PASS2(test_shrink,
+                   "shrink the window when requests queue up"),
+    SVN_TEST_PASS2(test_converge,
+                   "converge to the window limits"),
+    SVN_TEST_PASS2(test_min_exceeds_max,
+                   "limit the window to the maximum below the minimum"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -0,0 +1,327 @@
+/* ra-serf-xml-bench.c
+ *
+ * Replay captured REPORT (or PROPFIND) response bodies through the XML
+ * parsing machinery of ra_serf, to measure how much time and memory it
+ * spends per element.
+ *
+ * A response body can be captured with e.g.
+ *
+ *   curl -X REPORT -H 'Content-Type: text/xml' --data @request.xml \
+ *        -o update-report.xml http://svn.example.com/repos/!svn/me
+ *
+ * and is then replayed with
+ *
+ *   ra-serf-xml-bench [-n ITERATIONS] [-t any|log] update-report.xml ...
+ *
+ * By default (-t any), every element is pushed through a wildcard
+ * transition table that collects a few common attributes and all cdata,
+ * which resembles the load of the update, log and PROPFIND parsers.
+ * With -t log, a log-report response is parsed with the named
+ * transitions of ra_serf's log parser instead.  Only those let the
+ * parser state refer to the element name in the transition table rather
+ * than copying it, and elements without a transition are skipped.
+ * The tool links against
+ * the private API of libsvn_ra_serf and is not built by default; build it
+ * from a configured tree with
+ *
+ *   libtool --mode=link gcc -o ra-serf-xml-bench \
+ *     -I subversion/include `apr-1-config --includes` -I/path/to/serf \
+ *     tools/dev/ra-serf-xml-bench.c \
+ *     subversion/libsvn_ra_serf/libsvn_ra_serf-1.la \
+ *     subversion/libsvn_subr/libsvn_subr-1.la
+ *
+ * With APR built with pool debugging, the number of bytes allocated per
+ * iteration is reported as well.  Otherwise, run the tool under a heap
+ * profiler (e.g. valgrind --tool=massif) to compare allocations.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stdlib.h>
+
+#include <apr_time.h>
+#include <serf.h>
+
+#include "svn_cmdline.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_sorts.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_xml.h"
+
+#include "../../subversion/libsvn_ra_serf/ra_serf.h"
+
+#include "svn_private_config.h"
+
+enum bench_state_e {
+  INITIAL = XML_STATE_INITIAL,
+  ELEMENT
+};
+
+static const svn_ra_serf__xml_transition_t bench_ttable[] = {
+  { INITIAL, "", "*", ELEMENT,
+    TRUE, { "?name", "?rev", "?revision", "?node-kind", "?action",
+            "?encoding", NULL }, TRUE },
+
+  { ELEMENT, "", "*", ELEMENT,
+    TRUE, { "?name", "?rev", "?revision", "?node-kind", "?action",
+            "?encoding", NULL }, TRUE },
+
+  { 0 }
+};
+
+enum log_state_e {
+  LOG_INITIAL = XML_STATE_INITIAL,
+  LOG_REPORT,
+  LOG_ITEM,
+  LOG_VERSION,
+  LOG_CREATOR,
+  LOG_DATE,
+  LOG_COMMENT,
+  LOG_REVPROP,
+  LOG_HAS_CHILDREN,
+  LOG_ADDED_PATH,
+  LOG_REPLACED_PATH,
+  LOG_DELETED_PATH,
+  LOG_MODIFIED_PATH,
+  LOG_SUBTRACTIVE_MERGE
+};
+
+/* Same as log_ttable in libsvn_ra_serf/log.c. */
+#define D_ "DAV:"
+#define S_ SVN_XML_NAMESPACE
+static const svn_ra_serf__xml_transition_t log_ttable[] = {
+  { LOG_INITIAL, S_, "log-report", LOG_REPORT,
+    FALSE, { NULL }, FALSE },
+
+  { LOG_REPORT, S_, "log-item", LOG_ITEM,
+    FALSE, { NULL }, TRUE },
+
+  { LOG_ITEM, D_, SVN_DAV__VERSION_NAME, LOG_VERSION,
+    TRUE, { NULL }, TRUE },
+
+  { LOG_ITEM, D_, "creator-displayname", LOG_CREATOR,
+    TRUE, { "?encoding", NULL }, TRUE },
+
+  { LOG_ITEM, S_, "date", LOG_DATE,
+    TRUE, { "?encoding", NULL }, TRUE },
+
+  { LOG_ITEM, D_, "comment", LOG_COMMENT,
+    TRUE, { "?encoding", NULL }, TRUE },
+
+  { LOG_ITEM, S_, "revprop", LOG_REVPROP,
+    TRUE, { "name", "?encoding", NULL }, TRUE },
+
+  { LOG_ITEM, S_, "has-children", LOG_HAS_CHILDREN,
+    FALSE, { NULL }, TRUE },
+
+  { LOG_ITEM, S_, "subtractive-merge", LOG_SUBTRACTIVE_MERGE,
+    FALSE, { NULL }, TRUE },
+
+  { LOG_ITEM, S_, "added-path", LOG_ADDED_PATH,
+    TRUE, { "?node-kind", "?text-mods", "?prop-mods",
+            "?copyfrom-path", "?copyfrom-rev", NULL }, TRUE },
+
+  { LOG_ITEM, S_, "replaced-path", LOG_REPLACED_PATH,
+    TRUE, { "?node-kind", "?text-mods", "?prop-mods",
+            "?copyfrom-path", "?copyfrom-rev", NULL }, TRUE },
+
+  { LOG_ITEM, S_, "deleted-path", LOG_DELETED_PATH,
+    TRUE, { "?node-kind", "?text-mods", "?prop-mods", NULL }, TRUE },
+
+  { LOG_ITEM, S_, "modified-path", LOG_MODIFIED_PATH,
+    TRUE, { "?node-kind", "?text-mods", "?prop-mods", NULL }, TRUE },
+
+  { 0 }
+};
+#undef D_
+#undef S_
+
+/* Statistics collected while replaying. */
+typedef struct bench_baton_t
+{
+  apr_int64_t elements;
+} bench_baton_t;
+
+/* Conforms to svn_ra_serf__xml_closed_t  */
+static svn_error_t *
+bench_closed(svn_ra_serf__xml_estate_t *xes,
+             void *baton,
+             int leaving_state,
+             const svn_string_t *cdata,
+             apr_hash_t *attrs,
+             apr_pool_t *scratch_pool)
+{
+  bench_baton_t *bb = baton;
+
+  bb->elements++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse BODY once with the transition table TTABLE, the way a response
+   handler created with svn_ra_serf__create_expat_handler() would, adding
+   statistics to BB.  Use POOL for all allocations. */
+static svn_error_t *
+replay_body(bench_baton_t *bb,
+            const svn_ra_serf__xml_transition_t *ttable,
+            const svn_string_t *body,
+            apr_pool_t *pool)
+{
+  svn_ra_serf__session_t *session;
+  svn_ra_serf__xml_context_t *xmlctx;
+  svn_ra_serf__handler_t *handler;
+  serf_bucket_alloc_t *alloc;
+  serf_bucket_t *response;
+  svn_error_t *err;
+
+  /* The XML handler only needs the session to initialize the handler. */
+  session = apr_pcalloc(pool, sizeof(*session));
+
+  xmlctx = svn_ra_serf__xml_context_create(ttable,
+                                           NULL, bench_closed, NULL,
+                                           bb, pool);
+  handler = svn_ra_serf__create_expat_handler(session, xmlctx, NULL, pool);
+  handler->sline.code = 200;
+
+  alloc = serf_bucket_allocator_create(pool, NULL, NULL);
+  response = serf_bucket_simple_create(body->data, body->len,
+                                       NULL, NULL, alloc);
+
+  err = handler->response_handler(NULL, response, handler->response_baton,
+                                  pool);
+
+  /* The handler reports the end of the body as APR_EOF. */
+  if (err && APR_STATUS_IS_EOF(err->apr_err))
+    {
+      svn_error_clear(err);
+      err = SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Replay the response body in the file PATH ITERATIONS times through
+   TTABLE, and print the results.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+bench_file(const char *path,
+           const svn_ra_serf__xml_transition_t *ttable,
+           int iterations,
+           apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  const svn_string_t *body;
+  bench_baton_t bb = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_time_t start, elapsed;
+  apr_size_t max_bytes = 0;
+  int i;
+
+  SVN_ERR(svn_stringbuf_from_file2(&contents, path, scratch_pool));
+  body = svn_string_ncreate(contents->data, contents->len, scratch_pool);
+
+  start = apr_time_now();
+  for (i = 0; i < iterations; i++)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(replay_body(&bb, ttable, body, iterpool));
+
+#if APR_POOL_DEBUG
+      max_bytes = MAX(max_bytes, apr_pool_num_bytes(iterpool, TRUE));
+#endif
+    }
+  elapsed = apr_time_now() - start;
+  svn_pool_destroy(iterpool);
+
+  /* Avoid dividing by zero for very small bodies. */
+  if (elapsed == 0)
+    elapsed = 1;
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%s: %" APR_SIZE_T_FMT " bytes, "
+                             "%" APR_INT64_T_FMT " elements\n",
+                             svn_dirent_local_style(path, scratch_pool),
+                             body->len, bb.elements / iterations));
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "  %.3f ms per iteration, "
+                             "%.1f MB/s, %.0f elements/s\n",
+                             elapsed / 1000.0 / iterations,
+                             (double)body->len * iterations / elapsed,
+                             (double)bb.elements * APR_USEC_PER_SEC
+                               / elapsed));
+  if (max_bytes)
+    SVN_ERR(svn_cmdline_printf(scratch_pool,
+                               "  at most %" APR_SIZE_T_FMT " bytes "
+                               "allocated per iteration\n", max_bytes));
+
+  return SVN_NO_ERROR;
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err = SVN_NO_ERROR;
+  const svn_ra_serf__xml_transition_t *ttable = bench_ttable;
+  int iterations = 100;
+  int i = 1;
+
+  if (svn_cmdline_init("ra-serf-xml-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  for (; !err && i + 1 < argc && argv[i][0] == '-'; i += 2)
+    {
+      if (strcmp(argv[i], "-n") == 0)
+        {
+          err = svn_cstring_atoi(&iterations, argv[i + 1]);
+          if (!err && iterations < 1)
+            err = svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("The number of iterations must be "
+                                     "positive"));
+        }
+      else if (strcmp(argv[i], "-t") == 0 && strcmp(argv[i + 1], "any") == 0)
+        ttable = bench_ttable;
+      else if (strcmp(argv[i], "-t") == 0 && strcmp(argv[i + 1], "log") == 0)
+        ttable = log_ttable;
+      else
+        break;
+    }
+
+  if (!err && (i >= argc || argv[i][0] == '-'))
+    err = svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                           _("Usage: ra-serf-xml-bench [-n ITERATIONS] "
+                             "[-t any|log] FILE..."));
+
+  for (; !err && i < argc; i++)
+    {
+      const char *path = svn_dirent_internal_style(argv[i], pool);
+
+      err = bench_file(path, ttable, iterations, pool);
+    }
+
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "ra-serf-xml-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}